@@ -83,6 +83,20 @@ static inline uint32_t tfrg_atomic32_store_release(tfrg_atomic32_t* pVar, uint32
 	return tfrg_atomic32_store_relaxed(pVar, val);
 }
 
+static inline uint32_t tfrg_atomic32_add_release(tfrg_atomic32_t* pVar, uint32_t val)
+{
+	tfrg_memorybarrier_release();
+	return tfrg_atomic32_add_relaxed(pVar, val);
+}
+
+static inline uint32_t tfrg_atomic32_add_acq_rel(tfrg_atomic32_t* pVar, uint32_t val)
+{
+	tfrg_memorybarrier_release();
+	uint32_t prev_val = tfrg_atomic32_add_relaxed(pVar, val);
+	tfrg_memorybarrier_acquire();
+	return prev_val;
+}
+
 static inline uint32_t tfrg_atomic32_max_relaxed(tfrg_atomic32_t* dst, uint32_t val)
 {
     uint32_t prev_val = val;
@@ -103,6 +117,20 @@ static inline uint64_t tfrg_atomic64_store_release(tfrg_atomic64_t* pVar, uint64
 	return tfrg_atomic64_store_relaxed(pVar, val);
 }
 
+static inline uint64_t tfrg_atomic64_add_release(tfrg_atomic64_t* pVar, uint64_t val)
+{
+	tfrg_memorybarrier_release();
+	return tfrg_atomic64_add_relaxed(pVar, val);
+}
+
+static inline uint64_t tfrg_atomic64_add_acq_rel(tfrg_atomic64_t* pVar, uint64_t val)
+{
+	tfrg_memorybarrier_release();
+	uint64_t prev_val = tfrg_atomic64_add_relaxed(pVar, val);
+	tfrg_memorybarrier_acquire();
+	return prev_val;
+}
+
 static inline uint64_t tfrg_atomic64_max_relaxed(tfrg_atomic64_t* dst, uint64_t val)
 {
     uint64_t prev_val = val;
@@ -116,6 +144,8 @@ static inline uint64_t tfrg_atomic64_max_relaxed(tfrg_atomic64_t* dst, uint64_t
 	#define tfrg_atomicptr_store_relaxed tfrg_atomic32_store_relaxed
 	#define tfrg_atomicptr_store_release tfrg_atomic32_store_release
 	#define tfrg_atomicptr_add_relaxed tfrg_atomic32_add_relaxed
+	#define tfrg_atomicptr_add_release tfrg_atomic32_add_release
+	#define tfrg_atomicptr_add_acq_rel tfrg_atomic32_add_acq_rel
 	#define tfrg_atomicptr_cas_relaxed tfrg_atomic32_cas_relaxed
 	#define tfrg_atomicptr_max_relaxed tfrg_atomic32_max_relaxed
 #elif PTR_SIZE == 8
@@ -124,6 +154,8 @@ static inline uint64_t tfrg_atomic64_max_relaxed(tfrg_atomic64_t* dst, uint64_t
 	#define tfrg_atomicptr_store_relaxed tfrg_atomic64_store_relaxed
 	#define tfrg_atomicptr_store_release tfrg_atomic64_store_release
 	#define tfrg_atomicptr_add_relaxed tfrg_atomic64_add_relaxed
+	#define tfrg_atomicptr_add_release tfrg_atomic64_add_release
+	#define tfrg_atomicptr_add_acq_rel tfrg_atomic64_add_acq_rel
 	#define tfrg_atomicptr_cas_relaxed tfrg_atomic64_cas_relaxed
 	#define tfrg_atomicptr_max_relaxed tfrg_atomic64_max_relaxed
 #endif
@@ -27,9 +27,13 @@
 #include "../Interfaces/IOperatingSystem.h"
 #include "../Interfaces/IFileSystem.h"
 #include "../Interfaces/ILog.h"
+#include "../Interfaces/IThread.h"
 
 #include "../../Renderer/IRenderer.h"
 
+#include "Atomics.h"
+#include "ThreadSystem.h"
+
 #include "../../ThirdParty/OpenSource/tinyimageformat/tinyimageformat_base.h"
 #include "../../ThirdParty/OpenSource/tinyimageformat/tinyimageformat_query.h"
 #include "../../ThirdParty/OpenSource/tinyimageformat/tinyimageformat_bits.h"
@@ -782,23 +786,144 @@ if (!(exp))                   \
 /************************************************************************/
 // BASIS Loading
 /************************************************************************/
-static bool loadBASISTextureDesc(FileStream* pStream, TextureDesc* pOutDesc, void** ppOutData, uint32_t* pOutDataSize)
+// The global selector codebook is immutable once built, so every transcoder shares one instance
+static basist::etc1_global_selector_codebook* util_get_basis_codebook()
 {
-	if (pStream == NULL || fsGetStreamFileSize(pStream) <= 0)
+	static basist::etc1_global_selector_codebook codebook(basist::g_global_selector_cb_size, basist::g_global_selector_cb);
+	return &codebook;
+}
+
+// Transcoded output cached on disk, the file name is the hash of the .basis file plus the target format
+#define BASIS_CACHE_MAGIC   0x48434254u    // 'TBCH'
+#define BASIS_CACHE_VERSION 1u
+
+struct BasisCacheHeader
+{
+	uint32_t mMagic;
+	uint32_t mVersion;
+	uint32_t mSourceSize;
+	uint32_t mWidth;
+	uint32_t mHeight;
+	uint32_t mMipLevels;
+	uint32_t mArraySize;
+	uint32_t mFormat;
+	uint32_t mDataSize;
+};
+
+static void util_get_basis_cache_name(const void* pBasisData, size_t size, basist::transcoder_texture_format format, char* pOutName)
+{
+	size_t hash = tf_mem_hash<uint32_t>((const uint32_t*)pBasisData, size / sizeof(uint32_t));
+	hash = tf_mem_hash<uint8_t>((const uint8_t*)pBasisData + (size & ~(sizeof(uint32_t) - 1)), size & (sizeof(uint32_t) - 1), hash);
+	sprintf(pOutName, "%08x%08x_%u.basiscache", (uint32_t)hash, (uint32_t)size, (uint32_t)format);
+}
+
+static bool util_load_basis_cache(ResourceDirectory cacheDir, const char* pCacheName, uint32_t sourceSize, TextureDesc* pDesc, void** ppOutData, uint32_t* pOutDataSize)
+{
+	FileStream cacheStream = {};
+	if (!fsOpenStreamFromPath(cacheDir, pCacheName, FM_READ_BINARY, &cacheStream))
+		return false;
+
+	BasisCacheHeader header = {};
+	bool valid = fsReadFromStream(&cacheStream, &header, sizeof(header)) == sizeof(header) &&
+		header.mMagic == BASIS_CACHE_MAGIC && header.mVersion == BASIS_CACHE_VERSION && header.mSourceSize == sourceSize &&
+		header.mWidth == pDesc->mWidth && header.mHeight == pDesc->mHeight && header.mMipLevels == pDesc->mMipLevels &&
+		header.mArraySize == pDesc->mArraySize && header.mFormat == (uint32_t)pDesc->mFormat;
+
+	void* data = NULL;
+	if (valid)
+	{
+		data = tf_malloc(header.mDataSize);
+		valid = fsReadFromStream(&cacheStream, data, header.mDataSize) == header.mDataSize;
+	}
+	fsCloseStream(&cacheStream);
+
+	if (!valid)
+	{
+		tf_free(data);
 		return false;
+	}
+
+	*ppOutData = data;
+	*pOutDataSize = header.mDataSize;
+	return true;
+}
+
+static void util_save_basis_cache(ResourceDirectory cacheDir, const char* pCacheName, uint32_t sourceSize, const TextureDesc* pDesc, const void* pData, uint32_t dataSize)
+{
+	FileStream cacheStream = {};
+	if (!fsOpenStreamFromPath(cacheDir, pCacheName, FM_WRITE_BINARY, &cacheStream))
+	{
+		LOGF(LogLevel::eWARNING, "Failed to write Basis transcode cache %s", pCacheName);
+		return;
+	}
+
+	BasisCacheHeader header = { BASIS_CACHE_MAGIC, BASIS_CACHE_VERSION, sourceSize, pDesc->mWidth, pDesc->mHeight,
+		pDesc->mMipLevels, pDesc->mArraySize, (uint32_t)pDesc->mFormat, dataSize };
+	fsWriteToStream(&cacheStream, &header, sizeof(header));
+	fsWriteToStream(&cacheStream, pData, dataSize);
+	fsCloseStream(&cacheStream);
+}
+
+// One image level of the .basis file, every level is transcoded independently into its own output range
+struct BasisTranscodeLevel
+{
+	uint32_t mImage;
+	uint32_t mLevel;
+	uint32_t mOffset;
+	uint32_t mNumBlocks;
+	uint32_t mRowPitchInBlocks;
+};
+
+struct BasisTranscodeJob
+{
+	const basist::basisu_transcoder*  pDecoder;
+	const void*                       pBasisData;
+	uint32_t                          mBasisDataSize;
+	basist::transcoder_texture_format mFormat;
+	const BasisTranscodeLevel*        pLevels;
+	uint8_t*                          pOutput;
+	tfrg_atomic32_t                   mRemaining;
+	tfrg_atomic32_t                   mFailed;
+};
+
+static void util_transcode_basis_level(void* pUser, uintptr_t index)
+{
+	BasisTranscodeJob* pJob = (BasisTranscodeJob*)pUser;
+	const BasisTranscodeLevel& level = pJob->pLevels[index];
 
-	basist::etc1_global_selector_codebook sel_codebook(basist::g_global_selector_cb_size, basist::g_global_selector_cb);
+	// The transcoder itself is read-only after start_transcoding, the per level state is not
+	basist::basisu_transcoder_state state;
+	if (!pJob->pDecoder->transcode_image_level(pJob->pBasisData, pJob->mBasisDataSize, level.mImage, level.mLevel,
+		pJob->pOutput + level.mOffset, level.mNumBlocks, pJob->mFormat, 0, level.mRowPitchInBlocks, &state))
+	{
+		LOGF(LogLevel::eERROR, "Failed transcoding image level (%u %u)!", level.mImage, level.mLevel);
+		tfrg_atomic32_store_relaxed(&pJob->mFailed, 1);
+	}
+
+	// Publishes the level to the thread waiting for the job
+	tfrg_atomic32_add_release(&pJob->mRemaining, (uint32_t)-1);
+}
+
+// Transcodes all images and mips of the .basis file into ppOutData, laid out slice by slice with all mips of a slice
+// back to back. Levels are transcoded in parallel when pThreadSystem is provided. When cacheDir is a valid directory the
+// transcoded output is read from / written to a cache file there so later loads skip transcoding entirely.
+static bool loadBASISTextureDesc(FileStream* pStream, TextureDesc* pOutDesc, void** ppOutData, uint32_t* pOutDataSize,
+	ThreadSystem* pThreadSystem = NULL, ResourceDirectory cacheDir = RD_COUNT)
+{
+	if (pStream == NULL || fsGetStreamFileSize(pStream) <= 0)
+		return false;
 
 	size_t memSize = (size_t)fsGetStreamFileSize(pStream);
 	void* basisData = tf_malloc(memSize);
 	fsReadFromStream(pStream, basisData, memSize);
 
-	basist::basisu_transcoder decoder(&sel_codebook);
+	basist::basisu_transcoder decoder(util_get_basis_codebook());
 
 	basist::basisu_file_info fileinfo;
 	if (!decoder.get_file_info(basisData, (uint32_t)memSize, fileinfo))
 	{
 		LOGF(LogLevel::eERROR, "Failed retrieving Basis file information!");
+		tf_free(basisData);
 		return false;
 	}
 
@@ -863,73 +988,107 @@ static bool loadBASISTextureDesc(FileStream* pStream, TextureDesc* pOutDesc, voi
 	}
 #endif
 
+	// Second launches read the transcoded output straight from the cache
+	char cacheName[64] = {};
+	if (cacheDir != RD_COUNT)
+	{
+		util_get_basis_cache_name(basisData, memSize, basisTextureFormat, cacheName);
+		if (util_load_basis_cache(cacheDir, cacheName, (uint32_t)memSize, &textureDesc, ppOutData, pOutDataSize))
+		{
+			tf_free(basisData);
+			return true;
+		}
+	}
+
 	decoder.start_transcoding(basisData, (uint32_t)memSize);
 
 	uint32_t requiredSize = util_get_surface_size(textureDesc.mFormat,
 		textureDesc.mWidth, textureDesc.mHeight, textureDesc.mDepth, 1, 1,
 		0, textureDesc.mMipLevels,
 		0, textureDesc.mArraySize);
-	void* startData = tf_malloc(requiredSize);
-	uint8_t* data = (uint8_t*)startData;
 
+	// Gather all image levels with their output ranges up front so they can be transcoded in any order
+	BasisTranscodeLevel* levels = (BasisTranscodeLevel*)tf_malloc(fileinfo.m_total_images * textureDesc.mMipLevels * sizeof(BasisTranscodeLevel));
+	uint32_t levelCount = 0;
+	uint32_t offset = 0;
 	for (uint32_t s = 0; s < fileinfo.m_total_images; ++s)
 	{
 		uint32_t w = textureDesc.mWidth;
 		uint32_t h = textureDesc.mHeight;
-		uint32_t d = textureDesc.mDepth;
 
-		for (uint32_t m = 0; m < fileinfo.m_image_mipmap_levels[s]; ++m)
+		for (uint32_t m = 0; m < min(fileinfo.m_image_mipmap_levels[s], textureDesc.mMipLevels); ++m)
 		{
 			uint32_t rowPitch = 0;
 			uint32_t numBytes = 0;
 			if (!util_get_surface_info(w, h, textureDesc.mFormat, &numBytes, &rowPitch, NULL))
 			{
+				tf_free(levels);
+				tf_free(basisData);
 				return false;
 			}
 
-			uint32_t rowPitchInBlocks = rowPitch / (TinyImageFormat_BitSizeOfBlock(textureDesc.mFormat) >> 3);
 			basist::basisu_image_level_info level_info;
-
 			if (!decoder.get_image_level_info(basisData, (uint32_t)memSize, level_info, s, m))
 			{
 				LOGF(LogLevel::eERROR, "Failed retrieving image level information (%u %u)!\n", s, m);
+				tf_free(levels);
 				tf_free(basisData);
-				tf_free(startData);
-				return false;
-			}
-
-			if (!decoder.transcode_image_level(basisData, (uint32_t)memSize, s, m, data,
-				(uint32_t)(rowPitchInBlocks * imageinfo.m_num_blocks_y), basisTextureFormat, 0, rowPitchInBlocks))
-			{
-				LOGF(LogLevel::eERROR, "Failed transcoding image level (%u %u)!", s, m);
-				tf_free(basisData);
-				tf_free(startData);
 				return false;
 			}
 
-			data += numBytes;
+			const uint32_t blockSize = TinyImageFormat_BitSizeOfBlock(textureDesc.mFormat) >> 3;
+			BasisTranscodeLevel& level = levels[levelCount++];
+			level.mImage = s;
+			level.mLevel = m;
+			level.mOffset = offset;
+			level.mNumBlocks = numBytes / blockSize;
+			level.mRowPitchInBlocks = rowPitch / blockSize;
+
+			offset += numBytes;
+			w = max(w >> 1, 1u);
+			h = max(h >> 1, 1u);
+		}
+	}
 
-			w = w >> 1;
-			h = h >> 1;
-			d = d >> 1;
-			if (w == 0)
-			{
-				w = 1;
-			}
-			if (h == 0)
-			{
-				h = 1;
-			}
-			if (d == 0)
-			{
-				d = 1;
-			}
+	BasisTranscodeJob job = {};
+	job.pDecoder = &decoder;
+	job.pBasisData = basisData;
+	job.mBasisDataSize = (uint32_t)memSize;
+	job.mFormat = basisTextureFormat;
+	job.pLevels = levels;
+	job.pOutput = (uint8_t*)tf_malloc(requiredSize);
+	job.mRemaining = levelCount;
+	job.mFailed = 0;
+
+	if (pThreadSystem && levelCount > 1)
+	{
+		addThreadSystemRangeTask(pThreadSystem, util_transcode_basis_level, &job, levelCount);
+		// Help with the levels instead of blocking the calling thread
+		while (tfrg_atomic32_load_acquire(&job.mRemaining))
+		{
+			if (!assistThreadSystem(pThreadSystem))
+				Thread::Sleep(0);
 		}
 	}
+	else
+	{
+		for (uint32_t i = 0; i < levelCount; ++i)
+			util_transcode_basis_level(&job, i);
+	}
 
+	tf_free(levels);
 	tf_free(basisData);
 
-	*ppOutData = startData;
+	if (tfrg_atomic32_load_relaxed(&job.mFailed))
+	{
+		tf_free(job.pOutput);
+		return false;
+	}
+
+	if (cacheDir != RD_COUNT)
+		util_save_basis_cache(cacheDir, cacheName, (uint32_t)memSize, &textureDesc, job.pOutput, requiredSize);
+
+	*ppOutData = job.pOutput;
 	*pOutDataSize = requiredSize;
 
 	return true;
@@ -937,17 +1096,190 @@ static bool loadBASISTextureDesc(FileStream* pStream, TextureDesc* pOutDesc, voi
 /************************************************************************/
 // SVT Loading
 /************************************************************************/
+#define SVT_MAGIC 0x32545653u    // "SVT2"
+#define SVT_VERSION 2
+
+typedef enum SVTPageCompression
+{
+	SVT_PAGE_COMPRESSION_NONE = 0,
+	// Byte oriented LZ77 in the LZ4 block layout, see util_compress_svt_page
+	SVT_PAGE_COMPRESSION_LZ = 1,
+} SVTPageCompression;
+
+// The header is followed by mPageCount + 2 file offsets (uint64_t): one per tiled page, the start of the mip tail
+// and the end of the data. Pages are stored mip by mip, row by row, each one either compressed or as is when its
+// stored size equals the uncompressed size. Files from before the offset table only hold the first five fields.
 struct SVT_HEADER
 {
+	uint32_t mMagic;
+	uint32_t mVersion;
 	uint32_t mWidth;
 	uint32_t mHeight;
 	uint32_t mMipLevels;
 	uint32_t mPageSize;
 	uint32_t mComponentCount;
+	uint32_t mCompression;
+	uint32_t mTiledMipCount;
+	uint32_t mPageCount;
 };
 
+#define SVT_LZ_MIN_MATCH 4
+#define SVT_LZ_HASH_BITS 12
+
+static uint32_t util_write_svt_lz_length(uint8_t* pDst, uint32_t length)
+{
+	if (length < 15)
+		return 0;
+
+	uint32_t written = 0;
+	for (length -= 15; length >= 255; length -= 255)
+		pDst[written++] = 255;
+	pDst[written++] = (uint8_t)length;
+	return written;
+}
+
+static bool util_read_svt_lz_length(const uint8_t* pSrc, uint32_t srcSize, uint32_t* pSrcOffset, uint32_t* pLength)
+{
+	if (*pLength != 15)
+		return true;
+
+	uint8_t byte = 0;
+	do
+	{
+		if (*pSrcOffset >= srcSize)
+			return false;
+		byte = pSrc[(*pSrcOffset)++];
+		*pLength += byte;
+	} while (byte == 255);
+
+	return true;
+}
+
+static bool util_write_svt_lz_sequence(
+	const uint8_t* pLiterals, uint32_t literalLength, uint32_t offset, uint32_t matchLength, uint8_t* pDst, uint32_t dstCapacity,
+	uint32_t* pDstOffset)
+{
+	// Token, literal length, literals, match offset and match length in the worst case
+	uint32_t dst = *pDstOffset;
+	if (dst + 1 + (literalLength / 255 + 1) + literalLength + 2 + (matchLength / 255 + 1) > dstCapacity)
+		return false;
+
+	const uint32_t matchCode = matchLength ? matchLength - SVT_LZ_MIN_MATCH : 0;
+	pDst[dst++] = (uint8_t)((min(literalLength, 15u) << 4) | min(matchCode, 15u));
+	dst += util_write_svt_lz_length(pDst + dst, literalLength);
+	memcpy(pDst + dst, pLiterals, literalLength);
+	dst += literalLength;
+
+	if (matchLength)
+	{
+		pDst[dst++] = (uint8_t)(offset & 0xFF);
+		pDst[dst++] = (uint8_t)(offset >> 8);
+		dst += util_write_svt_lz_length(pDst + dst, matchCode);
+	}
+
+	*pDstOffset = dst;
+	return true;
+}
+
+// Greedy single probe compressor, fast enough to run on every page of a 16K texture. Returns 0 if the
+// result does not fit into dstCapacity, the page is stored as is in that case.
+static uint32_t util_compress_svt_page(const uint8_t* pSrc, uint32_t srcSize, uint8_t* pDst, uint32_t dstCapacity)
+{
+	uint32_t hashTable[1 << SVT_LZ_HASH_BITS];
+	memset(hashTable, 0xFF, sizeof(hashTable));
+
+	uint32_t src = 0;
+	uint32_t literalStart = 0;
+	uint32_t dst = 0;
+	while (src + SVT_LZ_MIN_MATCH <= srcSize)
+	{
+		uint32_t sequence = 0;
+		memcpy(&sequence, pSrc + src, sizeof(sequence));
+		const uint32_t hash = (sequence * 2654435761u) >> (32 - SVT_LZ_HASH_BITS);
+		const uint32_t candidate = hashTable[hash];
+		hashTable[hash] = src;
+
+		uint32_t candidateSequence = 0;
+		if (candidate != UINT32_MAX && src - candidate <= 0xFFFF)
+			memcpy(&candidateSequence, pSrc + candidate, sizeof(candidateSequence));
+
+		if (candidate == UINT32_MAX || src - candidate > 0xFFFF || candidateSequence != sequence)
+		{
+			++src;
+			continue;
+		}
+
+		uint32_t matchLength = SVT_LZ_MIN_MATCH;
+		while (src + matchLength < srcSize && pSrc[candidate + matchLength] == pSrc[src + matchLength])
+			++matchLength;
+
+		if (!util_write_svt_lz_sequence(pSrc + literalStart, src - literalStart, src - candidate, matchLength, pDst, dstCapacity, &dst))
+			return 0;
+
+		src += matchLength;
+		literalStart = src;
+	}
+
+	// The last sequence only holds literals
+	if (!util_write_svt_lz_sequence(pSrc + literalStart, srcSize - literalStart, 0, 0, pDst, dstCapacity, &dst))
+		return 0;
+
+	return dst;
+}
+
+static bool util_decompress_svt_page(const uint8_t* pSrc, uint32_t srcSize, uint8_t* pDst, uint32_t dstSize)
+{
+	uint32_t src = 0;
+	uint32_t dst = 0;
+	while (src < srcSize)
+	{
+		const uint8_t token = pSrc[src++];
+
+		uint32_t literalLength = token >> 4;
+		if (!util_read_svt_lz_length(pSrc, srcSize, &src, &literalLength))
+			return false;
+		if (src + literalLength > srcSize || dst + literalLength > dstSize)
+			return false;
+
+		memcpy(pDst + dst, pSrc + src, literalLength);
+		src += literalLength;
+		dst += literalLength;
+
+		if (src == srcSize)
+			break;
+
+		if (src + 2 > srcSize)
+			return false;
+		const uint32_t offset = pSrc[src] | ((uint32_t)pSrc[src + 1] << 8);
+		src += 2;
+
+		uint32_t matchLength = token & 0xF;
+		if (!util_read_svt_lz_length(pSrc, srcSize, &src, &matchLength))
+			return false;
+		matchLength += SVT_LZ_MIN_MATCH;
+		if (offset == 0 || offset > dst || dst + matchLength > dstSize)
+			return false;
+
+		// Matches may overlap the bytes they produce
+		const uint8_t* pMatch = pDst + dst - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(pDst + dst, pMatch, matchLength);
+		}
+		else
+		{
+			for (uint32_t i = 0; i < matchLength; ++i)
+				pDst[dst + i] = pMatch[i];
+		}
+		dst += matchLength;
+	}
+
+	return dst == dstSize;
+}
+
 #if defined(DIRECT3D12) || defined(VULKAN)
-static bool loadSVTTextureDesc(FileStream* pStream, TextureDesc* pOutDesc)
+// Reads the header and the page offset table. The table is allocated with tf_malloc and owned by the caller.
+static bool loadSVTTextureDesc(FileStream* pStream, TextureDesc* pOutDesc, SVT_HEADER* pOutHeader, uint64_t** ppOutPageOffsets)
 {
 #define RETURN_IF_FAILED(exp) \
 if (!(exp))                   \
@@ -958,13 +1290,53 @@ if (!(exp))                   \
 	RETURN_IF_FAILED(pStream);
 
 	ssize_t svtDataSize = fsGetStreamFileSize(pStream);
-	RETURN_IF_FAILED(svtDataSize <= UINT32_MAX);
 	RETURN_IF_FAILED((svtDataSize > (sizeof(SVT_HEADER))));
 
 	SVT_HEADER header = {};
 	ssize_t bytesRead = fsReadFromStream(pStream, &header, sizeof(SVT_HEADER));
 	RETURN_IF_FAILED(bytesRead == sizeof(SVT_HEADER));
 
+	uint64_t* pPageOffsets = NULL;
+	if (header.mMagic == SVT_MAGIC)
+	{
+		RETURN_IF_FAILED(header.mVersion == SVT_VERSION);
+		RETURN_IF_FAILED(header.mCompression <= SVT_PAGE_COMPRESSION_LZ);
+
+		const size_t tableSize = (header.mPageCount + 2) * sizeof(uint64_t);
+		pPageOffsets = (uint64_t*)tf_malloc(tableSize);
+		if (fsReadFromStream(pStream, pPageOffsets, tableSize) != tableSize || pPageOffsets[header.mPageCount + 1] > (uint64_t)svtDataSize)
+		{
+			tf_free(pPageOffsets);
+			return false;
+		}
+	}
+	else
+	{
+		// Tightly packed raw pages right after the five field header of the first version
+		uint32_t legacyHeader[5] = {};
+		memcpy(legacyHeader, &header, sizeof(legacyHeader));
+		header.mWidth = legacyHeader[0];
+		header.mHeight = legacyHeader[1];
+		header.mMipLevels = legacyHeader[2];
+		header.mPageSize = legacyHeader[3];
+		header.mComponentCount = legacyHeader[4];
+		header.mMagic = 0;
+		header.mVersion = 1;
+		header.mCompression = SVT_PAGE_COMPRESSION_NONE;
+		RETURN_IF_FAILED(header.mPageSize && header.mMipLevels);
+
+		header.mTiledMipCount = header.mMipLevels - (uint32_t)log2f((float)header.mPageSize);
+		header.mPageCount = 0;
+		for (uint32_t mip = 0; mip < header.mTiledMipCount; ++mip)
+			header.mPageCount += ((header.mWidth >> mip) / header.mPageSize) * ((header.mHeight >> mip) / header.mPageSize);
+
+		const uint64_t pageBytes = (uint64_t)header.mPageSize * header.mPageSize * header.mComponentCount;
+		pPageOffsets = (uint64_t*)tf_malloc((header.mPageCount + 2) * sizeof(uint64_t));
+		for (uint32_t page = 0; page <= header.mPageCount; ++page)
+			pPageOffsets[page] = 5 * sizeof(uint32_t) + page * pageBytes;
+		pPageOffsets[header.mPageCount + 1] = (uint64_t)svtDataSize;
+	}
+
 	TextureDesc& textureDesc = *pOutDesc;
 	textureDesc.mWidth = header.mWidth;
 	textureDesc.mHeight = header.mHeight;
@@ -975,6 +1347,9 @@ if (!(exp))                   \
 	textureDesc.mSampleCount = SAMPLE_COUNT_1;
 	textureDesc.mFormat = TinyImageFormat_R8G8B8A8_UNORM;
 
+	*pOutHeader = header;
+	*ppOutPageOffsets = pPageOffsets;
+
 	return true;
 }
 #endif
@@ -38,8 +38,8 @@ struct ThreadedTask
 
 struct ThreadSystem
 {
-	ThreadDesc                 mThreadDescs[MAX_LOAD_THREADS];
-	ThreadHandle               mThread[MAX_LOAD_THREADS];
+	ThreadDesc                 mThreadDescs[MAX_SYSTEM_THREADS];
+	ThreadHandle               mThread[MAX_SYSTEM_THREADS];
 	ThreadedTask			   mLoadTask[MAX_SYSTEM_TASKS];
 	uint32_t				   mBegin, mEnd;
 	ConditionVariable          mQueueCond;
@@ -50,7 +50,7 @@ struct ThreadSystem
 	volatile bool              mRun;
 
 #if defined(NX64)
-	ThreadTypeNX			   mThreadType[MAX_LOAD_THREADS];
+	ThreadTypeNX			   mThreadType[MAX_SYSTEM_THREADS];
 #endif
 };
 
@@ -179,7 +179,7 @@ void initThreadSystem(ThreadSystem** ppThreadSystem, uint32_t numRequestedThread
 	ThreadSystem* pThreadSystem = tf_new(ThreadSystem);
 
 	uint32_t numThreads = max<uint32_t>(Thread::GetNumCPUCores() - 1, 1);
-	uint32_t numLoaders = min<uint32_t>(numThreads, min<uint32_t>(numRequestedThreads, MAX_LOAD_THREADS));
+	uint32_t numLoaders = min<uint32_t>(numThreads, min<uint32_t>(numRequestedThreads, MAX_SYSTEM_THREADS));
 
 	pThreadSystem->mQueueMutex.Init();
 	pThreadSystem->mQueueCond.Init();
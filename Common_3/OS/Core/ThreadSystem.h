@@ -42,6 +42,7 @@ static void memberTaskFunc0(void* userData, size_t)
 enum
 {
 	MAX_LOAD_THREADS = 16,
+	MAX_SYSTEM_THREADS = 64,
 	MAX_SYSTEM_TASKS = 128
 };
 
@@ -29,6 +29,12 @@
 
 bool PlatformOpenFile(ResourceDirectory resourceDir, const char* fileName, FileMode mode, FileStream* pOut);
 
+#if (defined(_WINDOWS) && !defined(XBOX)) || defined(__linux__) || defined(__APPLE__) || defined(__ANDROID__)
+#define ENABLE_PLATFORM_MAPPED_FILES
+bool PlatformMapFile(ResourceDirectory resourceDir, const char* fileName, MappedFile* pOut);
+void PlatformUnmapFile(MappedFile* pFile);
+#endif
+
 typedef struct ResourceDirectoryInfo
 {
 	IFileSystem* pIO;
@@ -305,6 +311,56 @@ bool fsOpenStreamFromPath(const ResourceDirectory resourceDir, const char* fileN
 	return io->Open(io, resourceDir, fileName, mode, pOut);
 }
 
+bool fsMapFileFromPath(const ResourceDirectory resourceDir, const char* fileName, MappedFile* pOut)
+{
+	*pOut = {};
+
+#if defined(ENABLE_PLATFORM_MAPPED_FILES)
+	// Only plain files on disk can be mapped, bundled and archived files go through their IO
+	const ResourceDirectoryInfo* dir = &gResourceDirectories[resourceDir];
+	if (dir->pIO == pSystemFileIO && !dir->mBundled && PlatformMapFile(resourceDir, fileName, pOut))
+		return true;
+#endif
+
+	FileStream file = {};
+	if (!fsOpenStreamFromPath(resourceDir, fileName, FM_READ_BINARY, &file))
+		return false;
+
+	const ssize_t size = fsGetStreamFileSize(&file);
+	if (size < 0)
+	{
+		fsCloseStream(&file);
+		return false;
+	}
+
+	void* data = tf_memalign(16, max((size_t)size, (size_t)1));
+	const size_t bytesRead = fsReadFromStream(&file, data, (size_t)size);
+	fsCloseStream(&file);
+
+	if (bytesRead != (size_t)size)
+	{
+		LOGF(LogLevel::eERROR, "Failed to read %s", fileName);
+		tf_free(data);
+		return false;
+	}
+
+	pOut->pData = data;
+	pOut->mSize = (size_t)size;
+	return true;
+}
+
+void fsUnmapFile(MappedFile* pFile)
+{
+#if defined(ENABLE_PLATFORM_MAPPED_FILES)
+	if (pFile->pHandle)
+		PlatformUnmapFile(pFile);
+	else
+#endif
+		tf_free(pFile->pData);
+
+	*pFile = {};
+}
+
 /// Closes and invalidates the file stream.
 bool fsCloseStream(FileStream* pStream)
 {
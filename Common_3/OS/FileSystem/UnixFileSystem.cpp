@@ -23,6 +23,8 @@
 */
 
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -110,6 +112,41 @@ bool UnixOpenFile(ResourceDirectory resourceDir, const char* fileName, FileMode
 	return true;
 }
 
+bool PlatformMapFile(ResourceDirectory resourceDir, const char* fileName, MappedFile* pOut)
+{
+	const char* resourcePath = fsGetResourceDirectory(resourceDir);
+	char filePath[FS_MAX_PATH] = {};
+	fsAppendPathComponent(resourcePath, fileName, filePath);
+
+	int fd = open(filePath, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat fileInfo = {};
+	if (fstat(fd, &fileInfo) != 0 || fileInfo.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// Private writable mapping, pages are only copied when written to
+	void* data = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	// The mapping keeps its own reference to the file
+	close(fd);
+	if (data == MAP_FAILED)
+		return false;
+
+	pOut->pData = data;
+	pOut->mSize = (size_t)fileInfo.st_size;
+	pOut->pHandle = data;
+	return true;
+}
+
+void PlatformUnmapFile(MappedFile* pFile)
+{
+	munmap(pFile->pData, pFile->mSize);
+}
+
 #if !defined(__ANDROID__)
 bool PlatformOpenFile(ResourceDirectory resourceDir, const char* fileName, FileMode mode, FileStream* pOut)
 {
@@ -148,6 +148,14 @@ typedef struct FileStream
 	FileMode          mMode;
 } FileStream;
 
+typedef struct MappedFile
+{
+	void*  pData;
+	size_t mSize;
+	// Platform mapping handle, NULL when pData is an allocated copy of the file
+	void*  pHandle;
+} MappedFile;
+
 typedef struct FileSystemInitDesc
 {
 	const char* pAppName;
@@ -215,6 +223,14 @@ bool fsFlushStream(FileStream* stream);
 
 /// Returns whether the current seek position is at the end of the file stream.
 bool fsStreamAtEnd(const FileStream* stream);
+
+/// Maps the whole file at `fileName` into memory, returning its contents in pOut->pData which must be released with `fsUnmapFile`.
+/// The mapping is copy-on-write: pages can be modified in place, changes are private and never reach the file.
+/// Files that cannot be mapped (bundled, archived or custom IO) are read into a 16 byte aligned buffer instead.
+bool fsMapFileFromPath(const ResourceDirectory resourceDir, const char* fileName, MappedFile* pOut);
+
+/// Releases a file mapped with `fsMapFileFromPath`.
+void fsUnmapFile(MappedFile* pFile);
 /************************************************************************/
 // MARK: - Minor filename manipulation
 /************************************************************************/
@@ -214,3 +214,55 @@ bool PlatformOpenFile(ResourceDirectory resourceDir, const char* fileName, FileM
 
 	return false;
 }
+
+#ifndef XBOX
+bool PlatformMapFile(ResourceDirectory resourceDir, const char* fileName, MappedFile* pOut)
+{
+	const char* resourcePath = fsGetResourceDirectory(resourceDir);
+	char filePath[FS_MAX_PATH] = {};
+	fsAppendPathComponent(resourcePath, fileName, filePath);
+
+	// Path utf-16 conversion
+	size_t filePathLen = strlen(filePath);
+	wchar_t* pathStr = (wchar_t*)alloca((filePathLen + 1) * sizeof(wchar_t));
+	size_t pathStrLength =
+		MultiByteToWideChar(CP_UTF8, 0, filePath, (int)filePathLen, pathStr, (int)filePathLen);
+	pathStr[pathStrLength] = 0;
+
+	HANDLE file = CreateFileW(pathStr, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	// Copy-on-write mapping, pages are only copied when written to
+	HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	// The mapping keeps its own reference to the file
+	CloseHandle(file);
+	if (!mapping)
+		return false;
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+
+	pOut->pData = data;
+	pOut->mSize = (size_t)fileSize.QuadPart;
+	pOut->pHandle = mapping;
+	return true;
+}
+
+void PlatformUnmapFile(MappedFile* pFile)
+{
+	UnmapViewOfFile(pFile->pData);
+	CloseHandle((HANDLE)pFile->pHandle);
+}
+#endif
@@ -94,6 +94,9 @@
 #define D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN ((D3D12_GPU_VIRTUAL_ADDRESS)-1)
 
 extern void d3d12_createShaderReflection(const uint8_t* shaderCode, uint32_t shaderSize, ShaderStage shaderStage, ShaderReflection* pOutReflection);
+extern void initVirtualTexturePageCache(VirtualTexture* pSvt, uint32_t width, uint32_t height, uint32_t tiledMipCount);
+extern bool readVirtualTexturePage(VirtualTexture* pSvt, uint32_t pageIndex, void* pDst);
+extern void removeVirtualTexturePageCache(VirtualTexture* pSvt);
 
 //stubs for durango because Direct3D12Raytracing.cpp is not used on XBOX
 #if defined(ENABLE_RAYTRACING)
@@ -6143,15 +6146,22 @@ void fillVirtualTexture(Cmd* pCmd, Texture* pTexture, Fence* pFence)
 
 		if (allocateVirtualPage(pRenderer, pTexture, *pPage))
 		{
-			void* pData = (void*)((unsigned char*)pTexture->pSvt->mVirtualImageData + (pageIndex * pPage->size));
-
 			map = !pPage->pIntermediateBuffer->pCpuMappedAddress;
 			if (map)
 			{
 				mapBuffer(pRenderer, pPage->pIntermediateBuffer, NULL);
 			}
 
-			memcpy(pPage->pIntermediateBuffer->pCpuMappedAddress, pData, pPage->size);
+			if (!readVirtualTexturePage(pTexture->pSvt, pageIndex, pPage->pIntermediateBuffer->pCpuMappedAddress))
+			{
+				// Stays unbacked so the page is requested again
+				if (map)
+				{
+					unmapBuffer(pRenderer, pPage->pIntermediateBuffer);
+				}
+				releaseVirtualPage(pRenderer, *pPage, true);
+				continue;
+			}
 
 
 			D3D12_TILED_RESOURCE_COORDINATE startCoord;
@@ -6238,8 +6248,6 @@ void fillVirtualTextureLevel(Cmd* pCmd, Texture* pTexture, uint32_t mipLevel)
 		{
 			if (allocateVirtualPage(renderer, pTexture, *pPage))
 			{
-				void* pData = (void*)((unsigned char*)pTexture->pSvt->mVirtualImageData + (pageIndex * (uint32_t)pPage->size));
-
 				//CPU to GPU
 				bool map = !pPage->pIntermediateBuffer->pCpuMappedAddress;
 				if (map)
@@ -6247,7 +6255,16 @@ void fillVirtualTextureLevel(Cmd* pCmd, Texture* pTexture, uint32_t mipLevel)
 					mapBuffer(renderer, pPage->pIntermediateBuffer, NULL);
 				}
 
-				memcpy(pPage->pIntermediateBuffer->pCpuMappedAddress, pData, pPage->size);
+				if (!readVirtualTexturePage(pTexture->pSvt, pageIndex, pPage->pIntermediateBuffer->pCpuMappedAddress))
+				{
+					// Stays unbacked so the level is filled again
+					if (map)
+					{
+						unmapBuffer(renderer, pPage->pIntermediateBuffer);
+					}
+					releaseVirtualPage(renderer, *pPage, true);
+					continue;
+				}
 
 				D3D12_TILED_RESOURCE_COORDINATE startCoord;
 				startCoord.X = pPage->offset.X / (uint)pTexture->pSvt->mSparseVirtualTexturePageWidth;
@@ -6309,7 +6326,7 @@ void fillVirtualTextureLevel(Cmd* pCmd, Texture* pTexture, uint32_t mipLevel)
 	tileCounts.set_capacity(0);
 }
 
-void addVirtualTexture(Cmd* pCmd, const TextureDesc * pDesc, Texture ** ppTexture, void* pImageData)
+void addVirtualTexture(Cmd* pCmd, const TextureDesc * pDesc, Texture ** ppTexture, void* pPageCache)
 {
 	ASSERT(pCmd);
 	Texture* pTexture = (Texture*)tf_calloc_memalign(1, alignof(Texture), sizeof(*pTexture) + sizeof(VirtualTexture));
@@ -6328,7 +6345,7 @@ void addVirtualTexture(Cmd* pCmd, const TextureDesc * pDesc, Texture ** ppTextur
 		mipSize /= 4;
 	}
 
-	pTexture->pSvt->mVirtualImageData = pImageData;
+	pTexture->pSvt->pPageCache = pPageCache;
 
 	//add to gpu
 	D3D12_RESOURCE_DESC desc = {};
@@ -6378,6 +6395,7 @@ void addVirtualTexture(Cmd* pCmd, const TextureDesc * pDesc, Texture ** ppTextur
 	tf_placement_new<decltype(pTexture->pSvt->pHeapRangeStartOffsets)>(pTexture->pSvt->pHeapRangeStartOffsets);
 
 	uint32_t TiledMiplevel = pDesc->mMipLevels - (uint32_t)log2(min((uint32_t)pTexture->pSvt->mSparseVirtualTexturePageWidth, (uint32_t)pTexture->pSvt->mSparseVirtualTexturePageHeight));
+	initVirtualTexturePageCache(pTexture->pSvt, pDesc->mWidth, pDesc->mHeight, TiledMiplevel);
 
 	// Sparse bindings for each mip level of all layers outside of the mip tail
 	for (uint32_t layer = 0; layer < 1; layer++)
@@ -6515,8 +6533,7 @@ void removeVirtualTexture(Renderer* pRenderer, VirtualTexture* pSvt)
 	if (pSvt->mPageCounts)
 		removeBuffer(pRenderer, pSvt->mPageCounts);
 
-	if (pSvt->mVirtualImageData)
-		tf_free(pSvt->mVirtualImageData);
+	removeVirtualTexturePageCache(pSvt);
 }
 
 void cmdUpdateVirtualTexture(Cmd* cmd, Texture* pTexture)
@@ -1025,8 +1025,8 @@ typedef struct VirtualTexture
 	Buffer*  mRemovePage;
 	/// a { uint alive; uint remove; } count of pages which are alive or should be removed
 	Buffer*  mPageCounts;
-	/// Original Pixel image data
-	void*    mVirtualImageData;
+	/// Disk backed cache of the page data, pages are read from the svt file on demand
+	void*    pPageCache;
 	///  Total pages count
 	uint32_t mVirtualPageTotalCount;
 	/// Sparse Virtual Texture Width
@@ -66,6 +66,15 @@ typedef struct BufferLoadDesc
 	bool        mForceReset;
 } BufferLoadDesc;
 
+/// Residency of a texture loaded with mip streaming. Written by the resource loader, read by the app
+typedef struct TextureResidency
+{
+	/// Most detailed mip level with resident data. Clamp the min LOD of the texture to this level until it reaches 0
+	volatile uint32_t    mResidentMip;
+	/// Number of mip levels of the texture
+	uint32_t             mMipLevels;
+} TextureResidency;
+
 typedef struct TextureLoadDesc
 {
 	Texture**            ppTexture;
@@ -79,6 +88,9 @@ typedef struct TextureLoadDesc
 	TextureCreationFlags mCreationFlag;
 	/// The texture file format (dds/ktx/...)
 	TextureContainerType mContainer;
+	/// Stream the mip chain (dds/ktx only). The token completes once the mip tail is resident, the higher mips
+	/// are uploaded over the following frames under the loader streaming budget (see updateTextureStreaming)
+	TextureResidency*    pResidency;
 } TextureLoadDesc;
 
 typedef struct Geometry
@@ -95,6 +107,29 @@ typedef struct Geometry
 		void*                   pAttributes[MAX_VERTEX_ATTRIBS];
 	};
 
+	struct Lod
+	{
+		/// Index range of this level in the index buffer
+		uint32_t                mStartIndex;
+		uint32_t                mIndexCount;
+		/// Max object space deviation from the full detail mesh
+		float                   mError;
+	};
+
+	struct Cluster
+	{
+		/// Triangle range of this cluster relative to the start of its draw arg
+		uint32_t                mTriangleStart;
+		uint32_t                mTriangleCount;
+		/// Object space bounding box
+		float                   mAabbMin[3];
+		float                   mAabbMax[3];
+		/// Backface cone, all triangles face away from the eye when dot(normalize(mConeApex - eye), mConeAxis) >= mConeCutoff
+		float                   mConeApex[3];
+		float                   mConeAxis[3];
+		float                   mConeCutoff;
+	};
+
 	/// Index buffer to bind when drawing this geometry
 	Buffer*                     pIndexBuffer;
 	/// The array of vertex buffers to bind when drawing this geometry
@@ -103,6 +138,11 @@ typedef struct Geometry
 	IndirectDrawIndexArguments* pDrawArgs;
 	/// Shadow copy of the geometry vertex and index data if requested through the load flags
 	ShadowData*                 pShadow;
+	/// The array of lod levels generated in the offline process (mDrawArgCount * mLodCount, NULL if the container has no lods)
+	Lod*                        pLods;
+	/// The array of clusters built in the offline process, clusters of draw arg i are [pClusterOffsets[i], pClusterOffsets[i + 1]) (NULL if the container has no clusters)
+	Cluster*                    pClusters;
+	uint32_t*                   pClusterOffsets;
 
 	/// The array of joint inverse bind-pose matrices ( object-space )
 	mat4*                       pInverseBindPoses;
@@ -119,6 +159,8 @@ typedef struct Geometry
 	uint32_t                    mIndexType : 2;
 	/// Number of joints in the skinned geometry
 	uint32_t                    mJointCount : 16;
+	/// Number of lod levels per draw arg (level 0 is the full detail mesh)
+	uint32_t                    mLodCount : 6;
 	/// Number of draw args in the geometry
 	uint32_t                    mDrawArgCount;
 	/// Number of indices in the geometry
@@ -126,7 +168,7 @@ typedef struct Geometry
 	/// Number of vertices in the geometry
 	uint32_t                    mVertexCount;
 
-	uint32_t                     mPad[3];
+	uint32_t                     mPad[1];
 } Geometry;
 static_assert(sizeof(Geometry) % 16 == 0, "GLTFContainer size must be a multiple of 16");
 
@@ -268,6 +310,12 @@ typedef struct ResourceLoaderDesc
 	uint64_t mBufferSize;
 	uint32_t mBufferCount;
 	bool     mSingleThreaded;
+	/// Keep transcoded Basis textures in RD_PIPELINE_CACHE so later runs skip transcoding
+	bool     mUseTranscodeCache;
+	/// Max bytes of streamed texture mips uploaded per frame (0 uses the default budget)
+	uint64_t mStreamingBudget;
+	/// Max bytes of sparse virtual texture pages kept in CPU memory per texture (0 uses the default size)
+	uint64_t mVirtualTexturePageCacheSize;
 } ResourceLoaderDesc;
 
 extern ResourceLoaderDesc gDefaultResourceLoaderDesc;
@@ -301,6 +349,18 @@ void removeResource(Buffer* pBuffer);
 void removeResource(Texture* pTexture);
 void removeResource(Geometry* pGeom);
 
+// MARK: Geometry lod selection
+
+/// Returns the coarsest lod of a draw arg whose simplification error projects to at most maxScreenError pixels.
+/// distance is the view space distance to the geometry, projectionScale is viewportHeight / (2 * tan(fovY / 2))
+uint32_t getGeometryLod(const Geometry* pGeom, uint32_t drawArg, float distance, float projectionScale, float maxScreenError);
+
+// MARK: Texture streaming
+
+/// Grants the resource loader the per frame byte budget for streamed texture mips.
+/// Call once per frame while textures loaded with TextureLoadDesc::pResidency are not fully resident
+void updateTextureStreaming();
+
 // MARK: Waiting for Loads
 
 /// Returns whether all submitted resource loads and updates have been completed.
@@ -80,7 +80,7 @@ extern void removeBuffer(Renderer* pRenderer, Buffer* p_buffer);
 extern void mapBuffer(Renderer* pRenderer, Buffer* pBuffer, ReadRange* pRange);
 extern void unmapBuffer(Renderer* pRenderer, Buffer* pBuffer);
 extern void addTexture(Renderer* pRenderer, const TextureDesc* pDesc, Texture** pp_texture);
-extern void addVirtualTexture(Cmd* pCmd, const TextureDesc* pDesc, Texture** ppTexture, void* pImageData);
+extern void addVirtualTexture(Cmd* pCmd, const TextureDesc* pDesc, Texture** ppTexture, void* pPageCache);
 extern void removeTexture(Renderer* pRenderer, Texture* p_texture);
 
 extern void cmdUpdateBuffer(Cmd* pCmd, Buffer* pBuffer, uint64_t dstOffset, Buffer* pSrcBuffer, uint64_t srcOffset, uint64_t size);
@@ -99,6 +99,10 @@ extern void cmdUpdateSubresource(Cmd* pCmd, Texture* pTexture, Buffer* pSrcBuffe
 
 #define MAX_FRAMES 3U
 
+// Mips at or below this size are uploaded with the texture, the rest is streamed in by updateTextureStreaming
+#define TEXTURE_STREAMING_TAIL_DIMENSION 256u
+#define DEFAULT_TEXTURE_STREAMING_BUDGET (4ull << 20)
+
 ResourceLoaderDesc gDefaultResourceLoaderDesc = { 8ull << 20, 2 };
 /************************************************************************/
 // Surface Utils
@@ -304,6 +308,94 @@ static inline void util_pack_float3_direction_to_half2(uint32_t count, uint32_t
 		}
 	}
 }
+// Parses the extras of a primitive written by the AssetPipeline if the extras object has the key pKey. Each AssetPipeline step
+// adds its keys next to the ones of the other steps. Returns the token array (NULL if the extras don't match), the caller frees it.
+// pKeyToken receives the index of the key, its value and the other keys of the step follow it
+static jsmntok_t* util_cgltf_parse_extras(const cgltf_data* data, const cgltf_primitive* prim, const char* pKey, const char** ppJson, int* pKeyToken)
+{
+	const uint32_t extrasSize = (uint32_t)(prim->extras.end_offset - prim->extras.start_offset);
+	if (!extrasSize)
+		return NULL;
+
+	const char* json = data->json + prim->extras.start_offset;
+	jsmn_parser parser = {};
+	int tokenCount = jsmn_parse(&parser, json, extrasSize, NULL, 0);
+	if (tokenCount < 3)
+		return NULL;
+
+	jsmntok_t* tokens = (jsmntok_t*)tf_malloc(tokenCount * sizeof(jsmntok_t));
+	jsmn_init(&parser);
+	jsmn_parse(&parser, json, extrasSize, tokens, tokenCount);
+
+	const int keyLength = (int)strlen(pKey);
+	int keyToken = 1;
+	for (int k = 0; tokens[0].type == JSMN_OBJECT && k < tokens[0].size && keyToken > 0; ++k)
+	{
+		if (tokens[keyToken].end - tokens[keyToken].start == keyLength && strncmp(json + tokens[keyToken].start, pKey, keyLength) == 0)
+		{
+			*ppJson = json;
+			*pKeyToken = keyToken;
+			return tokens;
+		}
+		keyToken = cgltf_skip_json(tokens, keyToken + 1);
+	}
+
+	tf_free(tokens);
+	return NULL;
+}
+
+// Reads the lod table written by the AssetPipeline into the primitive extras
+// { "mLodCount" : 3, "mLods" : [ startIndex, indexCount, error, ... ] }
+// Returns the number of lods of the primitive (0 if there is no lod table). pLods can be NULL to only query the count
+static uint32_t util_cgltf_read_lod_table(const cgltf_data* data, const cgltf_primitive* prim, Geometry::Lod* pLods, uint32_t maxLods)
+{
+	const char* json = NULL;
+	int k = 0;
+	jsmntok_t* tokens = util_cgltf_parse_extras(data, prim, "mLodCount", &json, &k);
+	if (!tokens)
+		return 0;
+
+	const uint32_t lodCount = (uint32_t)atoi(json + tokens[k + 1].start);
+	ASSERT(tokens[k + 3].size == (int)lodCount * 3);
+	if (pLods)
+	{
+		for (uint32_t l = 0; l < min(lodCount, maxLods); ++l)
+		{
+			pLods[l].mStartIndex = (uint32_t)atoi(json + tokens[k + 4 + l * 3].start);
+			pLods[l].mIndexCount = (uint32_t)atoi(json + tokens[k + 5 + l * 3].start);
+			pLods[l].mError = (float)atof(json + tokens[k + 6 + l * 3].start);
+		}
+	}
+	tf_free(tokens);
+
+	return pLods ? min(lodCount, maxLods) : lodCount;
+}
+
+// Reads the cluster table reference written by the AssetPipeline into the primitive extras
+// { "mClusterCount" : 42, "mClusterView" : 7 }
+// The buffer view holds the Geometry::Cluster records as is. Returns the number of clusters (0 if there is no cluster table)
+static uint32_t util_cgltf_read_cluster_table(const cgltf_data* data, const cgltf_primitive* prim, const Geometry::Cluster** ppClusters)
+{
+	const char* json = NULL;
+	int k = 0;
+	jsmntok_t* tokens = util_cgltf_parse_extras(data, prim, "mClusterCount", &json, &k);
+	if (!tokens)
+		return 0;
+
+	const uint32_t clusterCount = (uint32_t)atoi(json + tokens[k + 1].start);
+	const uint32_t viewIndex = (uint32_t)atoi(json + tokens[k + 3].start);
+	tf_free(tokens);
+
+	if (viewIndex >= data->buffer_views_count)
+		return 0;
+
+	const cgltf_buffer_view* view = &data->buffer_views[viewIndex];
+	ASSERT(view->size >= clusterCount * sizeof(Geometry::Cluster));
+	if (ppClusters)
+		*ppClusters = (const Geometry::Cluster*)((const uint8_t*)view->buffer->data + view->offset);
+
+	return clusterCount;
+}
 /************************************************************************/
 // Internal Structures
 /************************************************************************/
@@ -319,9 +411,29 @@ typedef struct TextureUpdateDescInternal
 	uint32_t          mBaseArrayLayer;
 	uint32_t          mLayerCount;
 	PreMipStepFn      pPreMipFunc;
+	/// Stream offset of each subresource [mip * mLayerCount + layer]. Set for streamed textures, the stream stays open
+	const uint64_t*   pMipOffsets;
 	bool              mMipsAfterSlice;
 } TextureUpdateDescInternal;
 
+typedef struct StreamingTexture
+{
+	Texture*          pTexture;
+	TextureResidency* pResidency;
+	FileStream        mStream;
+	uint64_t*         pMipOffsets;
+	/// Next mip to upload, the texture is fully resident after mip 0
+	uint32_t          mNextMip;
+	uint32_t          mLayerCount;
+} StreamingTexture;
+
+typedef struct TextureResidencyUpdate
+{
+	Texture*          pTexture;
+	TextureResidency* pResidency;
+	uint32_t          mResidentMip;
+} TextureResidencyUpdate;
+
 typedef struct CopyResourceSet
 {
 #if !defined(DIRECT3D11)
@@ -335,6 +447,9 @@ typedef struct CopyResourceSet
 	/// Buffers created in case we ran out of space in the original staging buffer
 	/// Will be cleaned up after the fence for this set is complete
 	eastl::vector<Buffer*> mTempBuffers;
+
+	/// Streamed mips recorded in this set. Published to TextureResidency after the fence for this set is complete
+	eastl::vector<TextureResidencyUpdate> mResidencyUpdates;
 } CopyResourceSet;
 
 //Synchronization?
@@ -413,6 +528,17 @@ struct ResourceLoader
 	uint32_t                     mNextSet;
 	uint32_t                     mSubmittedSets;
 
+	// Worker threads for CPU side texture processing (Basis transcoding, virtual texture page prefetching).
+	// Started by the loader thread on first use, see util_get_loader_thread_system
+	ThreadSystem*                pThreadSystem;
+
+	// Textures with mips left to stream. Lock order is mQueueMutex then mStreamingMutex
+	Mutex                        mStreamingMutex;
+	eastl::vector<StreamingTexture> mStreamingTextures;
+	tfrg_atomic64_t              mStreamingCredit;
+	// Textures removed while a copy set still uploads mips to them. Destroyed once no set references them
+	eastl::vector<Texture*>      mPendingTextureRemovals;
+
 #if defined(NX64)
 	ThreadTypeNX                 mThreadType;
 	void*                        mThreadStackPtr;
@@ -432,6 +558,16 @@ static uint32_t util_get_texture_subresource_alignment(Renderer* pRenderer, Tiny
 	uint32_t alignment = round_up(pRenderer->pActiveGpuSettings->mUploadBufferTextureAlignment, blockSize);
 	return round_up(alignment, util_get_texture_row_alignment(pRenderer));
 }
+
+// Only called on the loader thread. Apps that never load a Basis or virtual texture do not start the workers
+static ThreadSystem* util_get_loader_thread_system(ResourceLoader* pLoader)
+{
+	if (!pLoader->pThreadSystem && !pLoader->mDesc.mSingleThreaded)
+	{
+		initThreadSystem(&pLoader->pThreadSystem, MAX_LOAD_THREADS, 0, true, "ResourceLoaderWorker");
+	}
+	return pLoader->pThreadSystem;
+}
 /************************************************************************/
 // Internal Functions
 /************************************************************************/
@@ -510,6 +646,7 @@ static void cleanupCopyEngine(Renderer* pRenderer, CopyEngine* pCopyEngine)
 			removeBuffer(pRenderer, buffer);
 		}
 		pCopyEngine->resourceSets[i].mTempBuffers.set_capacity(0);
+		pCopyEngine->resourceSets[i].mResidencyUpdates.set_capacity(0);
 	}
 
 	tf_free(pCopyEngine->resourceSets);
@@ -656,9 +793,15 @@ static UploadFunctionResult updateTexture(Renderer* pRenderer, CopyEngine* pCopy
 		texUpdateDesc.mBaseMipLevel, texUpdateDesc.mMipLevels,
 		texUpdateDesc.mBaseArrayLayer, texUpdateDesc.mLayerCount);
 
+	// Streamed mips are uploaded after the mip tail is already in use, so only transition the updated subresources
+	const bool streamedMips = texUpdateDesc.pMipOffsets && (texUpdateDesc.mBaseMipLevel + texUpdateDesc.mMipLevels) < texture->mMipLevels;
+
 #if defined(VULKAN)
-	TextureBarrier barrier = { texture, RESOURCE_STATE_UNDEFINED, RESOURCE_STATE_COPY_DEST };
-	cmdResourceBarrier(cmd, 0, NULL, 1, &barrier, 0, NULL);
+	if (!streamedMips)
+	{
+		TextureBarrier barrier = { texture, RESOURCE_STATE_UNDEFINED, RESOURCE_STATE_COPY_DEST };
+		cmdResourceBarrier(cmd, 0, NULL, 1, &barrier, 0, NULL);
+	}
 #endif
 
 	MappedMemoryRange upload = dataAlreadyFilled ? texUpdateDesc.mRange : allocateStagingMemory(requiredSize, sliceAlignment);
@@ -667,7 +810,7 @@ static UploadFunctionResult updateTexture(Renderer* pRenderer, CopyEngine* pCopy
 	// #TODO: Investigate - fsRead crashes if we pass the upload buffer mapped address. Allocating temporary buffer as a workaround. Does NX support loading from disk to GPU shared memory?
 #ifdef NX64
 	void* nxTempBuffer = NULL;
-	if (!dataAlreadyFilled)
+	if (!dataAlreadyFilled && !texUpdateDesc.pMipOffsets)
 	{
 		size_t remainingBytes = fsGetStreamFileSize(&stream) - fsGetStreamSeekPosition(&stream);
 		nxTempBuffer = tf_malloc(remainingBytes);
@@ -698,14 +841,14 @@ static UploadFunctionResult updateTexture(Renderer* pRenderer, CopyEngine* pCopy
 	{
 		for (uint32_t j = firstStart; j < firstEnd; ++j)
 		{
-			if (texUpdateDesc.mMipsAfterSlice && texUpdateDesc.pPreMipFunc)
+			if (texUpdateDesc.mMipsAfterSlice && texUpdateDesc.pPreMipFunc && !texUpdateDesc.pMipOffsets)
 			{
 				texUpdateDesc.pPreMipFunc(&stream, j);
 			}
 
 			for (uint32_t i = secondStart; i < secondEnd; ++i)
 			{
-				if (!texUpdateDesc.mMipsAfterSlice && texUpdateDesc.pPreMipFunc)
+				if (!texUpdateDesc.mMipsAfterSlice && texUpdateDesc.pPreMipFunc && !texUpdateDesc.pMipOffsets)
 				{
 					texUpdateDesc.pPreMipFunc(&stream, i);
 				}
@@ -736,6 +879,11 @@ static UploadFunctionResult updateTexture(Renderer* pRenderer, CopyEngine* pCopy
 
 				if (!dataAlreadyFilled)
 				{
+					if (texUpdateDesc.pMipOffsets)
+					{
+						fsSeekStream(&stream, SBO_START_OF_FILE, (ssize_t)texUpdateDesc.pMipOffsets[mip * texUpdateDesc.mLayerCount + layer]);
+					}
+
 					for (uint32_t z = 0; z < subDepth; ++z)
 					{
 						uint8_t* dstData = data + subSlicePitch * z;
@@ -749,6 +897,16 @@ static UploadFunctionResult updateTexture(Renderer* pRenderer, CopyEngine* pCopy
 						}
 					}
 				}
+#if defined(VULKAN)
+				TextureBarrier subresourceBarrier = { texture, RESOURCE_STATE_UNDEFINED, RESOURCE_STATE_COPY_DEST };
+				subresourceBarrier.mSubresourceBarrier = 1;
+				subresourceBarrier.mMipLevel = (uint8_t)mip;
+				subresourceBarrier.mArrayLayer = (uint16_t)layer;
+				if (streamedMips)
+				{
+					cmdResourceBarrier(cmd, 0, NULL, 1, &subresourceBarrier, 0, NULL);
+				}
+#endif
 				SubresourceDataDesc subresourceDesc = {};
 				subresourceDesc.mArrayLayer = layer;
 				subresourceDesc.mMipLevel = mip;
@@ -758,17 +916,29 @@ static UploadFunctionResult updateTexture(Renderer* pRenderer, CopyEngine* pCopy
 				subresourceDesc.mSlicePitch = subSlicePitch;
 #endif
 				cmdUpdateSubresource(cmd, texture, upload.pBuffer, &subresourceDesc);
+#if defined(VULKAN)
+				if (streamedMips)
+				{
+					subresourceBarrier.mCurrentState = RESOURCE_STATE_COPY_DEST;
+					subresourceBarrier.mNewState = RESOURCE_STATE_SHADER_RESOURCE;
+					cmdResourceBarrier(cmd, 0, NULL, 1, &subresourceBarrier, 0, NULL);
+				}
+#endif
 				offset += subDepth * subSlicePitch;
 			}
 		}
 	}
 
 #if defined(VULKAN)
-	barrier = { texture, RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_SHADER_RESOURCE };
-	cmdResourceBarrier(cmd, 0, NULL, 1, &barrier, 0, NULL);
+	if (!streamedMips)
+	{
+		TextureBarrier barrier = { texture, RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_SHADER_RESOURCE };
+		cmdResourceBarrier(cmd, 0, NULL, 1, &barrier, 0, NULL);
+	}
 #endif
 
-	if (stream.pIO)
+	// Streamed textures keep their stream open until the last mip is uploaded
+	if (stream.pIO && !texUpdateDesc.pMipOffsets)
 	{
 		fsCloseStream(&stream);
 	}
@@ -776,6 +946,486 @@ static UploadFunctionResult updateTexture(Renderer* pRenderer, CopyEngine* pCopy
 	return UPLOAD_FUNCTION_RESULT_COMPLETED;
 }
 
+/************************************************************************/
+// Virtual Texture Page Cache
+/************************************************************************/
+#if defined(DIRECT3D12) || defined(VULKAN)
+#define DEFAULT_VIRTUAL_TEXTURE_PAGE_CACHE_SIZE (64ull << 20)
+#define VIRTUAL_TEXTURE_PAGE_INVALID UINT32_MAX
+
+// Keeps the most recently used pages of a sparse virtual texture in memory, the rest is read from the svt file on demand
+typedef struct VirtualTexturePageCache
+{
+	/// The svt file. Pages are copied out of it, a cache miss on the render thread does not wait for a read call
+	MappedFile               mFile;
+	/// Used instead of mFile when the file could not be mapped: stream for the pages requested by the renderer
+	/// and a second stream of the same file so prefetching does not block demand reads
+	FileStream               mStream;
+	FileStream               mPrefetchStream;
+	/// Guards the page slots and the prefetch queue
+	Mutex                    mMutex;
+	/// File offset of every page followed by the mip tail and the end of the data, see SVT_HEADER
+	uint64_t*                pPageOffsets;
+	/// Compressed page data read by mStream
+	uint8_t*                 pReadBuffer;
+	uint32_t                 mFilePageCount;
+	uint32_t                 mFilePageSize;
+	uint32_t                 mCompression;
+	uint32_t                 mPageSize;
+	uint32_t                 mPageCount;
+	uint32_t                 mTiledMipCount;
+	/// First page and pages per row of each tiled mip
+	eastl::vector<uint32_t>  mMipFirstPage;
+	eastl::vector<uint32_t>  mMipPagesX;
+	/// Page to slot and slot to page mapping, slots form an LRU list starting with the most recently used one
+	eastl::vector<uint32_t>  mPageSlots;
+	eastl::vector<uint32_t>  mSlotPages;
+	eastl::vector<uint32_t>  mSlotPrev;
+	eastl::vector<uint32_t>  mSlotNext;
+	eastl::vector<uint8_t*>  mSlotData;
+	uint32_t                 mSlotCapacity;
+	uint32_t                 mLruHead;
+	uint32_t                 mLruTail;
+	eastl::vector<uint32_t>  mPrefetchQueue;
+	eastl::vector<uint8_t>   mPageQueued;
+	/// Parent pages are prefetched on the loader worker threads
+	bool                     mPrefetch;
+	tfrg_atomic32_t          mPrefetchInFlight;
+} VirtualTexturePageCache;
+
+static void util_page_cache_unlink(VirtualTexturePageCache* pCache, uint32_t slot)
+{
+	uint32_t prev = pCache->mSlotPrev[slot];
+	uint32_t next = pCache->mSlotNext[slot];
+	if (prev != VIRTUAL_TEXTURE_PAGE_INVALID)
+		pCache->mSlotNext[prev] = next;
+	else
+		pCache->mLruHead = next;
+	if (next != VIRTUAL_TEXTURE_PAGE_INVALID)
+		pCache->mSlotPrev[next] = prev;
+	else
+		pCache->mLruTail = prev;
+}
+
+static void util_page_cache_push_front(VirtualTexturePageCache* pCache, uint32_t slot)
+{
+	pCache->mSlotPrev[slot] = VIRTUAL_TEXTURE_PAGE_INVALID;
+	pCache->mSlotNext[slot] = pCache->mLruHead;
+	if (pCache->mLruHead != VIRTUAL_TEXTURE_PAGE_INVALID)
+		pCache->mSlotPrev[pCache->mLruHead] = slot;
+	else
+		pCache->mLruTail = slot;
+	pCache->mLruHead = slot;
+}
+
+// pStream and pReadBuffer are only used when the file is not mapped. pReadBuffer holds at least mPageSize bytes and receives the compressed page data
+static bool util_page_cache_read(VirtualTexturePageCache* pCache, FileStream* pStream, uint8_t* pReadBuffer, uint32_t pageIndex, void* pDst)
+{
+	if (pageIndex >= pCache->mFilePageCount)
+	{
+		return false;
+	}
+
+	const uint64_t offset = pCache->pPageOffsets[pageIndex];
+	const uint64_t size = pCache->pPageOffsets[pageIndex + 1] - offset;
+	const uint8_t* pSrc = NULL;
+	if (pCache->mFile.pData)
+	{
+		if (offset > pCache->mFile.mSize || size > pCache->mFile.mSize - offset)
+		{
+			return false;
+		}
+		pSrc = (const uint8_t*)pCache->mFile.pData + offset;
+	}
+	else if (!fsSeekStream(pStream, SBO_START_OF_FILE, (ssize_t)offset))
+	{
+		return false;
+	}
+
+	// Pages that did not get smaller are stored as is
+	if (size == pCache->mPageSize)
+	{
+		if (pSrc)
+		{
+			memcpy(pDst, pSrc, pCache->mPageSize);
+			return true;
+		}
+		return fsReadFromStream(pStream, pDst, pCache->mPageSize) == (ssize_t)pCache->mPageSize;
+	}
+
+	if (pCache->mCompression != SVT_PAGE_COMPRESSION_LZ || size > pCache->mPageSize)
+	{
+		return false;
+	}
+
+	if (!pSrc)
+	{
+		if (fsReadFromStream(pStream, pReadBuffer, (size_t)size) != (size_t)size)
+		{
+			return false;
+		}
+		pSrc = pReadBuffer;
+	}
+
+	return util_decompress_svt_page(pSrc, (uint32_t)size, (uint8_t*)pDst, pCache->mPageSize);
+}
+
+// Must be called with mMutex held
+static void util_page_cache_insert(VirtualTexturePageCache* pCache, uint32_t pageIndex, const void* pData)
+{
+	uint32_t slot = pCache->mPageSlots[pageIndex];
+	if (slot != VIRTUAL_TEXTURE_PAGE_INVALID)
+	{
+		util_page_cache_unlink(pCache, slot);
+		util_page_cache_push_front(pCache, slot);
+		return;
+	}
+
+	if (pCache->mSlotData.size() < pCache->mSlotCapacity)
+	{
+		slot = (uint32_t)pCache->mSlotData.size();
+		pCache->mSlotData.push_back((uint8_t*)tf_malloc(pCache->mPageSize));
+		pCache->mSlotPages.push_back(VIRTUAL_TEXTURE_PAGE_INVALID);
+		pCache->mSlotPrev.push_back(VIRTUAL_TEXTURE_PAGE_INVALID);
+		pCache->mSlotNext.push_back(VIRTUAL_TEXTURE_PAGE_INVALID);
+	}
+	else
+	{
+		// Evict the least recently used page
+		slot = pCache->mLruTail;
+		util_page_cache_unlink(pCache, slot);
+		pCache->mPageSlots[pCache->mSlotPages[slot]] = VIRTUAL_TEXTURE_PAGE_INVALID;
+	}
+
+	memcpy(pCache->mSlotData[slot], pData, pCache->mPageSize);
+	pCache->mSlotPages[slot] = pageIndex;
+	pCache->mPageSlots[pageIndex] = slot;
+	util_page_cache_push_front(pCache, slot);
+}
+
+// Must be called with mMutex held
+static void util_page_cache_queue_parents(VirtualTexturePageCache* pCache, uint32_t pageIndex)
+{
+	uint32_t mip = 0;
+	while (mip + 1 < pCache->mTiledMipCount && pageIndex >= pCache->mMipFirstPage[mip + 1])
+	{
+		++mip;
+	}
+
+	uint32_t x = (pageIndex - pCache->mMipFirstPage[mip]) % pCache->mMipPagesX[mip];
+	uint32_t y = (pageIndex - pCache->mMipFirstPage[mip]) / pCache->mMipPagesX[mip];
+	for (++mip; mip < pCache->mTiledMipCount; ++mip)
+	{
+		x = min(x >> 1, pCache->mMipPagesX[mip] - 1);
+		y >>= 1;
+		uint32_t parent = pCache->mMipFirstPage[mip] + y * pCache->mMipPagesX[mip] + x;
+		if (parent >= pCache->mPageCount)
+		{
+			break;
+		}
+
+		if (pCache->mPageSlots[parent] == VIRTUAL_TEXTURE_PAGE_INVALID && !pCache->mPageQueued[parent])
+		{
+			pCache->mPageQueued[parent] = 1;
+			pCache->mPrefetchQueue.push_back(parent);
+		}
+	}
+}
+
+static void util_page_cache_prefetch(void* pUserData, uintptr_t)
+{
+	VirtualTexturePageCache* pCache = (VirtualTexturePageCache*)pUserData;
+	uint8_t* pPageData = (uint8_t*)tf_malloc(pCache->mPageSize);
+	uint8_t* pReadBuffer = (uint8_t*)tf_malloc(pCache->mPageSize);
+
+	for (;;)
+	{
+		pCache->mMutex.Acquire();
+		if (pCache->mPrefetchQueue.empty())
+		{
+			// The cache can be removed as soon as this is cleared
+			tfrg_atomic32_store_release(&pCache->mPrefetchInFlight, 0);
+			pCache->mMutex.Release();
+			break;
+		}
+
+		// Most recently queued first, those are the parents of the pages requested last
+		uint32_t pageIndex = pCache->mPrefetchQueue.back();
+		pCache->mPrefetchQueue.pop_back();
+		pCache->mPageQueued[pageIndex] = 0;
+		bool cached = pCache->mPageSlots[pageIndex] != VIRTUAL_TEXTURE_PAGE_INVALID;
+		pCache->mMutex.Release();
+
+		if (!cached && util_page_cache_read(pCache, &pCache->mPrefetchStream, pReadBuffer, pageIndex, pPageData))
+		{
+			pCache->mMutex.Acquire();
+			util_page_cache_insert(pCache, pageIndex, pPageData);
+			pCache->mMutex.Release();
+		}
+	}
+
+	tf_free(pReadBuffer);
+	tf_free(pPageData);
+}
+
+static VirtualTexturePageCache* addVirtualTexturePageCache(FileStream* pStream, const char* fileName, const SVT_HEADER* pHeader, uint64_t* pPageOffsets)
+{
+	VirtualTexturePageCache* pCache = tf_new(VirtualTexturePageCache);
+	pCache->pPageOffsets = pPageOffsets;
+	pCache->mFilePageCount = pHeader->mPageCount;
+	pCache->mFilePageSize = pHeader->mPageSize * pHeader->mPageSize * pHeader->mComponentCount;
+	pCache->mCompression = pHeader->mCompression;
+	pCache->mMutex.Init();
+	pCache->mLruHead = VIRTUAL_TEXTURE_PAGE_INVALID;
+	pCache->mLruTail = VIRTUAL_TEXTURE_PAGE_INVALID;
+
+	// Without worker threads there is nobody to prefetch parent pages
+	ThreadSystem* pThreadSystem = util_get_loader_thread_system(pResourceLoader);
+	if (fsMapFileFromPath(RD_TEXTURES, fileName, &pCache->mFile))
+	{
+		fsCloseStream(pStream);
+		pCache->mPrefetch = pThreadSystem != NULL;
+	}
+	else
+	{
+		pCache->mStream = *pStream;
+		pCache->mPrefetch = pThreadSystem && fsOpenStreamFromPath(RD_TEXTURES, fileName, FM_READ_BINARY, &pCache->mPrefetchStream);
+	}
+
+	return pCache;
+}
+
+// Called by addVirtualTexture once the page size of the texture is known
+void initVirtualTexturePageCache(VirtualTexture* pSvt, uint32_t width, uint32_t height, uint32_t tiledMipCount)
+{
+	VirtualTexturePageCache* pCache = (VirtualTexturePageCache*)pSvt->pPageCache;
+	if (!pCache)
+	{
+		return;
+	}
+
+	const uint32_t pageWidth = (uint32_t)pSvt->mSparseVirtualTexturePageWidth;
+	const uint32_t pageHeight = (uint32_t)pSvt->mSparseVirtualTexturePageHeight;
+	pCache->mPageSize = pageWidth * pageHeight * sizeof(uint32_t);
+	pCache->mTiledMipCount = max(tiledMipCount, 1u);
+	pCache->pReadBuffer = (uint8_t*)tf_malloc(pCache->mPageSize);
+
+	if (pCache->mPageSize != pCache->mFilePageSize)
+	{
+		LOGF(LogLevel::eERROR, "Virtual texture pages of the file (%u bytes) do not match the pages of the device (%u bytes)",
+			pCache->mFilePageSize, pCache->mPageSize);
+		pCache->mFilePageCount = 0;
+	}
+
+	// Same page order as the page table of the backends: mip by mip, row by row
+	pCache->mPageCount = 0;
+	pCache->mMipFirstPage.resize(pCache->mTiledMipCount);
+	pCache->mMipPagesX.resize(pCache->mTiledMipCount);
+	for (uint32_t mip = 0; mip < pCache->mTiledMipCount; ++mip)
+	{
+		uint32_t pagesX = (MIP_REDUCE(width, mip) + pageWidth - 1) / pageWidth;
+		uint32_t pagesY = (MIP_REDUCE(height, mip) + pageHeight - 1) / pageHeight;
+		pCache->mMipFirstPage[mip] = pCache->mPageCount;
+		pCache->mMipPagesX[mip] = pagesX;
+		pCache->mPageCount += pagesX * pagesY;
+	}
+
+	pCache->mPageSlots.resize(pCache->mPageCount, VIRTUAL_TEXTURE_PAGE_INVALID);
+	pCache->mPageQueued.resize(pCache->mPageCount, 0);
+
+	const uint64_t cacheSize = pResourceLoader->mDesc.mVirtualTexturePageCacheSize ? pResourceLoader->mDesc.mVirtualTexturePageCacheSize : DEFAULT_VIRTUAL_TEXTURE_PAGE_CACHE_SIZE;
+	pCache->mSlotCapacity = (uint32_t)max(1ull, min((unsigned long long)(cacheSize / pCache->mPageSize), (unsigned long long)pCache->mPageCount));
+
+	LOGF(LogLevel::eINFO, "Virtual texture page cache: %u of %u pages (%llu KB)", pCache->mSlotCapacity, pCache->mPageCount,
+		(unsigned long long)pCache->mSlotCapacity * pCache->mPageSize / 1024);
+}
+
+// Copies the page data to pDst, reading it from disk if it is not cached
+bool readVirtualTexturePage(VirtualTexture* pSvt, uint32_t pageIndex, void* pDst)
+{
+	VirtualTexturePageCache* pCache = (VirtualTexturePageCache*)pSvt->pPageCache;
+	ASSERT(pCache);
+	ASSERT(pageIndex < pCache->mPageCount);
+
+	pCache->mMutex.Acquire();
+	uint32_t slot = pCache->mPageSlots[pageIndex];
+	bool cached = slot != VIRTUAL_TEXTURE_PAGE_INVALID;
+	if (cached)
+	{
+		memcpy(pDst, pCache->mSlotData[slot], pCache->mPageSize);
+		util_page_cache_unlink(pCache, slot);
+		util_page_cache_push_front(pCache, slot);
+	}
+	pCache->mMutex.Release();
+
+	if (!cached)
+	{
+		if (!util_page_cache_read(pCache, &pCache->mStream, pCache->pReadBuffer, pageIndex, pDst))
+		{
+			LOGF(LogLevel::eERROR, "Failed to read virtual texture page %u", pageIndex);
+			return false;
+		}
+
+		pCache->mMutex.Acquire();
+		util_page_cache_insert(pCache, pageIndex, pDst);
+		pCache->mMutex.Release();
+	}
+
+	// Parent pages are the fallback when a page gets evicted, keep them close
+	if (pCache->mPrefetch)
+	{
+		bool startPrefetch = false;
+		pCache->mMutex.Acquire();
+		util_page_cache_queue_parents(pCache, pageIndex);
+		if (!pCache->mPrefetchQueue.empty() && !pCache->mPrefetchInFlight)
+		{
+			pCache->mPrefetchInFlight = 1;
+			startPrefetch = true;
+		}
+		pCache->mMutex.Release();
+
+		if (startPrefetch)
+		{
+			addThreadSystemRangeTask(pResourceLoader->pThreadSystem, util_page_cache_prefetch, pCache, 1);
+		}
+	}
+
+	return true;
+}
+
+void removeVirtualTexturePageCache(VirtualTexture* pSvt)
+{
+	VirtualTexturePageCache* pCache = (VirtualTexturePageCache*)pSvt->pPageCache;
+	if (!pCache)
+	{
+		return;
+	}
+
+	pCache->mMutex.Acquire();
+	pCache->mPrefetchQueue.clear();
+	pCache->mMutex.Release();
+	// The prefetch task finishes the page it is reading. If no worker picked the task up yet, run it here
+	while (tfrg_atomic32_load_acquire(&pCache->mPrefetchInFlight))
+	{
+		if (!assistThreadSystem(pResourceLoader->pThreadSystem))
+			Thread::Sleep(0);
+	}
+
+	for (uint8_t* pData : pCache->mSlotData)
+	{
+		tf_free(pData);
+	}
+
+	tf_free(pCache->pReadBuffer);
+	tf_free(pCache->pPageOffsets);
+
+	if (pCache->mFile.pData)
+	{
+		fsUnmapFile(&pCache->mFile);
+	}
+	if (pCache->mStream.pIO)
+	{
+		fsCloseStream(&pCache->mStream);
+	}
+	if (pCache->mPrefetchStream.pIO)
+	{
+		fsCloseStream(&pCache->mPrefetchStream);
+	}
+
+	pCache->mMutex.Destroy();
+	tf_delete(pCache);
+	pSvt->pPageCache = NULL;
+}
+#endif
+/************************************************************************/
+// Texture Loading
+/************************************************************************/
+/// Uploads the mip tail of a dds/ktx texture and registers the remaining mips for streaming
+static UploadFunctionResult loadStreamingTexture(Renderer* pRenderer, CopyEngine* pCopyEngine, size_t activeSet, TextureResidency* pResidency, TextureUpdateDescInternal& updateDesc)
+{
+	Texture* texture = updateDesc.pTexture;
+	const TinyImageFormat fmt = (TinyImageFormat)texture->mFormat;
+	const uint32_t mipLevels = updateDesc.mMipLevels;
+	const uint32_t layerCount = updateDesc.mLayerCount;
+
+	uint32_t tailStart = 0;
+	while (tailStart + 1 < mipLevels &&
+		(MIP_REDUCE(texture->mWidth, tailStart) > TEXTURE_STREAMING_TAIL_DIMENSION || MIP_REDUCE(texture->mHeight, tailStart) > TEXTURE_STREAMING_TAIL_DIMENSION))
+	{
+		++tailStart;
+	}
+
+	pResidency->mMipLevels = mipLevels;
+	if (!tailStart)
+	{
+		pResidency->mResidentMip = 0;
+		return updateTexture(pRenderer, pCopyEngine, activeSet, updateDesc);
+	}
+
+	// Record where each subresource starts so the mips can be uploaded from the smallest to the largest
+	uint64_t* pMipOffsets = (uint64_t*)tf_malloc(sizeof(uint64_t) * mipLevels * layerCount);
+	const uint32_t firstEnd = updateDesc.mMipsAfterSlice ? mipLevels : layerCount;
+	const uint32_t secondEnd = updateDesc.mMipsAfterSlice ? layerCount : mipLevels;
+	for (uint32_t j = 0; j < firstEnd; ++j)
+	{
+		if (updateDesc.mMipsAfterSlice && updateDesc.pPreMipFunc)
+		{
+			updateDesc.pPreMipFunc(&updateDesc.mStream, j);
+		}
+
+		for (uint32_t i = 0; i < secondEnd; ++i)
+		{
+			if (!updateDesc.mMipsAfterSlice && updateDesc.pPreMipFunc)
+			{
+				updateDesc.pPreMipFunc(&updateDesc.mStream, i);
+			}
+
+			uint32_t mip = updateDesc.mMipsAfterSlice ? j : i;
+			uint32_t layer = updateDesc.mMipsAfterSlice ? i : j;
+
+			uint32_t numBytes = 0;
+			uint32_t rowBytes = 0;
+			uint32_t numRows = 0;
+			if (!util_get_surface_info(MIP_REDUCE(texture->mWidth, mip), MIP_REDUCE(texture->mHeight, mip), fmt, &numBytes, &rowBytes, &numRows))
+			{
+				fsCloseStream(&updateDesc.mStream);
+				tf_free(pMipOffsets);
+				return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+			}
+
+			pMipOffsets[mip * layerCount + layer] = (uint64_t)fsGetStreamSeekPosition(&updateDesc.mStream);
+			fsSeekStream(&updateDesc.mStream, SBO_CURRENT_POSITION, (ssize_t)MIP_REDUCE(texture->mDepth, mip) * numRows * rowBytes);
+		}
+	}
+
+	updateDesc.pMipOffsets = pMipOffsets;
+	updateDesc.mBaseMipLevel = tailStart;
+	updateDesc.mMipLevels = mipLevels - tailStart;
+	UploadFunctionResult result = updateTexture(pRenderer, pCopyEngine, activeSet, updateDesc);
+	if (UPLOAD_FUNCTION_RESULT_COMPLETED != result)
+	{
+		fsCloseStream(&updateDesc.mStream);
+		tf_free(pMipOffsets);
+		return result;
+	}
+
+	pResidency->mResidentMip = tailStart;
+
+	StreamingTexture streaming = {};
+	streaming.pTexture = texture;
+	streaming.pResidency = pResidency;
+	streaming.mStream = updateDesc.mStream;
+	streaming.pMipOffsets = pMipOffsets;
+	streaming.mNextMip = tailStart - 1;
+	streaming.mLayerCount = layerCount;
+
+	pResourceLoader->mStreamingMutex.Acquire();
+	pResourceLoader->mStreamingTextures.push_back(streaming);
+	pResourceLoader->mStreamingMutex.Release();
+
+	return result;
+}
+
 static UploadFunctionResult loadTexture(Renderer* pRenderer, CopyEngine* pCopyEngine, size_t activeSet, const UpdateRequest& pTextureUpdate)
 {
 	const TextureLoadDesc* pTextureDesc = &pTextureUpdate.texLoadDesc;
@@ -861,7 +1511,8 @@ static UploadFunctionResult loadTexture(Renderer* pRenderer, CopyEngine* pCopyEn
 			success = fsOpenStreamFromPath(RD_TEXTURES, fileName, FM_READ_BINARY, &stream);
 			if (success)
 			{
-				success = loadBASISTextureDesc(&stream, &textureDesc, &data, &dataSize);
+				success = loadBASISTextureDesc(&stream, &textureDesc, &data, &dataSize, util_get_loader_thread_system(pResourceLoader),
+					pResourceLoader->mDesc.mUseTranscodeCache ? RD_PIPELINE_CACHE : RD_COUNT);
 				if (success)
 				{
 					fsCloseStream(&stream);
@@ -907,6 +1558,17 @@ static UploadFunctionResult loadTexture(Renderer* pRenderer, CopyEngine* pCopyEn
 			updateDesc.mBaseArrayLayer = 0;
 			updateDesc.mLayerCount = textureDesc.mArraySize;
 
+			if (pTextureDesc->pResidency)
+			{
+				if (TEXTURE_CONTAINER_DDS == container || TEXTURE_CONTAINER_KTX == container)
+				{
+					return loadStreamingTexture(pRenderer, pCopyEngine, activeSet, pTextureDesc->pResidency, updateDesc);
+				}
+
+				pTextureDesc->pResidency->mMipLevels = textureDesc.mMipLevels;
+				pTextureDesc->pResidency->mResidentMip = 0;
+			}
+
 			return updateTexture(pRenderer, pCopyEngine, activeSet, updateDesc);
 		}
 		/************************************************************************/
@@ -917,17 +1579,18 @@ static UploadFunctionResult loadTexture(Renderer* pRenderer, CopyEngine* pCopyEn
 		{
 			if (fsOpenStreamFromPath(RD_TEXTURES, fileName, FM_READ_BINARY, &stream))
 			{
-				success = loadSVTTextureDesc(&stream, &textureDesc);
+				SVT_HEADER header = {};
+				uint64_t* pPageOffsets = NULL;
+				success = loadSVTTextureDesc(&stream, &textureDesc, &header, &pPageOffsets);
 				if (success)
 				{
-					ssize_t dataSize = fsGetStreamFileSize(&stream) - fsGetStreamSeekPosition(&stream);
-					void* data = tf_malloc(dataSize);
-					fsReadFromStream(&stream, data, dataSize);
+					// The page cache takes ownership of the stream and the page offsets and reads pages as the renderer requests them
+					VirtualTexturePageCache* pPageCache = addVirtualTexturePageCache(&stream, fileName, &header, pPageOffsets);
 
 					textureDesc.mStartState = RESOURCE_STATE_COPY_DEST;
 					textureDesc.mFlags |= pTextureDesc->mCreationFlag;
 					textureDesc.mNodeIndex = pTextureDesc->mNodeIndex;
-					addVirtualTexture(acquireCmd(pCopyEngine, activeSet), &textureDesc, pTextureDesc->ppTexture, data);
+					addVirtualTexture(acquireCmd(pCopyEngine, activeSet), &textureDesc, pTextureDesc->ppTexture, pPageCache);
 					/************************************************************************/
 					// Create visibility buffer
 					/************************************************************************/
@@ -1009,8 +1672,6 @@ static UploadFunctionResult loadTexture(Renderer* pRenderer, CopyEngine* pCopyEn
 					pageCountsDesc.ppBuffer = &(*pTextureDesc->ppTexture)->pSvt->mPageCounts;
 					addResource(&pageCountsDesc, NULL);
 
-					fsCloseStream(&stream);
-
 					return UPLOAD_FUNCTION_RESULT_COMPLETED;
 				}
 			}
@@ -1136,6 +1797,8 @@ static UploadFunctionResult loadGeometry(Renderer* pRenderer, CopyEngine* pCopyE
 		uint32_t drawCount = 0;
 		uint32_t jointCount = 0;
 		uint32_t vertexBufferCount = 0;
+		uint32_t lodCount = 0;
+		uint32_t clusterCount = 0;
 
 		// Find number of traditional draw calls required to draw this piece of geometry
 		// Find total index count, total vertex count
@@ -1146,6 +1809,8 @@ static UploadFunctionResult loadGeometry(Renderer* pRenderer, CopyEngine* pCopyE
 				const cgltf_primitive* prim = &data->meshes[i].primitives[p];
 				indexCount += (uint32_t)prim->indices->count;
 				vertexCount += (uint32_t)prim->attributes->data->count;
+				lodCount = max(lodCount, util_cgltf_read_lod_table(data, prim, NULL, 0));
+				clusterCount += util_cgltf_read_cluster_table(data, prim, NULL);
 				++drawCount;
 
 				for (uint32_t i = 0; i < prim->attributes_count; ++i)
@@ -1221,6 +1886,12 @@ static UploadFunctionResult loadGeometry(Renderer* pRenderer, CopyEngine* pCopyE
 		totalSize += round_up(drawCount * sizeof(IndirectDrawIndexArguments), 16);
 		totalSize += round_up(jointCount * sizeof(mat4), 16);
 		totalSize += round_up(jointCount * sizeof(uint32_t), 16);
+		totalSize += round_up(drawCount * lodCount * sizeof(Geometry::Lod), 16);
+		if (clusterCount)
+		{
+			totalSize += round_up(clusterCount * sizeof(Geometry::Cluster), 16);
+			totalSize += round_up((drawCount + 1) * sizeof(uint32_t), 16);
+		}
 
 		Geometry* geom = (Geometry*)tf_calloc(1, totalSize);
 		ASSERT(geom);
@@ -1228,6 +1899,14 @@ static UploadFunctionResult loadGeometry(Renderer* pRenderer, CopyEngine* pCopyE
 		geom->pDrawArgs = (IndirectDrawIndexArguments*)(geom + 1);
 		geom->pInverseBindPoses = (mat4*)((uint8_t*)geom->pDrawArgs + round_up(drawCount * sizeof(*geom->pDrawArgs), 16));
 		geom->pJointRemaps = (uint32_t*)((uint8_t*)geom->pInverseBindPoses + round_up(jointCount * sizeof(*geom->pInverseBindPoses), 16));
+		if (lodCount)
+			geom->pLods = (Geometry::Lod*)((uint8_t*)geom->pJointRemaps + round_up(jointCount * sizeof(*geom->pJointRemaps), 16));
+		if (clusterCount)
+		{
+			geom->pClusters = (Geometry::Cluster*)((uint8_t*)geom->pJointRemaps + round_up(jointCount * sizeof(*geom->pJointRemaps), 16) +
+				round_up(drawCount * lodCount * sizeof(Geometry::Lod), 16));
+			geom->pClusterOffsets = (uint32_t*)((uint8_t*)geom->pClusters + round_up(clusterCount * sizeof(*geom->pClusters), 16));
+		}
 
 		uint32_t shadowSize = 0;
 		if (pDesc->mFlags & GEOMETRY_LOAD_FLAG_SHADOWED)
@@ -1247,6 +1926,7 @@ static UploadFunctionResult loadGeometry(Renderer* pRenderer, CopyEngine* pCopyE
 		geom->mVertexCount = vertexCount;
 		geom->mIndexType = (sizeof(uint16_t) == indexStride) ? INDEX_TYPE_UINT16 : INDEX_TYPE_UINT32;
 		geom->mJointCount = jointCount;
+		geom->mLodCount = lodCount;
 
 		// Allocate buffer memory
 		const bool structuredBuffers = (pDesc->mFlags & GEOMETRY_LOAD_FLAG_STRUCTURED_BUFFERS);
@@ -1372,6 +2052,24 @@ static UploadFunctionResult loadGeometry(Renderer* pRenderer, CopyEngine* pCopyE
 				// Fill draw arguments for this primitive
 				/************************************************************************/
 				geom->pDrawArgs[drawCount].mIndexCount = (uint32_t)prim->indices->count;
+				if (lodCount)
+				{
+					// Index buffer of a primitive with lods holds all levels back to back, default draw uses the full detail level
+					Geometry::Lod* lods = geom->pLods + drawCount * lodCount;
+					uint32_t primLodCount = util_cgltf_read_lod_table(data, prim, lods, lodCount);
+					if (!primLodCount)
+					{
+						lods[0] = { 0, (uint32_t)prim->indices->count, 0.0f };
+						primLodCount = 1;
+					}
+					// Primitives with a shorter chain repeat their coarsest level
+					for (uint32_t l = primLodCount; l < lodCount; ++l)
+						lods[l] = lods[primLodCount - 1];
+					for (uint32_t l = 0; l < lodCount; ++l)
+						lods[l].mStartIndex += indexCount;
+
+					geom->pDrawArgs[drawCount].mIndexCount = lods[0].mIndexCount;
+				}
 				geom->pDrawArgs[drawCount].mInstanceCount = 1;
 				geom->pDrawArgs[drawCount].mStartIndex = indexCount;
 				geom->pDrawArgs[drawCount].mStartInstance = 0;
@@ -1380,6 +2078,17 @@ static UploadFunctionResult loadGeometry(Renderer* pRenderer, CopyEngine* pCopyE
 				// need for changing shader code
 				geom->pDrawArgs[drawCount].mVertexOffset = 0;
 
+				if (clusterCount)
+				{
+					// Triangle ranges of the clusters are relative to the draw arg so the table is copied as is
+					const Geometry::Cluster* clusters = NULL;
+					const uint32_t primClusterCount = util_cgltf_read_cluster_table(data, prim, &clusters);
+					const uint32_t clusterStart = geom->pClusterOffsets[drawCount];
+					if (primClusterCount)
+						memcpy(geom->pClusters + clusterStart, clusters, primClusterCount * sizeof(Geometry::Cluster));
+					geom->pClusterOffsets[drawCount + 1] = clusterStart + primClusterCount;
+				}
+
 				indexCount += (uint32_t)prim->indices->count;
 				vertexCount += (uint32_t)prim->attributes->data->count;
 				++drawCount;
@@ -1502,9 +2211,139 @@ static bool areTasksAvailable(ResourceLoader* pLoader)
 		}
 	}
 
+	// Streamed mips wait for budget from updateTextureStreaming, residency updates wait for their copy set to complete
+	bool streamingPending = false;
+	pLoader->mStreamingMutex.Acquire();
+	if (!pLoader->mStreamingTextures.empty() && (int64_t)tfrg_atomic64_load_relaxed(&pLoader->mStreamingCredit) > 0)
+	{
+		streamingPending = true;
+	}
+	for (uint32_t nodeIndex = 0; nodeIndex < pLoader->pRenderer->mLinkedNodeCount && !streamingPending; ++nodeIndex)
+	{
+		const CopyEngine& copyEngine = pLoader->pCopyEngines[nodeIndex];
+		for (uint32_t i = 0; i < copyEngine.bufferCount; ++i)
+		{
+			streamingPending |= !copyEngine.resourceSets[i].mResidencyUpdates.empty();
+		}
+	}
+	pLoader->mStreamingMutex.Release();
+
+	return streamingPending;
+}
+
+static bool isTextureInCopyEngine(const CopyEngine* pCopyEngine, const Texture* pTexture)
+{
+	for (uint32_t set = 0; set < pCopyEngine->bufferCount; ++set)
+	{
+		for (const TextureResidencyUpdate& update : pCopyEngine->resourceSets[set].mResidencyUpdates)
+		{
+			if (update.pTexture == pTexture)
+				return true;
+		}
+	}
 	return false;
 }
 
+/// Called after the fence of the set completed
+static void applyTextureResidencyUpdates(ResourceLoader* pLoader, CopyEngine* pCopyEngine, uint32_t nodeIndex, size_t activeSet)
+{
+	CopyResourceSet& resourceSet = pCopyEngine->resourceSets[activeSet];
+	eastl::vector<Texture*> removedTextures;
+	pLoader->mStreamingMutex.Acquire();
+	for (const TextureResidencyUpdate& update : resourceSet.mResidencyUpdates)
+	{
+		// NULL once the texture was removed
+		if (update.pResidency)
+			tfrg_atomic32_store_release((tfrg_atomic32_t*)&update.pResidency->mResidentMip, update.mResidentMip);
+	}
+	resourceSet.mResidencyUpdates.clear();
+
+	eastl::vector<Texture*>& pendingRemovals = pLoader->mPendingTextureRemovals;
+	for (size_t i = 0; i < pendingRemovals.size();)
+	{
+		if (pendingRemovals[i]->mNodeIndex == nodeIndex && !isTextureInCopyEngine(pCopyEngine, pendingRemovals[i]))
+		{
+			removedTextures.push_back(pendingRemovals[i]);
+			pendingRemovals.erase(pendingRemovals.begin() + i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+	pLoader->mStreamingMutex.Release();
+
+	for (Texture* pTexture : removedTextures)
+	{
+		removeTexture(pLoader->pRenderer, pTexture);
+	}
+}
+
+/// Records uploads of streamed mips until the streaming budget is spent. Returns true if any commands were recorded
+static bool streamTextureMips(ResourceLoader* pLoader, CopyEngine* pCopyEngine, uint32_t nodeIndex)
+{
+	bool recorded = false;
+	const uint32_t rowAlignment = util_get_texture_row_alignment(pLoader->pRenderer);
+	CopyResourceSet& resourceSet = pCopyEngine->resourceSets[pLoader->mNextSet];
+
+	pLoader->mStreamingMutex.Acquire();
+	eastl::vector<StreamingTexture>& textures = pLoader->mStreamingTextures;
+	// One mip per texture so all streamed textures make progress. A mip larger than the remaining budget still goes
+	// through and overdraws the credit, so every frame uploads at least one mip
+	for (size_t i = 0; i < textures.size() && (int64_t)tfrg_atomic64_load_relaxed(&pLoader->mStreamingCredit) > 0;)
+	{
+		StreamingTexture& streaming = textures[i];
+		Texture* texture = streaming.pTexture;
+		if (texture->mNodeIndex != nodeIndex)
+		{
+			++i;
+			continue;
+		}
+
+		const TinyImageFormat fmt = (TinyImageFormat)texture->mFormat;
+		const uint64_t mipSize = util_get_surface_size(fmt, texture->mWidth, texture->mHeight, texture->mDepth, rowAlignment,
+			util_get_texture_subresource_alignment(pLoader->pRenderer, fmt), streaming.mNextMip, 1, 0, streaming.mLayerCount);
+
+		TextureUpdateDescInternal updateDesc = {};
+		updateDesc.pTexture = texture;
+		updateDesc.mStream = streaming.mStream;
+		updateDesc.mBaseMipLevel = streaming.mNextMip;
+		updateDesc.mMipLevels = 1;
+		updateDesc.mBaseArrayLayer = 0;
+		updateDesc.mLayerCount = streaming.mLayerCount;
+		updateDesc.pMipOffsets = streaming.pMipOffsets;
+
+		UploadFunctionResult result = updateTexture(pLoader->pRenderer, pCopyEngine, pLoader->mNextSet, updateDesc);
+		tfrg_atomic64_add_relaxed(&pLoader->mStreamingCredit, -(int64_t)mipSize);
+		recorded = true;
+
+		if (UPLOAD_FUNCTION_RESULT_COMPLETED == result)
+		{
+			TextureResidencyUpdate update = { texture, streaming.pResidency, streaming.mNextMip };
+			resourceSet.mResidencyUpdates.push_back(update);
+		}
+		else
+		{
+			LOGF(LogLevel::eWARNING, "Failed to stream mip %u, texture stays at its resident mip", streaming.mNextMip);
+		}
+
+		if (UPLOAD_FUNCTION_RESULT_COMPLETED == result && streaming.mNextMip > 0)
+		{
+			--streaming.mNextMip;
+			++i;
+		}
+		else
+		{
+			fsCloseStream(&streaming.mStream);
+			tf_free(streaming.pMipOffsets);
+			textures.erase(textures.begin() + i);
+		}
+	}
+	pLoader->mStreamingMutex.Release();
+
+	return recorded;
+}
+
 static void streamerThreadFunc(void* pThreadData)
 {
 	ResourceLoader* pLoader = (ResourceLoader*)pThreadData;
@@ -1545,6 +2384,7 @@ static void streamerThreadFunc(void* pThreadData)
 		for (uint32_t nodeIndex = 0; nodeIndex < linkedGPUCount; ++nodeIndex)
 		{
 			waitCopyEngineSet(pLoader->pRenderer, &pLoader->pCopyEngines[nodeIndex], pLoader->mNextSet, true);
+			applyTextureResidencyUpdates(pLoader, &pLoader->pCopyEngines[nodeIndex], nodeIndex, pLoader->mNextSet);
 			resetCopyEngineSet(pLoader->pRenderer, &pLoader->pCopyEngines[nodeIndex], pLoader->mNextSet);
 		}
 
@@ -1563,12 +2403,6 @@ static void streamerThreadFunc(void* pThreadData)
 			eastl::vector<UpdateRequest>& requestQueue = pLoader->mRequestQueue[nodeIndex];
 			CopyEngine& copyEngine = pLoader->pCopyEngines[nodeIndex];
 
-			if (!requestQueue.size())
-			{
-				pLoader->mQueueMutex.Release();
-				continue;
-			}
-
 			eastl::vector<UpdateRequest> activeQueue;
 			eastl::swap(requestQueue, activeQueue);
 			pLoader->mQueueMutex.Release();
@@ -1625,6 +2459,11 @@ static void streamerThreadFunc(void* pThreadData)
 				ASSERT(result != UPLOAD_FUNCTION_RESULT_STAGING_BUFFER_FULL);
 			}
 
+			if (streamTextureMips(pLoader, &copyEngine, nodeIndex))
+			{
+				completionMask |= 1ull << nodeIndex;
+			}
+
 			if (completionMask != 0)
 			{
 				for (uint32_t nodeIndex = 0; nodeIndex < linkedGPUCount; ++nodeIndex)
@@ -1671,6 +2510,7 @@ static void addResourceLoader(Renderer* pRenderer, ResourceLoaderDesc* pDesc, Re
 	pLoader->mTokenMutex.Init();
 	pLoader->mQueueCond.Init();
 	pLoader->mTokenCond.Init();
+	pLoader->mStreamingMutex.Init();
 
 	pLoader->mTokenCounter = 0;
 	pLoader->mTokenCompleted = 0;
@@ -1716,12 +2556,29 @@ static void removeResourceLoader(ResourceLoader* pLoader)
 	{
 		pLoader->mQueueCond.WakeOne();
 		destroy_thread(pLoader->mThread);
+		if (pLoader->pThreadSystem)
+			shutdownThreadSystem(pLoader->pThreadSystem);
+	}
+
+	for (StreamingTexture& streaming : pLoader->mStreamingTextures)
+	{
+		fsCloseStream(&streaming.mStream);
+		tf_free(streaming.pMipOffsets);
+	}
+	pLoader->mStreamingTextures.set_capacity(0);
+
+	// The copy queues are idle after the streamer thread exited
+	for (Texture* pTexture : pLoader->mPendingTextureRemovals)
+	{
+		removeTexture(pLoader->pRenderer, pTexture);
 	}
+	pLoader->mPendingTextureRemovals.set_capacity(0);
 
 	pLoader->mQueueCond.Destroy();
 	pLoader->mTokenCond.Destroy();
 	pLoader->mQueueMutex.Destroy();
 	pLoader->mTokenMutex.Destroy();
+	pLoader->mStreamingMutex.Destroy();
 
 	tf_delete(pLoader);
 }
@@ -1974,7 +2831,47 @@ void removeResource(Buffer* pBuffer)
 
 void removeResource(Texture* pTexture)
 {
-	removeTexture(pResourceLoader->pRenderer, pTexture);
+	// Textures can be removed before all of their mips were streamed in
+	pResourceLoader->mStreamingMutex.Acquire();
+	eastl::vector<StreamingTexture>& textures = pResourceLoader->mStreamingTextures;
+	for (size_t i = 0; i < textures.size();)
+	{
+		if (textures[i].pTexture == pTexture)
+		{
+			fsCloseStream(&textures[i].mStream);
+			tf_free(textures[i].pMipOffsets);
+			textures.erase(textures.begin() + i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+	// Copy sets with residency updates for the texture still upload to it until their fence completed.
+	// The residency can be freed with the texture, the updates are kept only to defer the removal
+	bool inFlight = false;
+	CopyEngine& copyEngine = pResourceLoader->pCopyEngines[pTexture->mNodeIndex];
+	for (uint32_t set = 0; set < copyEngine.bufferCount; ++set)
+	{
+		for (TextureResidencyUpdate& update : copyEngine.resourceSets[set].mResidencyUpdates)
+		{
+			if (update.pTexture == pTexture)
+			{
+				update.pResidency = NULL;
+				inFlight = true;
+			}
+		}
+	}
+	if (inFlight)
+	{
+		pResourceLoader->mPendingTextureRemovals.push_back(pTexture);
+	}
+	pResourceLoader->mStreamingMutex.Release();
+
+	if (!inFlight)
+	{
+		removeTexture(pResourceLoader->pRenderer, pTexture);
+	}
 }
 
 void removeResource(Geometry* pGeom)
@@ -1987,6 +2884,27 @@ void removeResource(Geometry* pGeom)
 	tf_free(pGeom);
 }
 
+uint32_t getGeometryLod(const Geometry* pGeom, uint32_t drawArg, float distance, float projectionScale, float maxScreenError)
+{
+	ASSERT(pGeom);
+	ASSERT(drawArg < pGeom->mDrawArgCount);
+
+	if (!pGeom->pLods)
+		return 0;
+
+	const Geometry::Lod* lods = pGeom->pLods + drawArg * pGeom->mLodCount;
+	const float invDistance = 1.0f / max(distance, 1e-4f);
+
+	// Errors grow with each level so walk down from the coarsest one
+	for (uint32_t l = pGeom->mLodCount - 1; l > 0; --l)
+	{
+		if (lods[l].mError * projectionScale * invDistance <= maxScreenError)
+			return l;
+	}
+
+	return 0;
+}
+
 void beginUpdateResource(BufferUpdateDesc* pBufferUpdate)
 {
 	Buffer* pBuffer = pBufferUpdate->pBuffer;
@@ -2090,6 +3008,24 @@ void endUpdateResource(TextureUpdateDesc* pTextureUpdate, SyncToken* token)
 	}
 }
 
+void updateTextureStreaming()
+{
+	const uint64_t budget = pResourceLoader->mDesc.mStreamingBudget ? pResourceLoader->mDesc.mStreamingBudget : DEFAULT_TEXTURE_STREAMING_BUDGET;
+	// Store under the queue lock so a sleeping loader thread cannot miss the new budget
+	pResourceLoader->mQueueMutex.Acquire();
+	tfrg_atomic64_store_relaxed(&pResourceLoader->mStreamingCredit, budget);
+	pResourceLoader->mQueueMutex.Release();
+
+	if (pResourceLoader->mDesc.mSingleThreaded)
+	{
+		streamerThreadFunc(pResourceLoader);
+	}
+	else
+	{
+		pResourceLoader->mQueueCond.WakeOne();
+	}
+}
+
 SyncToken getLastTokenCompleted()
 {
 	return tfrg_atomic64_load_acquire(&pResourceLoader->mTokenCompleted);
@@ -93,6 +93,9 @@
 #include "../../OS/Interfaces/IMemory.h"
 
 extern void vk_createShaderReflection(const uint8_t* shaderCode, uint32_t shaderSize, ShaderStage shaderStage, ShaderReflection* pOutReflection);
+extern void initVirtualTexturePageCache(VirtualTexture* pSvt, uint32_t width, uint32_t height, uint32_t tiledMipCount);
+extern bool readVirtualTexturePage(VirtualTexture* pSvt, uint32_t pageIndex, void* pDst);
+extern void removeVirtualTexturePageCache(VirtualTexture* pSvt);
 
 #ifdef ENABLE_RAYTRACING
 extern void addRaytracingPipeline(const PipelineDesc*, Pipeline**);
@@ -7471,9 +7474,12 @@ void fillVirtualTexture(Cmd* pCmd, Texture* pTexture, Fence* pFence)
 
 		if (allocateVirtualPage(pRenderer, pTexture, *pPage, pTexture->pSvt->mSparseMemoryTypeIndex))
 		{
-			void* pData = (void*)((unsigned char*)pTexture->pSvt->mVirtualImageData + (pageIndex * pPage->size));
-
-			memcpy(pPage->pIntermediateBuffer->pCpuMappedAddress, pData, pPage->size);
+			if (!readVirtualTexturePage(pTexture->pSvt, pageIndex, pPage->pIntermediateBuffer->pCpuMappedAddress))
+			{
+				// Stays unbacked so the page is requested again
+				releaseVirtualPage(pRenderer, *pPage, true);
+				continue;
+			}
 
 			//Copy image to VkImage	
 			VkBufferImageCopy region = {};
@@ -7547,10 +7553,13 @@ void fillVirtualTextureLevel(Cmd* pCmd, Texture* pTexture, uint32_t mipLevel)
 		{
 			if (allocateVirtualPage(pRenderer, pTexture, *pPage, pTexture->pSvt->mSparseMemoryTypeIndex))
 			{
-				void* pData = (void*)((unsigned char*)pTexture->pSvt->mVirtualImageData + (pageIndex * (uint32_t)pPage->size));
-
 				//CPU to GPU
-				memcpy(pPage->pIntermediateBuffer->pCpuMappedAddress, pData, pPage->size);
+				if (!readVirtualTexturePage(pTexture->pSvt, pageIndex, pPage->pIntermediateBuffer->pCpuMappedAddress))
+				{
+					// Stays unbacked so the level is filled again
+					releaseVirtualPage(pRenderer, *pPage, true);
+					continue;
+				}
 
 				//Copy image to VkImage	
 				VkBufferImageCopy region = {};
@@ -7604,7 +7613,7 @@ void fillVirtualTextureLevel(Cmd* pCmd, Texture* pTexture, uint32_t mipLevel)
 	}
 }
 
-void addVirtualTexture(Cmd* pCmd, const TextureDesc * pDesc, Texture** ppTexture, void* pImageData)
+void addVirtualTexture(Cmd* pCmd, const TextureDesc * pDesc, Texture** ppTexture, void* pPageCache)
 {
 	ASSERT(pCmd);
 	Texture* pTexture = (Texture*)tf_calloc_memalign(1, alignof(Texture), sizeof(*pTexture) + sizeof(VirtualTexture));
@@ -7622,7 +7631,7 @@ void addVirtualTexture(Cmd* pCmd, const TextureDesc * pDesc, Texture** ppTexture
 		mipSize /= 4;
 	}
 
-	pTexture->pSvt->mVirtualImageData = pImageData;
+	pTexture->pSvt->pPageCache = pPageCache;
 
 	VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
 	pTexture->mOwnsImage = true;
@@ -7678,6 +7687,7 @@ void addVirtualTexture(Cmd* pCmd, const TextureDesc * pDesc, Texture** ppTexture
 	pTexture->pSvt->mVirtualPageTotalCount = imageSize / (uint32_t)(pTexture->pSvt->mSparseVirtualTexturePageWidth * pTexture->pSvt->mSparseVirtualTexturePageHeight);
 
 	uint32_t TiledMiplevel = pDesc->mMipLevels - (uint32_t)log2(min((uint32_t)pTexture->pSvt->mSparseVirtualTexturePageWidth, (uint32_t)pTexture->pSvt->mSparseVirtualTexturePageHeight));
+	initVirtualTexturePageCache(pTexture->pSvt, pDesc->mWidth, pDesc->mHeight, TiledMiplevel);
 
 	LOGF(LogLevel::eINFO, "Sparse image memory requirements: %d", sparseMemoryReqsCount);
 
@@ -7922,8 +7932,7 @@ void removeVirtualTexture(Renderer* pRenderer, VirtualTexture* pSvt)
 	if (pSvt->mPageCounts)
 		removeBuffer(pRenderer, pSvt->mPageCounts);
 
-	if (pSvt->mVirtualImageData)
-		tf_free(pSvt->mVirtualImageData);
+	removeVirtualTexturePageCache(pSvt);
 }
 
 void cmdUpdateVirtualTexture(Cmd* cmd, Texture* pTexture)
@@ -396,9 +396,8 @@ namespace {
 #define MINIZ_HAS_64BIT_REGISTERS 1
 #endif
 
-#ifdef __cplusplus
-		extern "C" {
-#endif
+		// No extern "C" here: the embedded miniz keeps the internal linkage of the unnamed namespace,
+		// so it links next to the miniz of zip/ (same symbol names)
 
 			// ------------------- zlib-style API Definitions.
 
@@ -991,6 +990,8 @@ namespace {
 
 			// Misc. high-level helper functions:
 
+			// Only defined with stdio, declaring them without would leave internal functions that are never defined
+#ifndef MINIZ_NO_STDIO
 			// mz_zip_add_mem_to_archive_file_in_place() efficiently (but not atomically)
 			// appends a memory blob to a ZIP archive.
 			// level_and_flags - compression level (0-10, see MZ_BEST_SPEED,
@@ -1006,6 +1007,7 @@ namespace {
 			void *mz_zip_extract_archive_file_to_heap(const char *pZip_filename,
 				const char *pArchive_name,
 				size_t *pSize, mz_uint zip_flags);
+#endif // #ifndef MINIZ_NO_STDIO
 
 #endif // #ifndef MINIZ_NO_ARCHIVE_WRITING_APIS
 
@@ -1365,9 +1367,6 @@ namespace {
 				int strategy);
 #endif // #ifndef MINIZ_NO_ZLIB_APIS
 
-#ifdef __cplusplus
-		}
-#endif
 
 #endif // MINIZ_HEADER_INCLUDED
 
@@ -1421,9 +1420,6 @@ namespace {
 #define MZ_FORCEINLINE inline
 #endif
 
-#ifdef __cplusplus
-		extern "C" {
-#endif
 
 			// ------------------- zlib-style API's
 
@@ -6578,9 +6574,6 @@ namespace {
 
 #endif // #ifndef MINIZ_NO_ARCHIVE_APIS
 
-#ifdef __cplusplus
-		}
-#endif
 
 #endif // MINIZ_HEADER_FILE_ONLY
 
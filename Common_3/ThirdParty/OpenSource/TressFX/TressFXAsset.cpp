@@ -64,7 +64,32 @@ static void GetTangentVectors(const vec3& n, vec3& t0, vec3& t1)
 	}
 }
 
-static float GetRandom(float Min, float Max) { return ((float(rand()) / float(RAND_MAX)) * (Max - Min)) + Min; }
+// Random sequence of one follow strand. It is seeded from the strand index instead of sharing the global rand() state,
+// so strands can be generated in any order and on any thread with the same result
+struct StrandRandom
+{
+	explicit StrandRandom(uint32_t strandIndex)
+	{
+		// Hash the index so neighbouring strands start from unrelated states
+		mState = strandIndex * 0x9E3779B9u + 0x7F4A7C15u;
+		mState = (mState ^ (mState >> 16)) * 0x85EBCA6Bu;
+		mState = (mState ^ (mState >> 13)) * 0xC2B2AE35u;
+		mState ^= mState >> 16;
+		if (!mState)
+			mState = 1;
+	}
+
+	// xorshift32
+	float GetRandom(float Min, float Max)
+	{
+		mState ^= mState << 13;
+		mState ^= mState >> 17;
+		mState ^= mState << 5;
+		return float(mState >> 8) * (1.0f / 16777216.0f) * (Max - Min) + Min;
+	}
+
+	uint32_t mState;
+};
 
 TressFXAsset::TressFXAsset():
 	m_positions(NULL),
@@ -84,7 +109,9 @@ TressFXAsset::TressFXAsset():
 	m_numVerticesPerStrand(0),
 	m_numGuideStrands(0),
 	m_numGuideVertices(0),
-	m_numFollowStrandsPerGuide(0)
+	m_numFollowStrandsPerGuide(0),
+	m_guidePositions(NULL),
+	m_guideStrandUV(NULL)
 
 {
 }
@@ -112,6 +139,23 @@ void TressFXAsset::Clear()
 	tf_free(m_restLengths);
 	tf_free(m_triangleIndices);
 	tf_free(m_boneSkinningData);
+	tf_free(m_guidePositions);
+	tf_free(m_guideStrandUV);
+
+	m_positions = NULL;
+	m_strandUV = NULL;
+	m_refVectors = NULL;
+	m_globalRotations = NULL;
+	m_localRotations = NULL;
+	m_tangents = NULL;
+	m_followRootOffsets = NULL;
+	m_strandTypes = NULL;
+	m_thicknessCoeffs = NULL;
+	m_restLengths = NULL;
+	m_triangleIndices = NULL;
+	m_boneSkinningData = NULL;
+	m_guidePositions = NULL;
+	m_guideStrandUV = NULL;
 }
 
 //TODO: Remove Comments
@@ -358,6 +402,17 @@ bool TressFXAsset::LoadV3(TressFXFileObject* header, FileStream* fh)
 // This generates follow hairs around loaded guide hairs procedually with random distribution within the max radius input.
 // Calling this is optional.
 bool TressFXAsset::GenerateFollowHairs(int numFollowHairsPerGuideHair, float tipSeparationFactor, float maxRadiusAroundGuideHair)
+{
+	if (!BeginFollowHairs(numFollowHairsPerGuideHair))
+		return false;
+
+	GenerateFollowHairStrands(0, m_numGuideStrands, tipSeparationFactor, maxRadiusAroundGuideHair);
+	EndFollowHairs();
+
+	return true;
+}
+
+bool TressFXAsset::BeginFollowHairs(int numFollowHairsPerGuideHair)
 {
 	ASSERT(numFollowHairsPerGuideHair >= 0);
 
@@ -371,9 +426,9 @@ bool TressFXAsset::GenerateFollowHairs(int numFollowHairsPerGuideHair, float tip
 	m_numTotalStrands = m_numGuideStrands * (m_numFollowStrandsPerGuide + 1);
 	m_numTotalVertices = m_numTotalStrands * m_numVerticesPerStrand;
 
-	// keep the old buffers until the end of this function.
-	float4* positionsGuide = m_positions;
-	float2* strandUVGuide = m_strandUV;
+	// keep the old buffers until EndFollowHairs.
+	m_guidePositions = m_positions;
+	m_guideStrandUV = m_strandUV;
 
 	// re-allocate all buffers
 	m_positions = tf_placement_new<float4>(tf_malloc(m_numTotalVertices * sizeof(float4)));
@@ -389,19 +444,26 @@ bool TressFXAsset::GenerateFollowHairs(int numFollowHairsPerGuideHair, float tip
 		return false;
 	}
 
+	return true;
+}
+
+void TressFXAsset::GenerateFollowHairStrands(int firstGuide, int guideCount, float tipSeparationFactor, float maxRadiusAroundGuideHair)
+{
+	ASSERT(firstGuide >= 0 && firstGuide + guideCount <= m_numGuideStrands);
+
 	// type-cast to vec3 to handle data easily.
 	ASSERT(sizeof(vec3) == sizeof(float4));    // sizeof(vec3) is 4*sizeof(float)
 	vec4* pos = static_cast<vec4*>((void*)m_positions);
 	vec4* followOffset = static_cast<vec4*>((void*)m_followRootOffsets);
 
 	// Generate follow hairs
-	for (int i = 0; i < m_numGuideStrands; i++)
+	for (int i = firstGuide; i < firstGuide + guideCount; i++)
 	{
 		int indexGuideStrand = i * (m_numFollowStrandsPerGuide + 1);
 		int indexRootVertMaster = indexGuideStrand * m_numVerticesPerStrand;
 
-		memcpy(&pos[indexRootVertMaster], &positionsGuide[i * m_numVerticesPerStrand], sizeof(vec4) * m_numVerticesPerStrand);
-		m_strandUV[indexGuideStrand] = strandUVGuide[i];
+		memcpy(&pos[indexRootVertMaster], &m_guidePositions[i * m_numVerticesPerStrand], sizeof(vec4) * m_numVerticesPerStrand);
+		m_strandUV[indexGuideStrand] = m_guideStrandUV[i];
 
 		followOffset[indexGuideStrand] = vec4(0);
 		followOffset[indexGuideStrand].setW((float)indexGuideStrand);
@@ -420,8 +482,10 @@ bool TressFXAsset::GenerateFollowHairs(int numFollowHairsPerGuideHair, float tip
 			m_strandUV[indexStrandFollow] = m_strandUV[indexGuideStrand];
 
 			// offset vector from the guide strand's root vertex position
-			vec3 offset = GetRandom(-maxRadiusAroundGuideHair, maxRadiusAroundGuideHair) * t0 +
-						  GetRandom(-maxRadiusAroundGuideHair, maxRadiusAroundGuideHair) * t1;
+			StrandRandom random((uint32_t)indexStrandFollow);
+			const float  offset0 = random.GetRandom(-maxRadiusAroundGuideHair, maxRadiusAroundGuideHair);
+			const float  offset1 = random.GetRandom(-maxRadiusAroundGuideHair, maxRadiusAroundGuideHair);
+			vec3         offset = offset0 * t0 + offset1 * t1;
 			followOffset[indexStrandFollow] = vec4(offset);
 			followOffset[indexStrandFollow].setW((float)indexGuideStrand);
 
@@ -436,14 +500,26 @@ bool TressFXAsset::GenerateFollowHairs(int numFollowHairsPerGuideHair, float tip
 			}
 		}
 	}
+}
 
-	tf_free(positionsGuide);
-	tf_free(strandUVGuide);
+void TressFXAsset::EndFollowHairs()
+{
+	tf_free(m_guidePositions);
+	tf_free(m_guideStrandUV);
+	m_guidePositions = NULL;
+	m_guideStrandUV = NULL;
+}
+
+bool TressFXAsset::ProcessAsset()
+{
+	if (!BeginProcessAsset())
+		return false;
 
+	ProcessStrands(0, m_numTotalStrands);
 	return true;
 }
 
-bool TressFXAsset::ProcessAsset()
+bool TressFXAsset::BeginProcessAsset()
 {
 	tf_free(m_strandTypes);
 	m_strandTypes = tf_placement_new<int>(tf_malloc(m_numTotalStrands * sizeof(int)));
@@ -477,36 +553,42 @@ bool TressFXAsset::ProcessAsset()
 		return false;
 	}
 
+	return true;
+}
+
+void TressFXAsset::ProcessStrands(int firstStrand, int strandCount)
+{
+	ASSERT(firstStrand >= 0 && firstStrand + strandCount <= m_numTotalStrands);
+	const int endStrand = firstStrand + strandCount;
+
 	// construct local and global transforms for each hair strand.
-	ComputeTransforms();
+	ComputeTransforms(firstStrand, endStrand);
 
 	// compute tangent vectors
-	ComputeStrandTangent();
+	ComputeStrandTangent(firstStrand, endStrand);
 
 	// compute thickness coefficients
-	ComputeThicknessCoeffs();
+	ComputeThicknessCoeffs(firstStrand, endStrand);
 
 	// compute rest lengths
-	ComputeRestLengths();
+	ComputeRestLengths(firstStrand, endStrand);
 
 	// triangle index
-	FillTriangleIndexArray();
+	FillTriangleIndexArray(firstStrand, endStrand);
 
-	for (int i = 0; i < m_numTotalStrands; i++)
+	for (int i = firstStrand; i < endStrand; i++)
 		m_strandTypes[i] = 0;
-
-	return true;
 }
 
-void TressFXAsset::FillTriangleIndexArray()
+void TressFXAsset::FillTriangleIndexArray(int firstStrand, int endStrand)
 {
 	ASSERT(m_numTotalVertices == m_numTotalStrands * m_numVerticesPerStrand);
 	ASSERT(m_triangleIndices != nullptr);
 
-	int id = 0;
-	int iCount = 0;
+	int id = firstStrand * m_numVerticesPerStrand;
+	int iCount = 6 * firstStrand * (m_numVerticesPerStrand - 1);
 
-	for (int i = 0; i < m_numTotalStrands; i++)
+	for (int i = firstStrand; i < endStrand; i++)
 	{
 		for (int j = 0; j < m_numVerticesPerStrand - 1; j++)
 		{
@@ -523,15 +605,15 @@ void TressFXAsset::FillTriangleIndexArray()
 		id++;
 	}
 
-	ASSERT(iCount == 6 * m_numTotalStrands * (m_numVerticesPerStrand - 1));    // iCount == GetNumHairTriangleIndices()
+	ASSERT(iCount == 6 * endStrand * (m_numVerticesPerStrand - 1));    // iCount == GetNumHairTriangleIndices() for the last strand
 }
 
-void TressFXAsset::ComputeStrandTangent()
+void TressFXAsset::ComputeStrandTangent(int firstStrand, int endStrand)
 {
 	vec3* pos = (vec3*)m_positions;
 	vec3* tan = (vec3*)m_tangents;
 
-	for (int iStrand = 0; iStrand < m_numTotalStrands; ++iStrand)
+	for (int iStrand = firstStrand; iStrand < endStrand; ++iStrand)
 	{
 		int indexRootVertMaster = iStrand * m_numVerticesPerStrand;
 
@@ -563,17 +645,27 @@ void TressFXAsset::ComputeStrandTangent()
 
 			tan[indexRootVertMaster + i] = tangent;
 		}
+
+		// vertex n, written as well so the output doesn't depend on uninitialized memory
+		{
+			vec3& vert_n_minus_1 = pos[indexRootVertMaster + m_numVerticesPerStrand - 2];
+			vec3& vert_n = pos[indexRootVertMaster + m_numVerticesPerStrand - 1];
+
+			vec3 tangent = vert_n - vert_n_minus_1;
+			tangent = normalize(tangent);
+			tan[indexRootVertMaster + m_numVerticesPerStrand - 1] = tangent;
+		}
 	}
 }
 
-void TressFXAsset::ComputeThicknessCoeffs()
+void TressFXAsset::ComputeThicknessCoeffs(int firstStrand, int endStrand)
 {
 	vec3* pos = (vec3*)m_positions;
 
-	int   index = 0;
+	int   index = firstStrand * m_numVerticesPerStrand;
 	float tValues[TRESSFX_SIM_THREAD_GROUP_SIZE] = { 0.0f };
 
-	for (int iStrand = 0; iStrand < m_numTotalStrands; ++iStrand)
+	for (int iStrand = firstStrand; iStrand < endStrand; ++iStrand)
 	{
 		int   indexRootVertMaster = iStrand * m_numVerticesPerStrand;
 		float strandLength = 0;
@@ -601,15 +693,15 @@ void TressFXAsset::ComputeThicknessCoeffs()
 	}
 }
 
-void TressFXAsset::ComputeRestLengths()
+void TressFXAsset::ComputeRestLengths(int firstStrand, int endStrand)
 {
 	vec3*  pos = (vec3*)m_positions;
 	float* restLen = (float*)m_restLengths;
 
-	int index = 0;
+	int index = firstStrand * m_numVerticesPerStrand;
 
 	// Calculate rest lengths
-	for (int i = 0; i < m_numTotalStrands; i++)
+	for (int i = firstStrand; i < endStrand; i++)
 	{
 		int indexRootVert = i * m_numVerticesPerStrand;
 
@@ -624,7 +716,7 @@ void TressFXAsset::ComputeRestLengths()
 	}
 }
 
-void TressFXAsset::ComputeTransforms()
+void TressFXAsset::ComputeTransforms(int firstStrand, int endStrand)
 {
 	vec3* pos = (vec3*)m_positions;
 	Quat* globalRot = (Quat*)m_globalRotations;
@@ -632,7 +724,7 @@ void TressFXAsset::ComputeTransforms()
 	vec3* ref = (vec3*)m_refVectors;
 
 	// construct local and global transforms for all hair strands
-	for (int iStrand = 0; iStrand < m_numTotalStrands; ++iStrand)
+	for (int iStrand = firstStrand; iStrand < endStrand; ++iStrand)
 	{
 		int indexRootVertMaster = iStrand * m_numVerticesPerStrand;
 
@@ -669,6 +761,7 @@ void TressFXAsset::ComputeTransforms()
 			Quat rot = Quat(rotL2W);
 			localRot[indexRootVertMaster] = globalRot[indexRootVertMaster] =
 				rot;    // For vertex 0, local and global transforms are the same.
+			ref[indexRootVertMaster] = vec3(0.0f);    // Unused, the root has no parent to be relative to.
 		}
 
 		// vertex 1 through n-1
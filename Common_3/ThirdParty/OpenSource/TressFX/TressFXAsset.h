@@ -78,9 +78,19 @@ class TressFXAsset
 	//Generates follow hairs procedually.  If numFollowHairsPerGuideHair is zero, then this function won't do anything.
 	bool GenerateFollowHairs(int numFollowHairsPerGuideHair = 0, float tipSeparationFactor = 0, float maxRadiusAroundGuideHair = 0);
 
+	// GenerateFollowHairs in steps, so that ranges of guides can be generated on different threads between Begin and End.
+	// Every follow strand has its own random sequence seeded from its index, the result doesn't depend on how guides are split
+	bool BeginFollowHairs(int numFollowHairsPerGuideHair);
+	void GenerateFollowHairStrands(int firstGuide, int guideCount, float tipSeparationFactor, float maxRadiusAroundGuideHair);
+	void EndFollowHairs();
+
 	// Computes various parameters for simulation and rendering. After calling this function, data is ready to be passed to hair object.
 	bool ProcessAsset();
 
+	// ProcessAsset in steps, strands are independent so ranges of strands can be processed on different threads
+	bool BeginProcessAsset();
+	void ProcessStrands(int firstStrand, int strandCount);
+
 	inline unsigned GetNumHairSegments() { return m_numTotalStrands * (m_numVerticesPerStrand - 1); }
 	inline unsigned GetNumHairTriangleIndices() { return 6 * GetNumHairSegments(); }
 	inline unsigned GetNumHairLineIndices() { return 2 * GetNumHairSegments(); }
@@ -95,12 +105,16 @@ class TressFXAsset
 	// Resets variables and clears up allocate buffers.
 	void Clear();
 
-	// Helper functions for ProcessAsset.
-	void ComputeTransforms();
-	void ComputeThicknessCoeffs();
-	void ComputeStrandTangent();
-	void ComputeRestLengths();
-	void FillTriangleIndexArray();
+	// Helper functions for ProcessAsset, process the strands in [firstStrand, endStrand)
+	void ComputeTransforms(int firstStrand, int endStrand);
+	void ComputeThicknessCoeffs(int firstStrand, int endStrand);
+	void ComputeStrandTangent(int firstStrand, int endStrand);
+	void ComputeRestLengths(int firstStrand, int endStrand);
+	void FillTriangleIndexArray(int firstStrand, int endStrand);
+
+	// Loaded guide hair data, kept between BeginFollowHairs and EndFollowHairs
+	float4* m_guidePositions;
+	float2* m_guideStrandUV;
 };
 
 }    // namespace AMD
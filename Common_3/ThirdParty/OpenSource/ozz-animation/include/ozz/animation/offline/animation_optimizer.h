@@ -28,6 +28,8 @@
 #ifndef OZZ_OZZ_ANIMATION_OFFLINE_ANIMATION_OPTIMIZER_H_
 #define OZZ_OZZ_ANIMATION_OFFLINE_ANIMATION_OPTIMIZER_H_
 
+#include "ozz/base/containers/vector.h" //CONFFX_BEGIN
+
 namespace ozz {
 namespace animation {
 
@@ -79,6 +81,24 @@ class AnimationOptimizer {
   // (distance) that an optimization on a joint is allowed to generate on its
   // whole child hierarchy.
   float hierarchical_tolerance;
+
+  //CONFFX_BEGIN
+  // Tolerances of a single joint, used instead of the ones above for that
+  // joint.
+  struct JointTolerances {
+    float translation;
+    float rotation;
+    float scale;
+    // Also applies to all parents of the joint, so a tight tolerance on a
+    // finger is honored when optimizing the shoulder.
+    float hierarchical;
+  };
+
+  // Per joint tolerances, indexed by joint. Either empty, all joints use the
+  // global tolerances then, or one entry per joint of the skeleton.
+  typedef ozz::Vector<JointTolerances>::Std JointsTolerances;
+  JointsTolerances joints_tolerances;
+  //CONFFX_END
 };
 }  // namespace offline
 }  // namespace animation
@@ -100,6 +100,17 @@ class Animation {
 
   void Deallocate();
 
+  //CONFFX_BEGIN - Relocatable runtime images, see runtime_image.h
+  // Size in bytes of the runtime image of *this animation.
+  size_t GetImageSize() const;
+  // Writes the runtime image of *this animation to _image, which must be
+  // GetImageSize() bytes large.
+  void WriteImage(void* _image) const;
+  // Uses the animation stored in _image in place, without any allocation or
+  // copy. _image must outlive *this animation or the next Deallocate() call.
+  bool LoadImage(void* _image, size_t _size);
+  //CONFFX_END
+
  protected:
  private:
   // Disables copy and assignation.
@@ -128,6 +139,10 @@ class Animation {
   Range<TranslationKey> translations_;
   Range<RotationKey> rotations_;
   Range<ScaleKey> scales_;
+
+  //CONFFX_BEGIN - Buffers point into an image given to LoadImage, not owned
+  bool external_;
+  //CONFFX_END
 };
 }  // namespace animation
 
@@ -0,0 +1,133 @@
+//----------------------------------------------------------------------------//
+//                                                                            //
+// ozz-animation is hosted at http://github.com/guillaumeblanc/ozz-animation  //
+// and distributed under the MIT License (MIT).                               //
+//                                                                            //
+// Copyright (c) 2017 Guillaume Blanc                                         //
+//                                                                            //
+// Permission is hereby granted, free of charge, to any person obtaining a    //
+// copy of this software and associated documentation files (the "Software"), //
+// to deal in the Software without restriction, including without limitation  //
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,   //
+// and/or sell copies of the Software, and to permit persons to whom the      //
+// Software is furnished to do so, subject to the following conditions:       //
+//                                                                            //
+// The above copyright notice and this permission notice shall be included in //
+// all copies or substantial portions of the Software.                        //
+//                                                                            //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR //
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   //
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    //
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER //
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING    //
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER        //
+// DEALINGS IN THE SOFTWARE.                                                  //
+//                                                                            //
+//----------------------------------------------------------------------------//
+
+
+//CONFFX_BEGIN - Relocatable runtime images
+#ifndef OZZ_OZZ_ANIMATION_RUNTIME_RUNTIME_IMAGE_H_
+#define OZZ_OZZ_ANIMATION_RUNTIME_RUNTIME_IMAGE_H_
+
+#include "../../base/platform.h"
+
+namespace ozz {
+namespace animation {
+
+// Runtime images store a skeleton or an animation in the exact memory layout
+// used at runtime, so that a file can be mapped and used in place instead of
+// being deserialized through an archive. Arrays start 16 byte aligned relative
+// to the beginning of the image, which must itself be 16 byte aligned.
+// Images are specific to the pointer size and endianness of the platform that
+// wrote them, loading fails on any other platform.
+
+enum RuntimeImageType {
+  kRuntimeImageSkeleton = 1,
+  kRuntimeImageAnimation = 2,
+};
+
+enum RuntimeImageConstants {
+  kRuntimeImageMagic = 0x495a5a4f,  // "OZZI" in little endian.
+  kRuntimeImageVersion = 1,
+  kRuntimeImageAlignment = 16,
+};
+
+struct RuntimeImageHeader {
+  uint32_t magic;
+  uint32_t type;
+  uint32_t version;
+  // See RuntimeImageLayout().
+  uint32_t layout;
+  // Size of the whole image, header included.
+  uint64_t size;
+  // Address the pointers stored in the image are relocated to, 0 in files.
+  uint64_t base;
+};
+
+// Follows the header of a skeleton image. Bind poses, joint name pointers,
+// joint properties and joint names come next, in that order.
+struct SkeletonImage {
+  int32_t num_joints;
+  int32_t chars_count;
+  uint16_t soa_transform_size;
+  uint16_t joint_properties_size;
+  uint32_t padding;
+};
+
+// Follows the header of an animation image. Translation, rotation and scale
+// keys come next, followed by the name.
+struct AnimationImage {
+  float duration;
+  int32_t num_tracks;
+  int32_t name_len;
+  int32_t translation_count;
+  int32_t rotation_count;
+  int32_t scale_count;
+  uint16_t translation_key_size;
+  uint16_t rotation_key_size;
+  uint16_t scale_key_size;
+  uint16_t padding;
+};
+
+OZZ_STATIC_ASSERT(sizeof(RuntimeImageHeader) % kRuntimeImageAlignment == 0);
+OZZ_STATIC_ASSERT(sizeof(SkeletonImage) % kRuntimeImageAlignment == 0);
+OZZ_STATIC_ASSERT(sizeof(AnimationImage) % kRuntimeImageAlignment == 0);
+
+// Pointer size and endianness of this platform.
+inline uint32_t RuntimeImageLayout() {
+  const uint32_t one = 1;
+  const bool little_endian = *reinterpret_cast<const uint8_t*>(&one) == 1;
+  return static_cast<uint32_t>(sizeof(void*)) | (little_endian ? 0x100u : 0u);
+}
+
+inline size_t RuntimeImageAlign(size_t _size) {
+  return (_size + kRuntimeImageAlignment - 1) &
+         ~static_cast<size_t>(kRuntimeImageAlignment - 1);
+}
+
+// Returns the header of _image if it is a valid image of type _type that fits
+// in _size bytes, NULL otherwise.
+inline RuntimeImageHeader* GetRuntimeImageHeader(void* _image, size_t _size,
+                                                 RuntimeImageType _type) {
+  RuntimeImageHeader* header = reinterpret_cast<RuntimeImageHeader*>(_image);
+  if (!_image || _size < sizeof(RuntimeImageHeader) ||
+      header->magic != kRuntimeImageMagic || header->type != uint32_t(_type) ||
+      header->version != kRuntimeImageVersion ||
+      header->layout != RuntimeImageLayout() || header->size > _size ||
+      (reinterpret_cast<uintptr_t>(_image) & (kRuntimeImageAlignment - 1))) {
+    return NULL;
+  }
+  return header;
+}
+
+// Returns true if _data starts like a runtime image, of any type.
+inline bool IsRuntimeImage(const void* _data, size_t _size) {
+  return _data && _size >= sizeof(RuntimeImageHeader) &&
+         reinterpret_cast<const RuntimeImageHeader*>(_data)->magic ==
+             kRuntimeImageMagic;
+}
+}  // namespace animation
+}  // namespace ozz
+#endif  // OZZ_OZZ_ANIMATION_RUNTIME_RUNTIME_IMAGE_H_
+//CONFFX_END
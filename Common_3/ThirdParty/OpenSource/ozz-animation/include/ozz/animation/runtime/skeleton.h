@@ -124,6 +124,18 @@ class Skeleton {
 
   void Deallocate();
 
+  //CONFFX_BEGIN - Relocatable runtime images, see runtime_image.h
+  // Size in bytes of the runtime image of *this skeleton.
+  size_t GetImageSize() const;
+  // Writes the runtime image of *this skeleton to _image, which must be
+  // GetImageSize() bytes large.
+  void WriteImage(void* _image) const;
+  // Uses the skeleton stored in _image in place, without any allocation or
+  // copy. Joint name pointers are relocated in place so _image must be
+  // writable, it must outlive *this skeleton or the next Deallocate() call.
+  bool LoadImage(void* _image, size_t _size);
+  //CONFFX_END
+
  private:
   // Disables copy and assignation.
   Skeleton(Skeleton const&);
@@ -148,6 +160,10 @@ class Skeleton {
 
   // Stores the name of every joint in an array of c-strings.
   Range<char*> joint_names_;
+
+  //CONFFX_BEGIN - Buffers point into an image given to LoadImage, not owned
+  bool external_;
+  //CONFFX_END
 };
 }  // namespace animation
 
@@ -53,6 +53,7 @@ namespace {
 struct JointSpec {
   float length;
   float scale;
+  float tolerance;  // Hierarchical tolerance //CONFFX_BEGIN
 };
 
 typedef ozz::Vector<JointSpec>::Std JointSpecs;
@@ -66,6 +67,9 @@ JointSpec Iter(const Skeleton& _skeleton, uint16_t _joint,
   const Skeleton::JointProperties* properties =
       _skeleton.joint_properties().begin;
 
+  // The tightest hierarchical tolerance of the joint and its children applies. //CONFFX_BEGIN
+  hierarchical_joint_spec.tolerance = local_joint_spec.tolerance;
+
   // Applies parent's scale to this joint.
   uint16_t parent = properties[_joint].parent;
   if (parent != Skeleton::kNoParentIndex) {
@@ -99,18 +103,22 @@ JointSpec Iter(const Skeleton& _skeleton, uint16_t _joint,
           max(hierarchical_joint_spec.length, child_spec.length); //CONFFX_BEGIN
       hierarchical_joint_spec.scale =
           max(hierarchical_joint_spec.scale, child_spec.scale); //CONFFX_BEGIN
+      hierarchical_joint_spec.tolerance =
+          min(hierarchical_joint_spec.tolerance, child_spec.tolerance); //CONFFX_BEGIN
     }
   }
 
   // Returns accumulated specs for this joint.
   const JointSpec spec = {
       hierarchical_joint_spec.length + local_joint_spec.length,
-      hierarchical_joint_spec.scale * _local_joint_specs[_joint].scale};
+      hierarchical_joint_spec.scale * _local_joint_specs[_joint].scale,
+      hierarchical_joint_spec.tolerance}; //CONFFX_BEGIN
   return spec;
 }
 
 void BuildHierarchicalSpecs(const RawAnimation& _animation,
                             const Skeleton& _skeleton,
+                            const AnimationOptimizer& _optimizer, //CONFFX_BEGIN
                             JointSpecs* _hierarchical_joint_specs) {
   assert(_animation.num_tracks() == _skeleton.num_joints());
 
@@ -147,6 +155,13 @@ void BuildHierarchicalSpecs(const RawAnimation& _animation,
       max_scale = 1.f;
     }
     local_joint_specs[i].scale = max_scale;
+
+    //CONFFX_BEGIN
+    local_joint_specs[i].tolerance =
+        _optimizer.joints_tolerances.empty()
+            ? _optimizer.hierarchical_tolerance
+            : _optimizer.joints_tolerances[i].hierarchical;
+    //CONFFX_END
   }
 
   // Iterates all skeleton roots.
@@ -274,9 +289,15 @@ bool AnimationOptimizer::operator()(const RawAnimation& _input,
     return false;
   }
 
+  // Validates joint tolerances match the skeleton. //CONFFX_BEGIN
+  if (!joints_tolerances.empty() &&
+      joints_tolerances.size() != static_cast<size_t>(_skeleton.num_joints())) {
+    return false;
+  }
+
   // First computes bone lengths, that will be used when filtering.
   JointSpecs hierarchical_joint_specs;
-  BuildHierarchicalSpecs(_input, _skeleton, &hierarchical_joint_specs);
+  BuildHierarchicalSpecs(_input, _skeleton, *this, &hierarchical_joint_specs); //CONFFX_BEGIN
 
   // Rebuilds output animation.
   _output->name = _input.name;
@@ -284,15 +305,24 @@ bool AnimationOptimizer::operator()(const RawAnimation& _input,
   _output->tracks.resize(_input.tracks.size());
 
   for (size_t i = 0; i < _input.tracks.size(); ++i) {
+    //CONFFX_BEGIN
+    JointTolerances tolerances = {translation_tolerance, rotation_tolerance,
+                                  scale_tolerance, hierarchical_tolerance};
+    if (!joints_tolerances.empty()) {
+      tolerances = joints_tolerances[i];
+    }
+    const float hierarchical = hierarchical_joint_specs[i].tolerance;
+
     Filter(_input.tracks[i].translations, CompareTranslation, LerpTranslation,
-           translation_tolerance, hierarchical_tolerance,
+           tolerances.translation, hierarchical,
            hierarchical_joint_specs[i].scale, &_output->tracks[i].translations);
     Filter(_input.tracks[i].rotations, CompareRotation, LerpRotation,
-           rotation_tolerance, hierarchical_tolerance,
+           tolerances.rotation, hierarchical,
            hierarchical_joint_specs[i].length, &_output->tracks[i].rotations);
-    Filter(_input.tracks[i].scales, CompareScale, LerpScale, scale_tolerance,
-           hierarchical_tolerance, hierarchical_joint_specs[i].length,
+    Filter(_input.tracks[i].scales, CompareScale, LerpScale, tolerances.scale,
+           hierarchical, hierarchical_joint_specs[i].length,
            &_output->tracks[i].scales);
+    //CONFFX_END
   }
 
   // Output animation is always valid though.
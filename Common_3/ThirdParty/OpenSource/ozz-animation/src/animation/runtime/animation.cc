@@ -45,10 +45,13 @@
 #define OZZ_INCLUDE_PRIVATE_HEADER  // Allows to include private headers.
 #include "animation_keyframe.h"
 
+#include "../../../include/ozz/animation/runtime/runtime_image.h"
+
 namespace ozz {
 namespace animation {
 
-Animation::Animation() : duration_(0.f), num_tracks_(0), name_(NULL) {}
+Animation::Animation()
+    : duration_(0.f), num_tracks_(0), name_(NULL), external_(false) {}
 
 Animation::~Animation() {
 	
@@ -98,7 +101,12 @@ void Animation::Allocate(size_t _name_len, size_t _translation_count,
 
 void Animation::Deallocate() {
 
-  memory::default_allocator()->Deallocate(translations_.begin);
+  //CONFFX_BEGIN - Image buffers are owned by the caller of LoadImage
+  if (!external_) {
+    memory::default_allocator()->Deallocate(translations_.begin);
+  }
+  external_ = false;
+  //CONFFX_END
 
   name_ = NULL;
   translations_ = ozz::Range<TranslationKey>();
@@ -218,5 +226,123 @@ void Animation::Load(ozz::io::IArchive& _archive, uint32_t _version) {
     _archive >> ozz::io::MakeArray(key.value);
   }
 }
+//CONFFX_BEGIN - Relocatable runtime images
+namespace {
+// Offsets of the animation arrays from the beginning of the image.
+struct AnimationImageOffsets {
+  AnimationImageOffsets(size_t _name_len, size_t _translation_count,
+                        size_t _rotation_count, size_t _scale_count) {
+    translations = sizeof(RuntimeImageHeader) + sizeof(AnimationImage);
+    rotations = translations + _translation_count * sizeof(TranslationKey);
+    scales = rotations + _rotation_count * sizeof(RotationKey);
+    name = scales + _scale_count * sizeof(ScaleKey);
+    size = RuntimeImageAlign(name + (_name_len > 0 ? _name_len + 1 : 0));
+  }
+  size_t translations;
+  size_t rotations;
+  size_t scales;
+  size_t name;
+  size_t size;
+};
+}  // namespace
+
+size_t Animation::GetImageSize() const {
+  return AnimationImageOffsets(name_ ? eastl::CharStrlen(name_) : 0,
+                               translations_.count(), rotations_.count(),
+                               scales_.count())
+      .size;
+}
+
+void Animation::WriteImage(void* _image) const {
+  const size_t name_len = name_ ? eastl::CharStrlen(name_) : 0;
+  const AnimationImageOffsets offsets(name_len, translations_.count(),
+                                      rotations_.count(), scales_.count());
+
+  char* image = reinterpret_cast<char*>(_image);
+  memset(image, 0, offsets.size);
+
+  RuntimeImageHeader* header = reinterpret_cast<RuntimeImageHeader*>(image);
+  header->magic = kRuntimeImageMagic;
+  header->type = kRuntimeImageAnimation;
+  header->version = kRuntimeImageVersion;
+  header->layout = RuntimeImageLayout();
+  header->size = offsets.size;
+  header->base = 0;
+
+  AnimationImage* body =
+      reinterpret_cast<AnimationImage*>(image + sizeof(RuntimeImageHeader));
+  body->duration = duration_;
+  body->num_tracks = num_tracks_;
+  body->name_len = static_cast<int32_t>(name_len);
+  body->translation_count = static_cast<int32_t>(translations_.count());
+  body->rotation_count = static_cast<int32_t>(rotations_.count());
+  body->scale_count = static_cast<int32_t>(scales_.count());
+  body->translation_key_size = static_cast<uint16_t>(sizeof(TranslationKey));
+  body->rotation_key_size = static_cast<uint16_t>(sizeof(RotationKey));
+  body->scale_key_size = static_cast<uint16_t>(sizeof(ScaleKey));
+
+  // Keys are plain data, arrays are copied as they are laid out in memory.
+  if (translations_.size()) {
+    memcpy(image + offsets.translations, translations_.begin,
+           translations_.size());
+  }
+  if (rotations_.size()) {
+    memcpy(image + offsets.rotations, rotations_.begin, rotations_.size());
+  }
+  if (scales_.size()) {
+    memcpy(image + offsets.scales, scales_.begin, scales_.size());
+  }
+  if (name_len) {
+    memcpy(image + offsets.name, name_, name_len);
+  }
+}
+
+bool Animation::LoadImage(void* _image, size_t _size) {
+  RuntimeImageHeader* header =
+      GetRuntimeImageHeader(_image, _size, kRuntimeImageAnimation);
+  if (!header ||
+      header->size < sizeof(RuntimeImageHeader) + sizeof(AnimationImage)) {
+    LOGF(LogLevel::eERROR, "Invalid Animation image.");
+    return false;
+  }
+
+  char* image = reinterpret_cast<char*>(_image);
+  const AnimationImage* body = reinterpret_cast<const AnimationImage*>(
+      image + sizeof(RuntimeImageHeader));
+  if (body->translation_key_size != sizeof(TranslationKey) ||
+      body->rotation_key_size != sizeof(RotationKey) ||
+      body->scale_key_size != sizeof(ScaleKey) || body->num_tracks < 0 ||
+      body->name_len < 0 || body->translation_count < 0 ||
+      body->rotation_count < 0 || body->scale_count < 0) {
+    LOGF(LogLevel::eERROR, "Animation image was written for another layout.");
+    return false;
+  }
+
+  const AnimationImageOffsets offsets(body->name_len, body->translation_count,
+                                      body->rotation_count, body->scale_count);
+  if (offsets.size > header->size ||
+      (body->name_len && image[offsets.name + body->name_len] != 0)) {
+    LOGF(LogLevel::eERROR, "Truncated Animation image.");
+    return false;
+  }
+
+  // Destroy animation in case it was already used before.
+  Deallocate();
+
+  duration_ = body->duration;
+  num_tracks_ = body->num_tracks;
+  translations_.begin =
+      reinterpret_cast<TranslationKey*>(image + offsets.translations);
+  translations_.end = reinterpret_cast<TranslationKey*>(image + offsets.rotations);
+  rotations_.begin = reinterpret_cast<RotationKey*>(image + offsets.rotations);
+  rotations_.end = reinterpret_cast<RotationKey*>(image + offsets.scales);
+  scales_.begin = reinterpret_cast<ScaleKey*>(image + offsets.scales);
+  scales_.end = reinterpret_cast<ScaleKey*>(image + offsets.name);
+  name_ = body->name_len ? image + offsets.name : NULL;
+  external_ = true;
+
+  return true;
+}
+//CONFFX_END
 }  // namespace animation
 }  // namespace ozz
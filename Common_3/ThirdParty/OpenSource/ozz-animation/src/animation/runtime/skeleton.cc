@@ -28,6 +28,7 @@
 //CONFFX_BEGIN
 #include "../../../include/ozz/animation/runtime/skeleton.h"
 #include <cstring>
+#include "../../../include/ozz/animation/runtime/runtime_image.h"
 #include "../../../include/ozz/base/io/archive.h"
 #include "../../../include/ozz/base/maths/math_ex.h"
 #include "../../../include/ozz/base/maths/soa_math_archive.h"
@@ -78,7 +79,7 @@ struct Extern<animation::Skeleton::JointProperties> {
 
 namespace animation {
 
-Skeleton::Skeleton() {}
+Skeleton::Skeleton() : external_(false) {}
 
 Skeleton::~Skeleton() { 
 	
@@ -143,7 +144,12 @@ char* Skeleton::Allocate(size_t _chars_size, size_t _num_joints) {
 //CONFFX_END
 
 void Skeleton::Deallocate() {
-  memory::default_allocator()->Deallocate(bind_pose_.begin);
+  //CONFFX_BEGIN - Image buffers are owned by the caller of LoadImage
+  if (!external_) {
+    memory::default_allocator()->Deallocate(bind_pose_.begin);
+  }
+  external_ = false;
+  //CONFFX_END
   bind_pose_.Clear();
   joint_names_.Clear();
   joint_properties_.Clear();
@@ -213,5 +219,146 @@ void Skeleton::Load(ozz::io::IArchive& _archive, uint32_t _version) {
   _archive >> ozz::io::MakeArray(joint_properties_);
   _archive >> ozz::io::MakeArray(bind_pose_);
 }
+//CONFFX_BEGIN - Relocatable runtime images
+namespace {
+// Offsets of the skeleton arrays from the beginning of the image.
+struct SkeletonImageOffsets {
+  SkeletonImageOffsets(size_t _num_joints, size_t _chars_count) {
+    bind_pose = sizeof(RuntimeImageHeader) + sizeof(SkeletonImage);
+    names = bind_pose + (_num_joints + 3) / 4 * sizeof(SoaTransform);
+    properties = names + _num_joints * sizeof(char*);
+    chars = properties + _num_joints * sizeof(Skeleton::JointProperties);
+    size = RuntimeImageAlign(chars + _chars_count);
+  }
+  size_t bind_pose;
+  size_t names;
+  size_t properties;
+  size_t chars;
+  size_t size;
+};
+
+size_t GetCharsCount(Range<const char* const> _names) {
+  size_t chars_count = 0;
+  for (size_t i = 0; i < _names.count(); ++i) {
+    chars_count += eastl::CharStrlen(_names[i]) + 1;
+  }
+  return chars_count;
+}
+}  // namespace
+
+size_t Skeleton::GetImageSize() const {
+  return SkeletonImageOffsets(num_joints(), GetCharsCount(joint_names()))
+      .size;
+}
+
+void Skeleton::WriteImage(void* _image) const {
+  const int num_joints = this->num_joints();
+  const size_t chars_count = GetCharsCount(joint_names());
+  const SkeletonImageOffsets offsets(num_joints, chars_count);
+
+  char* image = reinterpret_cast<char*>(_image);
+  memset(image, 0, offsets.size);
+
+  RuntimeImageHeader* header = reinterpret_cast<RuntimeImageHeader*>(image);
+  header->magic = kRuntimeImageMagic;
+  header->type = kRuntimeImageSkeleton;
+  header->version = kRuntimeImageVersion;
+  header->layout = RuntimeImageLayout();
+  header->size = offsets.size;
+  header->base = 0;
+
+  SkeletonImage* body =
+      reinterpret_cast<SkeletonImage*>(image + sizeof(RuntimeImageHeader));
+  body->num_joints = num_joints;
+  body->chars_count = static_cast<int32_t>(chars_count);
+  body->soa_transform_size = static_cast<uint16_t>(sizeof(SoaTransform));
+  body->joint_properties_size =
+      static_cast<uint16_t>(sizeof(Skeleton::JointProperties));
+
+  if (!num_joints) {
+    return;
+  }
+
+  memcpy(image + offsets.bind_pose, bind_pose_.begin, bind_pose_.size());
+  memcpy(image + offsets.properties, joint_properties_.begin,
+         joint_properties_.size());
+  // Names are all concatenated in the same buffer, starting at
+  // joint_names_[0]. Name pointers are stored as offsets from the image.
+  memcpy(image + offsets.chars, joint_names_[0], chars_count);
+  uintptr_t* names = reinterpret_cast<uintptr_t*>(image + offsets.names);
+  for (int i = 0; i < num_joints; ++i) {
+    names[i] = offsets.chars + (joint_names_[i] - joint_names_[0]);
+  }
+}
+
+bool Skeleton::LoadImage(void* _image, size_t _size) {
+  RuntimeImageHeader* header =
+      GetRuntimeImageHeader(_image, _size, kRuntimeImageSkeleton);
+  if (!header ||
+      header->size < sizeof(RuntimeImageHeader) + sizeof(SkeletonImage)) {
+    LOGF(LogLevel::eERROR, "Invalid Skeleton image.");
+    return false;
+  }
+
+  char* image = reinterpret_cast<char*>(_image);
+  const SkeletonImage* body =
+      reinterpret_cast<const SkeletonImage*>(image + sizeof(RuntimeImageHeader));
+  if (body->soa_transform_size != sizeof(SoaTransform) ||
+      body->joint_properties_size != sizeof(Skeleton::JointProperties) ||
+      body->num_joints < 0 || body->num_joints > kMaxJoints ||
+      body->chars_count < body->num_joints) {
+    LOGF(LogLevel::eERROR, "Skeleton image was written for another layout.");
+    return false;
+  }
+
+  const size_t num_joints = body->num_joints;
+  const SkeletonImageOffsets offsets(num_joints, body->chars_count);
+  if (offsets.size > header->size ||
+      (num_joints && image[offsets.chars + body->chars_count - 1] != 0)) {
+    LOGF(LogLevel::eERROR, "Truncated Skeleton image.");
+    return false;
+  }
+
+  // Deallocate skeleton in case it was already used before.
+  Deallocate();
+
+  if (!num_joints) {
+    return true;
+  }
+
+  bind_pose_.begin = reinterpret_cast<SoaTransform*>(image + offsets.bind_pose);
+  bind_pose_.end = reinterpret_cast<SoaTransform*>(image + offsets.names);
+  joint_names_.begin = reinterpret_cast<char**>(image + offsets.names);
+  joint_names_.end = reinterpret_cast<char**>(image + offsets.properties);
+  joint_properties_.begin =
+      reinterpret_cast<JointProperties*>(image + offsets.properties);
+  joint_properties_.end =
+      reinterpret_cast<JointProperties*>(image + offsets.chars);
+  external_ = true;
+
+  // Relocates name pointers from the address they were last relocated to,
+  // images that are loaded again at the same address are left untouched.
+  const uintptr_t base = reinterpret_cast<uintptr_t>(image);
+  if (header->base != base) {
+    uintptr_t* names = reinterpret_cast<uintptr_t*>(joint_names_.begin);
+    const uintptr_t old_base = static_cast<uintptr_t>(header->base);
+    for (size_t i = 0; i < num_joints; ++i) {
+      const uintptr_t offset = names[i] - old_base;
+      if (offset < offsets.chars ||
+          offset >= offsets.chars + body->chars_count) {
+        LOGF(LogLevel::eERROR, "Corrupted Skeleton image joint names.");
+        Deallocate();
+        return false;
+      }
+    }
+    for (size_t i = 0; i < num_joints; ++i) {
+      names[i] = names[i] - old_base + base;
+    }
+    header->base = base;
+  }
+
+  return true;
+}
+//CONFFX_END
 }  // namespace animation
 }  // namespace ozz
@@ -31,6 +31,7 @@
 #include "../../../ThirdParty/OpenSource/EASTL/string.h"
 #include "../../../ThirdParty/OpenSource/EASTL/vector.h"
 #include "../../../ThirdParty/OpenSource/EASTL/unordered_map.h"
+#include "../../../ThirdParty/OpenSource/EASTL/sort.h"
 
 // OZZ
 //#include "../../../ThirdParty/OpenSource/ozz-animation/include/ozz/base/io/stream.h"
@@ -39,9 +40,15 @@
 #include "../../../ThirdParty/OpenSource/ozz-animation/include/ozz/animation/offline/raw_animation.h"
 #include "../../../ThirdParty/OpenSource/ozz-animation/include/ozz/animation/offline/skeleton_builder.h"
 #include "../../../ThirdParty/OpenSource/ozz-animation/include/ozz/animation/offline/animation_builder.h"
+#include "../../../ThirdParty/OpenSource/ozz-animation/include/ozz/animation/offline/animation_optimizer.h"
+#include "../../../ThirdParty/OpenSource/ozz-animation/include/ozz/animation/offline/raw_animation_utils.h"
+#include "../../../ThirdParty/OpenSource/ozz-animation/include/ozz/animation/runtime/runtime_image.h"
 
 #include "../../../ThirdParty/OpenSource/tinyimageformat/tinyimageformat_base.h"
 
+// Mesh optimization
+#include "../../../ThirdParty/OpenSource/meshoptimizer/src/meshoptimizer.h"
+
 // TressFX
 #include "../../../ThirdParty/OpenSource/TressFX/TressFXAsset.h"
 
@@ -52,9 +59,37 @@
 #define TINYKTX_IMPLEMENTATION
 #include "../../../OS/Core/TextureContainers.h"
 
+#define TINYDDS_IMPLEMENTATION
+#include "../../../ThirdParty/OpenSource/tinydds/tinydds.h"
+#include "../../../ThirdParty/OpenSource/tinyimageformat/tinyimageformat_encode.h"
+
+// Source images
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_STDIO
+#define STBI_ONLY_PNG
+#define STBI_ONLY_TGA
+#define STBI_ONLY_JPEG
+#define STBI_MALLOC tf_malloc
+#define STBI_REALLOC tf_realloc
+#define STBI_FREE tf_free
+#define STBI_ASSERT ASSERT
+#include "../../../ThirdParty/OpenSource/Nothings/stb_image.h"
+#include "../../../ThirdParty/OpenSource/TinyEXR/tinyexr.h"
+
+// Scripts
+extern "C"
+{
+#include "../../../ThirdParty/OpenSource/lua-5.3.5/src/lua.h"
+#include "../../../ThirdParty/OpenSource/lua-5.3.5/src/lauxlib.h"
+}
+#include "../../../../Middleware_3/LUA/LuaBytecode.h"
+
 #include "../../../OS/Interfaces/IOperatingSystem.h"
 #include "../../../OS/Interfaces/IFileSystem.h"
 #include "../../../OS/Interfaces/ILog.h"
+#include "../../../OS/Interfaces/IThread.h"
+#include "../../../OS/Interfaces/ITime.h"
+#include "../../../OS/Core/ThreadSystem.h"
 
 #include "../../FileSystem/IToolFileSystem.h"
 
@@ -163,7 +198,7 @@ cgltf_result cgltf_parse_and_load(const char* skeletonAsset, cgltf_data** ppData
 	return result;
 }
 
-cgltf_result cgltf_write(const char* skeletonAsset, cgltf_data* data)
+cgltf_result cgltf_write(const char* skeletonAsset, cgltf_data* data, ResourceDirectory resourceDir = RD_INPUT)
 {
 	cgltf_options options = {};
 	options.memory_alloc = [](void* user, cgltf_size size) { return tf_malloc(size); };
@@ -178,7 +213,7 @@ cgltf_result cgltf_write(const char* skeletonAsset, cgltf_data* data)
 	}
 
 	FileStream file = {};
-	fsOpenStreamFromPath(RD_INPUT, skeletonAsset, FM_WRITE, &file);
+	fsOpenStreamFromPath(resourceDir, skeletonAsset, FM_WRITE, &file);
 	fsWriteToStream(&file, writeBuffer, actual - 1);
 	fsCloseStream(&file);
 	tf_free(writeBuffer);
@@ -186,6 +221,511 @@ cgltf_result cgltf_write(const char* skeletonAsset, cgltf_data* data)
 	return cgltf_result_success;
 }
 
+//--------------------------------------------------------------------------------------------
+// Build database
+//--------------------------------------------------------------------------------------------
+
+// Bump whenever the output of a command changes so every asset gets rebuilt by the new tool
+#define ASSET_PIPELINE_VERSION 3
+
+#define BUILD_DATABASE_MAGIC 0x42445041u    // "APDB"
+#define BUILD_DATABASE_VERSION 1
+
+#define FNV1A_64_OFFSET_BASIS 14695981039346656037ull
+#define FNV1A_64_PRIME 1099511628211ull
+
+enum BuildRecordFlags
+{
+	BUILD_RECORD_FLAG_NONE = 0x0,
+	// The input was processed but did not produce an output file (e.g. a mesh without any lods)
+	BUILD_RECORD_FLAG_NO_OUTPUT = 0x1,
+};
+
+struct BuildRecord
+{
+	uint64_t mKey;     // Hash of the input path
+	uint64_t mHash;    // Hash of the input content, command settings, tool version and dependency
+	uint32_t mFlags;
+	uint32_t mPadding;
+};
+
+// Persistent record of the last successful build of every input, stored next to the output of a command.
+// Content hashes keep assets up-to-date across checkouts, which touch the modification time of every file.
+struct BuildDatabase
+{
+	eastl::unordered_map<uint64_t, BuildRecord> mRecords;
+	Mutex                                       mMutex;
+	char                                        mFileName[FS_MAX_PATH];
+};
+
+static uint64_t HashBytes(const void* pData, size_t size, uint64_t hash = FNV1A_64_OFFSET_BASIS)
+{
+	const uint8_t* bytes = (const uint8_t*)pData;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= FNV1A_64_PRIME;
+	}
+	return hash;
+}
+
+static bool HashFile(ResourceDirectory resourceDir, const char* path, uint64_t* pHash)
+{
+	FileStream file = {};
+	if (!fsOpenStreamFromPath(resourceDir, path, FM_READ_BINARY, &file))
+		return false;
+
+	const size_t chunkSize = 1024 * 1024;
+	uint8_t* chunk = (uint8_t*)tf_malloc(chunkSize);
+	uint64_t hash = *pHash;
+	size_t bytesRead = 0;
+	while ((bytesRead = fsReadFromStream(&file, chunk, chunkSize)) > 0)
+		hash = HashBytes(chunk, bytesRead, hash);
+
+	tf_free(chunk);
+	fsCloseStream(&file);
+
+	*pHash = hash;
+	return true;
+}
+
+// Hashes the content of an input, including the external buffers referenced by a gltf
+static bool HashAssetInput(const char* input, uint64_t* pHash)
+{
+	if (!HashFile(RD_INPUT, input, pHash))
+		return false;
+
+	char extension[FS_MAX_PATH] = {};
+	fsGetPathExtension(input, extension);
+	if (stricmp(extension, "gltf"))
+		return true;
+
+	FileStream file = {};
+	if (!fsOpenStreamFromPath(RD_INPUT, input, FM_READ_BINARY, &file))
+		return false;
+
+	ssize_t fileSize = fsGetStreamFileSize(&file);
+	void* fileData = tf_malloc(fileSize);
+	fsReadFromStream(&file, fileData, fileSize);
+	fsCloseStream(&file);
+
+	cgltf_data* data = NULL;
+	cgltf_options options = {};
+	options.memory_alloc = [](void* user, cgltf_size size) { return tf_malloc(size); };
+	options.memory_free = [](void* user, void* ptr) { tf_free(ptr); };
+	bool success = cgltf_parse(&options, fileData, fileSize, &data) == cgltf_result_success;
+
+	for (cgltf_size i = 0; success && i < data->buffers_count; ++i)
+	{
+		const char* uri = data->buffers[i].uri;
+		if (!uri || !strncmp(uri, "data:", 5) || strstr(uri, "://"))
+			continue;
+
+		char parent[FS_MAX_PATH] = { 0 };
+		fsGetParentPath(input, parent);
+		char path[FS_MAX_PATH] = { 0 };
+		fsAppendPathComponent(parent, uri, path);
+		success = HashFile(RD_INPUT, path, pHash);
+	}
+
+	if (data)
+		cgltf_free(data);
+	tf_free(fileData);
+
+	return success;
+}
+
+static void LoadBuildDatabase(const char* command, BuildDatabase* pDatabase)
+{
+	pDatabase->mMutex.Init();
+	sprintf(pDatabase->mFileName, "%s.builddb", command);
+
+	FileStream file = {};
+	if (!fsOpenStreamFromPath(RD_OUTPUT, pDatabase->mFileName, FM_READ_BINARY, &file))
+		return;
+
+	uint32_t header[3] = {};
+	if (fsReadFromStream(&file, header, sizeof(header)) == sizeof(header) && header[0] == BUILD_DATABASE_MAGIC &&
+		header[1] == BUILD_DATABASE_VERSION)
+	{
+		for (uint32_t i = 0; i < header[2]; ++i)
+		{
+			BuildRecord record = {};
+			if (fsReadFromStream(&file, &record, sizeof(record)) != sizeof(record))
+				break;
+			pDatabase->mRecords[record.mKey] = record;
+		}
+	}
+
+	fsCloseStream(&file);
+}
+
+static void SaveBuildDatabase(BuildDatabase* pDatabase)
+{
+	FileStream file = {};
+	if (fsOpenStreamFromPath(RD_OUTPUT, pDatabase->mFileName, FM_WRITE_BINARY, &file))
+	{
+		const uint32_t header[3] = { BUILD_DATABASE_MAGIC, BUILD_DATABASE_VERSION, (uint32_t)pDatabase->mRecords.size() };
+		fsWriteToStream(&file, header, sizeof(header));
+		for (eastl::unordered_map<uint64_t, BuildRecord>::iterator it = pDatabase->mRecords.begin(); it != pDatabase->mRecords.end(); ++it)
+			fsWriteToStream(&file, &it->second, sizeof(BuildRecord));
+		fsCloseStream(&file);
+	}
+	else
+	{
+		LOGF(LogLevel::eWARNING, "Failed to write build database %s.", pDatabase->mFileName);
+	}
+
+	pDatabase->mMutex.Destroy();
+}
+
+//--------------------------------------------------------------------------------------------
+// Job graph
+//--------------------------------------------------------------------------------------------
+
+struct AssetJob;
+typedef bool (*AssetJobFunc)(AssetJob* pJob, ProcessAssetsSettings* settings);
+
+// One input of a command. Jobs without a dependency run concurrently on the ThreadSystem,
+// a job with a dependency starts once that job succeeded.
+struct AssetJob
+{
+	eastl::string           mInput;
+	eastl::string           mOutput;
+	AssetJobFunc            pProcess;
+	// Optional, called instead of pProcess for an up-to-date job whose result is needed by its dependents
+	AssetJobFunc            pLoadUpToDate;
+	void*                   pUserData;
+	uint32_t                mDependency;    // UINT32_MAX if the job has no dependency
+	eastl::vector<uint32_t> mDependents;
+	uint64_t                mBuildHash;
+	int64_t                 mDurationUs;
+	bool                    mUpToDate;
+	bool                    mSucceeded;
+	bool                    mNoOutput;      // Set by pProcess when the input produced nothing to write
+};
+
+static AssetJob CreateAssetJob(const char* input, const char* output, AssetJobFunc pProcess, void* pUserData = NULL)
+{
+	AssetJob job = {};
+	job.mInput = input;
+	job.mOutput = output;
+	job.pProcess = pProcess;
+	job.pUserData = pUserData;
+	job.mDependency = UINT32_MAX;
+	return job;
+}
+
+struct AssetJobGraph
+{
+	AssetJob*               pJobs;
+	uint32_t                mJobCount;
+	ProcessAssetsSettings*  pSettings;
+	BuildDatabase*          pDatabase;
+	uint64_t                mCommandHash;   // Command, its settings and the tool version
+	Mutex                   mMutex;
+	ConditionVariable       mCond;
+	eastl::vector<uint32_t> mReadyJobs;
+	uint32_t                mPendingJobs;
+};
+
+static void RunAssetJob(AssetJobGraph* pGraph, AssetJob* pJob)
+{
+	ProcessAssetsSettings* settings = pGraph->pSettings;
+	BuildDatabase* pDatabase = pGraph->pDatabase;
+	const int64_t startTime = getUSec();
+
+	const uint64_t key = HashBytes(pJob->mInput.c_str(), pJob->mInput.size());
+	uint64_t hash = pGraph->mCommandHash;
+	if (pJob->mDependency != UINT32_MAX)
+		hash = HashBytes(&pGraph->pJobs[pJob->mDependency].mBuildHash, sizeof(uint64_t), hash);
+	const bool hashed = HashAssetInput(pJob->mInput.c_str(), &hash);
+	pJob->mBuildHash = hash;
+
+	if (hashed && !settings->force)
+	{
+		pDatabase->mMutex.Acquire();
+		eastl::unordered_map<uint64_t, BuildRecord>::iterator it = pDatabase->mRecords.find(key);
+		const bool found = it != pDatabase->mRecords.end() && it->second.mHash == hash;
+		const uint32_t flags = found ? it->second.mFlags : BUILD_RECORD_FLAG_NONE;
+		pDatabase->mMutex.Release();
+
+		pJob->mUpToDate = found && ((flags & BUILD_RECORD_FLAG_NO_OUTPUT) || fsGetLastModifiedTime(RD_OUTPUT, pJob->mOutput.c_str()) != ~0u);
+		if (pJob->mUpToDate && pJob->pLoadUpToDate)
+			pJob->mUpToDate = pJob->pLoadUpToDate(pJob, settings);
+	}
+
+	if (pJob->mUpToDate)
+	{
+		pJob->mSucceeded = true;
+	}
+	else
+	{
+		pJob->mSucceeded = pJob->pProcess(pJob, settings);
+
+		pDatabase->mMutex.Acquire();
+		if (pJob->mSucceeded && hashed)
+		{
+			BuildRecord record = {};
+			record.mKey = key;
+			record.mHash = hash;
+			record.mFlags = pJob->mNoOutput ? BUILD_RECORD_FLAG_NO_OUTPUT : BUILD_RECORD_FLAG_NONE;
+			pDatabase->mRecords[key] = record;
+		}
+		else
+		{
+			pDatabase->mRecords.erase(key);
+		}
+		pDatabase->mMutex.Release();
+	}
+
+	pJob->mDurationUs = getUSec() - startTime;
+}
+
+// Needs pGraph->mMutex. Dependents of a failed job fail without running.
+static void CompleteAssetJob(AssetJobGraph* pGraph, uint32_t jobIndex)
+{
+	AssetJob* pJob = &pGraph->pJobs[jobIndex];
+	--pGraph->mPendingJobs;
+
+	for (uint32_t dependent : pJob->mDependents)
+	{
+		if (pJob->mSucceeded)
+		{
+			pGraph->mReadyJobs.push_back(dependent);
+		}
+		else
+		{
+			LOGF(LogLevel::eERROR, "Skipping %s, its dependency %s failed.", pGraph->pJobs[dependent].mInput.c_str(), pJob->mInput.c_str());
+			CompleteAssetJob(pGraph, dependent);
+		}
+	}
+}
+
+static void AssetJobWorker(void* pUserData, uintptr_t)
+{
+	AssetJobGraph* pGraph = (AssetJobGraph*)pUserData;
+
+	pGraph->mMutex.Acquire();
+	while (true)
+	{
+		while (pGraph->mReadyJobs.empty() && pGraph->mPendingJobs)
+			pGraph->mCond.Wait(pGraph->mMutex);
+
+		if (!pGraph->mPendingJobs)
+			break;
+
+		const uint32_t jobIndex = pGraph->mReadyJobs.back();
+		pGraph->mReadyJobs.pop_back();
+		pGraph->mMutex.Release();
+
+		RunAssetJob(pGraph, &pGraph->pJobs[jobIndex]);
+
+		pGraph->mMutex.Acquire();
+		CompleteAssetJob(pGraph, jobIndex);
+		pGraph->mCond.WakeAll();
+	}
+	pGraph->mMutex.Release();
+}
+
+static void PrintAssetJobReport(const char* command, AssetJob* pJobs, uint32_t jobCount, uint32_t threadCount, int64_t durationUs)
+{
+	eastl::vector<AssetJob*> processedJobs;
+	uint32_t upToDateCount = 0;
+	uint32_t failedCount = 0;
+	for (uint32_t i = 0; i < jobCount; ++i)
+	{
+		if (pJobs[i].mUpToDate)
+			++upToDateCount;
+		else if (pJobs[i].mDurationUs)
+			processedJobs.push_back(&pJobs[i]);
+
+		if (!pJobs[i].mSucceeded)
+			++failedCount;
+	}
+
+	// Slowest assets first, they bound the wall time of the build
+	eastl::sort(processedJobs.begin(), processedJobs.end(), [](const AssetJob* a, const AssetJob* b) { return a->mDurationUs > b->mDurationUs; });
+	for (const AssetJob* pJob : processedJobs)
+	{
+		LOGF(LogLevel::eINFO, "%10.2f ms  %s%s", (double)pJob->mDurationUs / 1000.0, pJob->mInput.c_str(),
+			pJob->mSucceeded ? "" : " (failed)");
+	}
+
+	LOGF(LogLevel::eINFO, "%s: %u processed, %u up-to-date, %u failed in %.2f s using %u threads.", command,
+		(uint32_t)processedJobs.size(), upToDateCount, failedCount, (double)durationUs / 1000000.0, threadCount);
+}
+
+// Runs all jobs of a command, skipping inputs whose build hash matches the build database
+static bool RunAssetJobs(const char* command, eastl::vector<AssetJob>& jobs, uint64_t settingsHash, ProcessAssetsSettings* settings)
+{
+	if (jobs.empty())
+		return true;
+
+	const int64_t startTime = getUSec();
+
+	BuildDatabase database;
+	LoadBuildDatabase(command, &database);
+
+	const uint32_t version = ASSET_PIPELINE_VERSION;
+	AssetJobGraph graph = {};
+	graph.pJobs = jobs.data();
+	graph.mJobCount = (uint32_t)jobs.size();
+	graph.pSettings = settings;
+	graph.pDatabase = &database;
+	graph.mCommandHash = HashBytes(command, strlen(command), HashBytes(&version, sizeof(version), settingsHash));
+	graph.mPendingJobs = graph.mJobCount;
+	graph.mMutex.Init();
+	graph.mCond.Init();
+
+	// Ready jobs are taken from the back, so push them in reverse to start in directory order
+	for (uint32_t i = graph.mJobCount; i-- > 0;)
+	{
+		if (jobs[i].mDependency == UINT32_MAX)
+			graph.mReadyJobs.push_back(i);
+		else
+			jobs[jobs[i].mDependency].mDependents.push_back(i);
+	}
+
+	// The calling thread works on the graph as well, so --jobs N starts N - 1 workers
+	uint32_t workerCount = settings->mJobCount ? settings->mJobCount - 1 : (uint32_t)MAX_SYSTEM_THREADS;
+	workerCount = min(workerCount, graph.mJobCount - 1);
+
+	ThreadSystem* pThreadSystem = NULL;
+	if (workerCount)
+	{
+		initThreadSystem(&pThreadSystem, workerCount, 0, true, "AssetPipelineWorker");
+		workerCount = getThreadSystemThreadCount(pThreadSystem);
+		addThreadSystemRangeTask(pThreadSystem, AssetJobWorker, &graph, workerCount);
+	}
+
+	AssetJobWorker(&graph, 0);
+
+	if (pThreadSystem)
+	{
+		waitThreadSystemIdle(pThreadSystem);
+		shutdownThreadSystem(pThreadSystem);
+	}
+
+	graph.mCond.Destroy();
+	graph.mMutex.Destroy();
+
+	SaveBuildDatabase(&database);
+
+	bool success = true;
+	uint32_t processedCount = 0;
+	for (const AssetJob& job : jobs)
+	{
+		success = success && job.mSucceeded;
+		processedCount += job.mUpToDate ? 0 : 1;
+	}
+
+	if (!settings->quiet)
+	{
+		if (processedCount == 0 && success)
+			LOGF(LogLevel::eINFO, "All assets already up-to-date.");
+		else
+			PrintAssetJobReport(command, jobs.data(), (uint32_t)jobs.size(), workerCount + 1, getUSec() - startTime);
+	}
+
+	return success;
+}
+
+//--------------------------------------------------------------------------------------------
+// Task ranges
+//--------------------------------------------------------------------------------------------
+
+// Tasks of one job queued on the ThreadSystem shared by all jobs of a command
+struct AssetTaskRange
+{
+	void            (*pFunc)(void* pUserData, uintptr_t taskIndex);
+	void*           pUserData;
+	tfrg_atomic32_t mPendingTasks;
+};
+
+static void RunAssetTaskRangeTask(void* pUserData, uintptr_t taskIndex)
+{
+	AssetTaskRange* pRange = (AssetTaskRange*)pUserData;
+	pRange->pFunc(pRange->pUserData, taskIndex);
+	// Publishes the results of the task to the job waiting for the range
+	tfrg_atomic32_add_release(&pRange->mPendingTasks, (uint32_t)-1);
+}
+
+// Runs pFunc for tasks 0 to taskCount - 1 and returns once all of them finished.
+// The calling job runs queued tasks while it waits, those of other jobs as well
+static void RunAssetTasks(ThreadSystem* pThreadSystem, void (*pFunc)(void*, uintptr_t), void* pUserData, uint32_t taskCount)
+{
+	if (!pThreadSystem || taskCount <= 1)
+	{
+		for (uint32_t i = 0; i < taskCount; ++i)
+			pFunc(pUserData, i);
+		return;
+	}
+
+	AssetTaskRange range = {};
+	range.pFunc = pFunc;
+	range.pUserData = pUserData;
+	range.mPendingTasks = taskCount;
+	addThreadSystemRangeTask(pThreadSystem, RunAssetTaskRangeTask, &range, taskCount);
+	while (tfrg_atomic32_load_acquire(&range.mPendingTasks))
+	{
+		if (!assistThreadSystem(pThreadSystem))
+			Thread::Sleep(0);
+	}
+}
+
+// Skeleton shared by the jobs of an animation asset
+struct AnimationAsset
+{
+	eastl::string            mName;
+	ozz::animation::Skeleton mSkeleton;
+	// Skeleton file mSkeleton points into when it was loaded from a runtime image
+	MappedFile               mSkeletonImage = {};
+};
+
+static bool ProcessSkeletonJob(AssetJob* pJob, ProcessAssetsSettings* settings)
+{
+	AnimationAsset* pAsset = (AnimationAsset*)pJob->pUserData;
+	return AssetPipeline::CreateRuntimeSkeleton(
+		pJob->mInput.c_str(), pAsset->mName.c_str(), pJob->mOutput.c_str(), &pAsset->mSkeleton, settings);
+}
+
+static bool LoadSkeletonJob(AssetJob* pJob, ProcessAssetsSettings* settings)
+{
+	AnimationAsset* pAsset = (AnimationAsset*)pJob->pUserData;
+
+	// Load skeleton from disk
+	MappedFile* pImage = &pAsset->mSkeletonImage;
+	if (!fsMapFileFromPath(RD_OUTPUT, pJob->mOutput.c_str(), pImage))
+		return false;
+
+	if (ozz::animation::IsRuntimeImage(pImage->pData, pImage->mSize))
+	{
+		if (!pAsset->mSkeleton.LoadImage(pImage->pData, pImage->mSize))
+			return false;
+	}
+	else
+	{
+		FileStream file = {};
+		fsOpenStreamFromMemory(pImage->pData, pImage->mSize, FM_READ, false, &file);
+		ozz::io::IArchive archive(&file);
+		archive >> pAsset->mSkeleton;
+		fsCloseStream(&file);
+		fsUnmapFile(pImage);
+	}
+
+	return pAsset->mSkeleton.num_joints() > 0;
+}
+
+static bool ProcessAnimationJob(AssetJob* pJob, ProcessAssetsSettings* settings)
+{
+	AnimationAsset* pAsset = (AnimationAsset*)pJob->pUserData;
+	char animationName[FS_MAX_PATH] = {};
+	fsGetPathFileName(pJob->mInput.c_str(), animationName);
+	return AssetPipeline::CreateRuntimeAnimation(
+		pJob->mInput.c_str(), &pAsset->mSkeleton, pAsset->mName.c_str(), animationName, pJob->mOutput.c_str(), settings);
+}
+
 bool AssetPipeline::ProcessAnimations(ProcessAssetsSettings* settings)
 {
 	// Check for assets containing animations in animationDirectory
@@ -250,12 +790,14 @@ bool AssetPipeline::ProcessAnimations(ProcessAssetsSettings* settings)
 	if (animationAssets.empty())
 		return true;
 
-	// Process the found assets
-	int  assetsProcessed = 0;
-	bool success = true;
+	// One skeleton job per asset, its animations depend on it
+	eastl::vector<AnimationAsset*> assets;
+	eastl::vector<AssetJob>        jobs;
 	for (AnimationAssetMap::iterator it = animationAssets.begin(); it != animationAssets.end(); ++it)
 	{
-		const char* skinnedMesh = it->second[0].c_str();
+		AnimationAsset* pAsset = tf_new(AnimationAsset);
+		pAsset->mName = it->first;
+		assets.push_back(pAsset);
 
 		// Create skeleton output file name
 		char skeletonOutputDir[FS_MAX_PATH] = {};
@@ -263,43 +805,10 @@ bool AssetPipeline::ProcessAnimations(ProcessAssetsSettings* settings)
 		char skeletonOutput[FS_MAX_PATH] = {};
 		fsAppendPathComponent(skeletonOutputDir, "skeleton.ozz", skeletonOutput);
 
-		// Check if the skeleton is already up-to-date
-		bool processSkeleton = true;
-		if (!settings->force)
-		{
-			time_t lastModified = fsGetLastModifiedTime(RD_INPUT, skinnedMesh);
-			time_t lastProcessed = fsGetLastModifiedTime(RD_OUTPUT, skeletonOutput);
-
-			if (lastModified < lastProcessed && lastProcessed != ~0u && lastProcessed > settings->minLastModifiedTime)
-				processSkeleton = false;
-		}
-
-		ozz::animation::Skeleton skeleton;
-		if (processSkeleton)
-		{
-			// Process the skeleton
-			if (!CreateRuntimeSkeleton(skinnedMesh, it->first.c_str(), skeletonOutput, &skeleton, settings))
-			{
-				success = false;
-				continue;
-			}
-
-			++assetsProcessed;
-		}
-		else
-		{
-			// Load skeleton from disk
-			FileStream file = {};
-
+		const uint32_t skeletonJob = (uint32_t)jobs.size();
+		jobs.push_back(CreateAssetJob(it->second[0].c_str(), skeletonOutput, ProcessSkeletonJob, pAsset));
+		jobs.back().pLoadUpToDate = LoadSkeletonJob;
 
-			if (!fsOpenStreamFromPath(RD_OUTPUT, skeletonOutput, FM_READ_BINARY, &file))
-				return false;
-			ozz::io::IArchive archive(&file);
-			archive >> skeleton;
-			fsCloseStream(&file);
-		}
-
-		// Process animations
 		for (size_t i = 1; i < it->second.size(); ++i)
 		{
 			const char* animationFile = it->second[i].c_str();
@@ -311,421 +820,1708 @@ bool AssetPipeline::ProcessAnimations(ProcessAssetsSettings* settings)
 			char animationOutput[FS_MAX_PATH] = {};
 			fsAppendPathComponent("", outputFileString.c_str(), animationOutput);
 
-			// Check if the animation is already up-to-date
-			bool processAnimation = true;
-			if (!settings->force && !processSkeleton)
-			{
-				time_t lastModified = fsGetLastModifiedTime(RD_INPUT, animationFile);
-				time_t lastProcessed = fsGetLastModifiedTime(RD_OUTPUT, animationOutput);
+			jobs.push_back(CreateAssetJob(animationFile, animationOutput, ProcessAnimationJob, pAsset));
+			jobs.back().mDependency = skeletonJob;
+		}
+	}
 
-				if (lastModified < lastProcessed && lastProcessed != ~0u && lastModified > settings->minLastModifiedTime)
-					processAnimation = false;
-			}
+	uint64_t settingsHash = HashBytes(&settings->mOptimizeAnimations, sizeof(settings->mOptimizeAnimations));
+	settingsHash = HashBytes(&settings->mAnimationRuntimeImages, sizeof(settings->mAnimationRuntimeImages), settingsHash);
+	settingsHash = HashBytes(&settings->mAnimationTranslationTolerance, sizeof(settings->mAnimationTranslationTolerance), settingsHash);
+	settingsHash = HashBytes(&settings->mAnimationRotationTolerance, sizeof(settings->mAnimationRotationTolerance), settingsHash);
+	settingsHash = HashBytes(&settings->mAnimationScaleTolerance, sizeof(settings->mAnimationScaleTolerance), settingsHash);
+	settingsHash = HashBytes(&settings->mAnimationHierarchicalTolerance, sizeof(settings->mAnimationHierarchicalTolerance), settingsHash);
+	settingsHash = HashBytes(
+		settings->mAnimationJointTolerances, settings->mAnimationJointToleranceCount * sizeof(AnimationJointTolerance), settingsHash);
+	bool success = RunAssetJobs("ProcessAnimations", jobs, settingsHash, settings);
+
+	for (AnimationAsset* pAsset : assets)
+	{
+		pAsset->mSkeleton.Deallocate();
+		fsUnmapFile(&pAsset->mSkeletonImage);
+		tf_delete(pAsset);
+	}
 
-			if (processAnimation)
-			{
-				// Process the animation
-				if (!CreateRuntimeAnimation(
-					animationFile, &skeleton, it->first.c_str(), animationName, animationOutput, settings))
-					continue;
+	return success;
+}
 
-				++assetsProcessed;
-			}
-		}
+// One row of pages of a tiled mip. Pages are tiled and compressed in parallel, then written in order.
+struct SVTPageRow
+{
+	const uint8_t*  pRows;          // Source rows of the page row, mRowCount rows of mRowPitch bytes
+	uint32_t        mRowPitch;
+	uint32_t        mRowCount;
+	uint32_t        mPageSize;
+	uint32_t        mComponentCount;
+	uint32_t        mCompression;
+	uint8_t*        pPages;         // Tiled pages, mPageBytes each
+	uint8_t*        pCompressedPages;
+	uint32_t*       pPageSizes;     // Stored size of each page, mPageBytes if the page is stored as is
+	uint32_t        mPageBytes;
+};
+
+static void TileSVTPage(void* pUserData, uintptr_t pageX)
+{
+	SVTPageRow* pRow = (SVTPageRow*)pUserData;
+	const uint32_t texelSize = pRow->mComponentCount;
+	const uint32_t rowWidth = pRow->mRowPitch / texelSize;
+	const uint32_t firstTexel = (uint32_t)pageX * pRow->mPageSize;
+	const uint32_t copyTexels = min(pRow->mPageSize, rowWidth - firstTexel);
+	uint8_t* pPage = pRow->pPages + pageX * pRow->mPageBytes;
+
+	// Pages over the right and bottom edge of mips that are not a multiple of the page size repeat the edge texels
+	for (uint32_t y = 0; y < pRow->mPageSize; ++y)
+	{
+		const uint8_t* pSrc = pRow->pRows + min(y, pRow->mRowCount - 1) * pRow->mRowPitch + firstTexel * texelSize;
+		uint8_t* pDst = pPage + y * pRow->mPageSize * texelSize;
+		memcpy(pDst, pSrc, copyTexels * texelSize);
+		for (uint32_t x = copyTexels; x < pRow->mPageSize; ++x)
+			memcpy(pDst + x * texelSize, pSrc + (copyTexels - 1) * texelSize, texelSize);
+	}
+
+	uint32_t storedSize = pRow->mPageBytes;
+	if (pRow->mCompression == SVT_PAGE_COMPRESSION_LZ)
+	{
+		uint8_t* pCompressed = pRow->pCompressedPages + pageX * pRow->mPageBytes;
+		const uint32_t compressedSize = util_compress_svt_page(pPage, pRow->mPageBytes, pCompressed, pRow->mPageBytes - 1);
+		if (compressedSize)
+			storedSize = compressedSize;
+	}
+
+	pRow->pPageSizes[pageX] = storedSize;
+}
+
+// Reads the mip chain from pSrc a page row at a time, so memory use stays at a few rows of pages for any texture size
+static bool SaveSVT(const char* fileName, FileStream* pSrc, SVT_HEADER* pHeader, ThreadSystem* pThreadSystem, const ProcessAssetsSettings* settings)
+{
+	const uint32_t componentCount = pHeader->mComponentCount;
+	const uint32_t pageSize = pHeader->mPageSize;
+	const uint32_t pageBytes = pageSize * pageSize * componentCount;
+
+	pHeader->mMagic = SVT_MAGIC;
+	pHeader->mVersion = SVT_VERSION;
+	pHeader->mTiledMipCount = 0;
+	pHeader->mPageCount = 0;
+	while (pHeader->mTiledMipCount < pHeader->mMipLevels && (pHeader->mWidth >> pHeader->mTiledMipCount) >= pageSize &&
+		   (pHeader->mHeight >> pHeader->mTiledMipCount) >= pageSize)
+	{
+		const uint32_t mip = pHeader->mTiledMipCount++;
+		pHeader->mPageCount += round_up(pHeader->mWidth >> mip, pageSize) / pageSize * (round_up(pHeader->mHeight >> mip, pageSize) / pageSize);
+	}
+
+	FileStream fh = {};
+	if (!fsOpenStreamFromPath(RD_OUTPUT, fileName, FM_WRITE_BINARY, &fh))
+		return false;
+
+	// The offset table is written again once all page sizes are known
+	eastl::vector<uint64_t> pageOffsets(pHeader->mPageCount + 2, 0);
+	fsWriteToStream(&fh, pHeader, sizeof(SVT_HEADER));
+	fsWriteToStream(&fh, pageOffsets.data(), pageOffsets.size() * sizeof(uint64_t));
+	uint64_t offset = sizeof(SVT_HEADER) + pageOffsets.size() * sizeof(uint64_t);
+
+	const uint32_t maxPagesX = round_up(pHeader->mWidth, pageSize) / pageSize;
+	eastl::vector<uint8_t> rows((size_t)pageSize * pHeader->mWidth * componentCount);
+	eastl::vector<uint8_t> pages((size_t)maxPagesX * pageBytes);
+	eastl::vector<uint8_t> compressedPages(pHeader->mCompression == SVT_PAGE_COMPRESSION_LZ ? pages.size() : 0);
+	eastl::vector<uint32_t> pageSizes(maxPagesX);
+
+	bool success = true;
+	uint32_t pageIndex = 0;
+	for (uint32_t mip = 0; mip < pHeader->mTiledMipCount && success; ++mip)
+	{
+		const uint32_t mipWidth = max(1u, pHeader->mWidth >> mip);
+		const uint32_t mipHeight = max(1u, pHeader->mHeight >> mip);
+		const uint32_t pagesX = round_up(mipWidth, pageSize) / pageSize;
+
+		for (uint32_t y = 0; y < mipHeight && success; y += pageSize)
+		{
+			SVTPageRow row = {};
+			row.pRows = rows.data();
+			row.mRowPitch = mipWidth * componentCount;
+			row.mRowCount = min(pageSize, mipHeight - y);
+			row.mPageSize = pageSize;
+			row.mComponentCount = componentCount;
+			row.mCompression = pHeader->mCompression;
+			row.pPages = pages.data();
+			row.pCompressedPages = compressedPages.data();
+			row.pPageSizes = pageSizes.data();
+			row.mPageBytes = pageBytes;
+
+			const size_t rowBytes = (size_t)row.mRowCount * row.mRowPitch;
+			if (fsReadFromStream(pSrc, rows.data(), rowBytes) != rowBytes)
+			{
+				success = false;
+				break;
+			}
+
+			RunAssetTasks(pThreadSystem, TileSVTPage, &row, pagesX);
+
+			for (uint32_t x = 0; x < pagesX; ++x, ++pageIndex)
+			{
+				const uint8_t* pPage = pageSizes[x] == pageBytes ? pages.data() + x * pageBytes : compressedPages.data() + x * pageBytes;
+				pageOffsets[pageIndex] = offset;
+				offset += fsWriteToStream(&fh, pPage, pageSizes[x]);
+			}
+		}
+	}
+
+	// The mip tail is small, it is stored as one block
+	if (success)
+	{
+		eastl::vector<uint8_t> mipTail;
+		for (uint32_t mip = pHeader->mTiledMipCount; mip < pHeader->mMipLevels && success; ++mip)
+		{
+			const size_t mipSize = (size_t)max(1u, pHeader->mWidth >> mip) * max(1u, pHeader->mHeight >> mip) * componentCount;
+			const size_t tailSize = mipTail.size();
+			mipTail.resize(tailSize + mipSize);
+			success = fsReadFromStream(pSrc, mipTail.data() + tailSize, mipSize) == mipSize;
+		}
+
+		uint32_t storedSize = (uint32_t)mipTail.size();
+		if (pHeader->mCompression == SVT_PAGE_COMPRESSION_LZ && !mipTail.empty())
+		{
+			compressedPages.resize(max(compressedPages.size(), mipTail.size()));
+			const uint32_t compressedSize = util_compress_svt_page(mipTail.data(), (uint32_t)mipTail.size(), compressedPages.data(), (uint32_t)mipTail.size() - 1);
+			if (compressedSize)
+				storedSize = compressedSize;
+		}
+
+		pageOffsets[pHeader->mPageCount] = offset;
+		offset += fsWriteToStream(&fh, storedSize == mipTail.size() ? mipTail.data() : compressedPages.data(), storedSize);
+		pageOffsets[pHeader->mPageCount + 1] = offset;
+	}
+
+	if (success)
+	{
+		fsSeekStream(&fh, SBO_START_OF_FILE, sizeof(SVT_HEADER));
+		fsWriteToStream(&fh, pageOffsets.data(), pageOffsets.size() * sizeof(uint64_t));
+	}
+
+	fsCloseStream(&fh);
+
+	if (success && pHeader->mCompression == SVT_PAGE_COMPRESSION_LZ && !settings->quiet)
+	{
+		const uint64_t rawSize = (uint64_t)pHeader->mPageCount * pageBytes;
+		const uint64_t storedSize = pageOffsets[pHeader->mPageCount] - pageOffsets[0];
+		LOGF(LogLevel::eINFO, "%s: %u pages compressed to %.1f%%.", fileName, pHeader->mPageCount, rawSize ? 100.0 * storedSize / rawSize : 100.0);
+	}
+
+	return success;
+}
+
+static bool ProcessVirtualTextureJob(AssetJob* pJob, ProcessAssetsSettings* settings)
+{
+	TextureDesc textureDesc = {};
+	FileStream ddsFile = {};
+	if (!fsOpenStreamFromPath(RD_INPUT, pJob->mInput.c_str(), FM_READ_BINARY, &ddsFile))
+	{
+		LOGF(LogLevel::eERROR, "Failed to open image %s.", pJob->mInput.c_str());
+		return false;
+	}
+
+	bool success = loadDDSTextureDesc(&ddsFile, &textureDesc);
+
+	if (!success)
+	{
+		fsCloseStream(&ddsFile);
+		LOGF(LogLevel::eERROR, "Failed to load image %s.", pJob->mInput.c_str());
+		return false;
+	}
+
+	SVT_HEADER header = {};
+	header.mComponentCount = 4;
+	header.mHeight = textureDesc.mHeight;
+	header.mMipLevels = textureDesc.mMipLevels;
+	header.mPageSize = 128;
+	header.mWidth = textureDesc.mWidth;
+	header.mCompression = settings->mCompressVirtualTexturePages ? SVT_PAGE_COMPRESSION_LZ : SVT_PAGE_COMPRESSION_NONE;
+
+	success = SaveSVT(pJob->mOutput.c_str(), &ddsFile, &header, (ThreadSystem*)pJob->pUserData, settings);
+
+	fsCloseStream(&ddsFile);
+
+	if (!success)
+		LOGF(LogLevel::eERROR, "Failed to save sparse virtual texture %s.", pJob->mOutput.c_str());
+
+	return success;
+}
+
+bool AssetPipeline::ProcessVirtualTextures(ProcessAssetsSettings* settings)
+{
+	// Get all image files
+	eastl::vector<eastl::string> ddsFilesInDirectory;
+	fsGetFilesWithExtension(RD_INPUT, "", ".dds", ddsFilesInDirectory);
+
+	// Pages of all textures are tiled on these threads, see RunAssetTasks
+	ThreadSystem* pThreadSystem = NULL;
+	if (settings->mJobCount != 1 && !ddsFilesInDirectory.empty())
+		initThreadSystem(&pThreadSystem, settings->mJobCount ? settings->mJobCount - 1 : (uint32_t)MAX_SYSTEM_THREADS, 0, true, "SVTPageWorker");
+
+	eastl::vector<AssetJob> jobs;
+	for (size_t i = 0; i < ddsFilesInDirectory.size(); ++i)
+	{
+		eastl::string outputFile = ddsFilesInDirectory[i];
+
+		if (outputFile.size() > 0)
+		{
+			outputFile.resize(outputFile.size() - 4);
+			outputFile.append(".svt");
+			jobs.push_back(CreateAssetJob(ddsFilesInDirectory[i].c_str(), outputFile.c_str(), ProcessVirtualTextureJob, pThreadSystem));
+		}
+	}
+
+	const uint64_t settingsHash = HashBytes(&settings->mCompressVirtualTexturePages, sizeof(settings->mCompressVirtualTexturePages));
+	bool success = RunAssetJobs("ProcessVirtualTextures", jobs, settingsHash, settings);
+
+	if (pThreadSystem)
+	{
+		waitThreadSystemIdle(pThreadSystem);
+		shutdownThreadSystem(pThreadSystem);
+	}
+
+	return success;
+}
+
+//--------------------------------------------------------------------------------------------
+// Texture cooking
+//--------------------------------------------------------------------------------------------
+
+#define TEXTURE_TASK_ROWS 16
+
+// Rows of a texture processed TEXTURE_TASK_ROWS rows per task
+struct TextureTask
+{
+	void     (*pFunc)(void* pUserData, uintptr_t row);
+	void*    pUserData;
+	uint32_t mRowCount;
+};
+
+static void RunTextureTaskRows(void* pUserData, uintptr_t taskIndex)
+{
+	TextureTask* pTask = (TextureTask*)pUserData;
+	const uint32_t firstRow = (uint32_t)taskIndex * TEXTURE_TASK_ROWS;
+	const uint32_t lastRow = min(firstRow + TEXTURE_TASK_ROWS, pTask->mRowCount);
+	for (uint32_t row = firstRow; row < lastRow; ++row)
+		pTask->pFunc(pTask->pUserData, row);
+}
+
+static void RunTextureTask(ThreadSystem* pThreadSystem, void (*pFunc)(void*, uintptr_t), void* pUserData, uint32_t rowCount)
+{
+	TextureTask task = {};
+	task.pFunc = pFunc;
+	task.pUserData = pUserData;
+	task.mRowCount = rowCount;
+
+	RunAssetTasks(pThreadSystem, RunTextureTaskRows, &task, round_up(rowCount, TEXTURE_TASK_ROWS) / TEXTURE_TASK_ROWS);
+}
+
+// One level of a texture in linear float rgba, filters and encoders work on whole texels as one SIMD vector
+struct TextureMip
+{
+	uint32_t               mWidth;
+	uint32_t               mHeight;
+	eastl::vector<Vector4> mTexels;
+};
+
+static float SrgbToLinear(float value)
+{
+	return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float value)
+{
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static bool LoadSourceImage8(const char* fileName, const uint8_t* pData, uint32_t size, bool srgb, TextureMip* pMip)
+{
+	int width = 0, height = 0, components = 0;
+	stbi_uc* pPixels = stbi_load_from_memory(pData, (int)size, &width, &height, &components, 4);
+	if (!pPixels)
+	{
+		LOGF(LogLevel::eERROR, "Failed to decode image %s: %s.", fileName, stbi_failure_reason());
+		return false;
+	}
+
+	float toFloat[256];
+	for (uint32_t i = 0; i < 256; ++i)
+		toFloat[i] = srgb ? SrgbToLinear(i / 255.0f) : i / 255.0f;
+
+	pMip->mWidth = (uint32_t)width;
+	pMip->mHeight = (uint32_t)height;
+	pMip->mTexels.resize((size_t)width * height);
+	for (size_t i = 0; i < pMip->mTexels.size(); ++i)
+	{
+		const stbi_uc* pTexel = pPixels + i * 4;
+		// Alpha is coverage, it is never sRGB encoded
+		pMip->mTexels[i] = Vector4(toFloat[pTexel[0]], toFloat[pTexel[1]], toFloat[pTexel[2]], pTexel[3] / 255.0f);
+	}
+
+	stbi_image_free(pPixels);
+	return true;
+}
+
+static bool LoadSourceImageEXR(const char* fileName, const uint8_t* pData, TextureMip* pMip)
+{
+	EXRImage image;
+	InitEXRImage(&image);
+
+	const char* error = NULL;
+	if (ParseMultiChannelEXRHeaderFromMemory(&image, pData, &error) != 0)
+	{
+		LOGF(LogLevel::eERROR, "Failed to parse exr header of %s: %s", fileName, error ? error : "");
+		return false;
+	}
+
+	// Half channels are widened while decoding, the filter runs in float anyway
+	for (int c = 0; c < image.num_channels; ++c)
+	{
+		if (image.pixel_types[c] == TINYEXR_PIXELTYPE_HALF)
+			image.requested_pixel_types[c] = TINYEXR_PIXELTYPE_FLOAT;
+	}
+
+	if (LoadMultiChannelEXRFromMemory(&image, pData, &error) != 0)
+	{
+		LOGF(LogLevel::eERROR, "Failed to decode exr image %s: %s", fileName, error ? error : "");
+		FreeEXRImage(&image);
+		return false;
+	}
+
+	int channels[4] = { -1, -1, -1, -1 };
+	const char* channelNames[4] = { "R", "G", "B", "A" };
+	for (int c = 0; c < image.num_channels; ++c)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			if (!strcmp(image.channel_names[c], channelNames[i]))
+				channels[i] = c;
+		}
+	}
+
+	// Luminance only images (no R channel) are replicated to rgb
+	if (channels[0] < 0 && image.num_channels)
+		channels[0] = channels[1] = channels[2] = 0;
+
+	pMip->mWidth = (uint32_t)image.width;
+	pMip->mHeight = (uint32_t)image.height;
+	pMip->mTexels.resize((size_t)image.width * image.height);
+	for (size_t i = 0; i < pMip->mTexels.size(); ++i)
+	{
+		float texel[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		for (int j = 0; j < 4; ++j)
+		{
+			const int c = channels[j];
+			if (c < 0)
+				continue;
+			if (image.pixel_types[c] == TINYEXR_PIXELTYPE_UINT)
+				texel[j] = (float)((const uint32_t*)image.images[c])[i];
+			else
+				texel[j] = ((const float*)image.images[c])[i];
+		}
+		pMip->mTexels[i] = Vector4(texel[0], texel[1], texel[2], texel[3]);
+	}
+
+	FreeEXRImage(&image);
+	return true;
+}
+
+// Separable 4 tap [1 3 3 1] / 8 filter centered on the 2x2 source texels of each destination texel.
+// Sharper than a box filter at the same cost, and odd sized levels still get every source texel.
+struct TextureMipFilter
+{
+	const TextureMip* pSrc;
+	TextureMip*       pDst;
+	Vector4*          pRows;    // pSrc->mHeight rows of pDst->mWidth texels, filtered horizontally
+};
+
+static void FilterMipRow(void* pUserData, uintptr_t y)
+{
+	TextureMipFilter* pFilter = (TextureMipFilter*)pUserData;
+	const uint32_t srcWidth = pFilter->pSrc->mWidth;
+	const uint32_t dstWidth = pFilter->pDst->mWidth;
+	const Vector4* pSrc = pFilter->pSrc->mTexels.data() + y * srcWidth;
+	Vector4* pDst = pFilter->pRows + y * dstWidth;
+
+	const uint32_t last = srcWidth - 1;
+	for (uint32_t x = 0; x < dstWidth; ++x)
+	{
+		const uint32_t x0 = 2 * x;
+		pDst[x] = (pSrc[x0 ? x0 - 1 : 0] + pSrc[min(x0 + 2, last)]) * 0.125f + (pSrc[min(x0, last)] + pSrc[min(x0 + 1, last)]) * 0.375f;
+	}
+}
+
+static void FilterMipColumn(void* pUserData, uintptr_t y)
+{
+	TextureMipFilter* pFilter = (TextureMipFilter*)pUserData;
+	const uint32_t width = pFilter->pDst->mWidth;
+	const uint32_t last = pFilter->pSrc->mHeight - 1;
+	const uint32_t y0 = 2 * (uint32_t)y;
+	const Vector4* pRow0 = pFilter->pRows + (y0 ? y0 - 1 : 0) * width;
+	const Vector4* pRow1 = pFilter->pRows + min(y0, last) * width;
+	const Vector4* pRow2 = pFilter->pRows + min(y0 + 1, last) * width;
+	const Vector4* pRow3 = pFilter->pRows + min(y0 + 2, last) * width;
+	Vector4* pDst = pFilter->pDst->mTexels.data() + y * width;
+
+	for (uint32_t x = 0; x < width; ++x)
+		pDst[x] = (pRow0[x] + pRow3[x]) * 0.125f + (pRow1[x] + pRow2[x]) * 0.375f;
+}
+
+static void GenerateMip(ThreadSystem* pThreadSystem, const TextureMip* pSrc, TextureMip* pDst, eastl::vector<Vector4>& rows)
+{
+	pDst->mWidth = max(1u, pSrc->mWidth >> 1);
+	pDst->mHeight = max(1u, pSrc->mHeight >> 1);
+	pDst->mTexels.resize((size_t)pDst->mWidth * pDst->mHeight);
+	rows.resize((size_t)pDst->mWidth * pSrc->mHeight);
+
+	TextureMipFilter filter = { pSrc, pDst, rows.data() };
+	RunTextureTask(pThreadSystem, FilterMipRow, &filter, pSrc->mHeight);
+	RunTextureTask(pThreadSystem, FilterMipColumn, &filter, pDst->mHeight);
+}
+
+static void EncodeTexel8(const Vector4& texel, bool srgb, uint8_t* pOut)
+{
+	const Vector4 clamped = minPerElem(maxPerElem(texel, Vector4(0.0f)), Vector4(1.0f));
+	for (int i = 0; i < 4; ++i)
+	{
+		const float value = (srgb && i < 3) ? LinearToSrgb(clamped[i]) : (float)clamped[i];
+		pOut[i] = (uint8_t)(value * 255.0f + 0.5f);
+	}
+}
+
+static uint16_t PackColor565(const float* pColor)
+{
+	const uint32_t r = (uint32_t)(pColor[0] * (31.0f / 255.0f) + 0.5f);
+	const uint32_t g = (uint32_t)(pColor[1] * (63.0f / 255.0f) + 0.5f);
+	const uint32_t b = (uint32_t)(pColor[2] * (31.0f / 255.0f) + 0.5f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackColor565(uint16_t color, int* pOut)
+{
+	const int r = (color >> 11) & 31;
+	const int g = (color >> 5) & 63;
+	const int b = color & 31;
+	pOut[0] = (r << 3) | (r >> 2);
+	pOut[1] = (g << 2) | (g >> 4);
+	pOut[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 color block. Endpoints are the extremes of the block along its principal axis, inset by 1/16th of their range
+// to move the interpolated colors onto the bulk of the texels, then every texel picks the closest palette entry.
+static void EncodeBC1Block(const uint8_t (*pBlock)[4], uint8_t* pOut)
+{
+	float mean[3] = {};
+	float minColor[3] = { 255.0f, 255.0f, 255.0f };
+	float maxColor[3] = {};
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			mean[c] += pBlock[i][c] / 16.0f;
+			minColor[c] = min(minColor[c], (float)pBlock[i][c]);
+			maxColor[c] = max(maxColor[c], (float)pBlock[i][c]);
+		}
+	}
+
+	float covariance[6] = {};
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		const float r = pBlock[i][0] - mean[0];
+		const float g = pBlock[i][1] - mean[1];
+		const float b = pBlock[i][2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	// Power iteration, starting from the bounding box diagonal converges in a few steps
+	float axis[3] = { maxColor[0] - minColor[0], maxColor[1] - minColor[1], maxColor[2] - minColor[2] };
+	for (uint32_t iteration = 0; iteration < 4; ++iteration)
+	{
+		const float x = axis[0] * covariance[0] + axis[1] * covariance[1] + axis[2] * covariance[2];
+		const float y = axis[0] * covariance[1] + axis[1] * covariance[3] + axis[2] * covariance[4];
+		const float z = axis[0] * covariance[2] + axis[1] * covariance[4] + axis[2] * covariance[5];
+		const float scale = max(fabsf(x), max(fabsf(y), fabsf(z)));
+		if (scale <= 0.0f)
+			break;
+		axis[0] = x / scale;
+		axis[1] = y / scale;
+		axis[2] = z / scale;
+	}
+
+	float endpoints[2][3] = {};
+	const float axisLengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	if (axisLengthSq > 0.0f)
+	{
+		float minT = FLT_MAX;
+		float maxT = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const float t = ((pBlock[i][0] - mean[0]) * axis[0] + (pBlock[i][1] - mean[1]) * axis[1] + (pBlock[i][2] - mean[2]) * axis[2]) / axisLengthSq;
+			minT = min(minT, t);
+			maxT = max(maxT, t);
+		}
+
+		const float inset = (maxT - minT) / 16.0f;
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			endpoints[0][c] = clamp(mean[c] + axis[c] * (maxT - inset), 0.0f, 255.0f);
+			endpoints[1][c] = clamp(mean[c] + axis[c] * (minT + inset), 0.0f, 255.0f);
+		}
+	}
+	else
+	{
+		memcpy(endpoints[0], mean, sizeof(mean));
+		memcpy(endpoints[1], mean, sizeof(mean));
+	}
+
+	uint16_t color0 = PackColor565(endpoints[0]);
+	uint16_t color1 = PackColor565(endpoints[1]);
+	// color0 > color1 selects the four color mode
+	if (color0 < color1)
+	{
+		const uint16_t temp = color0;
+		color0 = color1;
+		color1 = temp;
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		int palette[4][3];
+		UnpackColor565(color0, palette[0]);
+		UnpackColor565(color1, palette[1]);
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			uint32_t bestIndex = 0;
+			int bestDistance = INT_MAX;
+			for (uint32_t p = 0; p < 4; ++p)
+			{
+				const int r = pBlock[i][0] - palette[p][0];
+				const int g = pBlock[i][1] - palette[p][1];
+				const int b = pBlock[i][2] - palette[p][2];
+				const int distance = r * r + g * g + b * b;
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+			indices |= bestIndex << (2 * i);
+		}
+	}
+
+	memcpy(pOut + 0, &color0, sizeof(color0));
+	memcpy(pOut + 2, &color1, sizeof(color1));
+	memcpy(pOut + 4, &indices, sizeof(indices));
+}
+
+// BC4 block of one channel of the block (also the alpha block of BC3), always in the eight value mode
+static void EncodeBC4Block(const uint8_t (*pBlock)[4], uint32_t channel, uint8_t* pOut)
+{
+	uint8_t minValue = 255;
+	uint8_t maxValue = 0;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		minValue = min(minValue, pBlock[i][channel]);
+		maxValue = max(maxValue, pBlock[i][channel]);
+	}
+
+	uint64_t indices = 0;
+	if (maxValue != minValue)
+	{
+		const float scale = 7.0f / (maxValue - minValue);
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			// Level 0 is minValue and 7 is maxValue, levels in between are stored as codes 7 to 2
+			const uint32_t level = (uint32_t)((pBlock[i][channel] - minValue) * scale + 0.5f);
+			const uint64_t code = level == 7 ? 0 : (level == 0 ? 1 : 8 - level);
+			indices |= code << (3 * i);
+		}
+	}
+
+	pOut[0] = maxValue;
+	pOut[1] = minValue;
+	for (uint32_t i = 0; i < 6; ++i)
+		pOut[2 + i] = (uint8_t)(indices >> (8 * i));
+}
+
+// Destination of one level, rows are texel rows for plain formats and block rows for BC formats
+struct TextureMipEncoder
+{
+	const TextureMip* pMip;
+	uint32_t          mFormat;
+	bool              mSrgb;
+	uint8_t*          pDst;
+	uint32_t          mRowPitch;
+};
+
+static void EncodeMipRow(void* pUserData, uintptr_t row)
+{
+	TextureMipEncoder* pEncoder = (TextureMipEncoder*)pUserData;
+	const TextureMip* pMip = pEncoder->pMip;
+	uint8_t* pDst = pEncoder->pDst + row * pEncoder->mRowPitch;
+	const Vector4* pTexels = pMip->mTexels.data();
+
+	if (pEncoder->mFormat == TEXTURE_COOK_FORMAT_RGBA8)
+	{
+		for (uint32_t x = 0; x < pMip->mWidth; ++x)
+			EncodeTexel8(pTexels[row * pMip->mWidth + x], pEncoder->mSrgb, pDst + x * 4);
+		return;
+	}
+
+	if (pEncoder->mFormat == TEXTURE_COOK_FORMAT_RGBA16F)
+	{
+		uint16_t* pHalfs = (uint16_t*)pDst;
+		for (uint32_t x = 0; x < pMip->mWidth; ++x)
+		{
+			const Vector4& texel = pTexels[row * pMip->mWidth + x];
+			for (int i = 0; i < 4; ++i)
+				pHalfs[x * 4 + i] = TinyImageFormat_FloatToHalfAsUint(texel[i]);
+		}
+		return;
+	}
+
+	const uint32_t blockSize = (pEncoder->mFormat == TEXTURE_COOK_FORMAT_BC1 || pEncoder->mFormat == TEXTURE_COOK_FORMAT_BC4) ? 8 : 16;
+	const uint32_t blockCount = round_up(pMip->mWidth, 4) / 4;
+	for (uint32_t bx = 0; bx < blockCount; ++bx)
+	{
+		// Blocks over the right and bottom edge of levels that are not a multiple of 4 repeat the edge texels
+		uint8_t block[16][4];
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			const uint32_t texelY = min((uint32_t)row * 4 + y, pMip->mHeight - 1);
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				const uint32_t texelX = min(bx * 4 + x, pMip->mWidth - 1);
+				EncodeTexel8(pTexels[texelY * pMip->mWidth + texelX], pEncoder->mSrgb, block[y * 4 + x]);
+			}
+		}
+
+		uint8_t* pBlock = pDst + bx * blockSize;
+		switch (pEncoder->mFormat)
+		{
+			case TEXTURE_COOK_FORMAT_BC1: EncodeBC1Block(block, pBlock); break;
+			case TEXTURE_COOK_FORMAT_BC3:
+				EncodeBC4Block(block, 3, pBlock);
+				EncodeBC1Block(block, pBlock + 8);
+				break;
+			case TEXTURE_COOK_FORMAT_BC4: EncodeBC4Block(block, 0, pBlock); break;
+			case TEXTURE_COOK_FORMAT_BC5:
+				EncodeBC4Block(block, 0, pBlock);
+				EncodeBC4Block(block, 1, pBlock + 8);
+				break;
+			default: break;
+		}
+	}
+}
+
+static TinyImageFormat GetTextureCookImageFormat(uint32_t format, bool srgb)
+{
+	switch (format)
+	{
+		case TEXTURE_COOK_FORMAT_RGBA8: return srgb ? TinyImageFormat_R8G8B8A8_SRGB : TinyImageFormat_R8G8B8A8_UNORM;
+		case TEXTURE_COOK_FORMAT_RGBA16F: return TinyImageFormat_R16G16B16A16_SFLOAT;
+		case TEXTURE_COOK_FORMAT_BC1: return srgb ? TinyImageFormat_DXBC1_RGB_SRGB : TinyImageFormat_DXBC1_RGB_UNORM;
+		case TEXTURE_COOK_FORMAT_BC3: return srgb ? TinyImageFormat_DXBC3_SRGB : TinyImageFormat_DXBC3_UNORM;
+		case TEXTURE_COOK_FORMAT_BC4: return TinyImageFormat_DXBC4_UNORM;
+		case TEXTURE_COOK_FORMAT_BC5: return TinyImageFormat_DXBC5_UNORM;
+		default: return TinyImageFormat_UNDEFINED;
+	}
+}
+
+static void TextureWriteError(void* user, char const* msg) { LOGF(LogLevel::eERROR, "%s", msg); }
+
+static void* TextureWriteAlloc(void* user, size_t size) { return tf_malloc(size); }
+
+static void TextureWriteFree(void* user, void* memory) { tf_free(memory); }
+
+static void TextureWrite(void* user, void const* buffer, size_t byteCount) { fsWriteToStream((FileStream*)user, buffer, byteCount); }
+
+static bool ProcessTextureJob(AssetJob* pJob, ProcessAssetsSettings* settings)
+{
+	ThreadSystem* pThreadSystem = (ThreadSystem*)pJob->pUserData;
+	const char* input = pJob->mInput.c_str();
+
+	FileStream file = {};
+	if (!fsOpenStreamFromPath(RD_INPUT, input, FM_READ_BINARY, &file))
+	{
+		LOGF(LogLevel::eERROR, "Failed to open image %s.", input);
+		return false;
+	}
+	eastl::vector<uint8_t> fileData((size_t)fsGetStreamFileSize(&file));
+	const bool read = fsReadFromStream(&file, fileData.data(), fileData.size()) == fileData.size();
+	fsCloseStream(&file);
+	if (!read || fileData.empty())
+	{
+		LOGF(LogLevel::eERROR, "Failed to read image %s.", input);
+		return false;
+	}
+
+	char extension[FS_MAX_PATH] = {};
+	fsGetPathExtension(input, extension);
+	const bool hdr = !stricmp(extension, "exr");
+
+	uint32_t format = settings->mTextureFormat;
+	if (format == TEXTURE_COOK_FORMAT_AUTO)
+		format = hdr ? TEXTURE_COOK_FORMAT_RGBA16F : TEXTURE_COOK_FORMAT_RGBA8;
+
+	// Color is filtered in linear space and stored as sRGB again by the 8 bit color formats.
+	// BC4 and BC5 hold data (masks, normals), their channels are never treated as color.
+	const bool color = !settings->mTextureLinear && format != TEXTURE_COOK_FORMAT_BC4 && format != TEXTURE_COOK_FORMAT_BC5;
+	const bool srgb = color && format != TEXTURE_COOK_FORMAT_RGBA16F;
+
+	eastl::vector<TextureMip> mips(1);
+	const bool loaded = hdr ? LoadSourceImageEXR(input, fileData.data(), &mips[0])
+							: LoadSourceImage8(input, fileData.data(), (uint32_t)fileData.size(), color, &mips[0]);
+	fileData.set_capacity(0);
+	if (!loaded)
+		return false;
+
+	const uint32_t width = mips[0].mWidth;
+	const uint32_t height = mips[0].mHeight;
+	uint32_t mipCount = 1;
+	while (mipCount < TINYDDS_MAX_MIPMAPLEVELS && max(width, height) >> mipCount)
+		++mipCount;
+
+	mips.resize(mipCount);
+	eastl::vector<Vector4> filterRows;
+	for (uint32_t mip = 1; mip < mipCount; ++mip)
+		GenerateMip(pThreadSystem, &mips[mip - 1], &mips[mip], filterRows);
+	filterRows.set_capacity(0);
+
+	const TinyImageFormat imageFormat = GetTextureCookImageFormat(format, srgb);
+	const uint32_t blockWidth = TinyImageFormat_WidthOfBlock(imageFormat);
+	const uint32_t blockHeight = TinyImageFormat_HeightOfBlock(imageFormat);
+	const uint32_t blockBytes = TinyImageFormat_BitSizeOfBlock(imageFormat) / 8;
+
+	eastl::vector<uint8_t> encoded[TINYDDS_MAX_MIPMAPLEVELS];
+	uint32_t mipSizes[TINYDDS_MAX_MIPMAPLEVELS] = {};
+	const void* mipData[TINYDDS_MAX_MIPMAPLEVELS] = {};
+	uint64_t totalSize = 0;
+	for (uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		const uint32_t rowCount = round_up(mips[mip].mHeight, blockHeight) / blockHeight;
+
+		TextureMipEncoder encoder = {};
+		encoder.pMip = &mips[mip];
+		encoder.mFormat = format;
+		encoder.mSrgb = srgb;
+		encoder.mRowPitch = round_up(mips[mip].mWidth, blockWidth) / blockWidth * blockBytes;
+		encoded[mip].resize((size_t)encoder.mRowPitch * rowCount);
+		encoder.pDst = encoded[mip].data();
+		RunTextureTask(pThreadSystem, EncodeMipRow, &encoder, rowCount);
+
+		mips[mip].mTexels.set_capacity(0);
+		mipSizes[mip] = (uint32_t)encoded[mip].size();
+		mipData[mip] = encoded[mip].data();
+		totalSize += mipSizes[mip];
+	}
+
+	FileStream fh = {};
+	if (!fsOpenStreamFromPath(RD_OUTPUT, pJob->mOutput.c_str(), FM_WRITE_BINARY, &fh))
+	{
+		LOGF(LogLevel::eERROR, "Failed to create texture %s.", pJob->mOutput.c_str());
+		return false;
+	}
+
+	bool success = false;
+	if (settings->mTextureContainer == TEXTURE_COOK_CONTAINER_KTX)
+	{
+		TinyKtx_WriteCallbacks callbacks = { TextureWriteError, TextureWriteAlloc, TextureWriteFree, TextureWrite };
+		success = TinyKtx_WriteImage(&callbacks, &fh, width, height, 1, 1, mipCount, TinyImageFormat_ToTinyKtxFormat(imageFormat), false, mipSizes, mipData);
+	}
+	else
+	{
+		// sRGB formats only exist in the DX10 header
+		TinyDDS_WriteCallbacks callbacks = { TextureWriteError, TextureWriteAlloc, TextureWriteFree, TextureWrite };
+		success = TinyDDS_WriteImage(&callbacks, &fh, width, height, 1, 1, mipCount, TinyImageFormat_ToTinyDDSFormat(imageFormat), false, srgb, mipSizes, mipData);
+	}
+
+	fsCloseStream(&fh);
+
+	if (!success)
+	{
+		LOGF(LogLevel::eERROR, "Failed to write texture %s.", pJob->mOutput.c_str());
+		return false;
+	}
+
+	if (!settings->quiet)
+	{
+		LOGF(LogLevel::eINFO, "%s: %ux%u, %u mips, %s, %.1f KB.", pJob->mOutput.c_str(), width, height, mipCount,
+			TinyImageFormat_Name(imageFormat), (double)totalSize / 1024.0);
+	}
+
+	return true;
+}
+
+bool AssetPipeline::ProcessTextures(ProcessAssetsSettings* settings)
+{
+	const char* extensions[] = { ".png", ".tga", ".jpg", ".jpeg", ".exr" };
+
+	// Get all image files
+	eastl::vector<eastl::string> imageFiles;
+	for (const char* extension : extensions)
+		fsGetFilesWithExtension(RD_INPUT, "", extension, imageFiles);
+
+	// Mips of all textures are filtered and encoded on these threads, see RunAssetTasks
+	ThreadSystem* pThreadSystem = NULL;
+	if (settings->mJobCount != 1 && !imageFiles.empty())
+		initThreadSystem(&pThreadSystem, settings->mJobCount ? settings->mJobCount - 1 : (uint32_t)MAX_SYSTEM_THREADS, 0, true, "TextureWorker");
+
+	const char* outputExtension = settings->mTextureContainer == TEXTURE_COOK_CONTAINER_KTX ? "ktx" : "dds";
+
+	eastl::vector<AssetJob> jobs;
+	for (const eastl::string& imageFile : imageFiles)
+	{
+		char outputFile[FS_MAX_PATH] = {};
+		fsReplacePathExtension(imageFile.c_str(), outputExtension, outputFile);
+
+		jobs.push_back(CreateAssetJob(imageFile.c_str(), outputFile, ProcessTextureJob, pThreadSystem));
+	}
+
+	uint64_t settingsHash = HashBytes(&settings->mTextureFormat, sizeof(settings->mTextureFormat));
+	settingsHash = HashBytes(&settings->mTextureContainer, sizeof(settings->mTextureContainer), settingsHash);
+	settingsHash = HashBytes(&settings->mTextureLinear, sizeof(settings->mTextureLinear), settingsHash);
+	bool success = RunAssetJobs("ProcessTextures", jobs, settingsHash, settings);
+
+	if (pThreadSystem)
+	{
+		waitThreadSystemIdle(pThreadSystem);
+		shutdownThreadSystem(pThreadSystem);
+	}
+
+	return success;
+}
+
+#define TFX_TASK_STRANDS 1024
+
+// Strands of a hair asset processed about TFX_TASK_STRANDS strands per task.
+// Follow hairs are generated per guide, the guide and its follow hairs are processed by the same task
+struct HairTask
+{
+	AMD::TressFXAsset*           pAsset;
+	const ProcessAssetsSettings* pSettings;
+	bool                         mFollowHairs;
+	uint32_t                     mCount;
+	uint32_t                     mCountPerTask;
+};
+
+static void RunHairTaskRange(void* pUserData, uintptr_t taskIndex)
+{
+	HairTask* pTask = (HairTask*)pUserData;
+	const uint32_t first = (uint32_t)taskIndex * pTask->mCountPerTask;
+	const uint32_t count = min(pTask->mCountPerTask, pTask->mCount - first);
+	if (pTask->mFollowHairs)
+	{
+		pTask->pAsset->GenerateFollowHairStrands(
+			(int)first, (int)count, pTask->pSettings->mTipSeperationFactor, pTask->pSettings->mMaxRadiusAroundGuideHair);
+	}
+	else
+	{
+		pTask->pAsset->ProcessStrands((int)first, (int)count);
+	}
+}
+
+static void RunHairTask(ThreadSystem* pThreadSystem, HairTask* pTask)
+{
+	RunAssetTasks(pThreadSystem, RunHairTaskRange, pTask, round_up(pTask->mCount, pTask->mCountPerTask) / pTask->mCountPerTask);
+}
+
+static bool ProcessTFXJob(AssetJob* pJob, ProcessAssetsSettings* settings)
+{
+#define RETURN_IF_TFX_ERROR(expression) if (!(expression)) { LOGF(eERROR, "Failed to load tfx"); return false; }
+
+	const char* input = pJob->mInput.c_str();
+	const char* output = pJob->mOutput.c_str();
+	char outputTemp[FS_MAX_PATH] = {};
+	fsGetPathFileName(input, outputTemp);
+
+	char binFilePath[FS_MAX_PATH] = {};
+	fsAppendPathExtension(outputTemp, "bin", binFilePath);
+
+	FileStream tfxFile = {};
+	fsOpenStreamFromPath(RD_INPUT, input, FM_READ_BINARY, &tfxFile);
+	AMD::TressFXAsset tressFXAsset = {};
+	const bool loaded = tressFXAsset.LoadHairData(&tfxFile);
+	fsCloseStream(&tfxFile);
+	RETURN_IF_TFX_ERROR(loaded)
+
+	ThreadSystem* pThreadSystem = (ThreadSystem*)pJob->pUserData;
+	HairTask task = {};
+	task.pAsset = &tressFXAsset;
+	task.pSettings = settings;
+
+	// Each follow strand is seeded from its own index, the output is the same for any split of the guides
+	if (settings->mFollowHairCount)
+	{
+		RETURN_IF_TFX_ERROR(tressFXAsset.BeginFollowHairs(settings->mFollowHairCount))
+		task.mFollowHairs = true;
+		task.mCount = (uint32_t)tressFXAsset.m_numGuideStrands;
+		task.mCountPerTask = max(1u, TFX_TASK_STRANDS / (settings->mFollowHairCount + 1));
+		RunHairTask(pThreadSystem, &task);
+		tressFXAsset.EndFollowHairs();
+	}
+
+	RETURN_IF_TFX_ERROR(tressFXAsset.BeginProcessAsset())
+	task.mFollowHairs = false;
+	task.mCount = (uint32_t)tressFXAsset.m_numTotalStrands;
+	task.mCountPerTask = TFX_TASK_STRANDS;
+	RunHairTask(pThreadSystem, &task);
+
+	struct TypePair { cgltf_type type; cgltf_component_type comp; };
+	const TypePair vertexTypes[] =
+	{
+		{ cgltf_type_scalar, cgltf_component_type_r_32u },   // Indices
+		{ cgltf_type_vec4,   cgltf_component_type_r_32f },   // Position
+		{ cgltf_type_vec4,   cgltf_component_type_r_32f },   // Tangents
+		{ cgltf_type_vec4,   cgltf_component_type_r_32f },   // Global rotations
+		{ cgltf_type_vec4,   cgltf_component_type_r_32f },   // Local rotations
+		{ cgltf_type_vec4,   cgltf_component_type_r_32f },   // Ref vectors
+		{ cgltf_type_vec4,   cgltf_component_type_r_32f },   // Follow root offsets
+		{ cgltf_type_vec2,   cgltf_component_type_r_32f },   // Strand UVs
+		{ cgltf_type_scalar, cgltf_component_type_r_32u },   // Strand types
+		{ cgltf_type_scalar, cgltf_component_type_r_32f },   // Thickness coeffs
+		{ cgltf_type_scalar, cgltf_component_type_r_32f },   // Rest lengths
+	};
+	const uint32_t vertexStrides[] =
+	{
+		sizeof(uint32_t), // Indices
+		sizeof(float4),   // Position
+		sizeof(float4),   // Tangents
+		sizeof(float4),   // Global rotations
+		sizeof(float4),   // Local rotations
+		sizeof(float4),   // Ref vectors
+		sizeof(float4),   // Follow root offsets
+		sizeof(float2),   // Strand UVs
+		sizeof(uint32_t), // Strand types
+		sizeof(float),    // Thickness coeffs
+		sizeof(float),    // Rest lengths
+	};
+	const uint32_t vertexCounts[] =
+	{
+		(uint32_t)tressFXAsset.GetNumHairTriangleIndices(),   // Indices
+		(uint32_t)tressFXAsset.m_numTotalVertices,   // Position
+		(uint32_t)tressFXAsset.m_numTotalVertices,   // Tangents
+		(uint32_t)tressFXAsset.m_numTotalVertices,   // Global rotations
+		(uint32_t)tressFXAsset.m_numTotalVertices,   // Local rotations
+		(uint32_t)tressFXAsset.m_numTotalVertices,   // Ref vectors
+		(uint32_t)tressFXAsset.m_numTotalStrands,    // Follow root offsets
+		(uint32_t)tressFXAsset.m_numTotalStrands,    // Strand UVs
+		(uint32_t)tressFXAsset.m_numTotalStrands,    // Strand types
+		(uint32_t)tressFXAsset.m_numTotalVertices,   // Thickness coeffs
+		(uint32_t)tressFXAsset.m_numTotalVertices,   // Rest lengths
+	};
+	const void* vertexData[] =
+	{
+		tressFXAsset.m_triangleIndices,    // Indices
+		tressFXAsset.m_positions,          // Position
+		tressFXAsset.m_tangents,           // Tangents
+		tressFXAsset.m_globalRotations,    // Global rotations
+		tressFXAsset.m_localRotations,     // Local rotations
+		tressFXAsset.m_refVectors,         // Ref vectors
+		tressFXAsset.m_followRootOffsets,  // Follow root offsets
+		tressFXAsset.m_strandUV,           // Strand UVs
+		tressFXAsset.m_strandTypes,        // Strand types
+		tressFXAsset.m_thicknessCoeffs,    // Thickness coeffs
+		tressFXAsset.m_restLengths,        // Rest lengths
+	};
+	const char* vertexNames[] =
+	{
+		"INDEX",             // Indices
+		"POSITION",          // Position
+		"TANGENT",           // Tangents
+		"TEXCOORD_0",        // Global rotations
+		"TEXCOORD_1",        // Local rotations
+		"TEXCOORD_2",        // Ref vectors
+		"TEXCOORD_3",        // Follow root offsets
+		"TEXCOORD_4",        // Strand UVs
+		"TEXCOORD_5",        // Strand types
+		"TEXCOORD_6",        // Thickness coeffs
+		"TEXCOORD_7",        // Rest lengths
+	};
+	const uint32_t count = sizeof(vertexData) / sizeof(vertexData[0]);
+
+	cgltf_buffer buffer = {};
+	cgltf_accessor accessors[count] = {};
+	cgltf_buffer_view views[count] = {};
+	cgltf_attribute attribs[count] = {};
+	cgltf_mesh mesh = {};
+	cgltf_primitive prim = {};
+	cgltf_size offset = 0;
+	FileStream binFile = {};
+	fsOpenStreamFromPath(RD_OUTPUT, binFilePath, FM_WRITE_BINARY, &binFile);
+	size_t fileSize = 0;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		views[i].type = (i ? cgltf_buffer_view_type_vertices : cgltf_buffer_view_type_indices);
+		views[i].buffer = &buffer;
+		views[i].offset = offset;
+		views[i].size = vertexCounts[i] * vertexStrides[i];
+		accessors[i].component_type = vertexTypes[i].comp;
+		accessors[i].stride = vertexStrides[i];
+		accessors[i].count = vertexCounts[i];
+		accessors[i].offset = 0;
+		accessors[i].type = vertexTypes[i].type;
+		accessors[i].buffer_view = &views[i];
+
+		attribs[i].name = (char*)vertexNames[i];
+		attribs[i].data = &accessors[i];
+
+		fileSize += fsWriteToStream(&binFile, vertexData[i], views[i].size);
+		offset += views[i].size;
+	}
+	fsCloseStream(&binFile);
+
+	char uri[FS_MAX_PATH] = {};
+	fsGetPathFileName(binFilePath, uri);
+	//sprintf(uri, "%s", fn.buffer);
+	buffer.uri = uri;
+	buffer.size = fileSize;
+
+	prim.indices = accessors;
+	prim.attributes_count = count - 1;
+	prim.attributes = attribs + 1;
+	prim.type = cgltf_primitive_type_triangles;
+
+	mesh.primitives_count = 1;
+	mesh.primitives = &prim;
+
+	char extras[128] = {};
+	sprintf(extras, "{ \"%s\" : %d, \"%s\" : %d }",
+		"mVertexCountPerStrand", tressFXAsset.m_numVerticesPerStrand, "mGuideCountPerStrand", tressFXAsset.m_numGuideStrands);
+
+	char generator[] = "TressFX";
+	cgltf_data data = {};
+	data.asset.generator = generator;
+	data.buffers_count = 1;
+	data.buffers = &buffer;
+	data.buffer_views_count = count;
+	data.buffer_views = views;
+	data.accessors_count = count;
+	data.accessors = accessors;
+	data.meshes_count = 1;
+	data.meshes = &mesh;
+	data.file_data = extras;
+	data.asset.extras.start_offset = 0;
+	data.asset.extras.end_offset = strlen(extras);
+	return cgltf_write(output, &data) == cgltf_result_success;
+}
+
+bool AssetPipeline::ProcessTFX(ProcessAssetsSettings* settings)
+{
+	// Get all tfx files
+	eastl::vector<eastl::string> tfxFilesInDirectory;
+	fsGetFilesWithExtension(RD_INPUT, "", ".tfx", tfxFilesInDirectory);
+
+	// Strands of all assets are generated and processed on these threads, see RunAssetTasks
+	ThreadSystem* pThreadSystem = NULL;
+	if (settings->mJobCount != 1 && !tfxFilesInDirectory.empty())
+		initThreadSystem(&pThreadSystem, settings->mJobCount ? settings->mJobCount - 1 : (uint32_t)MAX_SYSTEM_THREADS, 0, true, "TFXWorker");
+
+	eastl::vector<AssetJob> jobs;
+	for (size_t i = 0; i < tfxFilesInDirectory.size(); ++i)
+	{
+		const char* input = tfxFilesInDirectory[i].c_str();
+		char outputTemp[FS_MAX_PATH] = {};
+		fsGetPathFileName(input, outputTemp);
+		char output[FS_MAX_PATH] = {};
+		fsAppendPathExtension(outputTemp, "gltf", output);
+		jobs.push_back(CreateAssetJob(input, output, ProcessTFXJob, pThreadSystem));
+	}
+
+	uint64_t settingsHash = HashBytes(&settings->mFollowHairCount, sizeof(settings->mFollowHairCount));
+	settingsHash = HashBytes(&settings->mMaxRadiusAroundGuideHair, sizeof(settings->mMaxRadiusAroundGuideHair), settingsHash);
+	settingsHash = HashBytes(&settings->mTipSeperationFactor, sizeof(settings->mTipSeperationFactor), settingsHash);
+
+	bool success = RunAssetJobs("ProcessTFX", jobs, settingsHash, settings);
+
+	if (pThreadSystem)
+	{
+		waitThreadSystemIdle(pThreadSystem);
+		shutdownThreadSystem(pThreadSystem);
+	}
+
+	return success;
+}
+
+// New index chain of a primitive written to the gltf by one of the offline mesh steps
+struct PrimitiveBufferData
+{
+	cgltf_primitive*        pPrimitive;
+	eastl::vector<uint32_t> mIndices;
+	// Optional raw data stored in its own buffer view, mViewIndex receives the index of that view
+	eastl::vector<uint8_t>  mViewData;
+	uint32_t                mViewIndex;
+};
+
+struct PrimitiveLods : PrimitiveBufferData
+{
+	// mIndices holds the index chains of all levels back to back, level 0 (source mesh) first
+	uint32_t                mLodCount;
+	uint32_t                mLodStart[MAX_LOD_LEVELS + 1];
+	uint32_t                mLodIndexCount[MAX_LOD_LEVELS + 1];
+	float                   mLodError[MAX_LOD_LEVELS + 1];
+};
+
+struct PrimitiveClusters : PrimitiveBufferData
+{
+	// mIndices holds the triangles of all clusters back to back, mViewData the cluster table
+	uint32_t                mClusterCount;
+};
+
+// Cluster record of the cluster buffer view, matches Geometry::Cluster in IResourceLoader.h
+struct GltfCluster
+{
+	uint32_t mTriangleStart;
+	uint32_t mTriangleCount;
+	float    mAabbMin[3];
+	float    mAabbMax[3];
+	float    mConeApex[3];
+	float    mConeAxis[3];
+	float    mConeCutoff;
+};
+
+#define REBASE_GLTF_POINTER(ptr, oldBase, newBase) if (ptr) { ptr = (newBase) + ((ptr) - (oldBase)); }
+
+// Adds one uint32 index accessor per primitive (plus one view for its raw data if any), all stored in a new buffer.
+// cgltf references buffers, views and accessors by pointer into flat arrays, so the arrays are grown
+// and every pointer into them is rebased before the primitives are redirected to the new accessors.
+static void AppendPrimitiveBuffer(cgltf_data* data, PrimitiveBufferData** ppPrims, uint32_t primCount, const char* bufferUri)
+{
+	cgltf_size rawViewCount = 0;
+	for (uint32_t i = 0; i < primCount; ++i)
+		rawViewCount += ppPrims[i]->mViewData.empty() ? 0 : 1;
+
+	const cgltf_size bufferCount = data->buffers_count + 1;
+	const cgltf_size viewCount = data->buffer_views_count + primCount + rawViewCount;
+	const cgltf_size accessorCount = data->accessors_count + primCount;
+
+	cgltf_buffer* buffers = (cgltf_buffer*)tf_calloc(bufferCount, sizeof(cgltf_buffer));
+	cgltf_buffer_view* views = (cgltf_buffer_view*)tf_calloc(viewCount, sizeof(cgltf_buffer_view));
+	cgltf_accessor* accessors = (cgltf_accessor*)tf_calloc(accessorCount, sizeof(cgltf_accessor));
+
+	if (data->buffers_count)
+		memcpy(buffers, data->buffers, data->buffers_count * sizeof(cgltf_buffer));
+	if (data->buffer_views_count)
+		memcpy(views, data->buffer_views, data->buffer_views_count * sizeof(cgltf_buffer_view));
+	if (data->accessors_count)
+		memcpy(accessors, data->accessors, data->accessors_count * sizeof(cgltf_accessor));
+
+	for (cgltf_size i = 0; i < data->buffer_views_count; ++i)
+		REBASE_GLTF_POINTER(views[i].buffer, data->buffers, buffers);
+
+	for (cgltf_size i = 0; i < data->accessors_count; ++i)
+	{
+		REBASE_GLTF_POINTER(accessors[i].buffer_view, data->buffer_views, views);
+		REBASE_GLTF_POINTER(accessors[i].sparse.indices_buffer_view, data->buffer_views, views);
+		REBASE_GLTF_POINTER(accessors[i].sparse.values_buffer_view, data->buffer_views, views);
+	}
+
+	for (cgltf_size i = 0; i < data->images_count; ++i)
+		REBASE_GLTF_POINTER(data->images[i].buffer_view, data->buffer_views, views);
+
+	for (cgltf_size i = 0; i < data->meshes_count; ++i)
+	{
+		for (cgltf_size p = 0; p < data->meshes[i].primitives_count; ++p)
+		{
+			cgltf_primitive* prim = &data->meshes[i].primitives[p];
+			REBASE_GLTF_POINTER(prim->indices, data->accessors, accessors);
+			for (cgltf_size a = 0; a < prim->attributes_count; ++a)
+				REBASE_GLTF_POINTER(prim->attributes[a].data, data->accessors, accessors);
+			for (cgltf_size t = 0; t < prim->targets_count; ++t)
+				for (cgltf_size a = 0; a < prim->targets[t].attributes_count; ++a)
+					REBASE_GLTF_POINTER(prim->targets[t].attributes[a].data, data->accessors, accessors);
+		}
+	}
+
+	for (cgltf_size i = 0; i < data->skins_count; ++i)
+		REBASE_GLTF_POINTER(data->skins[i].inverse_bind_matrices, data->accessors, accessors);
+
+	for (cgltf_size i = 0; i < data->animations_count; ++i)
+	{
+		for (cgltf_size s = 0; s < data->animations[i].samplers_count; ++s)
+		{
+			REBASE_GLTF_POINTER(data->animations[i].samplers[s].input, data->accessors, accessors);
+			REBASE_GLTF_POINTER(data->animations[i].samplers[s].output, data->accessors, accessors);
+		}
+	}
+
+	// Fill the new buffer
+	cgltf_size newBufferSize = 0;
+	for (uint32_t i = 0; i < primCount; ++i)
+		newBufferSize += ppPrims[i]->mIndices.size() * sizeof(uint32_t) + round_up((uint32_t)ppPrims[i]->mViewData.size(), (uint32_t)sizeof(uint32_t));
+
+	cgltf_buffer* newBuffer = &buffers[data->buffers_count];
+	newBuffer->size = newBufferSize;
+	newBuffer->data = tf_calloc(1, newBufferSize);
+	newBuffer->uri = (char*)tf_calloc(strlen(bufferUri) + 1, sizeof(char));
+	strcpy(newBuffer->uri, bufferUri);
+
+	cgltf_size offset = 0;
+	cgltf_size viewIndex = data->buffer_views_count;
+	for (uint32_t i = 0; i < primCount; ++i)
+	{
+		PrimitiveBufferData* prim = ppPrims[i];
+		const cgltf_size size = prim->mIndices.size() * sizeof(uint32_t);
+		memcpy((uint8_t*)newBuffer->data + offset, prim->mIndices.data(), size);
+
+		cgltf_buffer_view* view = &views[viewIndex++];
+		view->buffer = newBuffer;
+		view->offset = offset;
+		view->size = size;
+		view->type = cgltf_buffer_view_type_indices;
+
+		cgltf_accessor* accessor = &accessors[data->accessors_count + i];
+		accessor->component_type = cgltf_component_type_r_32u;
+		accessor->type = cgltf_type_scalar;
+		accessor->count = prim->mIndices.size();
+		accessor->stride = sizeof(uint32_t);
+		accessor->buffer_view = view;
+
+		prim->pPrimitive->indices = accessor;
+		offset += size;
+
+		if (!prim->mViewData.empty())
+		{
+			memcpy((uint8_t*)newBuffer->data + offset, prim->mViewData.data(), prim->mViewData.size());
+
+			prim->mViewIndex = (uint32_t)viewIndex;
+			cgltf_buffer_view* rawView = &views[viewIndex++];
+			rawView->buffer = newBuffer;
+			rawView->offset = offset;
+			rawView->size = prim->mViewData.size();
+
+			offset += round_up((uint32_t)prim->mViewData.size(), (uint32_t)sizeof(uint32_t));
+		}
+	}
+
+	tf_free(data->buffers);
+	tf_free(data->buffer_views);
+	tf_free(data->accessors);
+
+	data->buffers = buffers;
+	data->buffers_count = bufferCount;
+	data->buffer_views = views;
+	data->buffer_views_count = viewCount;
+	data->accessors = accessors;
+	data->accessors_count = accessorCount;
+}
+
+static bool HasGltfExtrasKey(const cgltf_data* data, const cgltf_extras* pExtras, const char* key)
+{
+	char quotedKey[64] = {};
+	snprintf(quotedKey, sizeof(quotedKey), "\"%s\"", key);
+	const eastl::string existing(data->json + pExtras->start_offset, data->json + pExtras->end_offset);
+	return existing.find(quotedKey) != eastl::string::npos;
+}
+
+// Points pExtras at a copy of its object in extras with members added, so the keys written by other steps are kept.
+// extras starts with the source json that the existing offsets point into
+static void AppendGltfExtras(const cgltf_data* data, cgltf_extras* pExtras, eastl::string& extras, const eastl::string& members)
+{
+	eastl::string existing(data->json + pExtras->start_offset, data->json + pExtras->end_offset);
+	const size_t closingBrace = existing.find_last_of('}');
+	existing.resize(closingBrace == eastl::string::npos ? 0 : closingBrace);
+	while (!existing.empty() && isspace((unsigned char)existing.back()))
+		existing.pop_back();
+
+	pExtras->start_offset = extras.size();
+	if (existing.empty())
+		extras.append("{ ");
+	else
+		extras.append(existing).append(existing.back() == '{' ? " " : ", ");
+	extras.append(members).append(" }");
+	pExtras->end_offset = extras.size();
+}
+
+// Writes the gltf and all its external buffers next to each other in RD_OUTPUT.
+// extras is the source json followed by the extras added by the offline step
+static bool WriteProcessedGltf(const char* output, cgltf_data* data, const eastl::string& extras)
+{
+	bool success = true;
+	for (cgltf_size b = 0; b < data->buffers_count; ++b)
+	{
+		const char* uri = data->buffers[b].uri;
+		if (!uri || strncmp(uri, "data:", 5) == 0 || strstr(uri, "://"))
+			continue;
 
-		skeleton.Deallocate();
+		FileStream fs = {};
+		if (!fsOpenStreamFromPath(RD_OUTPUT, uri, FM_WRITE_BINARY, &fs))
+		{
+			success = false;
+			continue;
+		}
+		fsWriteToStream(&fs, data->buffers[b].data, data->buffers[b].size);
+		fsCloseStream(&fs);
 	}
 
-	if (!settings->quiet && assetsProcessed == 0 && success)
-		LOGF(LogLevel::eINFO, "All assets already up-to-date.");
+	// Extras are offsets into file_data
+	data->file_data = (void*)extras.c_str();
+	if (cgltf_write(output, data, RD_OUTPUT) != cgltf_result_success)
+		success = false;
 
 	return success;
 }
 
-static bool SaveSVT(const char* fileName, FileStream* pSrc, SVT_HEADER* pHeader)
+static bool GeneratePrimitiveLods(const cgltf_data* data, cgltf_primitive* prim, const ProcessAssetsSettings* settings, PrimitiveLods* pOut)
 {
-	FileStream fh = {};
-
-	if (!fsOpenStreamFromPath(RD_OUTPUT, fileName, FM_WRITE_BINARY, &fh))
+	if (prim->type != cgltf_primitive_type_triangles || !prim->indices)
 		return false;
 
-	//TODO: SVT should support any components somepoint
-	const uint32_t numberOfComponents = pHeader->mComponentCount;
-	const uint32_t pageSize = pHeader->mPageSize;
-
-	//Header
-	fsWriteToStream(&fh, pHeader, sizeof(SVT_HEADER));
+	const cgltf_accessor* positions = NULL;
+	for (cgltf_size a = 0; a < prim->attributes_count; ++a)
+	{
+		if (prim->attributes[a].type == cgltf_attribute_type_position)
+			positions = prim->attributes[a].data;
+	}
 
-	uint32_t mipPageCount = pHeader->mMipLevels - (uint32_t)log2f((float)pageSize);
+	if (!positions)
+		return false;
 
-	// Allocate Pages
-	unsigned char** mipLevelPixels = (unsigned char**)tf_calloc(pHeader->mMipLevels, sizeof(unsigned char*));
-	unsigned char*** pagePixels = (unsigned char***)tf_calloc(mipPageCount + 1, sizeof(unsigned char**));
+	// Skip primitives that already carry a lod table, extras of other steps such as the cluster table stay
+	if (HasGltfExtrasKey(data, &prim->extras, "mLodCount"))
+		return false;
 
-	uint32_t* mipSizes = (uint32_t*)tf_calloc(pHeader->mMipLevels, sizeof(uint32_t));
+	const uint32_t indexCount = (uint32_t)prim->indices->count;
+	const uint32_t vertexCount = (uint32_t)positions->count;
 
-	for (uint32_t i = 0; i < pHeader->mMipLevels; ++i)
+	eastl::vector<float3> vertices(vertexCount);
+	float3 minExtent = float3(FLT_MAX);
+	float3 maxExtent = float3(-FLT_MAX);
+	for (uint32_t v = 0; v < vertexCount; ++v)
 	{
-		uint32_t mipSize = (pHeader->mWidth >> i) * (pHeader->mHeight >> i) * numberOfComponents;
-		mipSizes[i] = mipSize;
-		mipLevelPixels[i] = (unsigned char*)tf_calloc(mipSize, sizeof(unsigned char));
-		fsReadFromStream(pSrc, mipLevelPixels[i], mipSize);
+		cgltf_accessor_read_float(positions, v, &vertices[v].x, 3);
+		minExtent = v3ToF3(minPerElem(f3Tov3(minExtent), f3Tov3(vertices[v])));
+		maxExtent = v3ToF3(maxPerElem(f3Tov3(maxExtent), f3Tov3(vertices[v])));
 	}
+	// meshoptimizer measures the simplification error relative to the largest dimension of the mesh
+	const float extent = max(maxExtent.x - minExtent.x, max(maxExtent.y - minExtent.y, maxExtent.z - minExtent.z));
 
-	// Store Mip data
-	for (uint32_t i = 0; i < mipPageCount; ++i)
-	{
-		uint32_t xOffset = pHeader->mWidth >> i;
-		uint32_t yOffset = pHeader->mHeight >> i;
-
-		// width and height in tiles
-		uint32_t tileWidth = xOffset / pageSize;
-		uint32_t tileHeight = yOffset / pageSize;
-
-		uint32_t xMipOffset = 0;
-		uint32_t yMipOffset = 0;
-		uint32_t pageIndex = 0;
+	pOut->pPrimitive = prim;
+	pOut->mIndices.resize(indexCount);
+	for (uint32_t idx = 0; idx < indexCount; ++idx)
+		pOut->mIndices[idx] = (uint32_t)cgltf_accessor_read_index(prim->indices, idx);
 
-		uint32_t rowLength = xOffset * numberOfComponents;
+	pOut->mLodCount = 1;
+	pOut->mLodStart[0] = 0;
+	pOut->mLodIndexCount[0] = indexCount;
+	pOut->mLodError[0] = 0.0f;
 
-		pagePixels[i] = (unsigned char**)tf_calloc(tileWidth * tileHeight, sizeof(unsigned char*));
-
-		for (uint32_t j = 0; j < tileHeight; ++j)
-		{
-			for (uint32_t k = 0; k < tileWidth; ++k)
-			{
-				pagePixels[i][pageIndex] = (unsigned char*)tf_calloc(pageSize * pageSize, sizeof(unsigned char) * numberOfComponents);
+	eastl::vector<uint32_t> lodIndices(indexCount);
+	for (uint32_t lod = 0; lod < settings->mLodCount; ++lod)
+	{
+		const size_t targetIndexCount = (size_t)(indexCount * settings->mLodTargetRatios[lod]) / 3 * 3;
+		const float targetError = settings->mLodTargetErrors[lod];
 
-				for (uint32_t y = 0; y < pageSize; ++y)
-				{
-					for (uint32_t x = 0; x < pageSize; ++x)
-					{
-						uint32_t mipPageIndex = (y * pageSize + x) * numberOfComponents;
-						uint32_t mipIndex = rowLength * (y + yMipOffset) + (numberOfComponents)*(x + xMipOffset);
+		// Always simplify the source mesh so errors don't accumulate over the chain
+		size_t lodIndexCount = meshopt_simplify(lodIndices.data(), pOut->mIndices.data(), indexCount, &vertices[0].x, vertexCount,
+			sizeof(float3), targetIndexCount, targetError);
 
-						pagePixels[i][pageIndex][mipPageIndex + 0] = mipLevelPixels[i][mipIndex + 0];
-						pagePixels[i][pageIndex][mipPageIndex + 1] = mipLevelPixels[i][mipIndex + 1];
-						pagePixels[i][pageIndex][mipPageIndex + 2] = mipLevelPixels[i][mipIndex + 2];
-						pagePixels[i][pageIndex][mipPageIndex + 3] = mipLevelPixels[i][mipIndex + 3];
-					}
-				}
+		// The simplifier stopped on the error threshold before making any progress compared to the previous level
+		if (lodIndexCount == 0 || lodIndexCount >= pOut->mLodIndexCount[pOut->mLodCount - 1])
+			break;
 
-				xMipOffset += pageSize;
-				pageIndex += 1;
-			}
+		meshopt_optimizeVertexCache(lodIndices.data(), lodIndices.data(), lodIndexCount, vertexCount);
 
-			xMipOffset = 0;
-			yMipOffset += pageSize;
-		}
+		const uint32_t lodIndex = pOut->mLodCount++;
+		pOut->mLodStart[lodIndex] = (uint32_t)pOut->mIndices.size();
+		pOut->mLodIndexCount[lodIndex] = (uint32_t)lodIndexCount;
+		// The simplifier never exceeds the target error so it is a conservative bound of the object space deviation
+		pOut->mLodError[lodIndex] = targetError * extent;
+		pOut->mIndices.insert(pOut->mIndices.end(), lodIndices.begin(), lodIndices.begin() + lodIndexCount);
 	}
 
-	uint32_t mipTailPageSize = 0;
-
-	pagePixels[mipPageCount] = (unsigned char**)tf_calloc(1, sizeof(unsigned char*));
+	return pOut->mLodCount > 1;
+}
 
-	// Calculate mip tail size
-	for (uint32_t i = mipPageCount; i < pHeader->mMipLevels - 1; ++i)
-	{
-		uint32_t mipSize = mipSizes[i];
-		mipTailPageSize += mipSize;
-	}
+static bool ProcessLodJob(AssetJob* pJob, ProcessAssetsSettings* settings)
+{
+	const char* input = pJob->mInput.c_str();
+	const char* output = pJob->mOutput.c_str();
+	char fileName[FS_MAX_PATH] = {};
+	fsGetPathFileName(input, fileName);
 
-	pagePixels[mipPageCount][0] = (unsigned char*)tf_calloc(mipTailPageSize, sizeof(unsigned char));
+	cgltf_data* data = NULL;
+	void* srcFileData = NULL;
+	if (cgltf_parse_and_load(input, &data, &srcFileData) != cgltf_result_success)
+		return false;
 
-	// Store mip tail data
-	uint32_t mipTailPageWrites = 0;
-	for (uint32_t i = mipPageCount; i < pHeader->mMipLevels - 1; ++i)
+	eastl::vector<PrimitiveLods> primitiveLods;
+	for (cgltf_size m = 0; m < data->meshes_count; ++m)
 	{
-		uint32_t mipSize = mipSizes[i];
-
-		for (uint32_t j = 0; j < mipSize; ++j)
+		for (cgltf_size p = 0; p < data->meshes[m].primitives_count; ++p)
 		{
-			pagePixels[mipPageCount][0][mipTailPageWrites++] = mipLevelPixels[i][j];
+			PrimitiveLods lods = {};
+			if (GeneratePrimitiveLods(data, &data->meshes[m].primitives[p], settings, &lods))
+				primitiveLods.push_back(lods);
 		}
 	}
 
-	// Write mip data
-	for (uint32_t i = 0; i < mipPageCount; ++i)
+	if (primitiveLods.empty())
+	{
+		if (!settings->quiet)
+			LOGF(LogLevel::eINFO, "No lods generated for %s.", input);
+		tf_free(srcFileData);
+		cgltf_free(data);
+		pJob->mNoOutput = true;
+		return true;
+	}
+
+	char lodBufferName[FS_MAX_PATH] = {};
+	sprintf(lodBufferName, "%s_lods", fileName);
+	char lodBufferUri[FS_MAX_PATH] = {};
+	fsAppendPathExtension(lodBufferName, "bin", lodBufferUri);
+
+	eastl::vector<PrimitiveBufferData*> lodPrims;
+	for (PrimitiveLods& lods : primitiveLods)
+		lodPrims.push_back(&lods);
+	AppendPrimitiveBuffer(data, lodPrims.data(), (uint32_t)lodPrims.size(), lodBufferUri);
+
+	// Write the lod table of each primitive into its extras. Extras are offsets into file_data, so the
+	// source json is kept in front of the new extras to leave the existing ones valid
+	// { "mLodCount" : 3, "mLods" : [ startIndex, indexCount, error, ... ] }
+	eastl::string extras(data->json, data->json_size);
+	for (PrimitiveLods& lods : primitiveLods)
 	{
-		// width and height in tiles
-		uint32_t mipWidth = (pHeader->mWidth >> i) / pageSize;
-		uint32_t mipHeight = (pHeader->mHeight >> i) / pageSize;
+		eastl::string members;
+		members.sprintf("\"mLodCount\" : %u, \"mLods\" : [ ", lods.mLodCount);
+		for (uint32_t lod = 0; lod < lods.mLodCount; ++lod)
+			members.append_sprintf("%s%u, %u, %f", lod ? ", " : "", lods.mLodStart[lod], lods.mLodIndexCount[lod], lods.mLodError[lod]);
+		members.append(" ]");
+		AppendGltfExtras(data, &lods.pPrimitive->extras, extras, members);
 
-		for (uint32_t j = 0; j < mipWidth * mipHeight; ++j)
+		if (!settings->quiet)
 		{
-			fsWriteToStream(&fh, pagePixels[i][j], pageSize * pageSize * numberOfComponents * sizeof(char));
+			LOGF(LogLevel::eINFO, "%s: generated %u lods from %u triangles down to %u triangles.", input, lods.mLodCount,
+				lods.mLodIndexCount[0] / 3, lods.mLodIndexCount[lods.mLodCount - 1] / 3);
 		}
 	}
 
-	// Write mip tail data
-	fsWriteToStream(&fh, pagePixels[mipPageCount][0], mipTailPageSize * sizeof(char));
+	const bool success = WriteProcessedGltf(output, data, extras);
 
-	// free memory
-	tf_free(mipSizes);
+	data->file_data = srcFileData;
+	cgltf_free(data);
 
-	for (uint32_t i = 0; i < mipPageCount; ++i)
-	{
-		// width and height in tiles
-		uint32_t mipWidth = (pHeader->mWidth >> i) / pageSize;
-		uint32_t mipHeight = (pHeader->mHeight >> i) / pageSize;
-		uint32_t pageIndex = 0;
+	return success;
+}
 
-		for (uint32_t j = 0; j < mipHeight; ++j)
-		{
-			for (uint32_t k = 0; k < mipWidth; ++k)
-			{
-				tf_free(pagePixels[i][pageIndex]);
-				pageIndex += 1;
-			}
-		}
+bool AssetPipeline::ProcessLODs(ProcessAssetsSettings* settings)
+{
+	// Get all gltf files
+	eastl::vector<eastl::string> gltfFilesInDirectory;
+	fsGetFilesWithExtension(RD_INPUT, "", ".gltf", gltfFilesInDirectory);
 
-		tf_free(pagePixels[i]);
-	}
-	tf_free(pagePixels[mipPageCount][0]);
-	tf_free(pagePixels[mipPageCount]);
-	tf_free(pagePixels);
+	if (!settings->quiet && gltfFilesInDirectory.empty())
+		LOGF(LogLevel::eWARNING, "%s does not contain any gltf files.", fsGetResourceDirectory(RD_INPUT));
 
-	for (uint32_t i = 0; i < pHeader->mMipLevels; ++i)
+	meshopt_setAllocator([](size_t size) { return tf_malloc(size); }, [](void* ptr) { tf_free(ptr); });
+
+	eastl::vector<AssetJob> jobs;
+	for (size_t i = 0; i < gltfFilesInDirectory.size(); ++i)
 	{
-		tf_free(mipLevelPixels[i]);
+		const char* input = gltfFilesInDirectory[i].c_str();
+		char fileName[FS_MAX_PATH] = {};
+		fsGetPathFileName(input, fileName);
+		char output[FS_MAX_PATH] = {};
+		fsAppendPathExtension(fileName, "gltf", output);
+		jobs.push_back(CreateAssetJob(input, output, ProcessLodJob));
 	}
-	tf_free(mipLevelPixels);
 
-	fsCloseStream(&fh);
+	uint64_t settingsHash = HashBytes(&settings->mLodCount, sizeof(settings->mLodCount));
+	settingsHash = HashBytes(settings->mLodTargetRatios, settings->mLodCount * sizeof(float), settingsHash);
+	settingsHash = HashBytes(settings->mLodTargetErrors, settings->mLodCount * sizeof(float), settingsHash);
 
-	return true;
+	return RunAssetJobs("ProcessLODs", jobs, settingsHash, settings);
 }
 
-bool AssetPipeline::ProcessVirtualTextures(ProcessAssetsSettings* settings)
+static bool GeneratePrimitiveClusters(cgltf_primitive* prim, const ProcessAssetsSettings* settings, PrimitiveClusters* pOut)
 {
-	// Get all image files
-	eastl::vector<eastl::string> ddsFilesInDirectory;
-	fsGetFilesWithExtension(RD_INPUT, "", ".dds", ddsFilesInDirectory);
+	if (prim->type != cgltf_primitive_type_triangles || !prim->indices)
+		return false;
 
-	for (size_t i = 0; i < ddsFilesInDirectory.size(); ++i)
+	const cgltf_accessor* positions = NULL;
+	for (cgltf_size a = 0; a < prim->attributes_count; ++a)
 	{
-		eastl::string outputFile = ddsFilesInDirectory[i];
+		if (prim->attributes[a].type == cgltf_attribute_type_position)
+			positions = prim->attributes[a].data;
+	}
 
-		if (outputFile.size() > 0)
-		{
-			TextureDesc textureDesc = {};
-			FileStream ddsFile = {};
-			fsOpenStreamFromPath(RD_INPUT, ddsFilesInDirectory[i].c_str(), FM_READ_BINARY, &ddsFile);
-			bool success = false;
-			if (!fsOpenStreamFromPath(RD_INPUT, ddsFilesInDirectory[i].c_str(), FM_READ_BINARY, &ddsFile))
-			{
-				continue;
-			}
+	if (!positions)
+		return false;
 
-			success = loadDDSTextureDesc(&ddsFile, &textureDesc);
+	// Skip primitives that already carry a lod or cluster table
+	if (prim->extras.end_offset > prim->extras.start_offset)
+		return false;
 
-			if (!success)
-			{
-				fsCloseStream(&ddsFile);
-				LOGF(LogLevel::eERROR, "Failed to load image %s.", outputFile.c_str());
-				continue;
-			}
+	const uint32_t indexCount = (uint32_t)prim->indices->count;
+	const uint32_t vertexCount = (uint32_t)positions->count;
 
-			outputFile.resize(outputFile.size() - 4);
-			outputFile.append(".svt");
+	eastl::vector<float3> vertices(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		cgltf_accessor_read_float(positions, v, &vertices[v].x, 3);
 
-			SVT_HEADER header = {};
-			header.mComponentCount = 4;
-			header.mHeight = textureDesc.mHeight;
-			header.mMipLevels = textureDesc.mMipLevels;
-			header.mPageSize = 128;
-			header.mWidth = textureDesc.mWidth;
+	eastl::vector<uint32_t> indices(indexCount);
+	for (uint32_t idx = 0; idx < indexCount; ++idx)
+		indices[idx] = (uint32_t)cgltf_accessor_read_index(prim->indices, idx);
 
-			success = SaveSVT(outputFile.c_str(), &ddsFile, &header);
+	// The meshlet builder is greedy over the index order, a cache friendly order keeps neighbouring triangles together
+	meshopt_optimizeVertexCache(indices.data(), indices.data(), indexCount, vertexCount);
+
+	// Limits of meshopt_Meshlet
+	const size_t maxVertices = clamp(settings->mClusterMaxVertices, 3u, 64u);
+	const size_t maxTriangles = clamp(settings->mClusterMaxTriangles, 1u, 126u);
+	eastl::vector<meshopt_Meshlet> meshlets(meshopt_buildMeshletsBound(indexCount, maxVertices, maxTriangles));
+	const size_t meshletCount = meshopt_buildMeshlets(meshlets.data(), indices.data(), indexCount, vertexCount, maxVertices, maxTriangles);
+
+	pOut->pPrimitive = prim;
+	pOut->mClusterCount = (uint32_t)meshletCount;
+	pOut->mIndices.reserve(indexCount);
+	pOut->mViewData.resize(meshletCount * sizeof(GltfCluster));
+
+	GltfCluster* clusters = (GltfCluster*)pOut->mViewData.data();
+	for (size_t c = 0; c < meshletCount; ++c)
+	{
+		const meshopt_Meshlet& meshlet = meshlets[c];
+		GltfCluster& cluster = clusters[c];
 
-			fsCloseStream(&ddsFile);
+		// Clusters are stored as contiguous triangle ranges of the reordered index buffer
+		cluster.mTriangleStart = (uint32_t)pOut->mIndices.size() / 3;
+		cluster.mTriangleCount = meshlet.triangle_count;
 
-			if (!success)
+		vec3 aabbMin = vec3(FLT_MAX);
+		vec3 aabbMax = vec3(-FLT_MAX);
+		for (uint32_t t = 0; t < meshlet.triangle_count; ++t)
+		{
+			for (uint32_t k = 0; k < 3; ++k)
 			{
-				LOGF(LogLevel::eERROR, "Failed to save sparse virtual texture %s.", outputFile.c_str());
-				continue;
+				const uint32_t vertex = meshlet.vertices[meshlet.indices[t][k]];
+				aabbMin = minPerElem(aabbMin, f3Tov3(vertices[vertex]));
+				aabbMax = maxPerElem(aabbMax, f3Tov3(vertices[vertex]));
+				pOut->mIndices.push_back(vertex);
 			}
 		}
+
+		const meshopt_Bounds bounds = meshopt_computeMeshletBounds(&meshlet, &vertices[0].x, vertexCount, sizeof(float3));
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			cluster.mAabbMin[k] = aabbMin[k];
+			cluster.mAabbMax[k] = aabbMax[k];
+			cluster.mConeApex[k] = bounds.cone_apex[k];
+			cluster.mConeAxis[k] = bounds.cone_axis[k];
+		}
+		cluster.mConeCutoff = bounds.cone_cutoff;
 	}
 
-	return true;
+	ASSERT(pOut->mIndices.size() == indexCount);
+	return meshletCount > 0;
 }
 
-bool AssetPipeline::ProcessTFX(ProcessAssetsSettings* settings)
+static bool ProcessClusterJob(AssetJob* pJob, ProcessAssetsSettings* settings)
 {
-	cgltf_result result = cgltf_result_success;
+	const char* input = pJob->mInput.c_str();
+	const char* output = pJob->mOutput.c_str();
+	char fileName[FS_MAX_PATH] = {};
+	fsGetPathFileName(input, fileName);
 
-	// Get all tfx files
-	eastl::vector<eastl::string> tfxFilesInDirectory;
-	fsGetFilesWithExtension(RD_INPUT, "", ".tfx", tfxFilesInDirectory);
+	cgltf_data* data = NULL;
+	void* srcFileData = NULL;
+	if (cgltf_parse_and_load(input, &data, &srcFileData) != cgltf_result_success)
+		return false;
 
-#define RETURN_IF_TFX_ERROR(expression) if (!(expression)) { LOGF(eERROR, "Failed to load tfx"); return false; }
+	eastl::vector<PrimitiveClusters> primitiveClusters;
+	for (cgltf_size m = 0; m < data->meshes_count; ++m)
+	{
+		for (cgltf_size p = 0; p < data->meshes[m].primitives_count; ++p)
+		{
+			PrimitiveClusters clusters = {};
+			if (GeneratePrimitiveClusters(&data->meshes[m].primitives[p], settings, &clusters))
+				primitiveClusters.push_back(clusters);
+		}
+	}
 
-	for (size_t i = 0; i < tfxFilesInDirectory.size(); ++i)
+	if (primitiveClusters.empty())
 	{
-		const char* input = tfxFilesInDirectory[i].c_str();
-		char outputTemp[FS_MAX_PATH] = {};
-		fsGetPathFileName(input, outputTemp);
-		char output[FS_MAX_PATH] = {};
-		fsAppendPathExtension(outputTemp, "gltf", output);
+		if (!settings->quiet)
+			LOGF(LogLevel::eINFO, "No clusters generated for %s.", input);
+		tf_free(srcFileData);
+		cgltf_free(data);
+		pJob->mNoOutput = true;
+		return true;
+	}
+
+	char clusterBufferName[FS_MAX_PATH] = {};
+	sprintf(clusterBufferName, "%s_clusters", fileName);
+	char clusterBufferUri[FS_MAX_PATH] = {};
+	fsAppendPathExtension(clusterBufferName, "bin", clusterBufferUri);
+
+	eastl::vector<PrimitiveBufferData*> clusterPrims;
+	for (PrimitiveClusters& clusters : primitiveClusters)
+		clusterPrims.push_back(&clusters);
+	AppendPrimitiveBuffer(data, clusterPrims.data(), (uint32_t)clusterPrims.size(), clusterBufferUri);
+
+	// Reference the cluster table view of each primitive from its extras
+	// { "mClusterCount" : 42, "mClusterView" : 7 }
+	eastl::string extras(data->json, data->json_size);
+	uint32_t totalClusterCount = 0;
+	for (PrimitiveClusters& clusters : primitiveClusters)
+	{
+		clusters.pPrimitive->extras.start_offset = extras.size();
+		extras.append_sprintf("{ \"mClusterCount\" : %u, \"mClusterView\" : %u }", clusters.mClusterCount, clusters.mViewIndex);
+		clusters.pPrimitive->extras.end_offset = extras.size();
+		totalClusterCount += clusters.mClusterCount;
+	}
+
+	if (!settings->quiet)
+	{
+		LOGF(LogLevel::eINFO, "%s: built %u clusters for %u primitives.", input, totalClusterCount,
+			(uint32_t)primitiveClusters.size());
+	}
 
-		char binFilePath[FS_MAX_PATH] = {};
-		fsAppendPathExtension(outputTemp, "bin", binFilePath);
+	const bool success = WriteProcessedGltf(output, data, extras);
 
-		FileStream tfxFile = {};
-		fsOpenStreamFromPath(RD_INPUT, input, FM_READ_BINARY, &tfxFile);
-		AMD::TressFXAsset tressFXAsset = {};
-		RETURN_IF_TFX_ERROR(tressFXAsset.LoadHairData(&tfxFile))
-			fsCloseStream(&tfxFile);
+	data->file_data = srcFileData;
+	cgltf_free(data);
 
-		if (settings->mFollowHairCount)
-		{
-			RETURN_IF_TFX_ERROR(tressFXAsset.GenerateFollowHairs(settings->mFollowHairCount, settings->mTipSeperationFactor, settings->mMaxRadiusAroundGuideHair))
-		}
+	return success;
+}
 
-		RETURN_IF_TFX_ERROR(tressFXAsset.ProcessAsset())
+bool AssetPipeline::ProcessClusters(ProcessAssetsSettings* settings)
+{
+	// Get all gltf files
+	eastl::vector<eastl::string> gltfFilesInDirectory;
+	fsGetFilesWithExtension(RD_INPUT, "", ".gltf", gltfFilesInDirectory);
 
-			struct TypePair { cgltf_type type; cgltf_component_type comp; };
-		const TypePair vertexTypes[] =
-		{
-			{ cgltf_type_scalar, cgltf_component_type_r_32u },   // Indices
-			{ cgltf_type_vec4,   cgltf_component_type_r_32f },   // Position
-			{ cgltf_type_vec4,   cgltf_component_type_r_32f },   // Tangents
-			{ cgltf_type_vec4,   cgltf_component_type_r_32f },   // Global rotations
-			{ cgltf_type_vec4,   cgltf_component_type_r_32f },   // Local rotations
-			{ cgltf_type_vec4,   cgltf_component_type_r_32f },   // Ref vectors
-			{ cgltf_type_vec4,   cgltf_component_type_r_32f },   // Follow root offsets
-			{ cgltf_type_vec2,   cgltf_component_type_r_32f },   // Strand UVs
-			{ cgltf_type_scalar, cgltf_component_type_r_32u },   // Strand types
-			{ cgltf_type_scalar, cgltf_component_type_r_32f },   // Thickness coeffs
-			{ cgltf_type_scalar, cgltf_component_type_r_32f },   // Rest lengths
-		};
-		const uint32_t vertexStrides[] =
-		{
-			sizeof(uint32_t), // Indices
-			sizeof(float4),   // Position
-			sizeof(float4),   // Tangents
-			sizeof(float4),   // Global rotations
-			sizeof(float4),   // Local rotations
-			sizeof(float4),   // Ref vectors
-			sizeof(float4),   // Follow root offsets
-			sizeof(float2),   // Strand UVs
-			sizeof(uint32_t), // Strand types
-			sizeof(float),    // Thickness coeffs
-			sizeof(float),    // Rest lengths
-		};
-		const uint32_t vertexCounts[] =
-		{
-			(uint32_t)tressFXAsset.GetNumHairTriangleIndices(),   // Indices
-			(uint32_t)tressFXAsset.m_numTotalVertices,   // Position
-			(uint32_t)tressFXAsset.m_numTotalVertices,   // Tangents
-			(uint32_t)tressFXAsset.m_numTotalVertices,   // Global rotations
-			(uint32_t)tressFXAsset.m_numTotalVertices,   // Local rotations
-			(uint32_t)tressFXAsset.m_numTotalVertices,   // Ref vectors
-			(uint32_t)tressFXAsset.m_numTotalStrands,    // Follow root offsets
-			(uint32_t)tressFXAsset.m_numTotalStrands,    // Strand UVs
-			(uint32_t)tressFXAsset.m_numTotalStrands,    // Strand types
-			(uint32_t)tressFXAsset.m_numTotalVertices,   // Thickness coeffs
-			(uint32_t)tressFXAsset.m_numTotalVertices,   // Rest lengths
-		};
-		const void* vertexData[] =
-		{
-			tressFXAsset.m_triangleIndices,    // Indices
-			tressFXAsset.m_positions,          // Position
-			tressFXAsset.m_tangents,           // Tangents
-			tressFXAsset.m_globalRotations,    // Global rotations
-			tressFXAsset.m_localRotations,     // Local rotations
-			tressFXAsset.m_refVectors,         // Ref vectors
-			tressFXAsset.m_followRootOffsets,  // Follow root offsets
-			tressFXAsset.m_strandUV,           // Strand UVs
-			tressFXAsset.m_strandTypes,        // Strand types
-			tressFXAsset.m_thicknessCoeffs,    // Thickness coeffs
-			tressFXAsset.m_restLengths,        // Rest lengths
-		};
-		const char* vertexNames[] =
-		{
-			"INDEX",             // Indices
-			"POSITION",          // Position
-			"TANGENT",           // Tangents
-			"TEXCOORD_0",        // Global rotations
-			"TEXCOORD_1",        // Local rotations
-			"TEXCOORD_2",        // Ref vectors
-			"TEXCOORD_3",        // Follow root offsets
-			"TEXCOORD_4",        // Strand UVs
-			"TEXCOORD_5",        // Strand types
-			"TEXCOORD_6",        // Thickness coeffs
-			"TEXCOORD_7",        // Rest lengths
-		};
-		const uint32_t count = sizeof(vertexData) / sizeof(vertexData[0]);
-
-		cgltf_buffer buffer = {};
-		cgltf_accessor accessors[count] = {};
-		cgltf_buffer_view views[count] = {};
-		cgltf_attribute attribs[count] = {};
-		cgltf_mesh mesh = {};
-		cgltf_primitive prim = {};
-		cgltf_size offset = 0;
-		FileStream binFile = {};
-		fsOpenStreamFromPath(RD_OUTPUT, binFilePath, FM_WRITE_BINARY, &binFile);
-		size_t fileSize = 0;
-
-		for (uint32_t i = 0; i < count; ++i)
-		{
-			views[i].type = (i ? cgltf_buffer_view_type_vertices : cgltf_buffer_view_type_indices);
-			views[i].buffer = &buffer;
-			views[i].offset = offset;
-			views[i].size = vertexCounts[i] * vertexStrides[i];
-			accessors[i].component_type = vertexTypes[i].comp;
-			accessors[i].stride = vertexStrides[i];
-			accessors[i].count = vertexCounts[i];
-			accessors[i].offset = 0;
-			accessors[i].type = vertexTypes[i].type;
-			accessors[i].buffer_view = &views[i];
-
-			attribs[i].name = (char*)vertexNames[i];
-			attribs[i].data = &accessors[i];
-
-			fileSize += fsWriteToStream(&binFile, vertexData[i], views[i].size);
-			offset += views[i].size;
-		}
-		fsCloseStream(&binFile);
-
-		char uri[FS_MAX_PATH] = {};
-		fsGetPathFileName(binFilePath, uri);
-		//sprintf(uri, "%s", fn.buffer);
-		buffer.uri = uri;
-		buffer.size = fileSize;
-
-		prim.indices = accessors;
-		prim.attributes_count = count - 1;
-		prim.attributes = attribs + 1;
-		prim.type = cgltf_primitive_type_triangles;
-
-		mesh.primitives_count = 1;
-		mesh.primitives = &prim;
-
-		char extras[128] = {};
-		sprintf(extras, "{ \"%s\" : %d, \"%s\" : %d }",
-			"mVertexCountPerStrand", tressFXAsset.m_numVerticesPerStrand, "mGuideCountPerStrand", tressFXAsset.m_numGuideStrands);
-
-		char generator[] = "TressFX";
-		cgltf_data data = {};
-		data.asset.generator = generator;
-		data.buffers_count = 1;
-		data.buffers = &buffer;
-		data.buffer_views_count = count;
-		data.buffer_views = views;
-		data.accessors_count = count;
-		data.accessors = accessors;
-		data.meshes_count = 1;
-		data.meshes = &mesh;
-		data.file_data = extras;
-		data.asset.extras.start_offset = 0;
-		data.asset.extras.end_offset = strlen(extras);
-		result = cgltf_write(output, &data);
-	}
-
-	return result == cgltf_result_success;
+	if (!settings->quiet && gltfFilesInDirectory.empty())
+		LOGF(LogLevel::eWARNING, "%s does not contain any gltf files.", fsGetResourceDirectory(RD_INPUT));
+
+	meshopt_setAllocator([](size_t size) { return tf_malloc(size); }, [](void* ptr) { tf_free(ptr); });
+
+	eastl::vector<AssetJob> jobs;
+	for (size_t i = 0; i < gltfFilesInDirectory.size(); ++i)
+	{
+		const char* input = gltfFilesInDirectory[i].c_str();
+		char fileName[FS_MAX_PATH] = {};
+		fsGetPathFileName(input, fileName);
+		char output[FS_MAX_PATH] = {};
+		fsAppendPathExtension(fileName, "gltf", output);
+		jobs.push_back(CreateAssetJob(input, output, ProcessClusterJob));
+	}
+
+	uint64_t settingsHash = HashBytes(&settings->mClusterMaxVertices, sizeof(settings->mClusterMaxVertices));
+	settingsHash = HashBytes(&settings->mClusterMaxTriangles, sizeof(settings->mClusterMaxTriangles), settingsHash);
+
+	return RunAssetJobs("ProcessClusters", jobs, settingsHash, settings);
 }
 
 static uint32_t FindJoint(ozz::animation::Skeleton* skeleton, const char* name)
@@ -753,6 +2549,26 @@ static bool isTrsDecomposable(Matrix4 matrix) {
 	return true;
 }
 
+// Writes the runtime image of an ozz skeleton or animation, which the runtime can map and use in place
+template <typename T>
+static bool WriteRuntimeImage(const T& object, const char* fileName)
+{
+	const size_t size = object.GetImageSize();
+	void* image = tf_memalign(ozz::animation::kRuntimeImageAlignment, size);
+	object.WriteImage(image);
+
+	FileStream file = {};
+	bool success = fsOpenStreamFromPath(RD_OUTPUT, fileName, FM_WRITE_BINARY, &file);
+	if (success)
+	{
+		success = fsWriteToStream(&file, image, size) == size;
+		fsCloseStream(&file);
+	}
+
+	tf_free(image);
+	return success;
+}
+
 bool AssetPipeline::CreateRuntimeSkeleton(
 	const char* skeletonAsset, const char* skeletonName, const char* skeletonOutput, ozz::animation::Skeleton* skeleton,
 	ProcessAssetsSettings* settings)
@@ -949,13 +2765,21 @@ bool AssetPipeline::CreateRuntimeSkeleton(
 	}
 
 	// Write skeleton to disk
-	FileStream file = {};
-	if (!fsOpenStreamFromPath(RD_OUTPUT, skeletonOutput, FM_WRITE_BINARY, &file))
-		return false;
+	if (settings->mAnimationRuntimeImages)
+	{
+		if (!WriteRuntimeImage(*skeleton, skeletonOutput))
+			return false;
+	}
+	else
+	{
+		FileStream file = {};
+		if (!fsOpenStreamFromPath(RD_OUTPUT, skeletonOutput, FM_WRITE_BINARY, &file))
+			return false;
 
-	ozz::io::OArchive archive(&file);
-	archive << *skeleton;
-	fsCloseStream(&file);
+		ozz::io::OArchive archive(&file);
+		archive << *skeleton;
+		fsCloseStream(&file);
+	}
 
 	void* fileData = data->file_data;
 
@@ -1033,6 +2857,117 @@ bool AssetPipeline::CreateRuntimeSkeleton(
 	return true;
 }
 
+// Value of a raw track at time, interpolated the same way the runtime animation is sampled
+template <typename Key, typename Lerp>
+static typename Key::Value SampleRawTrack(const typename ozz::Vector<Key>::Std& keys, float time, Lerp lerp)
+{
+	if (keys.empty())
+		return Key::identity();
+	if (time <= keys.front().time)
+		return keys.front().value;
+	if (time >= keys.back().time)
+		return keys.back().value;
+
+	size_t next = 1;
+	while (keys[next].time < time)
+		++next;
+	const Key& left = keys[next - 1];
+	const Key& right = keys[next];
+	return lerp(left.value, right.value, (time - left.time) / (right.time - left.time));
+}
+
+static void SampleRawAnimationModelSpace(
+	const ozz::animation::Skeleton* skeleton, const ozz::animation::offline::RawAnimation& animation, float time, Matrix4* pModels)
+{
+	using namespace ozz::animation::offline;
+
+	for (int i = 0; i < skeleton->num_joints(); ++i)
+	{
+		const RawAnimation::JointTrack& track = animation.tracks[i];
+		const Matrix4 local = Matrix4::translation(SampleRawTrack<RawAnimation::TranslationKey>(track.translations, time, LerpTranslation)) *
+							  Matrix4::rotation(SampleRawTrack<RawAnimation::RotationKey>(track.rotations, time, LerpRotation)) *
+							  Matrix4::scale(SampleRawTrack<RawAnimation::ScaleKey>(track.scales, time, LerpScale));
+
+		const int parent = skeleton->joint_properties()[i].parent;
+		pModels[i] = parent == ozz::animation::Skeleton::kNoParentIndex ? local : pModels[parent] * local;
+	}
+}
+
+#define ANIMATION_ERROR_SAMPLE_RATE 60.0f
+
+// Largest model space distance between a joint of the source and the optimized animation, sampled at 60 Hz
+static float MeasureAnimationError(
+	const ozz::animation::Skeleton* skeleton, const ozz::animation::offline::RawAnimation& source,
+	const ozz::animation::offline::RawAnimation& optimized, uint32_t* pWorstJoint)
+{
+	eastl::vector<Matrix4> sourceModels(skeleton->num_joints());
+	eastl::vector<Matrix4> optimizedModels(skeleton->num_joints());
+
+	float maxError = 0.0f;
+	*pWorstJoint = 0;
+	const uint32_t sampleCount = (uint32_t)ceilf(source.duration * ANIMATION_ERROR_SAMPLE_RATE) + 1;
+	for (uint32_t sample = 0; sample < sampleCount; ++sample)
+	{
+		const float time = min(sample / ANIMATION_ERROR_SAMPLE_RATE, source.duration);
+		SampleRawAnimationModelSpace(skeleton, source, time, sourceModels.data());
+		SampleRawAnimationModelSpace(skeleton, optimized, time, optimizedModels.data());
+
+		for (uint32_t i = 0; i < (uint32_t)skeleton->num_joints(); ++i)
+		{
+			const float error = length(sourceModels[i].getTranslation() - optimizedModels[i].getTranslation());
+			if (error > maxError)
+			{
+				maxError = error;
+				*pWorstJoint = i;
+			}
+		}
+	}
+
+	return maxError;
+}
+
+static uint32_t CountRawAnimationKeys(const ozz::animation::offline::RawAnimation& animation)
+{
+	uint32_t keyCount = 0;
+	for (const ozz::animation::offline::RawAnimation::JointTrack& track : animation.tracks)
+		keyCount += (uint32_t)(track.translations.size() + track.rotations.size() + track.scales.size());
+	return keyCount;
+}
+
+static void SetupAnimationOptimizer(
+	const ozz::animation::Skeleton* skeleton, const ProcessAssetsSettings* settings, ozz::animation::offline::AnimationOptimizer* pOptimizer)
+{
+	typedef ozz::animation::offline::AnimationOptimizer::JointTolerances JointTolerances;
+
+	pOptimizer->translation_tolerance = settings->mAnimationTranslationTolerance;
+	pOptimizer->rotation_tolerance = degToRad(settings->mAnimationRotationTolerance);
+	pOptimizer->scale_tolerance = settings->mAnimationScaleTolerance;
+	pOptimizer->hierarchical_tolerance = settings->mAnimationHierarchicalTolerance;
+
+	if (!settings->mAnimationJointToleranceCount)
+		return;
+
+	const JointTolerances defaults = { pOptimizer->translation_tolerance, pOptimizer->rotation_tolerance, pOptimizer->scale_tolerance,
+									   pOptimizer->hierarchical_tolerance };
+	pOptimizer->joints_tolerances.resize(skeleton->num_joints(), defaults);
+	for (int i = 0; i < skeleton->num_joints(); ++i)
+	{
+		// Later entries override earlier ones, so a broad match ("Spine") can be refined by a narrower one
+		for (uint32_t j = 0; j < settings->mAnimationJointToleranceCount; ++j)
+		{
+			const AnimationJointTolerance& tolerance = settings->mAnimationJointTolerances[j];
+			if (!strstr(skeleton->joint_names()[i], tolerance.mJointName))
+				continue;
+
+			JointTolerances& jointTolerances = pOptimizer->joints_tolerances[i];
+			jointTolerances.translation = tolerance.mTranslation;
+			jointTolerances.rotation = degToRad(tolerance.mRotation);
+			jointTolerances.scale = tolerance.mScale;
+			jointTolerances.hierarchical = tolerance.mHierarchical;
+		}
+	}
+}
+
 bool AssetPipeline::CreateRuntimeAnimation(
 	const char* animationAsset, ozz::animation::Skeleton* skeleton, const char* skeletonName, const char* animationName,
 	const char* animationOutput, ProcessAssetsSettings* settings)
@@ -1141,25 +3076,175 @@ bool AssetPipeline::CreateRuntimeAnimation(
 		return false;
 	}
 
+	// Strip keyframes that can be interpolated from their neighbours
+	ozz::animation::offline::RawAnimation optimizedAnimation;
+	const ozz::animation::offline::RawAnimation* pBuildAnimation = &rawAnimation;
+	if (settings->mOptimizeAnimations)
+	{
+		ozz::animation::offline::AnimationOptimizer optimizer;
+		SetupAnimationOptimizer(skeleton, settings, &optimizer);
+		if (!optimizer(rawAnimation, *skeleton, &optimizedAnimation))
+		{
+			LOGF(LogLevel::eERROR, "Animation %s of %s can not be optimized.", animationName, skeletonName);
+			return false;
+		}
+		pBuildAnimation = &optimizedAnimation;
+	}
+
 	// Build runtime animation from raw animation
 	ozz::animation::Animation animation;
-	if (!ozz::animation::offline::AnimationBuilder::Build(rawAnimation, &animation))
+	if (!ozz::animation::offline::AnimationBuilder::Build(*pBuildAnimation, &animation))
 	{
 		LOGF(LogLevel::eERROR, "Animation %s can not be created for %s.", animationName, skeletonName);
 		return false;
 	}
 
+	if (settings->mOptimizeAnimations && !settings->quiet)
+	{
+		size_t sourceSize = 0;
+		ozz::animation::Animation sourceAnimation;
+		if (ozz::animation::offline::AnimationBuilder::Build(rawAnimation, &sourceAnimation))
+		{
+			sourceSize = sourceAnimation.size();
+			sourceAnimation.Deallocate();
+		}
+
+		uint32_t worstJoint = 0;
+		const float maxError = MeasureAnimationError(skeleton, rawAnimation, optimizedAnimation, &worstJoint);
+		LOGF(LogLevel::eINFO, "%s/%s: %u -> %u keys, %.1f -> %.1f KB, max error %.3f mm (%s).", skeletonName, animationName,
+			CountRawAnimationKeys(rawAnimation), CountRawAnimationKeys(optimizedAnimation), sourceSize / 1024.0,
+			animation.size() / 1024.0, maxError * 1000.0f, skeleton->joint_names()[worstJoint]);
+	}
+
 	// Write animation to disk
-	FileStream file = {};
+	if (settings->mAnimationRuntimeImages)
+	{
+		if (!WriteRuntimeImage(animation, animationOutput))
+		{
+			animation.Deallocate();
+			return false;
+		}
+	}
+	else
+	{
+		FileStream file = {};
 
-	if (!fsOpenStreamFromPath(RD_OUTPUT, animationOutput, FM_WRITE_BINARY, &file))
-		return false;
+		if (!fsOpenStreamFromPath(RD_OUTPUT, animationOutput, FM_WRITE_BINARY, &file))
+			return false;
 
-	ozz::io::OArchive archive(&file);
-	archive << animation;
-	fsCloseStream(&file);
+		ozz::io::OArchive archive(&file);
+		archive << animation;
+		fsCloseStream(&file);
+	}
 	//Deallocate animation
 	animation.Deallocate();
 
 	return true;
 }
+
+static void* LuaAlloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+	if (nsize == 0)
+	{
+		tf_free(ptr);
+		return NULL;
+	}
+	return tf_realloc(ptr, nsize);
+}
+
+static int LuaWriteBytecode(lua_State* L, const void* p, size_t size, void* ud)
+{
+	eastl::vector<uint8_t>* pBytecode = (eastl::vector<uint8_t>*)ud;
+	pBytecode->insert(pBytecode->end(), (const uint8_t*)p, (const uint8_t*)p + size);
+	return 0;
+}
+
+static bool ProcessScriptJob(AssetJob* pJob, ProcessAssetsSettings* settings)
+{
+	const char* input = pJob->mInput.c_str();
+
+	FileStream file = {};
+	if (!fsOpenStreamFromPath(RD_INPUT, input, FM_READ_BINARY, &file))
+		return false;
+	const ssize_t sourceSize = fsGetStreamFileSize(&file);
+	eastl::vector<char> source(sourceSize > 0 ? (size_t)sourceSize : 0);
+	const size_t bytesRead = fsReadFromStream(&file, source.data(), source.size());
+	fsCloseStream(&file);
+	if (bytesRead != source.size())
+	{
+		LOGF(LogLevel::eERROR, "Failed to read %s.", input);
+		return false;
+	}
+
+	// Compiling does not run the script, so a bare state without any library or registered function is enough
+	lua_State* L = lua_newstate(LuaAlloc, NULL);
+	if (!L)
+		return false;
+
+	// The chunk name is stored in the debug information, match the runtime which loads scripts by file name
+	char fileName[FS_MAX_PATH] = {};
+	fsGetPathFileName(input, fileName);
+	char chunkName[FS_MAX_PATH] = {};
+	sprintf(chunkName, "@%s.lua", fileName);
+
+	eastl::vector<uint8_t> bytecode;
+	bool success = luaL_loadbufferx(L, source.data(), source.size(), chunkName, "t") == LUA_OK;
+	if (success)
+		success = lua_dump(L, LuaWriteBytecode, &bytecode, settings->mStripScriptDebugInfo ? 1 : 0) == 0;
+	else
+		LOGF(LogLevel::eERROR, "Failed to compile %s: %s", input, lua_tostring(L, -1));
+	lua_close(L);
+
+	if (!success)
+		return false;
+
+	LuaBytecodeHeader header = {};
+	header.mMagic = LUA_BYTECODE_MAGIC;
+	header.mVersion = LUA_BYTECODE_VERSION;
+	header.mLuaVersion = LUA_VERSION_NUM;
+	header.mFlags = settings->mStripScriptDebugInfo ? LUA_BYTECODE_FLAG_STRIPPED : LUA_BYTECODE_FLAG_NONE;
+	header.mSourceSize = source.size();
+	header.mSourceHash = LuaBytecodeHashSource(source.data(), source.size());
+
+	if (!fsOpenStreamFromPath(RD_OUTPUT, pJob->mOutput.c_str(), FM_WRITE_BINARY, &file))
+	{
+		LOGF(LogLevel::eERROR, "Failed to write %s.", pJob->mOutput.c_str());
+		return false;
+	}
+	success = fsWriteToStream(&file, &header, sizeof(header)) == sizeof(header) &&
+			  fsWriteToStream(&file, bytecode.data(), bytecode.size()) == bytecode.size();
+	fsCloseStream(&file);
+
+	if (!settings->quiet)
+		LOGF(LogLevel::eINFO, "%s: %u bytes of source, %u bytes of bytecode.", input, (uint32_t)source.size(), (uint32_t)bytecode.size());
+
+	return success;
+}
+
+bool AssetPipeline::ProcessScripts(ProcessAssetsSettings* settings)
+{
+	// Get all lua files
+	eastl::vector<eastl::string> luaFilesInDirectory;
+	fsGetFilesWithExtension(RD_INPUT, "", ".lua", luaFilesInDirectory);
+
+	if (!settings->quiet && luaFilesInDirectory.empty())
+		LOGF(LogLevel::eWARNING, "%s does not contain any lua files.", fsGetResourceDirectory(RD_INPUT));
+
+	eastl::vector<AssetJob> jobs;
+	for (size_t i = 0; i < luaFilesInDirectory.size(); ++i)
+	{
+		const char* input = luaFilesInDirectory[i].c_str();
+		char fileName[FS_MAX_PATH] = {};
+		fsGetPathFileName(input, fileName);
+		char output[FS_MAX_PATH] = {};
+		fsAppendPathExtension(fileName, LUA_BYTECODE_EXTENSION, output);
+		jobs.push_back(CreateAssetJob(input, output, ProcessScriptJob));
+	}
+
+	// Bytecode is only valid for the Lua version and the number formats of the build that dumped it
+	const uint32_t luaVersion = LUA_VERSION_NUM;
+	uint64_t settingsHash = HashBytes(&luaVersion, sizeof(luaVersion));
+	settingsHash = HashBytes(&settings->mStripScriptDebugInfo, sizeof(settings->mStripScriptDebugInfo), settingsHash);
+
+	return RunAssetJobs("ProcessScripts", jobs, settingsHash, settings);
+}
@@ -32,16 +32,76 @@
 extern ResourceDirectory RD_INPUT;
 extern ResourceDirectory RD_OUTPUT;
 
+#define MAX_LOD_LEVELS 8
+#define MAX_ANIMATION_JOINT_TOLERANCES 32
+
+// Keyframe reduction tolerances of the joints whose name contains mJointName
+struct AnimationJointTolerance
+{
+	char        mJointName[64];
+	float       mTranslation;                       // Meters.
+	float       mRotation;                          // Degrees.
+	float       mScale;
+	float       mHierarchical;                      // Meters, also applies to all parents of the joint.
+};
+
+enum TextureCookFormat
+{
+	TEXTURE_COOK_FORMAT_AUTO = 0,       // RGBA8 for 8 bit source images, RGBA16F for exr images
+	TEXTURE_COOK_FORMAT_RGBA8,
+	TEXTURE_COOK_FORMAT_RGBA16F,
+	TEXTURE_COOK_FORMAT_BC1,
+	TEXTURE_COOK_FORMAT_BC3,
+	TEXTURE_COOK_FORMAT_BC4,
+	TEXTURE_COOK_FORMAT_BC5,
+};
+
+enum TextureCookContainer
+{
+	TEXTURE_COOK_CONTAINER_DDS = 0,
+	TEXTURE_COOK_CONTAINER_KTX,
+};
+
 struct ProcessAssetsSettings
 {
 	bool quiet;                  // Only output warnings.
 	bool force;                  // Force all assets to be processed.
-	uint minLastModifiedTime;    // Force all assets older than this to be processed.
+	uint32_t mJobCount;          // Max number of assets processed concurrently. 0 uses all cores.
+
+	// Animation settings
+	bool        mOptimizeAnimations;                // Strip keyframes that can be interpolated within the tolerances.
+	bool        mAnimationRuntimeImages;            // Write ozz files as runtime images that are mapped and used in place.
+	float       mAnimationTranslationTolerance;     // Meters.
+	float       mAnimationRotationTolerance;        // Degrees.
+	float       mAnimationScaleTolerance;
+	float       mAnimationHierarchicalTolerance;    // Max error (meters) the optimization of a joint may cause on its children.
+	uint32_t    mAnimationJointToleranceCount;
+	AnimationJointTolerance mAnimationJointTolerances[MAX_ANIMATION_JOINT_TOLERANCES];
+
+	// Virtual texture settings
+	bool        mCompressVirtualTexturePages;       // Store the pages of baked svt files compressed.
+
+	// Texture settings
+	uint32_t    mTextureFormat;                     // TextureCookFormat of cooked textures.
+	uint32_t    mTextureContainer;                  // TextureCookContainer of cooked textures.
+	bool        mTextureLinear;                     // 8 bit source images hold data (e.g. normal maps) instead of sRGB color.
 
 	// TressFX settings
 	uint32_t    mFollowHairCount;
 	float       mMaxRadiusAroundGuideHair;
 	float       mTipSeperationFactor;
+
+	// LOD settings
+	uint32_t    mLodCount;                          // Number of simplified levels generated below the source mesh.
+	float       mLodTargetRatios[MAX_LOD_LEVELS];   // Target index count of each level relative to the source mesh.
+	float       mLodTargetErrors[MAX_LOD_LEVELS];   // Max simplification error of each level relative to the mesh extent.
+
+	// Cluster settings
+	uint32_t    mClusterMaxVertices;                // Max unique vertices per cluster (<= 64).
+	uint32_t    mClusterMaxTriangles;               // Max triangles per cluster (<= 126).
+
+	// Script settings
+	bool        mStripScriptDebugInfo;              // Strip line numbers and local names from compiled scripts.
 };
 
 class AssetPipeline
@@ -56,5 +116,9 @@ public:
 		const char* animationOutput, ProcessAssetsSettings* settings);
 
 	static bool ProcessVirtualTextures(ProcessAssetsSettings* settings);
+	static bool ProcessTextures(ProcessAssetsSettings* settings);
 	static bool ProcessTFX(ProcessAssetsSettings* settings);
+	static bool ProcessLODs(ProcessAssetsSettings* settings);
+	static bool ProcessClusters(ProcessAssetsSettings* settings);
+	static bool ProcessScripts(ProcessAssetsSettings* settings);
 };
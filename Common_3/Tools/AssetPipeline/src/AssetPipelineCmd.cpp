@@ -38,26 +38,58 @@ void PrintHelp()
 	printf("AssetPipelineCmd\n");
 	printf(
 		"\nCommand: ProcessAnimations          (GLTF to OZZ) -pa   \"animation/directory/\" \"output/directory/\" [flags]\n"
+			"\t --nokeyreduction              : Keep every keyframe of the source animations\n"
+			"\t --animtolerances t,r,s,h      : Keyframe reduction tolerances. Translation (m), rotation (degrees), scale and\n"
+			"\t                                 hierarchical (m, max error on child joints). Defaults to 0.001,0.1,0.001,0.001\n"
+			"\t --jointtolerances Name=t,r,s,h: Tolerances of the joints whose name contains Name, repeatable. Missing values\n"
+			"\t                                 use --animtolerances. Hierarchical tolerances also apply to the parent joints\n"
+			"\t --ozzimages                   : Write skeletons and animations as runtime images, loaded without parsing.\n"
+			"\t                                 Images only load on platforms with the pointer size and endianness of this one\n"
 		"\nCommand: ProcessVirtualTextures     (DDS to SVT)  -pvt  \"source texture directory/\" \"output directory/\" [flags]\n"
+			"\t --compresspages               : Compress each page, pages that do not get smaller are stored as is\n"
+		"\nCommand: ProcessTextures            (PNG to DDS)  -ptex \"source image directory/\" \"output directory/\" [flags]\n"
+			"\t --format bc1                  : rgba8, rgba16f, bc1, bc3, bc4 or bc5. Defaults to rgba8 (rgba16f for exr images)\n"
+			"\t --ktx                         : Write ktx files instead of dds files\n"
+			"\t --linear                      : Source images hold data (e.g. normal maps), not sRGB color\n"
 		"\nCommand: ProcessTFX                 (TFX to GLTF) -ptfx \"source tfx directory/\" \"output directory/\" [flags]\n"
 			"\t --fhc | -followhaircount      : Number of follow hairs around loaded guide hairs procedually\n"
 			"\t --tsf | -tipseparationfactor  : Separation factor for the follow hairs\n"
 			"\t --maxradius | -maxradius      : Max radius of the random distribution to generate follow hairs\n"
+		"\nCommand: ProcessLODs                (GLTF to GLTF) -plod \"source gltf directory/\" \"output directory/\" [flags]\n"
+			"\t --lodratios 0.5,0.25          : Target index count of each generated level relative to the source mesh\n"
+			"\t --loderrors 0.01,0.02         : Max simplification error of each generated level relative to the mesh extent\n"
+		"\nCommand: ProcessClusters            (GLTF to GLTF) -pcl \"source gltf directory/\" \"output directory/\" [flags]\n"
+			"\t --clustervertices 64          : Max unique vertices per cluster (up to 64)\n"
+			"\t --clustertriangles 124        : Max triangles per cluster (up to 126)\n"
+		"\nCommand: ProcessScripts             (LUA to LUAC) -plua \"source script directory/\" \"output directory/\" [flags]\n"
+			"\t --strip                       : Strip debug information, script errors no longer report line numbers\n"
 		"\nCommon Options:\n"
 			"\t --quiet                       : Print only error messages.\n"
 			"\t --force                       : Force all assets to be processed. Including ones that are already up-to-date.\n"
+			"\t --jobs N                      : Max number of assets processed in parallel. Defaults to the number of cores.\n"
 			"\t -h | -help                    : Print usage information.\n");
 }
 
 ResourceDirectory RD_APPLICATION = RD_MIDDLEWARE_0;
 
+// Parses a comma separated list of floats ("0.5,0.25,0.125") and returns the number of values read
+static uint32_t ParseFloatList(const char* list, float* pValues, uint32_t maxCount)
+{
+	uint32_t count = 0;
+	while (list && *list && count < maxCount)
+	{
+		pValues[count++] = (float)atof(list);
+		list = strchr(list, ',');
+		if (list)
+			++list;
+	}
+	return count;
+}
+
 int AssetPipelineCmd(int argc, char** argv)
 {
 	fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_APPLICATION, "");
 
-	time_t appLastModified = 0;
-	appLastModified = fsGetLastModifiedTime(RD_APPLICATION, gApplicationName);
-
 	if (argc == 1)
 	{
 		PrintHelp();
@@ -82,7 +114,31 @@ int AssetPipelineCmd(int argc, char** argv)
 	ProcessAssetsSettings settings = {};
 	settings.quiet = false;
 	settings.force = false;
-	settings.minLastModifiedTime = (unsigned int)appLastModified;
+	settings.mJobCount = 0;
+
+	settings.mOptimizeAnimations = true;
+	settings.mAnimationRuntimeImages = false;
+	settings.mAnimationTranslationTolerance = 0.001f;
+	settings.mAnimationRotationTolerance = 0.1f;
+	settings.mAnimationScaleTolerance = 0.001f;
+	settings.mAnimationHierarchicalTolerance = 0.001f;
+	uint32_t jointToleranceValueCounts[MAX_ANIMATION_JOINT_TOLERANCES] = {};
+
+	settings.mLodCount = 3;
+	const float defaultLodRatios[] = { 0.5f, 0.25f, 0.125f };
+	const float defaultLodErrors[] = { 0.01f, 0.02f, 0.04f };
+	memcpy(settings.mLodTargetRatios, defaultLodRatios, sizeof(defaultLodRatios));
+	memcpy(settings.mLodTargetErrors, defaultLodErrors, sizeof(defaultLodErrors));
+	uint32_t lodErrorCount = settings.mLodCount;
+
+	settings.mClusterMaxVertices = 64;
+	settings.mClusterMaxTriangles = 124;
+
+	settings.mStripScriptDebugInfo = false;
+
+	settings.mTextureFormat = TEXTURE_COOK_FORMAT_AUTO;
+	settings.mTextureContainer = TEXTURE_COOK_CONTAINER_DDS;
+	settings.mTextureLinear = false;
 
 	const char* command = argv[1];
 
@@ -98,6 +154,86 @@ int AssetPipelineCmd(int argc, char** argv)
 		{
 			settings.force = true;
 		}
+		else if (stricmp(arg, "--jobs") == 0)
+		{
+			if (i + 1 < argc && isdigit(argv[i + 1][0]))
+				settings.mJobCount = (uint32_t)atoi(argv[++i]);
+			else
+				printf("WARNING: Argument expects a value: %s\n", arg);
+		}
+		else if (stricmp(arg, "--nokeyreduction") == 0)
+		{
+			settings.mOptimizeAnimations = false;
+		}
+		else if (stricmp(arg, "--ozzimages") == 0)
+		{
+			settings.mAnimationRuntimeImages = true;
+		}
+		else if (stricmp(arg, "--animtolerances") == 0)
+		{
+			float tolerances[4] = { settings.mAnimationTranslationTolerance, settings.mAnimationRotationTolerance,
+									settings.mAnimationScaleTolerance, settings.mAnimationHierarchicalTolerance };
+			if (i + 1 < argc)
+				ParseFloatList(argv[++i], tolerances, 4);
+			else
+				printf("WARNING: Argument expects a value: %s\n", arg);
+
+			settings.mAnimationTranslationTolerance = tolerances[0];
+			settings.mAnimationRotationTolerance = tolerances[1];
+			settings.mAnimationScaleTolerance = tolerances[2];
+			settings.mAnimationHierarchicalTolerance = tolerances[3];
+		}
+		else if (stricmp(arg, "--jointtolerances") == 0)
+		{
+			const char* value = i + 1 < argc ? argv[++i] : "";
+			const char* separator = strchr(value, '=');
+			const uint32_t index = settings.mAnimationJointToleranceCount;
+			AnimationJointTolerance* pTolerance = &settings.mAnimationJointTolerances[index];
+			if (!separator || separator == value || (size_t)(separator - value) >= sizeof(pTolerance->mJointName))
+			{
+				printf("WARNING: Argument expects JointName=t,r,s,h: %s\n", arg);
+			}
+			else if (index == MAX_ANIMATION_JOINT_TOLERANCES)
+			{
+				printf("WARNING: Too many joint tolerances, max is %d\n", MAX_ANIMATION_JOINT_TOLERANCES);
+			}
+			else
+			{
+				float tolerances[4] = {};
+				strncpy(pTolerance->mJointName, value, separator - value);
+				jointToleranceValueCounts[index] = ParseFloatList(separator + 1, tolerances, 4);
+				pTolerance->mTranslation = tolerances[0];
+				pTolerance->mRotation = tolerances[1];
+				pTolerance->mScale = tolerances[2];
+				pTolerance->mHierarchical = tolerances[3];
+				++settings.mAnimationJointToleranceCount;
+			}
+		}
+		else if (stricmp(arg, "--compresspages") == 0)
+		{
+			settings.mCompressVirtualTexturePages = true;
+		}
+		else if (stricmp(arg, "--format") == 0)
+		{
+			const char* formatNames[] = { "auto", "rgba8", "rgba16f", "bc1", "bc3", "bc4", "bc5" };
+			const char* format = i + 1 < argc ? argv[++i] : "";
+			uint32_t formatIndex = 0;
+			while (formatIndex < sizeof(formatNames) / sizeof(formatNames[0]) && stricmp(format, formatNames[formatIndex]) != 0)
+				++formatIndex;
+
+			if (formatIndex < sizeof(formatNames) / sizeof(formatNames[0]))
+				settings.mTextureFormat = formatIndex;
+			else
+				printf("WARNING: Unrecognized texture format: %s\n", format);
+		}
+		else if (stricmp(arg, "--ktx") == 0)
+		{
+			settings.mTextureContainer = TEXTURE_COOK_CONTAINER_KTX;
+		}
+		else if (stricmp(arg, "--linear") == 0)
+		{
+			settings.mTextureLinear = true;
+		}
 		else if (stricmp(arg, "-followhaircount") == 0 || stricmp(arg, "--fhc") == 0)
 		{
 			if (i + 1 < argc && isdigit(argv[i + 1][0]))
@@ -113,12 +249,63 @@ int AssetPipelineCmd(int argc, char** argv)
 		{
 			settings.mMaxRadiusAroundGuideHair = (float)atof(argv[++i]);
 		}
+		else if (stricmp(arg, "--lodratios") == 0)
+		{
+			if (i + 1 < argc)
+				settings.mLodCount = ParseFloatList(argv[++i], settings.mLodTargetRatios, MAX_LOD_LEVELS);
+			else
+				printf("WARNING: Argument expects a value: %s\n", arg);
+		}
+		else if (stricmp(arg, "--clustervertices") == 0)
+		{
+			if (i + 1 < argc && isdigit(argv[i + 1][0]))
+				settings.mClusterMaxVertices = (uint32_t)atoi(argv[++i]);
+			else
+				printf("WARNING: Argument expects a value: %s\n", arg);
+		}
+		else if (stricmp(arg, "--clustertriangles") == 0)
+		{
+			if (i + 1 < argc && isdigit(argv[i + 1][0]))
+				settings.mClusterMaxTriangles = (uint32_t)atoi(argv[++i]);
+			else
+				printf("WARNING: Argument expects a value: %s\n", arg);
+		}
+		else if (stricmp(arg, "--strip") == 0)
+		{
+			settings.mStripScriptDebugInfo = true;
+		}
+		else if (stricmp(arg, "--loderrors") == 0)
+		{
+			if (i + 1 < argc)
+				lodErrorCount = ParseFloatList(argv[++i], settings.mLodTargetErrors, MAX_LOD_LEVELS);
+			else
+				printf("WARNING: Argument expects a value: %s\n", arg);
+		}
 		else
 		{
 			printf("WARNING: Unrecognized argument: %s\n", arg);
 		}
 	}
 
+	// Joint tolerances without all values take the remaining ones from the animation tolerances
+	for (uint32_t i = 0; i < settings.mAnimationJointToleranceCount; ++i)
+	{
+		AnimationJointTolerance* pTolerance = &settings.mAnimationJointTolerances[i];
+		const uint32_t valueCount = jointToleranceValueCounts[i];
+		if (valueCount < 1)
+			pTolerance->mTranslation = settings.mAnimationTranslationTolerance;
+		if (valueCount < 2)
+			pTolerance->mRotation = settings.mAnimationRotationTolerance;
+		if (valueCount < 3)
+			pTolerance->mScale = settings.mAnimationScaleTolerance;
+		if (valueCount < 4)
+			pTolerance->mHierarchical = settings.mAnimationHierarchicalTolerance;
+	}
+
+	// Levels without an explicit error threshold keep doubling the last one
+	for (uint32_t i = max(lodErrorCount, 1u); i < settings.mLodCount; ++i)
+		settings.mLodTargetErrors[i] = settings.mLodTargetErrors[i - 1] * 2.0f;
+
 	if (stricmp(command, "-pa") == 0)
 	{
 		if (!AssetPipeline::ProcessAnimations(&settings))
@@ -129,11 +316,31 @@ int AssetPipelineCmd(int argc, char** argv)
 		if (!AssetPipeline::ProcessVirtualTextures(&settings))
 			return 1;
 	}
+	else if (stricmp(command, "-ptex") == 0)
+	{
+		if (!AssetPipeline::ProcessTextures(&settings))
+			return 1;
+	}
 	else if (stricmp(command, "-ptfx") == 0)
 	{
 		if (!AssetPipeline::ProcessTFX(&settings))
 			return 1;
 	}
+	else if (stricmp(command, "-plod") == 0)
+	{
+		if (!AssetPipeline::ProcessLODs(&settings))
+			return 1;
+	}
+	else if (stricmp(command, "-pcl") == 0)
+	{
+		if (!AssetPipeline::ProcessClusters(&settings))
+			return 1;
+	}
+	else if (stricmp(command, "-plua") == 0)
+	{
+		if (!AssetPipeline::ProcessScripts(&settings))
+			return 1;
+	}
 	else
 	{
 		printf("ERROR: Invalid command. %s\n", command);
@@ -66,6 +66,7 @@
 
 //LUA
 #include "../../../../Middleware_3/LUA/LuaManager.h"
+#include "../../../../Middleware_3/LUA/LuaBinding.h"
 
 #include "../../../../Common_3/OS/Core/ThreadSystem.h"
 
@@ -667,6 +668,106 @@ eastl::vector<mat4> gTextWorldMats;
 
 void ReloadScriptButtonCallback() { gLuaManager.ReloadUpdatableScript(); }
 
+// Functions called by updateCamera.lua every frame, bound with LUA_BINDING
+static void LuaSetCameraPosition(float x, float y, float z) { pCameraController->moveTo(vec3(x, y, z)); }
+static void LuaLookAtWorldOrigin() { pCameraController->lookAt(vec3(0, 0, 0)); }
+static int  LuaGetIsCameraAnimated() { return gbAnimateCamera ? 1 : 0; }
+
+// Lua binding benchmark: bindingBenchmark.lua calls a function of the same signature
+// through the ILuaStateWrap path and through a LUA_BINDING and reports the time per call.
+// The memory of the Lua states is listed after it
+const int                    gLuaBindingBenchmarkCalls = 1000000;
+bool                         gRunLuaBindingBenchmark = false;
+eastl::vector<eastl::string> gLuaBindingBenchmarkResults;
+
+static double  LuaBenchmarkNative(int i, double x, const char* name) { return i * x + (double)strlen(name); }
+static int64_t LuaGetBenchmarkTime() { return getUSec(); }
+static int     LuaGetBenchmarkCalls() { return gLuaBindingBenchmarkCalls; }
+static void    LuaReportBenchmark(const char* name, int64_t usec, int calls)
+{
+	eastl::string result;
+	result.sprintf("Lua %s: %.1f ns per call (%d calls)", name, usec * 1000.0 / calls, calls);
+	LOGF(LogLevel::eINFO, "%s", result.c_str());
+	gLuaBindingBenchmarkResults.push_back(result);
+}
+
+void RunLuaBindingBenchmarkButtonCallback() { gRunLuaBindingBenchmark = true; }
+
+// Lua async stress test: asyncStress.lua is queued gLuaAsyncStressScripts times with AddAsyncScript.
+// The functions it calls run on the async workers at the same time, each run writes the report of its own index.
+// Every callback and every reported sum is checked once all runs finished, the result is listed like the benchmark
+#define LUA_ASYNC_STRESS_SCRIPTS 1024
+struct LuaAsyncStressReport
+{
+	uint32_t mCount;
+	bool     mCorrect;
+	ThreadID mThread;
+};
+bool                 gRunLuaAsyncStressTest = false;
+tfrg_atomic32_t      gLuaAsyncStressNextIndex = 0;
+LuaAsyncStressReport gLuaAsyncStressReports[LUA_ASYNC_STRESS_SCRIPTS];
+
+static int  LuaGetAsyncStressIndex() { return (int)tfrg_atomic32_add_relaxed(&gLuaAsyncStressNextIndex, 1); }
+static void LuaReportAsyncStress(int index, int64_t sum)
+{
+	if (index < 0 || index >= LUA_ASYNC_STRESS_SCRIPTS)
+		return;
+	const int64_t count = ((int64_t)index + 1) * 100;
+	LuaAsyncStressReport& report = gLuaAsyncStressReports[index];
+	++report.mCount;
+	report.mCorrect = sum == count * (count + 1) / 2;
+	report.mThread = Thread::GetCurrentThreadID();
+}
+
+static void RunLuaAsyncStressTest()
+{
+	memset(gLuaAsyncStressReports, 0, sizeof(gLuaAsyncStressReports));
+	tfrg_atomic32_store_relaxed(&gLuaAsyncStressNextIndex, 0);
+
+	uint32_t callbackCount = 0;
+	uint32_t failedCount = 0;
+	const int64_t start = getUSec();
+	for (uint32_t i = 0; i < LUA_ASYNC_STRESS_SCRIPTS; ++i)
+	{
+		gLuaManager.AddAsyncScript("asyncStress.lua", [&callbackCount, &failedCount](ScriptState state) {
+			++callbackCount;
+			if (state != FINISHED_OK)
+				++failedCount;
+		});
+	}
+	// Also runs the callbacks
+	gLuaManager.WaitForAsyncScripts();
+	const int64_t duration = getUSec() - start;
+
+	uint32_t wrongCount = (uint32_t)tfrg_atomic32_load_relaxed(&gLuaAsyncStressNextIndex) != LUA_ASYNC_STRESS_SCRIPTS ? 1 : 0;
+	eastl::vector<ThreadID> threads;
+	for (uint32_t i = 0; i < LUA_ASYNC_STRESS_SCRIPTS; ++i)
+	{
+		const LuaAsyncStressReport& report = gLuaAsyncStressReports[i];
+		if (report.mCount != 1 || !report.mCorrect)
+		{
+			++wrongCount;
+			continue;
+		}
+		if (eastl::find(threads.begin(), threads.end(), report.mThread) == threads.end())
+			threads.push_back(report.mThread);
+	}
+
+	const bool passed = callbackCount == LUA_ASYNC_STRESS_SCRIPTS && !failedCount && !wrongCount;
+	eastl::string result;
+	result.sprintf("Lua async stress test %s: %u scripts in %.1f ms on %u threads, %u callbacks, %u failed, %u wrong results",
+		passed ? "passed" : "FAILED", LUA_ASYNC_STRESS_SCRIPTS, duration / 1000.0, (uint32_t)threads.size(), callbackCount, failedCount,
+		wrongCount);
+	LOGF(passed ? LogLevel::eINFO : LogLevel::eERROR, "%s", result.c_str());
+	gLuaBindingBenchmarkResults.push_back(result);
+}
+
+void RunLuaAsyncStressTestButtonCallback() { gRunLuaAsyncStressTest = true; }
+
+// Time per frame the Lua garbage collector may run in gLuaManager.Update, and while waiting for the render fence
+const float gLuaFrameGCBudgetMs = 0.25f;
+const float gLuaIdleGCBudgetMs = 0.5f;
+
 bool gTakeScreenshot = false;
 
 void takeScreenshot()
@@ -902,22 +1003,26 @@ class MaterialPlayground: public IApp
 			state->PushResultNumber(pos.getZ());
 			return 3;    // return amount of arguments
 		});
-		gLuaManager.SetFunction("SetCameraPosition", [cameraLocalPtr](ILuaStateWrap* state) -> int {
-			float x = (float)state->GetNumberArg(1);    //in Lua indexing starts from 1!
-			float y = (float)state->GetNumberArg(2);
-			float z = (float)state->GetNumberArg(3);
-			cameraLocalPtr->moveTo(vec3(x, y, z));
-			return 0;    // return amount of arguments
-		});
-		gLuaManager.SetFunction("LookAtWorldOrigin", [cameraLocalPtr](ILuaStateWrap* state) -> int {
-			cameraLocalPtr->lookAt(vec3(0, 0, 0));
-			return 0;    // return amount of arguments
-		});
-		gLuaManager.SetFunction("GetIsCameraAnimated", [](ILuaStateWrap* state) -> int {
-			state->PushResultInteger(gbAnimateCamera ? 1 : 0);
-			return 1;    // return amount of arguments
+		gLuaManager.SetFunction<LUA_BINDING(&LuaSetCameraPosition)>("SetCameraPosition");
+		gLuaManager.SetFunction<LUA_BINDING(&LuaLookAtWorldOrigin)>("LookAtWorldOrigin");
+		gLuaManager.SetFunction<LUA_BINDING(&LuaGetIsCameraAnimated)>("GetIsCameraAnimated");
+
+		gLuaManager.SetFunction("BenchmarkWrapped", [](ILuaStateWrap* state) -> int {
+			int           i = (int)state->GetIntegerArg(1);
+			double        x = state->GetNumberArg(2);
+			eastl::string name = state->GetStringArg(3);
+			state->PushResultNumber(i * x + (double)name.size());
+			return 1;
 		});
+		gLuaManager.SetFunction<LUA_BINDING(&LuaBenchmarkNative)>("BenchmarkNative");
+		gLuaManager.SetFunction<LUA_BINDING(&LuaGetBenchmarkTime)>("GetBenchmarkTime");
+		gLuaManager.SetFunction<LUA_BINDING(&LuaGetBenchmarkCalls)>("GetBenchmarkCalls");
+		gLuaManager.SetFunction<LUA_BINDING(&LuaReportBenchmark)>("ReportBenchmark");
+		gLuaManager.SetFunction<LUA_BINDING(&LuaGetAsyncStressIndex)>("GetAsyncStressIndex");
+		gLuaManager.SetFunction<LUA_BINDING(&LuaReportAsyncStress)>("ReportAsyncStress");
 		gbLuaScriptingSystemLoadedSuccessfully = gLuaManager.SetUpdatableScript("updateCamera.lua", "Update", "Exit");
+		// Lua garbage is collected at the end of the update and while waiting for the GPU, not inside the scripts
+		gLuaManager.SetGarbageCollectorMode(LUA_GC_MODE_BUDGETED, gLuaFrameGCBudgetMs);
 		
 		// SET MATERIAL LIGHTING MODELS
 		//
@@ -972,6 +1077,7 @@ class MaterialPlayground: public IApp
 	{
 		exitInputSystem();
 		gLuaManager.Exit();
+		gLuaBindingBenchmarkResults.set_capacity(0);
 		shutdownThreadSystem(pIOThreads);
 
 		waitQueueIdle(pGraphicsQueue);
@@ -1086,6 +1192,34 @@ class MaterialPlayground: public IApp
 			gLuaManager.Update(deltaTime);
 		}
 
+		if (gRunLuaBindingBenchmark)
+		{
+			gRunLuaBindingBenchmark = false;
+			gLuaBindingBenchmarkResults.clear();
+			gLuaManager.RunScript("bindingBenchmark.lua");
+
+			// Memory of the Lua states after the benchmark
+			eastl::vector<LuaMemoryStats> memoryStats;
+			gLuaManager.GetMemoryStats(memoryStats);
+			for (const LuaMemoryStats& stats : memoryStats)
+			{
+				eastl::string result;
+				result.sprintf(
+					"Lua %s state: %llu KB used, %llu KB reserved, %llu allocations, %llu frees, GC %llu us last frame, %u cycles",
+					stats.pStateName, (unsigned long long)(stats.mUsedBytes / 1024), (unsigned long long)(stats.mReservedBytes / 1024),
+					(unsigned long long)stats.mNumAllocations, (unsigned long long)stats.mNumFrees,
+					(unsigned long long)stats.mGCFrameTimeUs, stats.mNumGCCycles);
+				gLuaBindingBenchmarkResults.push_back(result);
+			}
+		}
+
+		if (gRunLuaAsyncStressTest)
+		{
+			gRunLuaAsyncStressTest = false;
+			gLuaBindingBenchmarkResults.clear();
+			RunLuaAsyncStressTest();
+		}
+
 		// calculate matrices
 		mat4 viewMat = pCameraController->getViewMatrix();
 		const float aspectInverse = (float)mSettings.mHeight / (float)mSettings.mWidth;
@@ -1304,7 +1438,10 @@ class MaterialPlayground: public IApp
 		FenceStatus fenceStatus;
 		getFenceStatus(pRenderer, pRenderCompleteFence, &fenceStatus);
 		if (fenceStatus == FENCE_STATUS_INCOMPLETE)
+		{
+			gLuaManager.CollectGarbage(gLuaIdleGCBudgetMs);
 			waitForFences(pRenderer, 1, &pRenderCompleteFence);
+		}
 
 		resetCmdPool(pRenderer, pCmdPools[gFrameIndex]);
 		resetCmdPool(pRenderer, pUICmdPools[gFrameIndex]);
@@ -2004,6 +2141,13 @@ class MaterialPlayground: public IApp
 		{
 			gAppUI.DrawText(cmd, float2(8, 75), "Error loading LUA scripts!", &gErrMsgDrawDesc);
 		}
+
+		float2 benchmarkTextPos = float2(8.0f, txtSize.y + 75.f);
+		for (const eastl::string& result : gLuaBindingBenchmarkResults)
+		{
+			gAppUI.DrawText(cmd, benchmarkTextPos, result.c_str(), &gFrameTimeDraw);
+			benchmarkTextPos.y += gAppUI.MeasureText(result.c_str(), gFrameTimeDraw).y + 5.f;
+		}
 		cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);	// HUD Text
 
 
@@ -2856,8 +3000,9 @@ class MaterialPlayground: public IApp
         
 		gLuaManager.AddAsyncScript("loadModels.lua", [&modelsAreLoaded](ScriptState state) { modelsAreLoaded = true; });
 
-		while (!modelsAreLoaded)
-			Thread::Sleep(0);
+		// The script runs on a Lua worker, its callback is called from here once it finished
+		gLuaManager.WaitForAsyncScripts();
+		ASSERT(modelsAreLoaded);
 
 		uintptr_t meshCount = pStagingData->mModelList.size();
 		gMeshes.resize(meshCount);
@@ -2893,8 +3038,9 @@ class MaterialPlayground: public IApp
        
 		gLuaManager.AddAsyncScript("loadTextures.lua", [&texturesAreLoaded](ScriptState state) { texturesAreLoaded = true; });
         
-		while (!texturesAreLoaded)
-			Thread::Sleep(0);
+		// The script runs on a Lua worker, its callback is called from here once it finished
+		gLuaManager.WaitForAsyncScripts();
+		ASSERT(texturesAreLoaded);
 
 		uintptr_t materialTextureCount = pStagingData->mMaterialNamesStorage.size();
 		gTextureMaterialMaps.resize(materialTextureCount);
@@ -2924,8 +3070,9 @@ class MaterialPlayground: public IApp
 		gLuaManager.AddAsyncScript(
 			"loadGroundTextures.lua", [&groundTexturesAreLoaded](ScriptState state) { groundTexturesAreLoaded = true; });
 
-		while (!groundTexturesAreLoaded)
-			Thread::Sleep(0);
+		// The script runs on a Lua worker, its callback is called from here once it finished
+		gLuaManager.WaitForAsyncScripts();
+		ASSERT(groundTexturesAreLoaded);
 
 		uintptr_t groundTextureCount = pStagingData->mGroundNamesStorage.size();
 		gTextureMaterialMapsGround.resize(groundTextureCount);
@@ -4643,6 +4790,12 @@ void GuiController::AddGui()
 	ButtonWidget ReloadScriptButton("Reload script");
 	ReloadScriptButton.pOnDeactivatedAfterEdit = ReloadScriptButtonCallback;
 	pGuiWindowMain->AddWidget(ReloadScriptButton);
+	ButtonWidget RunLuaBindingBenchmarkButton("Run Lua binding benchmark");
+	RunLuaBindingBenchmarkButton.pOnDeactivatedAfterEdit = RunLuaBindingBenchmarkButtonCallback;
+	pGuiWindowMain->AddWidget(RunLuaBindingBenchmarkButton);
+	ButtonWidget RunLuaAsyncStressTestButton("Run Lua async stress test");
+	RunLuaAsyncStressTestButton.pOnDeactivatedAfterEdit = RunLuaAsyncStressTestButtonCallback;
+	pGuiWindowMain->AddWidget(RunLuaAsyncStressTestButton);
 
 	pGuiWindowMain->AddWidget(CheckboxWidget("Skybox", &gDrawSkybox));
 	
@@ -0,0 +1,13 @@
+--[[
+Copyright (c) 2018-2021 The Forge Interactive Inc.
+]]--
+
+-- Queued many times at once as an async script, the runs are spread over all async Lua states.
+-- Every run takes its own index and reports the sum of 1 to (index + 1) * 100, the app checks it
+local index = loader.GetAsyncStressIndex()
+local count = (index + 1) * 100
+local sum = 0
+for i = 1, count do
+	sum = sum + i
+end
+loader.ReportAsyncStress(index, sum)
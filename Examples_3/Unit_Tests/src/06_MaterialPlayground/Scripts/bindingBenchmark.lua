@@ -0,0 +1,34 @@
+--[[
+Copyright (c) 2018-2021 The Forge Interactive Inc.
+]]--
+
+-- Call overhead of native functions: BenchmarkWrapped goes through ILuaStateWrap,
+-- BenchmarkNative is a LUA_BINDING with the same signature
+local calls = loader.GetBenchmarkCalls()
+local sum = 0
+
+local start = loader.GetBenchmarkTime()
+for i = 1, calls do
+	sum = sum + i * 0.5 + 7
+end
+loader.ReportBenchmark("empty loop", loader.GetBenchmarkTime() - start, calls)
+
+start = loader.GetBenchmarkTime()
+for i = 1, calls do
+	sum = sum + loader.BenchmarkWrapped(i, 0.5, "wrapped")
+end
+loader.ReportBenchmark("wrapped function", loader.GetBenchmarkTime() - start, calls)
+
+start = loader.GetBenchmarkTime()
+for i = 1, calls do
+	sum = sum + loader.BenchmarkNative(i, 0.5, "binding")
+end
+loader.ReportBenchmark("LUA_BINDING", loader.GetBenchmarkTime() - start, calls)
+
+-- Without the lookup in loader on every call
+local native = loader.BenchmarkNative
+start = loader.GetBenchmarkTime()
+for i = 1, calls do
+	sum = sum + native(i, 0.5, "binding")
+end
+loader.ReportBenchmark("LUA_BINDING, cached in a local", loader.GetBenchmarkTime() - start, calls)
@@ -29,6 +29,8 @@
 
 // ECS
 #include "../../../../Middleware_3/ECS/EntityManager.h"
+#include "../../../../Middleware_3/ECS/SystemScheduler.h"
+#include "../../../../Middleware_3/ECS/SpatialHashGrid.h"
 #include "../../../../Middleware_3/ECS/ComponentRepresentation.h"
 
 // REPRESENTATIONS
@@ -36,12 +38,14 @@
 #include "../17_EntityComponentSystem/Representations/PositionRepresentation.h"
 #include "../17_EntityComponentSystem/Representations/SpriteRepresentation.h"
 #include "../17_EntityComponentSystem/Representations/MoveRepresentation.h"
+#include "../17_EntityComponentSystem/Representations/AvoidRepresentation.h"
 
 // COMPONENTS
 #include "../17_EntityComponentSystem/Components/WorldBoundsComponent.h"
 #include "../17_EntityComponentSystem/Components/PositionComponent.h"
 #include "../17_EntityComponentSystem/Components/SpriteComponent.h"
 #include "../17_EntityComponentSystem/Components/MoveComponent.h"
+#include "../17_EntityComponentSystem/Components/AvoidComponent.h"
 
 //Interfaces
 #include "../../../../Common_3/OS/Interfaces/ICameraController.h"
@@ -111,12 +115,50 @@ static float RandomFloat01() { return (float)rand() / (float)RAND_MAX; }
 static float RandomFloat(float from, float to) { return RandomFloat01() * (to - from) + from; }
 
 const uint MaxSpriteCount = 11000;
-const uint SpriteEntityCount = 10000;
 const uint AvoidCount = 20;
 
-static Entity* worldBoundsEntity;
-static Entity* spriteEntities[SpriteEntityCount];
-static Entity* avoidEntities[AvoidCount];
+// Only the first sprites fit in the sprite buffer, the avoid entities are always drawn
+const uint MaxDrawnSpriteEntityCount = MaxSpriteCount - AvoidCount;
+
+enum ComponentStorage
+{
+	COMPONENT_STORAGE_INDIVIDUAL = 0,
+	COMPONENT_STORAGE_ARCHETYPE,
+};
+
+const uint32_t gSpriteEntityCounts[] = { 10000, 100000, 250000, 500000, 1000000 };
+const char*    gSpriteEntityCountNames[] = { "10k", "100k", "250k", "500k", "1M" };
+// Individually allocated components and their representations take around a kilobyte per sprite
+const uint32_t IndividualStorageMaxSpriteCount = 250000;
+
+const uint32_t gComponentStorageValues[] = { COMPONENT_STORAGE_INDIVIDUAL, COMPONENT_STORAGE_ARCHETYPE };
+const char*    gComponentStorageNames[] = { "Individual components", "Archetype chunks" };
+
+uint32_t gSpriteEntityCount = gSpriteEntityCounts[0];
+uint32_t gComponentStorage = COMPONENT_STORAGE_ARCHETYPE;
+bool     gRecreateEntities = false;
+
+// Archetype chunks and individually allocated entities processed by one thread system task
+const uint32_t ChunksPerTask = 8;
+const uint32_t EntitiesPerTask = 4096;
+
+// Cells twice the avoid distance, an avoider query covers at most 2x2 cells. The world bounds hold about 2400 cells
+const float    GridCellSize = 2.6f;
+const uint32_t GridBucketCount = 4096;
+
+const unsigned int BenchmarkFrameCount = 32;
+bool               gRunBenchmark = false;
+eastl::vector<eastl::string> gBenchmarkResults;
+
+static HiresTimer gSystemsTimer;
+
+static EntityId worldBoundsEntityId;
+static Entity*  worldBoundsEntity;
+static eastl::vector<Entity*>  spriteEntities;
+static eastl::vector<EntityId> spriteEntityIds;
+static Entity*  avoidEntities[AvoidCount];
+static EntityId avoidEntityIds[AvoidCount];
+static eastl::vector<ArchetypeChunk*> gDrawChunks;
 
 EntityManager* pEntityManager = nullptr;
 
@@ -125,7 +167,7 @@ bool multiThread			= true;
 
 GuiComponent* GUIWindow = nullptr;
 
-void MoveEntities(PositionComponent& position, MoveComponent& move, float& deltaTime, const WorldBoundsComponent& bounds)
+void MoveEntities(PositionComponent& position, MoveComponent& move, float deltaTime, const WorldBoundsComponent& bounds)
 {
 	// update position based on movement velocity & delta time
 	position.x += move.velx * deltaTime;
@@ -154,79 +196,74 @@ void MoveEntities(PositionComponent& position, MoveComponent& move, float& delta
 	}
 }
 
-struct timeAndBounds {
-	Entity** entities;
-	float deltaTime;
-	const WorldBoundsComponent* bounds;
-};
+// Number of tasks for entities with individually allocated components, the avoiders get one more task
+static uint32_t getEntityTaskCount() { return ((uint32_t)spriteEntities.size() + EntitiesPerTask - 1) / EntitiesPerTask + 1; }
 
-struct MoveSystem
+// Entities of an entity task, the last task holds the avoiders
+static void getEntityTaskRange(uint32_t task, Entity*** ppEntities, size_t* pStart, size_t* pEnd)
 {
-	struct Task
+	if (task + 1 == getEntityTaskCount())
 	{
-		size_t         start;
-		size_t         end;
-		timeAndBounds* data;
-	};
+		*ppEntities = avoidEntities;
+		*pStart = 0;
+		*pEnd = AvoidCount;
+		return;
+	}
 
-	Task          tasks[MAX_LOAD_THREADS + 2] = {};
+	*ppEntities = spriteEntities.data();
+	*pStart = task * EntitiesPerTask;
+	*pEnd = min(spriteEntities.size(), *pStart + EntitiesPerTask);
+}
 
-	void Update(float deltaTime)
-	{
-		const WorldBoundsComponent& bounds = *worldBoundsEntity->getComponent<WorldBoundsComponent>();
+struct MoveSystem: public ChunkSystem
+{
+	const WorldBoundsComponent* pBounds = NULL;
 
-		timeAndBounds moveData = { spriteEntities, deltaTime, &bounds };
-		timeAndBounds avoidData = { avoidEntities, deltaTime, &bounds };
-		
-		// 1 thread used by resource loader
-		const uint32_t numThreads = max(1u, getThreadSystemThreadCount(pThreadSystem) - 1);
-		const uint32_t entitiesPerThread = SpriteEntityCount / (numThreads + 1);
+	MoveSystem(): ChunkSystem(pEntityManager, ChunksPerTask) { setQuery<PositionComponent, MoveComponent>(); }
 
-		// Make sure there is enough workload for parallel processing
-		if (multiThread && entitiesPerThread < SpriteEntityCount / 2)
-		{
-			uint32_t taskCount = 0;
+	void declareAccess(SystemAccess& access) override
+	{
+		access.write<PositionComponent>().write<MoveComponent>().read<WorldBoundsComponent>();
+	}
 
-			for (taskCount = 0; taskCount < numThreads; ++taskCount)
-			{
-				Task* task = &tasks[taskCount];
-				task->start = taskCount * entitiesPerThread;
-				task->end = min((size_t)SpriteEntityCount, task->start + entitiesPerThread);
-				task->data = &moveData;
-				addThreadSystemTask(pThreadSystem, &memberTaskFunc<MoveSystem, &MoveSystem::threadedUpdate>, this, taskCount);
-			}
+	uint32_t prepare(float deltaTime) override
+	{
+		pBounds = worldBoundsEntity->getComponent<WorldBoundsComponent>();
+		if (gComponentStorage == COMPONENT_STORAGE_ARCHETYPE)
+			return ChunkSystem::prepare(deltaTime);
 
-			// Remaining entities on main thread
-			tasks[taskCount] = { tasks[taskCount - 1].end, SpriteEntityCount, &moveData };
-			threadedUpdate(taskCount++);
-			
-			tasks[taskCount] = { 0, AvoidCount, &avoidData };
-			threadedUpdate(taskCount++);
+		return getEntityTaskCount();
+	}
 
-			waitThreadSystemIdle(pThreadSystem);
-		}
-		else
+	void update(uint32_t task, float deltaTime) override
+	{
+		if (gComponentStorage == COMPONENT_STORAGE_ARCHETYPE)
 		{
-			tasks[0] = { 0, SpriteEntityCount, &moveData };
-			threadedUpdate(0);
-
-			tasks[1] = { 0, AvoidCount, &avoidData };
-			threadedUpdate(1);
+			ChunkSystem::update(task, deltaTime);
+			return;
 		}
-	}
 
-	void threadedUpdate(uintptr_t id)
-	{
-		const Task* task = &tasks[id];
-		for (uintptr_t i = task->start; i < task->end; ++i)
+		Entity** entities = NULL;
+		size_t   start = 0, end = 0;
+		getEntityTaskRange(task, &entities, &start, &end);
+		for (size_t i = start; i < end; ++i)
 		{
-			Entity* pEntity = (task->data->entities)[i];
+			Entity* pEntity = entities[i];
 			PositionComponent& position = *(pEntity->getComponent<PositionComponent>());
 			MoveComponent& move = *(pEntity->getComponent<MoveComponent>());
 
-			MoveEntities(position, move, task->data->deltaTime, *task->data->bounds);
+			MoveEntities(position, move, deltaTime, *pBounds);
 		}
 	}
+
+	void updateChunk(ArchetypeChunk* pChunk, float deltaTime) override
+	{
+		PositionComponent* pPositions = pChunk->getArray<PositionComponent>();
+		MoveComponent*     pMoves = pChunk->getArray<MoveComponent>();
+
+		for (uint32_t i = 0; i < pChunk->mCount; ++i)
+			MoveEntities(pPositions[i], pMoves[i], deltaTime, *pBounds);
+	}
 };
 
 static float DistanceSq(const PositionComponent& a, const PositionComponent& b)
@@ -236,49 +273,137 @@ static float DistanceSq(const PositionComponent& a, const PositionComponent& b)
 	return dx * dx + dy * dy;
 }
 
-struct AvoidanceSystem
+// Rebuilds the grid of sprite positions after the sprites moved, the grid value is the index of the sprite
+// in spriteEntities, or the row of the sprite across mChunks with archetype storage.
+// The first pass counts the sprites of each cell, the second one scatters them
+struct SpriteGridSystem: public ChunkSystem
 {
-	struct Task
-	{
-		size_t         start;
-		size_t         end;
-		timeAndBounds* data;
-	};
-
-	Task tasks[MAX_LOAD_THREADS + 1] = {};
-
-	static eastl::vector<float>    avoidDistanceList;
+	SpatialHashGrid         grid;
+	eastl::vector<uint32_t> chunkFirstRows;
+	uint32_t                taskCount = 0;
+	uint32_t                pass = 0;
 
-	Mutex emplaceMutex;
-	
-	bool init()
+	SpriteGridSystem(): ChunkSystem(pEntityManager, ChunksPerTask), grid(GridCellSize, GridBucketCount)
 	{
-		return emplaceMutex.Init();
+		setQuery<PositionComponent, SpriteComponent>();
+		setExcludedTypes<AvoidComponent>();
 	}
-	
-	void exit()
+
+	void declareAccess(SystemAccess& access) override { access.read<PositionComponent>(); }
+
+	uint32_t prepare(float deltaTime) override
 	{
-		emplaceMutex.Destroy();
+		uint32_t spriteCount = 0;
+		if (gComponentStorage == COMPONENT_STORAGE_ARCHETYPE)
+		{
+			taskCount = ChunkSystem::prepare(deltaTime);
+			chunkFirstRows.resize(mChunks.size() + 1);
+			for (size_t i = 0; i < mChunks.size(); ++i)
+			{
+				chunkFirstRows[i] = spriteCount;
+				spriteCount += mChunks[i]->mCount;
+			}
+			chunkFirstRows[mChunks.size()] = spriteCount;
+		}
+		else
+		{
+			// The avoiders are not in the grid, skip their task
+			taskCount = getEntityTaskCount() - 1;
+			spriteCount = (uint32_t)spriteEntities.size();
+		}
+
+		pass = 0;
+		grid.beginBuild(spriteCount, taskCount);
+		return taskCount;
 	}
 
-	void addAvoidThisObjectToSystem(Entity* entity, float distance)
+	void update(uint32_t task, float deltaTime) override
 	{
+		uint32_t first = 0, count = 0;
+		if (gComponentStorage == COMPONENT_STORAGE_ARCHETYPE)
+		{
+			const uint32_t firstChunk = task * mChunksPerTask;
+			const uint32_t endChunk = min((uint32_t)mChunks.size(), firstChunk + mChunksPerTask);
+			first = chunkFirstRows[firstChunk];
+			count = chunkFirstRows[endChunk] - first;
+
+			if (!pass)
+			{
+				for (uint32_t i = firstChunk; i < endChunk; ++i)
+				{
+					const PositionComponent* pPositions = mChunks[i]->getArray<PositionComponent>();
+					for (uint32_t row = 0; row < mChunks[i]->mCount; ++row)
+						grid.setPoint(chunkFirstRows[i] + row, pPositions[row].x, pPositions[row].y, chunkFirstRows[i] + row);
+				}
+			}
+		}
+		else
 		{
-			MutexLock lock(emplaceMutex);
-			avoidDistanceList.emplace_back(distance * distance);
+			Entity** entities = NULL;
+			size_t   start = 0, end = 0;
+			getEntityTaskRange(task, &entities, &start, &end);
+			first = (uint32_t)start;
+			count = (uint32_t)(end - start);
+
+			if (!pass)
+			{
+				for (size_t i = start; i < end; ++i)
+				{
+					const PositionComponent& position = *(entities[i]->getComponent<PositionComponent>());
+					grid.setPoint((uint32_t)i, position.x, position.y, (uint32_t)i);
+				}
+			}
 		}
+
+		if (!pass)
+			grid.countPoints(task, first, count);
+		else
+			grid.scatterPoints(task, first, count);
+	}
+
+	uint32_t nextPass(float deltaTime) override
+	{
+		if (pass)
+			return 0;
+
+		grid.sortPoints();
+		pass = 1;
+		return taskCount;
 	}
 
-	static void removeAllObjects()
+	void updateChunk(ArchetypeChunk* pChunk, float deltaTime) override {}
+
+	// Chunk and row of a grid value with archetype storage
+	ArchetypeChunk* getChunk(uint32_t value, uint32_t* pRow) const
 	{
-		avoidDistanceList.set_capacity(0);
+		const uint32_t chunk = (uint32_t)(eastl::upper_bound(chunkFirstRows.begin(), chunkFirstRows.end(), value) - chunkFirstRows.begin()) - 1;
+		*pRow = value - chunkFirstRows[chunk];
+		return mChunks[chunk];
 	}
+};
+
+// Each avoider looks up the sprites around it in the sprite grid, instead of every sprite testing every avoider
+struct AvoidanceSystem: public EntitySystem
+{
+	struct AvoidTarget
+	{
+		const PositionComponent* pPosition;
+		const SpriteComponent*   pSprite;
+		float                    distanceSq;
+	};
+
+	const SpriteGridSystem*    pGridSystem;
+	eastl::vector<AvoidTarget> avoidTargets;
+
+	AvoidanceSystem(const SpriteGridSystem* pGridSystem): pGridSystem(pGridSystem) {}
 
-	static void resolveCollision(Entity* pEntity, float deltaTime)
+	void declareAccess(SystemAccess& access) override
 	{
-		PositionComponent& pos  = *(pEntity->getComponent<PositionComponent>());
-		MoveComponent&     move = *(pEntity->getComponent<MoveComponent>());
+		access.write<PositionComponent>().write<MoveComponent>().write<SpriteComponent>().read<AvoidComponent>();
+	}
 
+	static void resolveCollision(PositionComponent& pos, MoveComponent& move, float deltaTime)
+	{
 		// flip velocity
 		move.velx = -move.velx;
 		move.vely = -move.vely;
@@ -288,82 +413,77 @@ struct AvoidanceSystem
 		pos.y += move.vely * deltaTime * 1.1f;
 	}
 
-	void Update(float deltaTime)
+	uint32_t prepare(float deltaTime) override
 	{
-		const WorldBoundsComponent& bounds = *worldBoundsEntity->getComponent<WorldBoundsComponent>();
-
-		timeAndBounds data = { spriteEntities, deltaTime, &bounds };
-		
-		// 1 thread used by resource loader
-		const uint32_t numThreads = max(1u, getThreadSystemThreadCount(pThreadSystem) - 1);
-		const uint32_t entitiesPerThread = SpriteEntityCount / (numThreads + 1);
-
-		// Make sure there is enough workload for parallel processing
-		if (multiThread && entitiesPerThread < SpriteEntityCount / 2)
+		avoidTargets.clear();
+		if (gComponentStorage == COMPONENT_STORAGE_ARCHETYPE)
 		{
-			uint32_t taskCount = 0;
-
-			for (taskCount = 0; taskCount < numThreads; ++taskCount)
-			{
-				Task* task = &tasks[taskCount];
-				task->start = taskCount * entitiesPerThread;
-				task->end = min((size_t)SpriteEntityCount, task->start + entitiesPerThread);
-				task->data = &data;
-				addThreadSystemTask(pThreadSystem, &memberTaskFunc<AvoidanceSystem, &AvoidanceSystem::threadedUpdate>, this, taskCount);
-			}
-
-			// Remaining entities on main thread
-			tasks[taskCount] = { tasks[taskCount - 1].end, SpriteEntityCount, &data };
-			threadedUpdate(taskCount++);
-
-			waitThreadSystemIdle(pThreadSystem);
+			pEntityManager->forEach<PositionComponent, SpriteComponent, AvoidComponent>(
+				[this](PositionComponent& position, SpriteComponent& sprite, AvoidComponent& avoid) {
+					avoidTargets.push_back({ &position, &sprite, avoid.distanceSq });
+				});
 		}
 		else
 		{
-			tasks[0] = { 0, SpriteEntityCount, &data };
-			threadedUpdate(0);
+			for (size_t i = 0; i < AvoidCount; ++i)
+			{
+				Entity* pAvoidEntity = avoidEntities[i];
+				avoidTargets.push_back({ pAvoidEntity->getComponent<PositionComponent>(), pAvoidEntity->getComponent<SpriteComponent>(),
+										 pAvoidEntity->getComponent<AvoidComponent>()->distanceSq });
+			}
 		}
+
+		// A sprite can be close to several avoiders, the queries run in a single task so no sprite is resolved concurrently
+		return avoidTargets.empty() || !pGridSystem->grid.getPointCount() ? 0 : 1;
 	}
 
-	void threadedUpdate(uintptr_t id)
+	void update(uint32_t task, float deltaTime) override
 	{
-		const Task* task = &tasks[id];
-		const timeAndBounds& data = *task->data;
-
-		for (uintptr_t i = task->start; i < task->end; ++i)
+		for (const AvoidTarget& target : avoidTargets)
 		{
-			Entity* pEntity = spriteEntities[i];
-			PositionComponent& position = *(pEntity->getComponent<PositionComponent>());
-
-			for (size_t j = 0; j < AvoidCount; ++j)
-			{
-				Entity*					pAvoidEntity = avoidEntities[j];
-				float                    avDistance = avoidDistanceList[j];
-				PositionComponent&	  avoidPosition = *(pAvoidEntity->getComponent<PositionComponent>());
+			const PositionComponent& avoidPosition = *target.pPosition;
+			pGridSystem->grid.queryRadius(avoidPosition.x, avoidPosition.y, sqrtf(target.distanceSq), [&](const SpatialHashGridPoint& point) {
+				PositionComponent* pPosition = NULL;
+				MoveComponent*     pMove = NULL;
+				SpriteComponent*   pSprite = NULL;
+				if (gComponentStorage == COMPONENT_STORAGE_ARCHETYPE)
+				{
+					uint32_t        row = 0;
+					ArchetypeChunk* pChunk = pGridSystem->getChunk(point.mValue, &row);
+					pPosition = pChunk->getArray<PositionComponent>() + row;
+					pMove = pChunk->getArray<MoveComponent>() + row;
+					pSprite = pChunk->getArray<SpriteComponent>() + row;
+				}
+				else
+				{
+					Entity* pEntity = spriteEntities[point.mValue];
+					pPosition = pEntity->getComponent<PositionComponent>();
+					pMove = pEntity->getComponent<MoveComponent>();
+					pSprite = pEntity->getComponent<SpriteComponent>();
+				}
 
-				// is our position closer to "thing to avoid" position than the avoid distance?
-				if (DistanceSq(position, avoidPosition) < avDistance)
+				// The grid holds the positions before this system ran, a previous avoider may have moved the sprite since
+				if (DistanceSq(*pPosition, avoidPosition) < target.distanceSq)
 				{
-					resolveCollision(pEntity, data.deltaTime);
+					resolveCollision(*pPosition, *pMove, deltaTime);
 					// also make our sprite take the color of the thing we just bumped into
-					SpriteComponent& avoidSprite = *(pAvoidEntity->getComponent<SpriteComponent>());
-					SpriteComponent& mySprite = *(pEntity->getComponent<SpriteComponent>());
-					mySprite.colorR = avoidSprite.colorR;
-					mySprite.colorG = avoidSprite.colorG;
-					mySprite.colorB = avoidSprite.colorB;
+					pSprite->colorR = target.pSprite->colorR;
+					pSprite->colorG = target.pSprite->colorG;
+					pSprite->colorB = target.pSprite->colorB;
 				}
-			}
+			});
 		}
 	}
 };
 
-eastl::vector<float>    AvoidanceSystem::avoidDistanceList;
-
-static MoveSystem*      pMoveSystem;
-static AvoidanceSystem* pAvoidanceSystem;
+static MoveSystem*       pMoveSystem;
+static SpriteGridSystem* pSpriteGridSystem;
+static AvoidanceSystem*  pAvoidanceSystem;
+static SystemScheduler*  pSystemScheduler;
 
 struct CreationData
 {
+	EntityId* entityIds;
 	Entity** entities;
 	WorldBoundsComponent* bounds;
 	const char* entityTypeName;
@@ -375,9 +495,23 @@ static void createEntities(void* pData, uintptr_t i)
 	//spriteEntities[i] = pEntityManager->createEntity();
 
 	CreationData data = *(CreationData*)pData;
+	const bool   avoid = !strcmp(data.entityTypeName, "avoid");
 
 	// DESERIALIZED WAY
-	EntityId entityId = pEntityManager->createEntity();
+	EntityId entityId = 0;
+	if (gComponentStorage == COMPONENT_STORAGE_ARCHETYPE)
+	{
+		// All components are created at once in the chunks of the archetype
+		if (avoid)
+			entityId = pEntityManager->createArchetypeEntity<PositionComponent, MoveComponent, SpriteComponent, AvoidComponent>();
+		else
+			entityId = pEntityManager->createArchetypeEntity<PositionComponent, MoveComponent, SpriteComponent>();
+	}
+	else
+	{
+		entityId = pEntityManager->createEntity();
+	}
+	(data.entityIds)[i] = entityId;
 	(data.entities)[i] = pEntityManager->getEntityById(entityId);
 
 	float x = RandomFloat(data.bounds->xMin, data.bounds->xMax);
@@ -398,9 +532,7 @@ static void createEntities(void* pData, uintptr_t i)
 	if (!sprite)
 		sprite = &( pEntityManager->addComponentToEntity<SpriteComponent>(entityId) );
 
-	if (strcmp(data.entityTypeName, "avoid")) {
-		pAvoidanceSystem->addAvoidThisObjectToSystem((data.entities)[i], 1.3f);
-		
+	if (!avoid) {
 		sprite->colorR = 1.0f;
 		sprite->colorG = 1.0f;
 		sprite->colorB = 1.0f;
@@ -415,9 +547,169 @@ static void createEntities(void* pData, uintptr_t i)
 		sprite->colorB = RandomFloat(0.5f, 1.0f);
 		sprite->scale = 2.0f;
 		sprite->spriteIndex = 5;
+
+		AvoidComponent* avoidComponent = (data.entities)[i]->getComponent<AvoidComponent>();
+		if (!avoidComponent)
+			avoidComponent = &(pEntityManager->addComponentToEntity<AvoidComponent>(entityId));
+		avoidComponent->distanceSq = 1.3f * 1.3f;
+	}
+}
+
+static void createSpriteEntities(uint32_t spriteEntityCount, uint32_t componentStorage)
+{
+	if (componentStorage == COMPONENT_STORAGE_INDIVIDUAL && spriteEntityCount > IndividualStorageMaxSpriteCount)
+	{
+		LOGF(eWARNING, "%u sprites with individual components would use too much memory, creating %u", spriteEntityCount, IndividualStorageMaxSpriteCount);
+		spriteEntityCount = IndividualStorageMaxSpriteCount;
+	}
+
+	gComponentStorage = componentStorage;
+	spriteEntities.resize(spriteEntityCount);
+	spriteEntityIds.resize(spriteEntityCount);
+
+	WorldBoundsComponent* bounds = worldBoundsEntity->getComponent<WorldBoundsComponent>();
+	CreationData data	   = { spriteEntityIds.data(), spriteEntities.data(), bounds, "sprite" };
+	CreationData avoidData = { avoidEntityIds, avoidEntities, bounds, "avoid" };
+	
+	for (size_t i = 0; i < spriteEntityCount; ++i)
+	{
+		createEntities(&data, i);
+	}
+
+	for (size_t i = 0; i < AvoidCount; ++i)
+	{
+		createEntities(&avoidData, i);
 	}
 }
 
+static void destroySpriteEntities()
+{
+	// Deleting the last entities first, archetype rows are then removed without moving other rows.
+	// The deletions are recorded and applied at once, like structural changes made from worker threads
+	EntityCommandBuffer* pCommands = pEntityManager->getCommandBuffer();
+	for (size_t i = AvoidCount; i > 0; --i)
+		pCommands->deleteEntity(avoidEntityIds[i - 1]);
+
+	for (size_t i = spriteEntityIds.size(); i > 0; --i)
+		pCommands->deleteEntity(spriteEntityIds[i - 1]);
+
+	pEntityManager->applyCommandBuffers();
+
+	spriteEntities.set_capacity(0);
+	spriteEntityIds.set_capacity(0);
+}
+
+static void updateSystems(float deltaTime)
+{
+	gSystemsTimer.Reset();
+	pSystemScheduler->update(deltaTime, multiThread ? pThreadSystem : NULL);
+	gSystemsTimer.GetUSec(false);
+}
+
+// Entity pointers change when a snapshot is read, the ids stay the same
+static void refreshEntityPointers()
+{
+	worldBoundsEntity = pEntityManager->getEntityById(worldBoundsEntityId);
+
+	spriteEntities.resize(spriteEntityIds.size());
+	for (size_t i = 0; i < spriteEntityIds.size(); ++i)
+		spriteEntities[i] = pEntityManager->getEntityById(spriteEntityIds[i]);
+
+	for (size_t i = 0; i < AvoidCount; ++i)
+		avoidEntities[i] = pEntityManager->getEntityById(avoidEntityIds[i]);
+}
+
+// Times both systems with both storages for 100k to 1M sprites, and how long it takes to snapshot the world and rewind it
+static void runBenchmark()
+{
+	const uint32_t componentStorage = gComponentStorage;
+	const float    deltaTime = 3.0f / 60.0f;
+
+	// The world is rewound to this snapshot once the benchmark is done
+	eastl::vector<uint8_t>  worldSnapshot;
+	eastl::vector<EntityId> worldSpriteEntityIds = spriteEntityIds;
+	EntityId                worldAvoidEntityIds[AvoidCount];
+	memcpy(worldAvoidEntityIds, avoidEntityIds, sizeof(avoidEntityIds));
+	pEntityManager->writeSnapshot(worldSnapshot);
+
+	eastl::vector<uint8_t> snapshot;
+	gBenchmarkResults.clear();
+	for (uint32_t countIndex = 1; countIndex < sizeof(gSpriteEntityCounts) / sizeof(gSpriteEntityCounts[0]); ++countIndex)
+	{
+		for (uint32_t storage = 0; storage < sizeof(gComponentStorageValues) / sizeof(gComponentStorageValues[0]); ++storage)
+		{
+			const uint32_t count = gSpriteEntityCounts[countIndex];
+			if (storage == COMPONENT_STORAGE_INDIVIDUAL && count > IndividualStorageMaxSpriteCount)
+				continue;
+
+			destroySpriteEntities();
+			createSpriteEntities(count, storage);
+
+			HiresTimer timer;
+			pEntityManager->writeSnapshot(snapshot);
+			const int64_t snapshotUSec = timer.GetUSec(true);
+
+			int64_t moveUSec = 0;
+			int64_t gridUSec = 0;
+			int64_t avoidanceUSec = 0;
+			int64_t systemsUSec = 0;
+			for (unsigned int frame = 0; frame < BenchmarkFrameCount; ++frame)
+			{
+				timer.Reset();
+				pSystemScheduler->update(deltaTime, multiThread ? pThreadSystem : NULL);
+				systemsUSec += timer.GetUSec(true);
+				moveUSec += pSystemScheduler->getSystemUSec(pMoveSystem);
+				gridUSec += pSystemScheduler->getSystemUSec(pSpriteGridSystem);
+				avoidanceUSec += pSystemScheduler->getSystemUSec(pAvoidanceSystem);
+			}
+
+			timer.Reset();
+			pEntityManager->readSnapshot(snapshot.data(), snapshot.size());
+			refreshEntityPointers();
+			const int64_t rewindUSec = timer.GetUSec(true);
+
+			eastl::string result;
+			result.sprintf(
+				"%u sprites, %s: move %.3f ms, grid %.3f ms, avoid %.3f ms, all systems %.3f ms, snapshot %.3f ms (%.1f MB), rewind %.3f ms",
+				count, gComponentStorageNames[storage], moveUSec / (1000.0f * BenchmarkFrameCount), gridUSec / (1000.0f * BenchmarkFrameCount),
+				avoidanceUSec / (1000.0f * BenchmarkFrameCount), systemsUSec / (1000.0f * BenchmarkFrameCount), snapshotUSec / 1000.0f, snapshot.size() / (1024.0f * 1024.0f),
+				rewindUSec / 1000.0f);
+			LOGF(eINFO, "%s", result.c_str());
+			gBenchmarkResults.push_back(result);
+		}
+	}
+
+	pEntityManager->readSnapshot(worldSnapshot.data(), worldSnapshot.size());
+	gComponentStorage = componentStorage;
+	spriteEntityIds = worldSpriteEntityIds;
+	memcpy(avoidEntityIds, worldAvoidEntityIds, sizeof(avoidEntityIds));
+	refreshEntityPointers();
+}
+
+static void addSpriteData(const PositionComponent& position, const SpriteComponent& sprite)
+{
+	const float globalScale = 0.05f;
+
+	SpriteData& spriteData = gSpriteData[gDrawSpriteCount++];
+	spriteData.posX   = position.x * globalScale;
+	spriteData.posY   = position.y * globalScale;
+	spriteData.scale  = sprite.scale * globalScale;
+	spriteData.colR   = sprite.colorR;
+	spriteData.colG   = sprite.colorG;
+	spriteData.colB   = sprite.colorB;
+	spriteData.sprite = (float)sprite.spriteIndex;
+}
+
+void recreateEntities()
+{
+	gRecreateEntities = true;
+}
+
+void runBenchmarkOnUpdate()
+{
+	gRunBenchmark = true;
+}
+
 bool gTestGraphicsReset = false;
 void testGraphicsReset()
 {
@@ -440,18 +732,26 @@ class EntityComponentSystem: public IApp
 		MoveComponentRepresentation::BUILD_VAR_REPRESENTATIONS();
 		PositionComponentRepresentation::BUILD_VAR_REPRESENTATIONS();
 		WorldBoundsComponentRepresentation::BUILD_VAR_REPRESENTATIONS();
+		AvoidComponentRepresentation::BUILD_VAR_REPRESENTATIONS();
 
 		initThreadSystem(&pThreadSystem);
 
 		pEntityManager = tf_new(EntityManager);
 
 		// Create entities
-		pAvoidanceSystem = tf_new(AvoidanceSystem);
-		pAvoidanceSystem->init();
-		
 		pMoveSystem = tf_new(MoveSystem);
 
-		EntityId worldBoundsEntityId = pEntityManager->createEntity();
+		pSpriteGridSystem = tf_new(SpriteGridSystem);
+
+		pAvoidanceSystem = tf_new(AvoidanceSystem, pSpriteGridSystem);
+
+		// Moving and avoiding write the positions the grid reads, so the grid is built between the two systems
+		pSystemScheduler = tf_new(SystemScheduler, pEntityManager);
+		pSystemScheduler->addSystem(pMoveSystem);
+		pSystemScheduler->addSystem(pSpriteGridSystem);
+		pSystemScheduler->addSystem(pAvoidanceSystem);
+
+		worldBoundsEntityId = pEntityManager->createEntity();
 		worldBoundsEntity = pEntityManager->getEntityById(worldBoundsEntityId);
 		WorldBoundsComponent* bounds = &(pEntityManager->addComponentToEntity<WorldBoundsComponent>(worldBoundsEntityId));
 		bounds->xMin = -80.0f;
@@ -462,18 +762,7 @@ class EntityComponentSystem: public IApp
 		// THIS IS HOW YOU SERIALIZE AN ENTITY
 		//pSerializer->SerializeEntity(worldBoundsEntityId, "serializedWorldBounds", "../../../src/17_EntityComponentSystem/Entities/");
 
-		CreationData data	   = { spriteEntities, bounds, "sprite" };
-		CreationData avoidData = { avoidEntities,  bounds, "avoid" };
-		
-		for (size_t i = 0; i < SpriteEntityCount; ++i)
-		{
-			createEntities(&data, i);
-		}
-
-		for (size_t i = 0; i < AvoidCount; ++i)
-		{
-			createEntities(&avoidData, i);
-		}
+		createSpriteEntities(gSpriteEntityCount, gComponentStorage);
 
 		if (!initInputSystem(pWindow))
 			return false;
@@ -501,17 +790,22 @@ class EntityComponentSystem: public IApp
 	{
 		exitInputSystem();
 		shutdownThreadSystem(pThreadSystem);
-		pAvoidanceSystem->exit();
+		tf_delete(pSystemScheduler);
 		tf_delete(pAvoidanceSystem);
+		tf_delete(pSpriteGridSystem);
 		tf_delete(pMoveSystem);
 		tf_delete(pEntityManager);
 		gSpriteData = NULL;
 
-		AvoidanceSystem::removeAllObjects();
+		spriteEntities.set_capacity(0);
+		spriteEntityIds.set_capacity(0);
+		gBenchmarkResults.set_capacity(0);
+		gDrawChunks.set_capacity(0);
 		SpriteComponentRepresentation::DESTROY_VAR_REPRESENTATIONS();
 		MoveComponentRepresentation::DESTROY_VAR_REPRESENTATIONS();
 		PositionComponentRepresentation::DESTROY_VAR_REPRESENTATIONS();
 		WorldBoundsComponentRepresentation::DESTROY_VAR_REPRESENTATIONS();
+		AvoidComponentRepresentation::DESTROY_VAR_REPRESENTATIONS();
 	}
 
 	bool Load()
@@ -631,6 +925,23 @@ class EntityComponentSystem: public IApp
 
 			CheckboxWidget Checkbox("Threading", &multiThread);
 			GUIWindow->AddWidget(Checkbox);
+
+			DropdownWidget spriteCountDropdown(
+				"Sprite Count", &gSpriteEntityCount, gSpriteEntityCountNames, gSpriteEntityCounts,
+				sizeof(gSpriteEntityCounts) / sizeof(gSpriteEntityCounts[0]));
+			spriteCountDropdown.pOnEdited = recreateEntities;
+			GUIWindow->AddWidget(spriteCountDropdown);
+
+			DropdownWidget storageDropdown(
+				"Component Storage", &gComponentStorage, gComponentStorageNames, gComponentStorageValues,
+				sizeof(gComponentStorageValues) / sizeof(gComponentStorageValues[0]));
+			storageDropdown.pOnEdited = recreateEntities;
+			GUIWindow->AddWidget(storageDropdown);
+
+			ButtonWidget runBenchmarkButton("Run Benchmark (100k - 1M sprites)");
+			runBenchmarkButton.pOnEdited = runBenchmarkOnUpdate;
+			GUIWindow->AddWidget(runBenchmarkButton);
+
 			// Reset graphics with a button.
 			ButtonWidget testGPUReset("ResetGraphicsDevice");
 			testGPUReset.pOnEdited = testGraphicsReset;
@@ -751,42 +1062,49 @@ class EntityComponentSystem: public IApp
 		static float currentTime = 0.0f;
 		currentTime += deltaTime * 1000.0f;
 
+		if (gRecreateEntities)
+		{
+			gRecreateEntities = false;
+			destroySpriteEntities();
+			createSpriteEntities(gSpriteEntityCount, gComponentStorage);
+		}
+
+		if (gRunBenchmark)
+		{
+			gRunBenchmark = false;
+			runBenchmark();
+		}
+
 		// update object systems
-		pMoveSystem->Update(deltaTime * 3.0f);
-		pAvoidanceSystem->Update(deltaTime * 3.0f);
+		updateSystems(deltaTime * 3.0f);
 
 		// Iterate all entities with transform and plane component
 		gDrawSpriteCount = 0;
-		float globalScale = 0.05f;
 
-		for (size_t i = 0; i < SpriteEntityCount; ++i) {
-			Entity* pEntity				= spriteEntities[i];
-			PositionComponent& position = *(pEntity->getComponent<PositionComponent>());
-			SpriteComponent&     sprite = *(pEntity->getComponent<SpriteComponent>());
-			
-			SpriteData& spriteData = gSpriteData[gDrawSpriteCount++];
-			spriteData.posX   = position.x * globalScale;
-			spriteData.posY   = position.y * globalScale;
-			spriteData.scale  = sprite.scale * globalScale;
-			spriteData.colR   = sprite.colorR;
-			spriteData.colG   = sprite.colorG;
-			spriteData.colB   = sprite.colorB;
-			spriteData.sprite = (float)sprite.spriteIndex;
+		if (gComponentStorage == COMPONENT_STORAGE_ARCHETYPE)
+		{
+			const uint32_t avoidType = AvoidComponent::getTypeStatic();
+			gDrawChunks.clear();
+			pEntityManager->getChunks<PositionComponent, SpriteComponent>(gDrawChunks, &avoidType, 1);
+			for (size_t c = 0; c < gDrawChunks.size() && gDrawSpriteCount < MaxDrawnSpriteEntityCount; ++c)
+			{
+				const PositionComponent* pPositions = gDrawChunks[c]->getArray<PositionComponent>();
+				const SpriteComponent*   pSprites = gDrawChunks[c]->getArray<SpriteComponent>();
+				for (uint32_t i = 0; i < gDrawChunks[c]->mCount && gDrawSpriteCount < MaxDrawnSpriteEntityCount; ++i)
+					addSpriteData(pPositions[i], pSprites[i]);
+			}
+
+			pEntityManager->forEach<PositionComponent, SpriteComponent, AvoidComponent>(
+				[](PositionComponent& position, SpriteComponent& sprite, AvoidComponent&) { addSpriteData(position, sprite); });
 		}
+		else
+		{
+			const size_t drawnSpriteEntityCount = min(spriteEntities.size(), (size_t)MaxDrawnSpriteEntityCount);
+			for (size_t i = 0; i < drawnSpriteEntityCount; ++i)
+				addSpriteData(*(spriteEntities[i]->getComponent<PositionComponent>()), *(spriteEntities[i]->getComponent<SpriteComponent>()));
 
-		for (size_t i = 0; i < AvoidCount; ++i) {
-			Entity* pEntity				= avoidEntities[i];
-			PositionComponent& position = *(pEntity->getComponent<PositionComponent>());
-			SpriteComponent&     sprite = *(pEntity->getComponent<SpriteComponent>());
-
-			SpriteData& spriteData = gSpriteData[gDrawSpriteCount++];
-			spriteData.posX   = position.x * globalScale;
-			spriteData.posY   = position.y * globalScale;
-			spriteData.scale  = sprite.scale * globalScale;
-			spriteData.colR   = sprite.colorR;
-			spriteData.colG   = sprite.colorG;
-			spriteData.colB   = sprite.colorB;
-			spriteData.sprite = (float)sprite.spriteIndex;
+			for (size_t i = 0; i < AvoidCount; ++i)
+				addSpriteData(*(avoidEntities[i]->getComponent<PositionComponent>()), *(avoidEntities[i]->getComponent<SpriteComponent>()));
 		}
 
 		gAppUI.Update(deltaTime);
@@ -865,11 +1183,24 @@ class EntityComponentSystem: public IApp
 		uiTextDesc.mFontColor = 0xff00cc00;
 		uiTextDesc.mFontSize = 18;
 		 
-#if !defined(__ANDROID__)
 		float2 txtSize = cmdDrawCpuProfile(cmd, float2(8.0f, 15.0f), &gFrameTimeDraw);
-        cmdDrawGpuProfile(cmd, float2(8.0f, txtSize.y + 30.f), gGpuProfileToken, &uiTextDesc);
-#else
-		cmdDrawCpuProfile(cmd, float2(8.0f, 15.0f), &gFrameTimeDraw);
+
+		eastl::string systemsText;
+		systemsText.sprintf(
+			"%u sprites, %s: move %.3f ms, grid %.3f ms, avoid %.3f ms, all systems %.3f ms", (uint32_t)spriteEntities.size(),
+			gComponentStorageNames[gComponentStorage], pSystemScheduler->getSystemUSec(pMoveSystem) / 1000.0f,
+			pSystemScheduler->getSystemUSec(pSpriteGridSystem) / 1000.0f, pSystemScheduler->getSystemUSec(pAvoidanceSystem) / 1000.0f,
+			gSystemsTimer.GetUSecAverage() / 1000.0f);
+		float2 benchmarkTextPos = float2(8.0f, txtSize.y + 30.f);
+		gAppUI.DrawText(cmd, benchmarkTextPos, systemsText.c_str(), &gFrameTimeDraw);
+		for (const eastl::string& result : gBenchmarkResults)
+		{
+			benchmarkTextPos.y += gAppUI.MeasureText(result.c_str(), gFrameTimeDraw).y + 5.f;
+			gAppUI.DrawText(cmd, benchmarkTextPos, result.c_str(), &gFrameTimeDraw);
+		}
+
+#if !defined(__ANDROID__)
+        cmdDrawGpuProfile(cmd, float2(8.0f, benchmarkTextPos.y + txtSize.y + 15.f), gGpuProfileToken, &uiTextDesc);
 #endif
 		cmdDrawProfilerUI();
 
@@ -48,6 +48,7 @@
 // Middleware packages
 #include "../../../../Middleware_3/Animation/SkeletonBatcher.h"
 #include "../../../../Middleware_3/Animation/AnimatedObject.h"
+#include "../../../../Middleware_3/Animation/AnimationSystem.h"
 #include "../../../../Middleware_3/Animation/Animation.h"
 #include "../../../../Middleware_3/Animation/Clip.h"
 #include "../../../../Middleware_3/Animation/ClipController.h"
@@ -144,6 +145,23 @@ Rig gStickFigureRigs[kMaxNumRigs];
 // SkeletonBatcher
 SkeletonBatcher gSkeletonBatcher;
 
+// Updates all the rigs in batched stage jobs, replaces the per AnimatedObject tasks when enabled
+AnimationSystem gAnimationSystem;
+bool            gUseAnimationSystem = true;
+
+// Update rate LOD, far rigs are sampled every 2nd, 4th or 8th frame and interpolated in between
+AnimationLODDesc gAnimationLODDesc;
+bool             gEnableAnimationLOD = false;
+bool             gMeasureAnimationLODError = false;
+unsigned int     gNumSampledRigs = 0;
+float            gMaxAnimationLODError = 0.0f;
+
+// Sampling caches of the Animations are leased from a pool, all rigs walk in lockstep so they can also share one sampled pose
+SamplingCachePool gSamplingCachePool;
+bool              gShareLockstepSampling = false;
+bool              gReinitAnimations = false;
+eastl::string     gSamplingMemoryText;
+
 // Filenames
 const char* gStickFigureName = "stickFigure/skeleton.ozz";
 const char* gWalkClipName = "stickFigure/animations/walk.ozz";
@@ -158,6 +176,12 @@ const float gJointRadius = gBoneWidthRatio * 0.5f;    // set to replicate Ozz sk
 // Timer to get animationsystem update time
 static HiresTimer gAnimationUpdateTimer;
 
+// Character counts of the AnimationSystem benchmark, rigs above kMaxNumRigs are updated but not drawn
+const unsigned int   kBenchmarkCharacterCounts[] = { 1000, 5000, 10000 };
+const unsigned int   kBenchmarkFrameCount = 64;
+bool                 gRunBenchmark = false;
+eastl::vector<eastl::string> gBenchmarkResults;
+
 //--------------------------------------------------------------------------------------------
 // MULTI THREADING DATA
 //--------------------------------------------------------------------------------------------
@@ -206,6 +230,10 @@ struct UIData
 	struct SampleControlData
 	{
 		unsigned int* mNumberOfRigs = &gNumRigs;
+		bool*         mUseAnimationSystem = &gUseAnimationSystem;
+		bool*         mEnableAnimationLOD = &gEnableAnimationLOD;
+		bool*         mMeasureAnimationLODError = &gMeasureAnimationLODError;
+		bool*         mShareLockstepSampling = &gShareLockstepSampling;
 	};
 	SampleControlData mSampleControl;
 
@@ -231,6 +259,25 @@ void testGraphicsReset()
 	gTestGraphicsReset = !gTestGraphicsReset;
 }
 
+void RunAnimationBenchmark()
+{
+	gRunBenchmark = true;
+}
+
+void ReinitAnimations()
+{
+	gReinitAnimations = true;
+}
+
+// Calculate the offset of each rig, rigs are placed on a grid and grids are stacked on top of each other
+mat4 GetRigRootTransform(unsigned int i)
+{
+	const unsigned int gridWidth = 25;
+	const unsigned int gridDepth = 10;
+	vec3 offset = vec3(-8.75f + 0.75f * (i % gridWidth), ((i / gridWidth) / gridDepth) * 2.0f, 8.0f - 2 * ((i / gridWidth) % gridDepth));
+	return mat4::translation(offset);
+}
+
 //--------------------------------------------------------------------------------------------
 // APP CODE
 //--------------------------------------------------------------------------------------------
@@ -294,28 +341,15 @@ class MultiThread: public IApp
 
 		// ANIMATIONS
 		//
-		for (unsigned int i = 0; i < kMaxNumRigs; i++)
-		{
-			AnimationDesc animationDesc{};
-			animationDesc.mRig = &gStickFigureRigs[i];
-			animationDesc.mNumLayers = 1;
-			animationDesc.mLayerProperties[0].mClip = &gWalkClip;
-			animationDesc.mLayerProperties[0].mClipController = &gWalkClipControllers[i];
-
-			gWalkAnimations[i].Initialize(animationDesc);
-		}
+		gSamplingCachePool.Initialize();
+		InitWalkAnimations();
 
 		// ANIMATED OBJECTS
 		//
-		const unsigned int gridWidth = 25;
-		const unsigned int gridDepth = 10;
 		for (unsigned int i = 0; i < kMaxNumRigs; i++)
 		{
 			gStickFigureAnimObjects[i].Initialize(&gStickFigureRigs[i], &gWalkAnimations[i]);
-
-			// Calculate and set offset for each rig
-			vec3 offset = vec3(-8.75f + 0.75f * (i % gridWidth), ((i / gridWidth) / gridDepth) * 2.0f, 8.0f - 2 * ((i / gridWidth) % gridDepth));
-			gStickFigureAnimObjects[i].SetRootTransform(mat4::translation(offset));
+			gStickFigureAnimObjects[i].SetRootTransform(GetRigRootTransform(i));
 		}
 
 		/************************************************************************/
@@ -332,6 +366,30 @@ class MultiThread: public IApp
 		//
 		initThreadSystem(&pThreadSystem);
 
+		// ANIMATION SYSTEM
+		//
+		// Same rigs, clip and offsets as the animated objects, the system owns its own clip controllers
+		AnimationSystemDesc animationSystemDesc = {};
+		animationSystemDesc.mThreadSystem = pThreadSystem;
+		animationSystemDesc.mMaxInstances = kMaxNumRigs;
+		animationSystemDesc.mMaxLayers = 1;
+		animationSystemDesc.mMaxJoints = gStickFigureRigs[0].GetNumJoints();
+		animationSystemDesc.mBatchSize = gGrainSize;
+		animationSystemDesc.mEnableLOD = true;
+		if (!gAnimationSystem.Initialize(animationSystemDesc))
+			return false;
+
+		for (unsigned int i = 0; i < kMaxNumRigs; i++)
+		{
+			AnimationInstanceDesc instanceDesc = {};
+			instanceDesc.mRig = &gStickFigureRigs[i];
+			instanceDesc.mNumLayers = 1;
+			instanceDesc.mLayerProperties[0].mClip = &gWalkClip;
+			instanceDesc.mRootTransform = GetRigRootTransform(i);
+			instanceDesc.mPoseRig = true;
+			gAnimationSystem.AddInstance(instanceDesc);
+		}
+
 		if (!initInputSystem(pWindow))
 			return false;
 
@@ -375,6 +433,8 @@ class MultiThread: public IApp
 		exitInputSystem();
 		shutdownThreadSystem(pThreadSystem);
 
+		gAnimationSystem.Destroy();
+
 		// Rigs
 		for (unsigned int i = 0; i < kMaxNumRigs; i++)
 		{
@@ -389,6 +449,7 @@ class MultiThread: public IApp
 		{
 			gWalkAnimations[i].Destroy();
 		}
+		gSamplingCachePool.Destroy();
 
 		// AnimatedObjects
 		for (unsigned int i = 0; i < kMaxNumRigs; i++)
@@ -590,6 +651,31 @@ class MultiThread: public IApp
 					SliderUintWidget("Number of Rigs", gUIData.mSampleControl.mNumberOfRigs, uintValMin, uintValMax, sliderStepSizeUint));
 				CollapsingSampleControlWidgets.AddSubWidget(SeparatorWidget());
 
+				// UseAnimationSystem - Checkbox
+				CollapsingSampleControlWidgets.AddSubWidget(CheckboxWidget("Use AnimationSystem", gUIData.mSampleControl.mUseAnimationSystem));
+
+				// AnimationLOD - Checkboxes and distance sliders
+				CollapsingSampleControlWidgets.AddSubWidget(CheckboxWidget("Update Rate LOD", gUIData.mSampleControl.mEnableAnimationLOD));
+				CollapsingSampleControlWidgets.AddSubWidget(
+					CheckboxWidget("Measure LOD Pose Error", gUIData.mSampleControl.mMeasureAnimationLODError));
+				CollapsingSampleControlWidgets.AddSubWidget(
+					SliderFloatWidget("Half Rate Distance", &gAnimationLODDesc.mDistances[0], 0.0f, 100.0f, 1.0f));
+				CollapsingSampleControlWidgets.AddSubWidget(
+					SliderFloatWidget("Quarter Rate Distance", &gAnimationLODDesc.mDistances[1], 0.0f, 100.0f, 1.0f));
+				CollapsingSampleControlWidgets.AddSubWidget(
+					SliderFloatWidget("Eighth Rate Distance", &gAnimationLODDesc.mDistances[2], 0.0f, 100.0f, 1.0f));
+
+				// SamplingCachePool - Checkbox, rebuilds the Animations with or without a shared lockstep pose
+				CheckboxWidget shareLockstepSampling("Share Lockstep Sampling", gUIData.mSampleControl.mShareLockstepSampling);
+				shareLockstepSampling.pOnEdited = ReinitAnimations;
+				CollapsingSampleControlWidgets.AddSubWidget(shareLockstepSampling);
+
+				// Benchmark - Button
+				ButtonWidget runBenchmark("Run AnimationSystem Benchmark (1k/5k/10k)");
+				runBenchmark.pOnEdited = RunAnimationBenchmark;
+				CollapsingSampleControlWidgets.AddSubWidget(runBenchmark);
+				CollapsingSampleControlWidgets.AddSubWidget(SeparatorWidget());
+
 				// GENERAL SETTINGS
 				//
 				CollapsingHeaderWidget CollapsingGeneralSettingsWidgets("General Settings");
@@ -800,12 +886,58 @@ class MultiThread: public IApp
 		/************************************************************************/
 		// Animation
 		/************************************************************************/
+		if (gReinitAnimations)
+		{
+			gReinitAnimations = false;
+			for (unsigned int i = 0; i < kMaxNumRigs; i++)
+				gWalkAnimations[i].Destroy();
+			InitWalkAnimations();
+		}
+
 		gAnimationUpdateTimer.Reset();
 
 		// Update the animated objects amd pose the rigs based on the animated object's updated values for this frame
 		gSkeletonBatcher.SetActiveRigs(gNumRigs);
+		// Update rate LOD of the animated objects, the AnimationSystem picks it in its sample stage.
+		// Rigs sharing a lockstep pose must all advance at the same rate
+		if (!gUseAnimationSystem)
+		{
+			const Point3 viewPosition(pCameraController->getViewPosition());
+			for (unsigned int i = 0; i < gNumRigs; ++i)
+			{
+				if (gEnableAnimationLOD && !gShareLockstepSampling)
+					gStickFigureAnimObjects[i].SetLODViewPosition(gAnimationLODDesc, viewPosition);
+				else
+					gStickFigureAnimObjects[i].GetLOD()->SetInterval(1);
+				gStickFigureAnimObjects[i].SetMeasureLODError(gMeasureAnimationLODError && !gShareLockstepSampling);
+			}
+		}
+
+		// Batched stage jobs, the system waits for its own jobs
+		if (gUseAnimationSystem)
+		{
+			if (gAutomateThreading)
+			{
+				uint32_t threadCount = getThreadSystemThreadCount(pThreadSystem);
+				gGrainSize = max(1U, gNumRigs / threadCount);
+			}
+
+			gAnimationSystem.SetThreadSystem(gEnableThreading ? pThreadSystem : NULL);
+			gAnimationSystem.SetBatchSize(gGrainSize);
+			gAnimationSystem.SetActiveInstances(gNumRigs);
+			gAnimationSystem.SetLOD(gEnableAnimationLOD ? &gAnimationLODDesc : NULL, Point3(pCameraController->getViewPosition()));
+			gAnimationSystem.SetMeasureLODError(gMeasureAnimationLODError);
+			if (!gAnimationSystem.Update(deltaTime))
+				LOGF(eERROR, "Animation NOT Updating!");
+
+			// Record animation update time
+			gAnimationUpdateTimer.GetUSec(true);
+
+			gNumSampledRigs = gAnimationSystem.GetStats().mNumSampledInstances;
+			gMaxAnimationLODError = gAnimationSystem.GetStats().mMaxLODPoseError;
+		}
 		// Threading
-		if (gEnableThreading)
+		else if (gEnableThreading)
 		{
 			if (gAutomateThreading)
 			{
@@ -860,7 +992,7 @@ class MultiThread: public IApp
 		gUniformDataPlane.mProjectView = projViewMat;
 		gUniformDataPlane.mToWorldMat = mat4::identity();
 
-		if (gEnableThreading)
+		if (gEnableThreading && !gUseAnimationSystem)
 		{
 			// Ensure all jobs are finished before proceeding
 			while (assistThreadSystem(pThreadSystem)) {};
@@ -869,6 +1001,23 @@ class MultiThread: public IApp
 			// Record animation update time
 			gAnimationUpdateTimer.GetUSec(true);
 		}
+
+		if (!gUseAnimationSystem)
+		{
+			gNumSampledRigs = 0;
+			gMaxAnimationLODError = 0.0f;
+			for (unsigned int i = 0; i < gNumRigs; ++i)
+			{
+				gNumSampledRigs += gStickFigureAnimObjects[i].WasSampled() ? 1 : 0;
+				gMaxAnimationLODError = max(gMaxAnimationLODError, gStickFigureAnimObjects[i].GetLODPoseError());
+			}
+		}
+
+		if (gRunBenchmark)
+		{
+			gRunBenchmark = false;
+			RunBenchmark();
+		}
 	}
 
 	void Draw()
@@ -988,8 +1137,26 @@ class MultiThread: public IApp
 			cmd, float2(8.f, txtSize.y + 30.f), eastl::string().sprintf("Animation Update %f ms", gAnimationUpdateTimer.GetUSecAverage() / 1000.0f).c_str(),
 			&gFrameTimeDraw);
 
+		float2 benchmarkTextPos = float2(8.f, txtSize.y * 2.f + 45.f);
+		gAppUI.DrawText(cmd, benchmarkTextPos, gSamplingMemoryText.c_str(), &gFrameTimeDraw);
+		benchmarkTextPos.y += gAppUI.MeasureText(gSamplingMemoryText.c_str(), gFrameTimeDraw).y + 5.f;
+		if (gEnableAnimationLOD)
+		{
+			eastl::string lodText;
+			lodText.sprintf("Sampled %u of %u rigs", gNumSampledRigs, gNumRigs);
+			if (gMeasureAnimationLODError)
+				lodText.append_sprintf(", max LOD pose error %.2f cm", gMaxAnimationLODError * 100.0f);
+			gAppUI.DrawText(cmd, benchmarkTextPos, lodText.c_str(), &gFrameTimeDraw);
+			benchmarkTextPos.y += gAppUI.MeasureText(lodText.c_str(), gFrameTimeDraw).y + 5.f;
+		}
+		for (const eastl::string& result : gBenchmarkResults)
+		{
+			benchmarkTextPos.y += gAppUI.MeasureText(result.c_str(), gFrameTimeDraw).y + 5.f;
+			gAppUI.DrawText(cmd, benchmarkTextPos, result.c_str(), &gFrameTimeDraw);
+		}
+
 #if !defined(__ANDROID__)
-        cmdDrawGpuProfile(cmd, float2(8.f, txtSize.y * 2.f + 45.f), gGpuProfileToken, &gFrameTimeDraw);
+        cmdDrawGpuProfile(cmd, float2(8.f, benchmarkTextPos.y + txtSize.y + 15.f), gGpuProfileToken, &gFrameTimeDraw);
 #endif
 
 		cmdDrawProfilerUI();
@@ -1079,6 +1246,162 @@ class MultiThread: public IApp
 		return pDepthBuffer != NULL;
 	}
 
+	// Initializes the Animation of every rig with caches leased from gSamplingCachePool and reports the memory they use
+	static void InitWalkAnimations()
+	{
+		for (unsigned int i = 0; i < kMaxNumRigs; i++)
+		{
+			AnimationDesc animationDesc{};
+			animationDesc.mRig = &gStickFigureRigs[i];
+			animationDesc.mNumLayers = 1;
+			animationDesc.mLayerProperties[0].mClip = &gWalkClip;
+			animationDesc.mLayerProperties[0].mClipController = &gWalkClipControllers[i];
+			animationDesc.mLayerProperties[0].mLockstepGroup = gShareLockstepSampling ? 1 : 0;
+			animationDesc.mSamplingCachePool = &gSamplingCachePool;
+
+			gWalkAnimations[i].Initialize(animationDesc);
+		}
+
+		// Released leases stay in the pool for reuse, only the ones in use are counted per rig
+		const SamplingCachePoolStats stats = gSamplingCachePool.GetStats();
+		const float                  pooledSize = (float)stats.mUsedBytes / kMaxNumRigs;
+		const float unpooledSize = (float)SamplingCachePool::GetUnpooledSize(gStickFigureRigs[0].GetNumJoints());
+		gSamplingMemoryText.sprintf(
+			"Sampling memory per rig: %.2f KB pooled in %u caches, %.2f KB with one cache per rig", pooledSize / 1024.0f,
+			stats.mNumUsedCaches, unpooledSize / 1024.0f);
+		LOGF(eINFO, "%s", gSamplingMemoryText.c_str());
+	}
+
+	// Times the per AnimatedObject update against the AnimationSystem for each benchmark character count.
+	// All characters share the first rig, which is only written by the serial AnimatedObject run.
+	static void RunBenchmark()
+	{
+		waitThreadSystemIdle(pThreadSystem);
+		gBenchmarkResults.clear();
+
+		Rig*        rig = &gStickFigureRigs[0];
+		const float dt = 1.0f / 60.0f;
+
+		for (unsigned int countIndex = 0; countIndex < sizeof(kBenchmarkCharacterCounts) / sizeof(kBenchmarkCharacterCounts[0]); ++countIndex)
+		{
+			const unsigned int characterCount = kBenchmarkCharacterCounts[countIndex];
+
+			// AnimatedObject path, one Animation and ClipController per character as in the sample update
+			eastl::vector<ClipController> clipControllers(characterCount);
+			eastl::vector<Animation>      animations(characterCount);
+			eastl::vector<AnimatedObject> animatedObjects(characterCount);
+			for (unsigned int i = 0; i < characterCount; ++i)
+			{
+				clipControllers[i].Initialize(gWalkClip.GetDuration());
+				clipControllers[i].SetTimeRatio(fmodf(i * 0.618f, 1.0f));
+
+				AnimationDesc animationDesc{};
+				animationDesc.mRig = rig;
+				animationDesc.mNumLayers = 1;
+				animationDesc.mLayerProperties[0].mClip = &gWalkClip;
+				animationDesc.mLayerProperties[0].mClipController = &clipControllers[i];
+				animations[i].Initialize(animationDesc);
+
+				animatedObjects[i].Initialize(rig, &animations[i]);
+			}
+
+			HiresTimer timer;
+			for (unsigned int frame = 0; frame < kBenchmarkFrameCount; ++frame)
+			{
+				for (unsigned int i = 0; i < characterCount; ++i)
+				{
+					animatedObjects[i].Update(dt);
+					animatedObjects[i].PoseRig();
+				}
+			}
+			const float animatedObjectMs = timer.GetUSec(false) / (1000.0f * kBenchmarkFrameCount);
+
+			for (unsigned int i = 0; i < characterCount; ++i)
+			{
+				animatedObjects[i].Destroy();
+				animations[i].Destroy();
+			}
+
+			// AnimationSystem, on the calling thread and then on the thread system
+			AnimationSystem     animationSystem;
+			AnimationSystemDesc animationSystemDesc = {};
+			animationSystemDesc.mMaxInstances = characterCount;
+			animationSystemDesc.mMaxLayers = 1;
+			animationSystemDesc.mMaxJoints = rig->GetNumJoints();
+			animationSystemDesc.mBatchSize = 64;
+			animationSystemDesc.mEnableLOD = true;
+			animationSystem.Initialize(animationSystemDesc);
+
+			for (unsigned int i = 0; i < characterCount; ++i)
+			{
+				AnimationInstanceDesc instanceDesc = {};
+				instanceDesc.mRig = rig;
+				instanceDesc.mNumLayers = 1;
+				instanceDesc.mLayerProperties[0].mClip = &gWalkClip;
+				instanceDesc.mLayerProperties[0].mTimeRatio = fmodf(i * 0.618f, 1.0f);
+				instanceDesc.mRootTransform = GetRigRootTransform(i);
+				animationSystem.AddInstance(instanceDesc);
+			}
+
+			float systemMs[2] = {};
+			float stageMs[ANIMATION_STAGE_COUNT] = {};
+			for (unsigned int run = 0; run < 2; ++run)
+			{
+				animationSystem.SetThreadSystem(run ? pThreadSystem : NULL);
+				for (unsigned int frame = 0; frame < kBenchmarkFrameCount; ++frame)
+				{
+					animationSystem.Update(dt);
+					systemMs[run] += animationSystem.GetStats().mTotalTimeMs / kBenchmarkFrameCount;
+					for (unsigned int stage = 0; run && stage < ANIMATION_STAGE_COUNT; ++stage)
+						stageMs[stage] += animationSystem.GetStats().mStageTimeMs[stage] / kBenchmarkFrameCount;
+				}
+			}
+
+			// Update rate LOD from the current camera, timed first and then run again to measure the pose error
+			float        lodMs = 0.0f;
+			float        lodSampledRatio = 0.0f;
+			float        lodPoseError = 0.0f;
+			const Point3 viewPosition(pCameraController->getViewPosition());
+			animationSystem.SetLOD(&gAnimationLODDesc, viewPosition);
+			for (unsigned int run = 0; run < 2; ++run)
+			{
+				animationSystem.SetMeasureLODError(run == 1);
+				for (unsigned int frame = 0; frame < kBenchmarkFrameCount; ++frame)
+				{
+					animationSystem.Update(dt);
+					const AnimationSystemStats& stats = animationSystem.GetStats();
+					if (run == 0)
+					{
+						lodMs += stats.mTotalTimeMs / kBenchmarkFrameCount;
+						lodSampledRatio += (float)stats.mNumSampledInstances / (characterCount * kBenchmarkFrameCount);
+					}
+					else
+					{
+						lodPoseError = max(lodPoseError, stats.mMaxLODPoseError);
+					}
+				}
+			}
+
+			animationSystem.Destroy();
+
+			eastl::string result;
+			result.sprintf(
+				"%u characters: AnimatedObject %.2f ms, AnimationSystem %.2f ms (1 thread), %.2f ms (%u workers: sample %.2f, blend %.2f, "
+				"ltm %.2f, skinning %.2f)",
+				characterCount, animatedObjectMs, systemMs[0], systemMs[1], getThreadSystemThreadCount(pThreadSystem),
+				stageMs[ANIMATION_STAGE_SAMPLE], stageMs[ANIMATION_STAGE_BLEND], stageMs[ANIMATION_STAGE_LOCAL_TO_MODEL],
+				stageMs[ANIMATION_STAGE_SKINNING]);
+			LOGF(eINFO, "%s", result.c_str());
+			gBenchmarkResults.push_back(result);
+
+			result.sprintf(
+				"    with update rate LOD: %.2f ms (%.0f%% saved), %.0f%% of characters sampled per frame, max pose error %.2f cm", lodMs,
+				systemMs[1] > 0.0f ? 100.0f * (1.0f - lodMs / systemMs[1]) : 0.0f, 100.0f * lodSampledRatio, lodPoseError * 100.0f);
+			LOGF(eINFO, "%s", result.c_str());
+			gBenchmarkResults.push_back(result);
+		}
+	}
+
 	static void SkeletonBatchUniformsThreaded(void* pData, uintptr_t i)
 	{
 		ThreadSkeletonData* data = ((ThreadSkeletonData*)pData) + i;
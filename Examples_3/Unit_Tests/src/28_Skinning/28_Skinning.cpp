@@ -115,15 +115,9 @@ struct Vertex
 	uint4  mBoneIndices;
 };
 
-struct UniformDataBones
-{
-	mat4 mBoneMatrix[MAX_NUM_BONES];
-};
-
 VertexLayout     gVertexLayoutSkinned = {};
 Geometry*        pGeom = NULL;
 Buffer*          pUniformBufferBones[gImageCount] = { NULL };
-UniformDataBones gUniformDataBones;
 Texture*         pTextureDiffuse = NULL;
 
 struct UniformBlockPlane
@@ -880,13 +874,6 @@ class Skinning: public IApp
 		// Update uniforms that will be shared between all skeletons
 		gSkeletonBatcher.SetSharedUniforms(projViewMat, lightPos, lightColor);
 
-		for (uint i = 0; i < pGeom->mJointCount; ++i)
-		{
-			gUniformDataBones.mBoneMatrix[i] = //mat4::scale(vec3(1, 1, -1)) *
-				gStickFigureRig.GetJointWorldMat(pGeom->pJointRemaps[i]) * 
-				pGeom->pInverseBindPoses[i];
-
-		}
 		/************************************************************************/
 		// Plane
 		/************************************************************************/
@@ -926,10 +913,11 @@ class Skinning: public IApp
 		*(UniformBlockPlane*)planeViewProjCbv.pMappedData = gUniformDataPlane;
 		endUpdateResource(&planeViewProjCbv, NULL);
 
-		BufferUpdateDesc boneBufferUpdateDesc = { pUniformBufferBones[gFrameIndex] };
-		beginUpdateResource(&boneBufferUpdateDesc);
-		memcpy(boneBufferUpdateDesc.pMappedData, &gUniformDataBones, sizeof(mat4) * gStickFigureRig.GetNumJoints());
-		endUpdateResource(&boneBufferUpdateDesc, NULL);
+		// The bone buffer is persistently mapped and no longer used by the GPU once the fence was waited on,
+		// so the skinning palette is computed straight into it
+		const uint32_t numBones = min(pGeom->mJointCount, gStickFigureRig.GetNumJoints());
+		gStickFigureRig.WriteSkinningMats(
+			pGeom->pInverseBindPoses, pGeom->pJointRemaps, numBones, (mat4*)pUniformBufferBones[gFrameIndex]->pCpuMappedAddress);
 
 		// Acquire the main render target from the swapchain
 		RenderTarget* pRenderTarget = pSwapChain->ppRenderTargets[swapchainImageIndex];
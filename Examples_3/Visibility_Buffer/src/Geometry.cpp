@@ -975,11 +975,53 @@ void removeScene(Scene* scene)
 	tf_free(scene);
 }
 
+// Converts the clusters built offline by the AssetPipeline (-pcl) to the culling layout.
+// Returns false if the geometry has no offline clusters for this draw.
+static bool loadOfflineClusters(bool twoSided, const Geometry* pGeom, uint32_t drawIndex, ClusterContainer* mesh)
+{
+	if (!pGeom->pClusters)
+		return false;
+
+	const uint32_t clusterStart = pGeom->pClusterOffsets[drawIndex];
+	const uint32_t clusterCount = pGeom->pClusterOffsets[drawIndex + 1] - clusterStart;
+	if (!clusterCount)
+		return false;
+
+	mesh->clusterCount = clusterCount;
+	mesh->clusterCompacts = (ClusterCompact*)tf_calloc(mesh->clusterCount, sizeof(ClusterCompact));
+	mesh->clusters = (Cluster*)tf_calloc(mesh->clusterCount, sizeof(Cluster));
+
+	for (uint32_t i = 0; i < clusterCount; ++i)
+	{
+		const Geometry::Cluster* src = pGeom->pClusters + clusterStart + i;
+
+		mesh->clusters[i].aabbMin = float3(src->mAabbMin[0], src->mAabbMin[1], src->mAabbMin[2]);
+		mesh->clusters[i].aabbMax = float3(src->mAabbMax[0], src->mAabbMax[1], src->mAabbMax[2]);
+
+		// cullCluster rejects the cluster when the eye lies inside the cone around coneAxis, which is the
+		// meshoptimizer backface test with the axis flipped
+		mesh->clusters[i].coneCenter = float3(src->mConeApex[0], src->mConeApex[1], src->mConeApex[2]);
+		mesh->clusters[i].coneAxis = float3(-src->mConeAxis[0], -src->mConeAxis[1], -src->mConeAxis[2]);
+		mesh->clusters[i].coneAngleCosine = src->mConeCutoff;
+		// A cutoff of 1 means the triangle normals are too spread out for the cone to reject anything
+		mesh->clusters[i].valid = !twoSided && src->mConeCutoff < 1.0f;
+
+		mesh->clusterCompacts[i].triangleCount = src->mTriangleCount;
+		mesh->clusterCompacts[i].clusterStart = src->mTriangleStart;
+	}
+
+	return true;
+}
+
 // Compute an array of clusters from the mesh vertices. Clusters are sub batches of the original mesh limited in number
 // for more efficient CPU / GPU culling. CPU culling operates per cluster, while GPU culling operates per triangle for
 // all the clusters that passed the CPU test.
 void createClusters(bool twoSided, const Scene* pScene, IndirectDrawIndexArguments* draw, ClusterContainer* mesh)
 {
+	// Prefer the clusters built by the offline asset step, they are tighter than the fixed size runs below
+	if (loadOfflineClusters(twoSided, pScene->geom, (uint32_t)(draw - pScene->geom->pDrawArgs), mesh))
+		return;
+
 #define makeVec3(v) (vec3((v).x, (v).y, (v).z))
 
 	// 12 KiB stack space
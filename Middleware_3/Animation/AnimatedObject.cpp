@@ -43,8 +43,12 @@ void MultiplySoATransformQuaternion(int _index, const Quat& _quat, ozz::Range<So
 
 void AnimatedObject::Initialize(Rig* rig, Animation* animation)
 {
+	// Objects initialized one after the other update on different frames once their LOD drops
+	static uint32_t nextLODPhase = 0;
+
 	mRig = rig;
 	mAnimation = animation;
+	mLOD.SetPhase(nextLODPhase++);
 
 	ozz::memory::Allocator* allocator = ozz::memory::default_allocator();
 
@@ -56,29 +60,106 @@ void AnimatedObject::Destroy()
 {
 	ozz::memory::Allocator* allocator = ozz::memory::default_allocator();
 	allocator->Deallocate(mLocalTrans);
+	allocator->Deallocate(mLODStartMats);
+	allocator->Deallocate(mLODTargetMats);
+	allocator->Deallocate(mLODReferenceTrans);
+	allocator->Deallocate(mLODReferenceMats);
 }
 
 bool AnimatedObject::Update(float dt)
 {
-	// sample the current animation to get mLocalTrans
-	if (!mAnimation->Sample(dt, mLocalTrans))
-		return false;
+	float advance = dt;
+	mSampled = mLOD.BeginFrame(dt, &advance);
 
-	// Local to model job
+	const bool interpolate = mLOD.IsInterpolating();
 
-	// Setup local-to-model conversion job.
-	ozz::animation::LocalToModelJob ltmJob;
-	ltmJob.skeleton = mRig->GetSkeleton();
-	ltmJob.input = mLocalTrans;
-	ltmJob.output = mRig->GetJointModelMats();    // Save results in mRig's model mat buffer
+	// Interpolation buffers are only needed once the object is updated at a lower rate
+	if (interpolate && !mLODStartMats.begin)
+	{
+		ozz::memory::Allocator* allocator = ozz::memory::default_allocator();
+		mLODStartMats = allocator->AllocateRange<Matrix4>(mRig->GetNumJoints());
+		mLODTargetMats = allocator->AllocateRange<Matrix4>(mRig->GetNumJoints());
+	}
 
-	// Runs ltm job.
-	if (!ltmJob.Run())
-		return false;
+	if (mSampled)
+	{
+		// sample the current animation to get mLocalTrans
+		if (!mAnimation->Sample(advance, mLocalTrans))
+			return false;
+
+		// Interpolation starts from what was displayed last, so changing the LOD never pops
+		if (interpolate && mHasPose)
+		{
+			const Matrix4* modelMats = mRig->GetJointModelMats().begin;
+			for (unsigned int i = 0; i < mRig->GetNumJoints(); ++i)
+				mLODStartMats.begin[i] = modelMats[i];
+		}
+
+		// Local to model job
+
+		// Setup local-to-model conversion job.
+		ozz::animation::LocalToModelJob ltmJob;
+		ltmJob.skeleton = mRig->GetSkeleton();
+		ltmJob.input = mLocalTrans;
+		ltmJob.output = interpolate ? mLODTargetMats : mRig->GetJointModelMats();    // Save results in mRig's model mat buffer
+
+		// Runs ltm job.
+		if (!ltmJob.Run())
+			return false;
 
+		if (interpolate && !mHasPose)
+		{
+			for (unsigned int i = 0; i < mRig->GetNumJoints(); ++i)
+				mLODStartMats.begin[i] = mLODTargetMats.begin[i];
+		}
+
+		mHasPose = true;
+	}
+
+	mLODPoseError = 0.0f;
+	if (interpolate)
+	{
+		AnimationLOD::InterpolatePose(
+			mLODStartMats.begin, mLODTargetMats.begin, mLOD.GetBlend(), mRig->GetJointModelMats().begin, mRig->GetNumJoints());
+
+		if (mMeasureLODError)
+		{
+			// The animation is ahead of the displayed pose by the LOD lead
+			if (!mAnimation->SampleAtOffset(-mLOD.GetLead(), mLODReferenceTrans))
+				return false;
+
+			ozz::animation::LocalToModelJob ltmJob;
+			ltmJob.skeleton = mRig->GetSkeleton();
+			ltmJob.input = mLODReferenceTrans;
+			ltmJob.output = mLODReferenceMats;
+			if (!ltmJob.Run())
+				return false;
+
+			mLODPoseError = AnimationLOD::GetPoseError(mRig->GetJointModelMats().begin, mLODReferenceMats.begin, mRig->GetNumJoints());
+		}
+	}
+
+	mLOD.EndFrame();
 	return true;
 }
 
+void AnimatedObject::SetLODViewPosition(const AnimationLODDesc& desc, const Point3& viewPosition)
+{
+	mLOD.SetDistance(desc, length(mRootTransform.getTranslation() - Vector3(viewPosition)));
+}
+
+void AnimatedObject::SetMeasureLODError(bool measure)
+{
+	mMeasureLODError = measure;
+
+	if (measure && !mLODReferenceTrans.begin)
+	{
+		ozz::memory::Allocator* allocator = ozz::memory::default_allocator();
+		mLODReferenceTrans = allocator->AllocateRange<SoaTransform>(mRig->GetNumSoaJoints());
+		mLODReferenceMats = allocator->AllocateRange<Matrix4>(mRig->GetNumJoints());
+	}
+}
+
 bool AnimatedObject::AimIK(AimIKDesc* params, Point3 target)
 {
 	ozz::Range<Matrix4> models = mRig->GetJointModelMats();
@@ -31,6 +31,7 @@
 
 #include "Rig.h"
 #include "Animation.h"
+#include "AnimationLOD.h"
 
 struct AimIKDesc
 {
@@ -93,8 +94,24 @@ class AnimatedObject
 	void Destroy();
 
 	// To be called every frame of the main application, handles sampling and updating the current animation
+	// Depending on the update rate LOD the animation is only sampled every few frames and the pose interpolated in between
 	bool Update(float dt);
 
+	// Picks the update rate LOD from the distance between the root of the object and viewPosition
+	void SetLODViewPosition(const AnimationLODDesc& desc, const Point3& viewPosition);
+
+	// Gets the update rate LOD to set its interval or phase directly
+	inline AnimationLOD* GetLOD() { return &mLOD; };
+
+	// When enabled, interpolated frames also sample the animation to measure the interpolation error
+	void SetMeasureLODError(bool measure);
+
+	// Largest joint position error of the last frame in model space units, 0 if the pose was not interpolated
+	inline float GetLODPoseError() const { return mLODPoseError; };
+
+	// Whether the animation was sampled during the last Update
+	inline bool WasSampled() const { return mSampled; };
+
 	bool AimIK(AimIKDesc* params, Point3 target);
 
 	// Apply two bone inverse kinematic
@@ -123,8 +140,25 @@ class AnimatedObject
 	Animation* mAnimation;
 
 	// Buffer of local transforms as sampled from the animation.
+	// With update rate LOD these are the local transforms of the last sample, IK is applied on top of them
 	ozz::Range<SoaTransform> mLocalTrans;
 
+	// Update rate LOD state
+	AnimationLOD mLOD;
+
+	// Pose displayed when the last sample was taken and the pose it is interpolated to, allocated once the LOD drops
+	ozz::Range<Matrix4> mLODStartMats;
+	ozz::Range<Matrix4> mLODTargetMats;
+
+	// Full rate pose used to measure the interpolation error, allocated when measuring is enabled
+	ozz::Range<SoaTransform> mLODReferenceTrans;
+	ozz::Range<Matrix4>      mLODReferenceMats;
+
+	bool  mHasPose = false;
+	bool  mSampled = false;
+	bool  mMeasureLODError = false;
+	float mLODPoseError = 0.0f;
+
 	// Transform to apply to entire rig
 	Matrix4 mRootTransform = Matrix4::identity();
 };
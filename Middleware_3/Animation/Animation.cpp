@@ -29,6 +29,8 @@ void Animation::Initialize(AnimationDesc animationDesc)
 	mRig = animationDesc.mRig;
 	mNumClips = min(animationDesc.mNumLayers, MAX_NUM_CLIPS);
 	mBlendType = animationDesc.mBlendType;
+	mSamplingCachePool = animationDesc.mSamplingCachePool;
+	mNumAdditiveClips = 0;
 
 	ozz::memory::Allocator* allocator = ozz::memory::default_allocator();
 
@@ -52,6 +54,16 @@ void Animation::Initialize(AnimationDesc animationDesc)
 		}
 
 		// Prepare input and output of clip sampling
+		if (mSamplingCachePool)
+		{
+			// Leases a cache and sampler buffers, possibly shared with the other animations of the lockstep group
+			mClipSamplingLeases[i] =
+				mSamplingCachePool->Acquire(mRig->GetNumJoints(), mClips[i], animationDesc.mLayerProperties[i].mLockstepGroup);
+			ASSERT(mClipSamplingLeases[i]);
+			mClipSamplingCaches[i] = &mClipSamplingLeases[i]->mCache;
+			mClipLocalTrans[i] = ozz::Range<SoaTransform>(mClipSamplingLeases[i]->mLocalTrans.begin, mRig->GetNumSoaJoints());
+			continue;
+		}
 
 		// Allocates sampler runtime buffers.
 		mClipLocalTrans[i] = allocator->AllocateRange<SoaTransform>(mRig->GetNumSoaJoints());
@@ -71,6 +83,16 @@ void Animation::Destroy()
 
 	for (unsigned int i = 0; i < mNumClips; i++)
 	{
+		if (mClipSamplingLeases[i])
+		{
+			mSamplingCachePool->Release(mClipSamplingLeases[i]);
+			mClipSamplingLeases[i] = nullptr;
+			if (mClipMissLocalTrans[i].begin)
+				allocator->Deallocate(mClipMissLocalTrans[i]);
+			mClipMissLocalTrans[i] = ozz::Range<SoaTransform>();
+			continue;
+		}
+
 		allocator->Delete(mClipSamplingCaches[i]);
 		allocator->Deallocate(mClipLocalTrans[i]);
 	}
@@ -95,9 +117,11 @@ bool Animation::Sample(float dt, ozz::Range<SoaTransform>& localTrans)
 		// Early out if this layers weight makes it irrelevant during blending.
 		if (mClipControllers[i]->GetWeight() != 0.f)
 		{
-			//if (!mClips[i]->Sample(mClipControllers[i]->GetTimeRatio()))
-			if (!mClips[i]->Sample(mClipSamplingCaches[i], mClipLocalTrans[i], mClipControllers[i]->GetTimeRatio()))
+			if (!SampleClip(i, mClipControllers[i]->GetTimeRatio()))
+			{
+				EndSampleClips();
 				return false;
+			}
 		}
 	}
 
@@ -105,9 +129,58 @@ bool Animation::Sample(float dt, ozz::Range<SoaTransform>& localTrans)
 	mTimeRatio = mClipControllers[mLongestClipIndex]->GetTimeRatio();
 
 	//blend these samples together
+	const bool blended = Blend(localTrans);
+	EndSampleClips();
+	return blended;
+}
+
+bool Animation::SampleAtOffset(float timeOffset, ozz::Range<SoaTransform>& localTrans)
+{
+	for (unsigned int i = 0; i < mNumClips; i++)
+	{
+		if (mClipControllers[i]->GetWeight() == 0.f)
+			continue;
+
+		// Would overwrite the pose the other animations of the group are blending
+		if (mClipSamplingLeases[i] && mClipSamplingLeases[i]->mLockstepGroup)
+			return false;
+
+		const float timeRatio = mClipControllers[i]->GetTimeRatioAfter(timeOffset);
+		if (!SampleClip(i, timeRatio))
+			return false;
+	}
+
 	return Blend(localTrans);
 }
 
+bool Animation::SampleClip(unsigned int i, float timeRatio)
+{
+	if (mClipSamplingLeases[i])
+	{
+		// Shared leases are blended from the pose of the lease, or from our own one when the group was out of lockstep
+		ozz::Range<SoaTransform> localTrans;
+		const bool               sampled =
+			mSamplingCachePool->Sample(mClipSamplingLeases[i], mClips[i], timeRatio, &mClipMissLocalTrans[i], &localTrans);
+		mClipLocalTrans[i] = ozz::Range<SoaTransform>(localTrans.begin, mRig->GetNumSoaJoints());
+		mClipReadsLease[i] = sampled && mClipSamplingLeases[i]->mLockstepGroup && localTrans.begin == mClipSamplingLeases[i]->mLocalTrans.begin;
+		return sampled;
+	}
+
+	return mClips[i]->Sample(mClipSamplingCaches[i], mClipLocalTrans[i], timeRatio);
+}
+
+void Animation::EndSampleClips()
+{
+	for (unsigned int i = 0; i < mNumClips; i++)
+	{
+		if (mClipReadsLease[i])
+		{
+			mSamplingCachePool->EndSample(mClipSamplingLeases[i]);
+			mClipReadsLease[i] = false;
+		}
+	}
+}
+
 void Animation::UpdateBlendParameters()
 {
 	// Set to Ozz's default min value to undo any external changes
@@ -34,6 +34,7 @@
 #include "Clip.h"
 #include "ClipMask.h"
 #include "ClipController.h"
+#include "SamplingCachePool.h"
 
 // Maximum number of clips that can make up one animation
 const unsigned int MAX_NUM_CLIPS = 10;
@@ -45,6 +46,9 @@ struct LayerProperty
 	ClipController* mClipController;
 	ClipMask*       mClipMask = nullptr;
 	bool            mAdditive = false;
+	// Layers of different animations with the same clip and non zero group share their sampled pose, see SamplingCachePool.
+	// Their controllers must stay in lockstep, so they can't be used with update rate LOD or SampleAtOffset
+	uint32_t mLockstepGroup = 0;
 };
 
 // Properties that define how the clips will be blended when mAutoSetBlendParams is true
@@ -63,6 +67,8 @@ struct AnimationDesc
 	unsigned int  mNumLayers;
 	LayerProperty mLayerProperties[MAX_NUM_CLIPS];
 	BlendType     mBlendType = BlendType::EQUAL;
+	// Leases the sampling caches from this pool instead of allocating them, needed for mLockstepGroup
+	SamplingCachePool* mSamplingCachePool = nullptr;
 };
 
 // Allows for blending and sampling of loaded clips
@@ -78,6 +84,11 @@ class Animation
 	// Will sample the animation at dt, storing the local transform results in localTrans
 	bool Sample(float dt, ozz::Range<SoaTransform>& localTrans);
 
+	// Samples the animation timeOffset seconds away from its current time, storing the local transform results in localTrans.
+	// Time and blend parameters are left untouched, used to get a reference pose for update rate LOD.
+	// Fails if a layer shares its pose with a lockstep group
+	bool SampleAtOffset(float timeOffset, ozz::Range<SoaTransform>& localTrans);
+
 	// Set if UpdateBlendParameters() be called or not
 	inline void SetAutoSetBlendParams(bool setValue) { mAutoSetBlendParams = setValue; };
 
@@ -106,6 +117,12 @@ class Animation
 	// Blend the sampled clips together based on their blend parameters
 	bool Blend(ozz::Range<SoaTransform>& localTrans);
 
+	// Samples clip i into mClipLocalTrans[i]
+	bool SampleClip(unsigned int i, float timeRatio);
+
+	// Ends the reads of the shared leases sampled by SampleClip
+	void EndSampleClips();
+
 	// Pointer to the rig that this animation corresponds to
 	Rig* mRig;
 
@@ -124,6 +141,14 @@ class Animation
 	// The buffer of local transforms that will be updated as output when each clip is sampled
 	ozz::Range<SoaTransform> mClipLocalTrans[MAX_NUM_CLIPS];
 
+	// Pool that owns the caches and local transforms when AnimationDesc::mSamplingCachePool was set
+	SamplingCachePool*  mSamplingCachePool = nullptr;
+	SamplingCacheLease* mClipSamplingLeases[MAX_NUM_CLIPS] = {};
+	// Own pose of shared leases sampled out of lockstep, allocated on the first miss
+	ozz::Range<SoaTransform> mClipMissLocalTrans[MAX_NUM_CLIPS];
+	// Set while mClipLocalTrans[i] is the pose of a shared lease, until EndSampleClips
+	bool mClipReadsLease[MAX_NUM_CLIPS] = {};
+
 	// The blend layers that will be set each sampling based on each clip's properties
 	ozz::Range<ozz::animation::BlendingJob::Layer> mLayers;
 	ozz::Range<ozz::animation::BlendingJob::Layer> mAdditiveLayers;
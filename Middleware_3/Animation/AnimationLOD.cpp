@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+#include "AnimationLOD.h"
+
+void AnimationLOD::SetDistance(const AnimationLODDesc& desc, float distance)
+{
+	uint32_t lod = 0;
+	while (lod < ANIMATION_LOD_COUNT - 1 && distance >= desc.mDistances[lod])
+		++lod;
+
+	mInterval = ANIMATION_LOD_INTERVALS[lod];
+}
+
+bool AnimationLOD::BeginFrame(float dt, float* pAdvance)
+{
+	// Displayed time moves by dt every frame
+	mLead -= dt;
+
+	// Update on the frames of our phase so the cost of a crowd is spread evenly, and whenever
+	// the last target was reached, which happens when the interval grows between two updates
+	const bool update = mInterval == 1 || mSegmentFrame >= mSegmentLength || ((mFrame + mPhase) % mInterval) == 0;
+	++mFrame;
+
+	if (!update)
+	{
+		*pAdvance = 0.0f;
+		return false;
+	}
+
+	// Assumes the next frames take as long as this one, any difference is caught up on the next update
+	const float lead = (float)(mInterval - 1) * dt;
+	*pAdvance = max(0.0f, lead - mLead);
+	mLead += *pAdvance;
+
+	// The start pose is the one displayed last frame, dt before now. When the interval shrinks the previous
+	// target may still be ahead, the pose then moves towards it at the speed of real time
+	mSegmentFrame = 0;
+	mSegmentLength = mInterval;
+	mSegmentDuration = mLead + dt;
+	return true;
+}
+
+void AnimationLOD::InterpolatePose(const Matrix4* start, const Matrix4* target, float blend, Matrix4* out, uint32_t numJoints)
+{
+	for (uint32_t i = 0; i < numJoints; ++i)
+	{
+		out[i] = Matrix4(
+			lerp(blend, start[i].getCol0(), target[i].getCol0()), lerp(blend, start[i].getCol1(), target[i].getCol1()),
+			lerp(blend, start[i].getCol2(), target[i].getCol2()), lerp(blend, start[i].getCol3(), target[i].getCol3()));
+	}
+}
+
+float AnimationLOD::GetPoseError(const Matrix4* pose, const Matrix4* reference, uint32_t numJoints)
+{
+	float error = 0.0f;
+	for (uint32_t i = 0; i < numJoints; ++i)
+		error = max(error, (float)length(pose[i].getCol3().getXYZ() - reference[i].getCol3().getXYZ()));
+
+	return error;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+#pragma once
+
+#include "../../Common_3/OS/Math/MathTypes.h"
+
+// Update rates of the LOD levels, LOD i samples and blends every ANIMATION_LOD_INTERVALS[i] frames
+const unsigned int ANIMATION_LOD_COUNT = 4;
+const unsigned int ANIMATION_LOD_INTERVALS[ANIMATION_LOD_COUNT] = { 1, 2, 4, 8 };
+
+// Distances from the camera at which an object drops to a lower update rate
+struct AnimationLODDesc
+{
+	// Object distance from which LOD i + 1 is used, must be increasing
+	float mDistances[ANIMATION_LOD_COUNT - 1] = { 10.0f, 20.0f, 40.0f };
+};
+
+// Distance based update rate of one animated object.
+// On an update frame the animation is advanced so that it leads real time by
+// (interval - 1) frames, and the model space pose of the frames until the next
+// update is interpolated in time from the pose that was displayed last to that target.
+// With an interval of 1 the animation is sampled every frame without any lag.
+class AnimationLOD
+{
+	public:
+	// Frame offset of this object, objects with different phases update on different frames
+	inline void SetPhase(uint32_t phase) { mPhase = phase; };
+
+	// Picks the update interval from the distance between the object and the camera
+	void SetDistance(const AnimationLODDesc& desc, float distance);
+
+	// Forces an update interval, must be one of ANIMATION_LOD_INTERVALS
+	inline void SetInterval(uint32_t interval) { mInterval = interval; };
+
+	inline uint32_t GetInterval() const { return mInterval; };
+
+	// Starts a frame, returns true if the animation has to be sampled this frame and
+	// how far it has to be advanced in pAdvance
+	bool BeginFrame(float dt, float* pAdvance);
+
+	// Interpolation weight of the target pose for the current frame, 1 means the target is displayed as is
+	inline float GetBlend() const { return mSegmentDuration > 0.0f ? clamp(1.0f - mLead / mSegmentDuration, 0.0f, 1.0f) : 1.0f; };
+
+	// True while the displayed pose is interpolated towards a target sampled ahead of time
+	inline bool IsInterpolating() const { return mSegmentLength > 1 || mLead > 0.0f; };
+
+	// Seconds the sampled animation is ahead of the displayed pose
+	inline float GetLead() const { return mLead; };
+
+	// Must be called after the pose of the frame has been output
+	inline void EndFrame() { ++mSegmentFrame; };
+
+	// out = lerp(start, target, blend) on all joints
+	static void InterpolatePose(const Matrix4* start, const Matrix4* target, float blend, Matrix4* out, uint32_t numJoints);
+
+	// Largest distance between the joint positions of two poses
+	static float GetPoseError(const Matrix4* pose, const Matrix4* reference, uint32_t numJoints);
+
+	private:
+	uint32_t mInterval = 1;
+	uint32_t mPhase = 0;
+	uint32_t mFrame = 0;
+	// Frames since the last update and frames until the target pose is reached
+	uint32_t mSegmentFrame = 0;
+	uint32_t mSegmentLength = 0;
+	// Animation time minus displayed time, in seconds
+	float mLead = 0.0f;
+	// Time between the start and the target pose of the interpolation
+	float mSegmentDuration = 0.0f;
+};
@@ -0,0 +1,489 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+#include "AnimationSystem.h"
+
+#include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/animation/runtime/blending_job.h"
+#include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/animation/runtime/local_to_model_job.h"
+
+#include "../../Common_3/OS/Interfaces/IThread.h"
+#include "../../Common_3/OS/Interfaces/ITime.h"
+
+#include "../../Common_3/OS/Interfaces/IMemory.h"
+
+bool AnimationSystem::Initialize(const AnimationSystemDesc& desc)
+{
+	if (!desc.mMaxInstances || !desc.mMaxJoints || !desc.mMaxLayers || desc.mMaxLayers > MAX_NUM_CLIPS)
+	{
+		LOGF(eERROR, "AnimationSystem needs at least one instance, joint and layer, and at most %u layers", MAX_NUM_CLIPS);
+		return false;
+	}
+
+	mThreadSystem = desc.mThreadSystem;
+	mMaxInstances = desc.mMaxInstances;
+	mMaxLayers = desc.mMaxLayers;
+	mMaxJoints = desc.mMaxJoints;
+	mMaxSoaJoints = (desc.mMaxJoints + 3) / 4;
+	mBatchSize = max(1U, desc.mBatchSize);
+	mNumInstances = 0;
+	mActiveInstances = 0;
+
+	const size_t layerCount = (size_t)mMaxInstances * mMaxLayers;
+
+	mInstances = (Instance*)tf_memalign(alignof(Instance), sizeof(Instance) * mMaxInstances);
+	mClips = (Clip**)tf_calloc(layerCount, sizeof(Clip*));
+	mClipMasks = (ClipMask**)tf_calloc(layerCount, sizeof(ClipMask*));
+	mClipControllers = (ClipController*)tf_calloc(layerCount, sizeof(ClipController));
+	// Caches are constructed in place by AddInstance, once the joint count of the instance is known
+	mSamplingCaches = (ozz::animation::SamplingCache*)tf_malloc(sizeof(ozz::animation::SamplingCache) * layerCount);
+
+	mLayerLocalTrans = (SoaTransform*)tf_memalign(alignof(SoaTransform), sizeof(SoaTransform) * mMaxSoaJoints * layerCount);
+	mLocalTrans = (SoaTransform*)tf_memalign(alignof(SoaTransform), sizeof(SoaTransform) * mMaxSoaJoints * mMaxInstances);
+	mModelMats = (Matrix4*)tf_memalign(alignof(Matrix4), sizeof(Matrix4) * mMaxJoints * mMaxInstances);
+	mSkinningMats = (Matrix4*)tf_memalign(alignof(Matrix4), sizeof(Matrix4) * mMaxJoints * mMaxInstances);
+
+	if (desc.mEnableLOD)
+	{
+		mLODs = (AnimationLOD*)tf_malloc(sizeof(AnimationLOD) * mMaxInstances);
+		mLODStartMats = (Matrix4*)tf_memalign(alignof(Matrix4), sizeof(Matrix4) * mMaxJoints * mMaxInstances);
+		mLODTargetMats = (Matrix4*)tf_memalign(alignof(Matrix4), sizeof(Matrix4) * mMaxJoints * mMaxInstances);
+	}
+
+	mUseLOD = false;
+	mStats = {};
+	return true;
+}
+
+void AnimationSystem::Destroy()
+{
+	RemoveAllInstances();
+
+	for (RigBindPose& bindPose : mBindPoses)
+		tf_free(bindPose.mInverseBindMats);
+	mBindPoses.set_capacity(0);
+
+	tf_free(mInstances);
+	tf_free(mClips);
+	tf_free(mClipMasks);
+	tf_free(mClipControllers);
+	tf_free(mSamplingCaches);
+	tf_free(mLayerLocalTrans);
+	tf_free(mLocalTrans);
+	tf_free(mModelMats);
+	tf_free(mSkinningMats);
+	tf_free(mLODs);
+	tf_free(mLODStartMats);
+	tf_free(mLODTargetMats);
+
+	mInstances = nullptr;
+	mClips = nullptr;
+	mClipMasks = nullptr;
+	mClipControllers = nullptr;
+	mSamplingCaches = nullptr;
+	mLayerLocalTrans = nullptr;
+	mLocalTrans = nullptr;
+	mModelMats = nullptr;
+	mSkinningMats = nullptr;
+	mSkinningOutput = nullptr;
+	mLODs = nullptr;
+	mLODStartMats = nullptr;
+	mLODTargetMats = nullptr;
+	mMaxInstances = 0;
+}
+
+uint32_t AnimationSystem::AddInstance(const AnimationInstanceDesc& desc)
+{
+	if (mNumInstances >= mMaxInstances)
+	{
+		LOGF(eERROR, "AnimationSystem is full (%u instances)", mMaxInstances);
+		return UINT32_MAX;
+	}
+
+	Rig* rig = desc.mRig;
+	if (!rig || !desc.mNumLayers || desc.mNumLayers > mMaxLayers || rig->GetNumJoints() > mMaxJoints)
+	{
+		LOGF(eERROR, "AnimationSystem instance needs a rig of at most %u joints and 1 to %u layers", mMaxJoints, mMaxLayers);
+		return UINT32_MAX;
+	}
+
+	const uint32_t index = mNumInstances;
+
+	Instance& instance = mInstances[index];
+	instance.mRootTransform = desc.mRootTransform;
+	instance.mRig = rig;
+	instance.mInverseBindMats = desc.mInverseBindMats ? desc.mInverseBindMats : GetSkeletonInverseBindMats(rig);
+	instance.mNumLayers = desc.mNumLayers;
+	instance.mNumJoints = rig->GetNumJoints();
+	instance.mNumSoaJoints = rig->GetNumSoaJoints();
+	instance.mPoseRig = desc.mPoseRig;
+	instance.mSampleDirect = desc.mNumLayers == 1 && !desc.mLayerProperties[0].mAdditive && !desc.mLayerProperties[0].mClipMask;
+	instance.mSampled = true;
+	instance.mHasPose = false;
+
+	// Consecutive instances update on different frames once their LOD drops
+	if (mLODs)
+		tf_placement_new<AnimationLOD>(&mLODs[index])->SetPhase(index);
+
+	for (uint32_t i = 0; i < desc.mNumLayers; ++i)
+	{
+		const AnimationLayerDesc& layer = desc.mLayerProperties[i];
+		const uint32_t            layerIndex = index * mMaxLayers + i;
+
+		mClips[layerIndex] = layer.mClip;
+		mClipMasks[layerIndex] = layer.mClipMask;
+
+		ClipController* clipController = &mClipControllers[layerIndex];
+		clipController->Initialize(layer.mClip->GetDuration());
+		clipController->SetAdditive(layer.mAdditive);
+		clipController->SetLoop(layer.mLoop);
+		clipController->SetWeight(layer.mWeight);
+		clipController->SetPlaybackSpeed(layer.mPlaybackSpeed);
+		clipController->SetTimeRatio(layer.mTimeRatio);
+
+		tf_placement_new<ozz::animation::SamplingCache>(&mSamplingCaches[layerIndex], (int)instance.mNumJoints);
+	}
+
+	// Start from the bind pose so instances that never get updated still have valid outputs
+	const ozz::Range<const SoaTransform> bindPose = rig->GetSkeleton()->bind_pose();
+	SoaTransform* localTrans = mLocalTrans + (size_t)index * mMaxSoaJoints;
+	for (uint32_t i = 0; i < instance.mNumSoaJoints; ++i)
+		localTrans[i] = bindPose.begin[i];
+
+	++mNumInstances;
+	mActiveInstances = mNumInstances;
+	return index;
+}
+
+void AnimationSystem::RemoveAllInstances()
+{
+	for (uint32_t i = 0; i < mNumInstances; ++i)
+	{
+		for (uint32_t j = 0; j < mInstances[i].mNumLayers; ++j)
+			mSamplingCaches[i * mMaxLayers + j].~SamplingCache();
+	}
+
+	mNumInstances = 0;
+	mActiveInstances = 0;
+}
+
+bool AnimationSystem::Update(float dt)
+{
+	const int64_t startTime = getUSec();
+
+	mDeltaTime = dt;
+	tfrg_atomic32_store_relaxed(&mStageFailed, 0);
+	tfrg_atomic32_store_relaxed(&mSampledInstances, 0);
+	tfrg_atomic32_store_relaxed(&mMaxLODPoseErrorBits, 0);
+
+	// Every stage waits for the previous one, the stage outputs are the only data shared between jobs
+	RunStage(ANIMATION_STAGE_SAMPLE, &AnimationSystem::SampleInstance);
+	RunStage(ANIMATION_STAGE_BLEND, &AnimationSystem::BlendInstance);
+	RunStage(ANIMATION_STAGE_LOCAL_TO_MODEL, &AnimationSystem::LocalToModelInstance);
+	RunStage(ANIMATION_STAGE_SKINNING, &AnimationSystem::SkinInstance);
+
+	const uint32_t maxLODPoseErrorBits = tfrg_atomic32_load_acquire(&mMaxLODPoseErrorBits);
+	mStats.mNumInstances = mActiveInstances;
+	mStats.mNumSampledInstances = tfrg_atomic32_load_acquire(&mSampledInstances);
+	memcpy(&mStats.mMaxLODPoseError, &maxLODPoseErrorBits, sizeof(float));
+	mStats.mNumBatches = (mActiveInstances + mBatchSize - 1) / mBatchSize;
+	mStats.mTotalTimeMs = (float)(getUSec() - startTime) / 1000.0f;
+
+	if (tfrg_atomic32_load_acquire(&mStageFailed))
+	{
+		LOGF(eERROR, "AnimationSystem failed to update some instances");
+		return false;
+	}
+
+	return true;
+}
+
+void AnimationSystem::SetLOD(const AnimationLODDesc* desc, const Point3& viewPosition)
+{
+	if (desc && !mLODs)
+	{
+		LOGF(eWARNING, "AnimationSystem was initialized without mEnableLOD, all instances keep updating every frame");
+		return;
+	}
+
+	mUseLOD = desc != nullptr;
+	if (desc)
+		mLODDesc = *desc;
+	mLODViewPosition = viewPosition;
+}
+
+void AnimationSystem::RunStage(AnimationSystemStage stage, StageFunc func)
+{
+	const int64_t  startTime = getUSec();
+	const uint32_t batchCount = (mActiveInstances + mBatchSize - 1) / mBatchSize;
+
+	mStageFunc = func;
+	tfrg_atomic32_store_relaxed(&mPendingBatches, batchCount);
+
+	if (!mThreadSystem || batchCount <= 1)
+	{
+		for (uint32_t i = 0; i < batchCount; ++i)
+			RunStageBatch(this, i);
+	}
+	else
+	{
+		addThreadSystemRangeTask(mThreadSystem, &AnimationSystem::RunStageBatch, this, batchCount);
+
+		// Work on batches of this stage instead of blocking, the next stage needs all of them
+		while (tfrg_atomic32_load_acquire(&mPendingBatches))
+		{
+			if (!assistThreadSystem(mThreadSystem))
+				Thread::Sleep(0);
+		}
+	}
+
+	mStats.mStageTimeMs[stage] = (float)(getUSec() - startTime) / 1000.0f;
+}
+
+void AnimationSystem::RunStageBatch(void* pUserData, uintptr_t batchIndex)
+{
+	AnimationSystem* pSystem = (AnimationSystem*)pUserData;
+
+	const uint32_t first = (uint32_t)batchIndex * pSystem->mBatchSize;
+	const uint32_t last = min(first + pSystem->mBatchSize, pSystem->mActiveInstances);
+	const StageFunc func = pSystem->mStageFunc;
+
+	for (uint32_t i = first; i < last; ++i)
+		(pSystem->*func)(i);
+
+	// Publishes the outputs of the batch to the thread waiting for the stage
+	tfrg_atomic32_add_release(&pSystem->mPendingBatches, (uint32_t)-1);
+}
+
+bool AnimationSystem::IsSampledDirect(uint32_t instance)
+{
+	// A single layer below the threshold gets blended with the bind pose, it needs the blend stage
+	return mInstances[instance].mSampleDirect &&
+		   mClipControllers[instance * mMaxLayers].GetWeight() >= ozz::animation::BlendingJob().threshold;
+}
+
+void AnimationSystem::SampleInstance(uint32_t instance)
+{
+	Instance& data = mInstances[instance];
+	float     advance = mDeltaTime;
+
+	if (mLODs)
+	{
+		AnimationLOD& lod = mLODs[instance];
+		if (mUseLOD)
+			lod.SetDistance(mLODDesc, length(data.mRootTransform.getTranslation() - Vector3(mLODViewPosition)));
+		else
+			lod.SetInterval(1);
+
+		data.mSampled = lod.BeginFrame(mDeltaTime, &advance);
+		if (!data.mSampled)
+			return;
+	}
+
+	tfrg_atomic32_add_relaxed(&mSampledInstances, 1);
+
+	// Updates clips time.
+	for (uint32_t i = 0; i < data.mNumLayers; ++i)
+		mClipControllers[instance * mMaxLayers + i].Update(advance);
+
+	SampleLayers(instance, 0.0f);
+}
+
+void AnimationSystem::SampleLayers(uint32_t instance, float timeOffset)
+{
+	const Instance& data = mInstances[instance];
+	const bool      sampleDirect = IsSampledDirect(instance);
+
+	for (uint32_t i = 0; i < data.mNumLayers; ++i)
+	{
+		const uint32_t  layerIndex = instance * mMaxLayers + i;
+		ClipController* clipController = &mClipControllers[layerIndex];
+
+		// Early out if this layers weight makes it irrelevant during blending.
+		if (clipController->GetWeight() == 0.f)
+			continue;
+
+		SoaTransform*            output = sampleDirect ? mLocalTrans + (size_t)instance * mMaxSoaJoints
+													   : mLayerLocalTrans + (size_t)layerIndex * mMaxSoaJoints;
+		ozz::Range<SoaTransform> localTrans(output, data.mNumSoaJoints);
+
+		const float timeRatio = timeOffset != 0.0f ? clipController->GetTimeRatioAfter(timeOffset) : clipController->GetTimeRatio();
+		if (!mClips[layerIndex]->Sample(&mSamplingCaches[layerIndex], localTrans, timeRatio))
+			tfrg_atomic32_store_relaxed(&mStageFailed, 1);
+	}
+}
+
+void AnimationSystem::BlendInstance(uint32_t instance)
+{
+	if (!mInstances[instance].mSampled || IsSampledDirect(instance))
+		return;
+
+	BlendLayers(instance);
+}
+
+void AnimationSystem::BlendLayers(uint32_t instance)
+{
+	const Instance& data = mInstances[instance];
+
+	ozz::animation::BlendingJob::Layer layers[MAX_NUM_CLIPS];
+	ozz::animation::BlendingJob::Layer additiveLayers[MAX_NUM_CLIPS];
+	uint32_t                           numLayers = 0;
+	uint32_t                           numAdditiveLayers = 0;
+
+	for (uint32_t i = 0; i < data.mNumLayers; ++i)
+	{
+		const uint32_t  layerIndex = instance * mMaxLayers + i;
+		ClipController* clipController = &mClipControllers[layerIndex];
+
+		// Layers without weight were not sampled this frame
+		if (clipController->GetWeight() == 0.f)
+			continue;
+
+		ozz::animation::BlendingJob::Layer& layer =
+			clipController->IsAdditive() ? additiveLayers[numAdditiveLayers++] : layers[numLayers++];
+		layer.transform = ozz::Range<const SoaTransform>(mLayerLocalTrans + (size_t)layerIndex * mMaxSoaJoints, data.mNumSoaJoints);
+		layer.weight = clipController->GetWeight();
+
+		if (mClipMasks[layerIndex])
+			layer.joint_weights = mClipMasks[layerIndex]->GetJointWeights();
+	}
+
+	ozz::animation::BlendingJob blendJob;
+	blendJob.layers = ozz::Range<const ozz::animation::BlendingJob::Layer>(layers, numLayers);
+	blendJob.additive_layers = ozz::Range<const ozz::animation::BlendingJob::Layer>(additiveLayers, numAdditiveLayers);
+	blendJob.bind_pose = data.mRig->GetSkeleton()->bind_pose();
+	blendJob.output = ozz::Range<SoaTransform>(mLocalTrans + (size_t)instance * mMaxSoaJoints, data.mNumSoaJoints);
+
+	if (!blendJob.Run())
+		tfrg_atomic32_store_relaxed(&mStageFailed, 1);
+}
+
+void AnimationSystem::LocalToModelInstance(uint32_t instance)
+{
+	Instance& data = mInstances[instance];
+	if (!data.mSampled)
+		return;
+
+	Matrix4* modelMats = mModelMats + (size_t)instance * mMaxJoints;
+
+	if (!mLODs || !mLODs[instance].IsInterpolating())
+	{
+		LocalToModel(instance, modelMats);
+		data.mHasPose = true;
+		return;
+	}
+
+	// Interpolation starts from what was displayed last, so changing the LOD never pops
+	Matrix4* startMats = mLODStartMats + (size_t)instance * mMaxJoints;
+	Matrix4* targetMats = mLODTargetMats + (size_t)instance * mMaxJoints;
+
+	LocalToModel(instance, targetMats);
+	const Matrix4* srcMats = data.mHasPose ? modelMats : targetMats;
+	for (uint32_t i = 0; i < data.mNumJoints; ++i)
+		startMats[i] = srcMats[i];
+	data.mHasPose = true;
+}
+
+void AnimationSystem::LocalToModel(uint32_t instance, Matrix4* output)
+{
+	const Instance& data = mInstances[instance];
+
+	ozz::animation::LocalToModelJob ltmJob;
+	ltmJob.skeleton = data.mRig->GetSkeleton();
+	ltmJob.input = ozz::Range<const SoaTransform>(mLocalTrans + (size_t)instance * mMaxSoaJoints, data.mNumSoaJoints);
+	ltmJob.output = ozz::Range<Matrix4>(output, data.mNumJoints);
+
+	if (!ltmJob.Run())
+		tfrg_atomic32_store_relaxed(&mStageFailed, 1);
+}
+
+void AnimationSystem::SkinInstance(uint32_t instance)
+{
+	const Instance& data = mInstances[instance];
+	Matrix4*        modelMats = mModelMats + (size_t)instance * mMaxJoints;
+	Matrix4*        skinningMats = mSkinningMats + (size_t)instance * mMaxJoints;
+
+	if (mLODs)
+	{
+		AnimationLOD& lod = mLODs[instance];
+		if (lod.IsInterpolating())
+		{
+			AnimationLOD::InterpolatePose(
+				mLODStartMats + (size_t)instance * mMaxJoints, mLODTargetMats + (size_t)instance * mMaxJoints, lod.GetBlend(), modelMats,
+				data.mNumJoints);
+
+			if (mMeasureLODError)
+			{
+				// Full rate pose at the displayed time, the local and skinning buffers are free to use as scratch here
+				SampleLayers(instance, -lod.GetLead());
+				if (!IsSampledDirect(instance))
+					BlendLayers(instance);
+				LocalToModel(instance, skinningMats);
+
+				const float error = AnimationLOD::GetPoseError(modelMats, skinningMats, data.mNumJoints);
+				// Positive floats compare like their bit patterns
+				uint32_t errorBits;
+				memcpy(&errorBits, &error, sizeof(errorBits));
+				tfrg_atomic32_max_relaxed(&mMaxLODPoseErrorBits, errorBits);
+			}
+		}
+		lod.EndFrame();
+	}
+
+	// World and skinning matrices of 4 joints at a time, written straight to the caller's buffer when one was set
+	Matrix4* output = mSkinningOutput ? mSkinningOutput + (size_t)instance * mSkinningOutputStride : skinningMats;
+	Rig::ComputeWorldMats(&data.mRootTransform, modelMats, nullptr, data.mInverseBindMats, data.mNumJoints, nullptr, output);
+
+	if (data.mPoseRig)
+	{
+		Matrix4* rigModelMats = data.mRig->GetJointModelMats().begin;
+		for (uint32_t i = 0; i < data.mNumJoints; ++i)
+			rigModelMats[i] = modelMats[i];
+		data.mRig->Pose(data.mRootTransform);
+	}
+}
+
+const Matrix4* AnimationSystem::GetSkeletonInverseBindMats(Rig* rig)
+{
+	for (const RigBindPose& bindPose : mBindPoses)
+	{
+		if (bindPose.mRig == rig)
+			return bindPose.mInverseBindMats;
+	}
+
+	// Model space bind pose of the skeleton, inverted so the skinning palette is identity in bind pose
+	RigBindPose bindPose = { rig, (Matrix4*)tf_memalign(alignof(Matrix4), sizeof(Matrix4) * rig->GetNumJoints()) };
+
+	ozz::animation::LocalToModelJob ltmJob;
+	ltmJob.skeleton = rig->GetSkeleton();
+	ltmJob.input = rig->GetSkeleton()->bind_pose();
+	ltmJob.output = ozz::Range<Matrix4>(bindPose.mInverseBindMats, rig->GetNumJoints());
+	if (!ltmJob.Run())
+		LOGF(eERROR, "Failed to compute the bind pose of a rig for AnimationSystem");
+
+	for (uint32_t i = 0; i < rig->GetNumJoints(); ++i)
+		bindPose.mInverseBindMats[i] = inverse(bindPose.mInverseBindMats[i]);
+
+	mBindPoses.push_back(bindPose);
+	return bindPose.mInverseBindMats;
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+#pragma once
+
+#include "../../Common_3/OS/Math/MathTypes.h"
+#include "../../Common_3/OS/Core/Atomics.h"
+#include "../../Common_3/OS/Core/ThreadSystem.h"
+
+#include "../../Common_3/ThirdParty/OpenSource/EASTL/vector.h"
+
+#include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/animation/runtime/sampling_job.h"
+
+#include "Rig.h"
+#include "Clip.h"
+#include "ClipMask.h"
+#include "ClipController.h"
+#include "Animation.h"
+#include "AnimationLOD.h"
+
+// Stages of AnimationSystem::Update, each stage runs as one batch job over all active instances
+enum AnimationSystemStage
+{
+	ANIMATION_STAGE_SAMPLE = 0,        // Advance the clip controllers and sample every layer
+	ANIMATION_STAGE_BLEND,             // Blend the sampled layers into one local pose
+	ANIMATION_STAGE_LOCAL_TO_MODEL,    // Convert local poses to model space matrices
+	ANIMATION_STAGE_SKINNING,          // root * model * inverse bind, optionally poses the Rig
+	ANIMATION_STAGE_COUNT
+};
+
+// One clip layer of an instance, its ClipController is owned by the AnimationSystem
+struct AnimationLayerDesc
+{
+	Clip*     mClip = nullptr;
+	ClipMask* mClipMask = nullptr;
+	bool      mAdditive = false;
+	bool      mLoop = true;
+	float     mWeight = 1.0f;
+	float     mPlaybackSpeed = 1.0f;
+	// Start time of the layer in [0,1], use different values to desynchronize crowds
+	float mTimeRatio = 0.0f;
+};
+
+// User will have to predefine to pass into AnimationSystem's AddInstance function
+struct AnimationInstanceDesc
+{
+	Rig*               mRig = nullptr;
+	unsigned int       mNumLayers = 0;
+	AnimationLayerDesc mLayerProperties[MAX_NUM_CLIPS];
+	Matrix4            mRootTransform = Matrix4::identity();
+	// mRig->GetNumJoints() inverse bind matrices, the inverse of the skeleton bind pose is used when null
+	const Matrix4* mInverseBindMats = nullptr;
+	// Also copies the model matrices to mRig and poses it, so SkeletonBatcher can draw the instance
+	bool mPoseRig = false;
+};
+
+struct AnimationSystemDesc
+{
+	// Stages run on the calling thread when this is null
+	ThreadSystem* mThreadSystem = nullptr;
+	unsigned int  mMaxInstances = 0;
+	// Strides of the per stage buffers, every rig added must fit in them
+	unsigned int mMaxLayers = 1;
+	unsigned int mMaxJoints = 0;
+	// Number of instances processed by one job of a stage
+	unsigned int mBatchSize = 32;
+	// Allocates the interpolation buffers needed by SetLOD
+	bool mEnableLOD = false;
+};
+
+struct AnimationSystemStats
+{
+	unsigned int mNumInstances;
+	// Instances that were sampled this update, the others had their pose interpolated
+	unsigned int mNumSampledInstances;
+	unsigned int mNumBatches;
+	// Largest joint position error of an interpolated pose, only measured when enabled with SetMeasureLODError
+	float        mMaxLODPoseError;
+	float        mStageTimeMs[ANIMATION_STAGE_COUNT];
+	float        mTotalTimeMs;
+};
+
+// Owns many animated instances and updates them in parallel batch jobs.
+// Every stage reads the output of the previous one from a contiguous buffer
+// (sampled layers -> blended locals -> model matrices -> skinning matrices),
+// so a job only touches memory of the instances in its batch.
+class AnimationSystem
+{
+	public:
+	// Allocates all stage buffers for desc.mMaxInstances instances
+	bool Initialize(const AnimationSystemDesc& desc);
+
+	// Must be called to clean up if the system was initialized
+	void Destroy();
+
+	// Adds an instance and returns its index, or UINT32_MAX if it does not fit in the system
+	uint32_t AddInstance(const AnimationInstanceDesc& desc);
+
+	// Removes all instances, keeps the stage buffers
+	void RemoveAllInstances();
+
+	// Only the first count instances are updated, the others keep their last pose
+	inline void SetActiveInstances(uint32_t count) { mActiveInstances = min(count, mNumInstances); };
+
+	inline void SetBatchSize(uint32_t batchSize) { mBatchSize = max(1U, batchSize); };
+
+	// Null runs the stages on the calling thread
+	inline void SetThreadSystem(ThreadSystem* threadSystem) { mThreadSystem = threadSystem; };
+
+	// Picks the update rate of every instance from its distance to viewPosition on the next updates,
+	// null updates all instances every frame. Needs AnimationSystemDesc::mEnableLOD
+	void SetLOD(const AnimationLODDesc* desc, const Point3& viewPosition);
+
+	// When enabled, interpolated poses are compared to a full rate pose, see AnimationSystemStats::mMaxLODPoseError
+	inline void SetMeasureLODError(bool measure) { mMeasureLODError = measure; };
+
+	// Runs all stages for the active instances, returns when the skinning matrices are ready
+	bool Update(float dt);
+
+	inline uint32_t GetNumInstances() const { return mNumInstances; };
+
+	inline void SetRootTransform(uint32_t instance, const Matrix4& rootTransform) { mInstances[instance].mRootTransform = rootTransform; };
+
+	// Gets the controller of a layer so weights, speeds or time can be changed between updates
+	inline ClipController* GetClipController(uint32_t instance, uint32_t layer) { return &mClipControllers[instance * mMaxLayers + layer]; };
+
+	// Model space joint matrices of an instance, valid after Update
+	inline const Matrix4* GetModelMats(uint32_t instance) const { return mModelMats + (size_t)instance * mMaxJoints; };
+
+	// World space skinning palette (root * model * inverse bind) of an instance, valid after Update
+	inline const Matrix4* GetSkinningMats(uint32_t instance) const
+	{
+		return mSkinningOutput ? mSkinningOutput + (size_t)instance * mSkinningOutputStride : mSkinningMats + (size_t)instance * mMaxJoints;
+	};
+
+	// The next updates write the skinning palette of instance i to pOutput + i * instanceStride instead of an internal buffer,
+	// typically the mapped address of the persistently mapped buffer of the frame. The palette is written without being read.
+	// Null goes back to the internal buffer
+	inline void SetSkinningOutput(Matrix4* pOutput, uint32_t instanceStride)
+	{
+		ASSERT(!pOutput || instanceStride >= mMaxJoints);
+		mSkinningOutput = pOutput;
+		mSkinningOutputStride = instanceStride;
+	};
+
+	// Timings of the last Update
+	inline const AnimationSystemStats& GetStats() const { return mStats; };
+
+	private:
+	struct Instance
+	{
+		Matrix4        mRootTransform;
+		Rig*           mRig;
+		const Matrix4* mInverseBindMats;
+		uint32_t       mNumLayers;
+		uint32_t       mNumJoints;
+		uint32_t       mNumSoaJoints;
+		bool           mPoseRig;
+		// Single full weight layer, sampled straight into the blended locals
+		bool mSampleDirect;
+		// Sampled this update or interpolated by the update rate LOD
+		bool mSampled;
+		bool mHasPose;
+	};
+
+	struct RigBindPose
+	{
+		Rig*     mRig;
+		Matrix4* mInverseBindMats;
+	};
+
+	typedef void (AnimationSystem::*StageFunc)(uint32_t instance);
+
+	// Runs stage over all active instances in batches of mBatchSize
+	void RunStage(AnimationSystemStage stage, StageFunc func);
+	static void RunStageBatch(void* pUserData, uintptr_t batchIndex);
+
+	void SampleInstance(uint32_t instance);
+	void BlendInstance(uint32_t instance);
+	void LocalToModelInstance(uint32_t instance);
+	void SkinInstance(uint32_t instance);
+
+	// Samples all layers timeOffset seconds away from the time of their controllers
+	void SampleLayers(uint32_t instance, float timeOffset);
+	void BlendLayers(uint32_t instance);
+	void LocalToModel(uint32_t instance, Matrix4* output);
+
+	const Matrix4* GetSkeletonInverseBindMats(Rig* rig);
+	bool           IsSampledDirect(uint32_t instance);
+
+	ThreadSystem* mThreadSystem = nullptr;
+	uint32_t      mMaxInstances = 0;
+	uint32_t      mMaxLayers = 0;
+	uint32_t      mMaxJoints = 0;
+	uint32_t      mMaxSoaJoints = 0;
+	uint32_t      mBatchSize = 1;
+	uint32_t      mNumInstances = 0;
+	uint32_t      mActiveInstances = 0;
+	float         mDeltaTime = 0.0f;
+
+	// Stage being run, read by the batch jobs
+	StageFunc       mStageFunc = nullptr;
+	tfrg_atomic32_t mStageFailed = 0;
+	tfrg_atomic32_t mPendingBatches = 0;
+	tfrg_atomic32_t mSampledInstances = 0;
+	tfrg_atomic32_t mMaxLODPoseErrorBits = 0;
+
+	// Update rate LOD settings
+	bool             mUseLOD = false;
+	bool             mMeasureLODError = false;
+	AnimationLODDesc mLODDesc;
+	Point3           mLODViewPosition = Point3(0.0f);
+
+	// Per instance data
+	Instance* mInstances = nullptr;
+
+	// Per instance and layer data, index instance * mMaxLayers + layer
+	Clip**                         mClips = nullptr;
+	ClipMask**                     mClipMasks = nullptr;
+	ClipController*                mClipControllers = nullptr;
+	ozz::animation::SamplingCache* mSamplingCaches = nullptr;
+
+	// Stage outputs, mMaxSoaJoints or mMaxJoints elements per instance (and per layer for the sampled locals)
+	SoaTransform* mLayerLocalTrans = nullptr;
+	SoaTransform* mLocalTrans = nullptr;
+	Matrix4*      mModelMats = nullptr;
+	Matrix4*      mSkinningMats = nullptr;
+
+	// Caller provided skinning palette, see SetSkinningOutput
+	Matrix4* mSkinningOutput = nullptr;
+	uint32_t mSkinningOutputStride = 0;
+
+	// Update rate LOD state and the poses interpolated between two samples, only allocated with mEnableLOD
+	AnimationLOD* mLODs = nullptr;
+	Matrix4*      mLODStartMats = nullptr;
+	Matrix4*      mLODTargetMats = nullptr;
+
+	eastl::vector<RigBindPose> mBindPoses;
+
+	AnimationSystemStats mStats = {};
+};
@@ -32,6 +32,7 @@ void Clip::Initialize(const ResourceDirectory resourceDir, const char* fileName,
 void Clip::Destroy()
 {
 	mAnimation.Deallocate();
+	fsUnmapFile(&mAnimationImage);
 }
 
 bool Clip::Sample(ozz::animation::SamplingCache* cacheInput, ozz::Range<SoaTransform>& localTransOutput, float timeRatio)
@@ -52,34 +53,44 @@ bool Clip::Sample(ozz::animation::SamplingCache* cacheInput, ozz::Range<SoaTrans
 
 bool Clip::LoadClip(const ResourceDirectory resourceDir, const char* fileName)
 {
-	FileStream file = {};
-	if (!fsOpenStreamFromPath(resourceDir, fileName, FM_READ_BINARY, &file))
+	MappedFile file = {};
+	if (!fsMapFileFromPath(resourceDir, fileName, &file))
 	{
 		LOGF(eERROR, "Cannot open skeleton file");
 		return false;
 	}
 
-	ssize_t size = fsGetStreamFileSize(&file);
-	void* data = tf_malloc(size);
-	fsReadFromStream(&file, data, (size_t)size);
-	fsCloseStream(&file);
+	// Runtime images are used in place without any allocation, the mapping is kept until Destroy
+	if (ozz::animation::IsRuntimeImage(file.pData, file.mSize))
+	{
+		if (!mAnimation.LoadImage(file.pData, file.mSize))
+		{
+			fsUnmapFile(&file);
+			return false;
+		}
+
+		mAnimationImage = file;
+		return true;
+	}
 
-	// Archive is doing a lot of freads from disk which is slow on some platforms and also generally not good
-	// So we just read the entire file once into a mem stream so the freads from IArchive are actually
-	// only reading from system memory instead of disk or network
+	// Archives are deserialized from the mapped file so the many small reads of IArchive
+	// only read from system memory instead of disk or network
 	FileStream memStream = {};
-	fsOpenStreamFromMemory(data, size, FM_READ, true, &memStream);
+	fsOpenStreamFromMemory(file.pData, file.mSize, FM_READ, false, &memStream);
 
 	ozz::io::IArchive archive(&memStream);
 	if (!archive.TestTag<ozz::animation::Animation>())
 	{
 		LOGF(eERROR, "Archive doesn't contain the expected object type.");
+		fsCloseStream(&memStream);
+		fsUnmapFile(&file);
 		return false;
 	}
 
 	archive >> mAnimation;
 
 	fsCloseStream(&memStream);
+	fsUnmapFile(&file);
 
 	return true;
 }
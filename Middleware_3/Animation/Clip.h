@@ -28,6 +28,7 @@
 #include "../../Common_3/OS/Interfaces/IFileSystem.h"
 
 #include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/animation/runtime/animation.h"
+#include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/animation/runtime/runtime_image.h"
 #include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/animation/runtime/sampling_job.h"
 #include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/base/memory/allocator.h"
 #include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/base/io/archive.h"
@@ -52,9 +53,12 @@ class Clip
 	inline float GetDuration() { return mAnimation.duration(); };
 
 	private:
-	// Load a clip from an ozz animation file
+	// Load a clip from an ozz animation file, either an ozz archive or a runtime image
 	bool LoadClip(const ResourceDirectory resourceDir, const char* fileName);
 
 	// Runtime animation.
 	ozz::animation::Animation mAnimation;
+
+	// Mapped animation file mAnimation points into when it was stored as a runtime image
+	MappedFile mAnimationImage = {};
 };
@@ -52,6 +52,12 @@ void ClipController::Update(float dt)
 	SetTimeRatio(newTime);
 }
 
+float ClipController::GetTimeRatioAfter(float dt) const
+{
+	const float time = mPlay ? mTimeRatio + dt * (mPlaybackSpeed / mDuration) : mTimeRatio;
+	return mLoop ? time - floorf(time) : clamp(time, 0.f, 1.f);
+}
+
 void ClipController::SetTimeRatio(float time)
 {
 	mPreviousTimeRatio = mTimeRatio;
@@ -89,6 +89,9 @@ class ClipController
 	// Returns true if animation has looped during update
 	void Update(float dt);
 
+	// Gets the time ratio an Update of dt would give, without changing any state.
+	float GetTimeRatioAfter(float dt) const;
+
 	// Resets all parameters to their default value.
 	void Reset();
 
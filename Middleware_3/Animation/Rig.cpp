@@ -55,6 +55,7 @@ void Rig::Initialize(const ResourceDirectory resourceDir, const char* fileName)
 void Rig::Destroy()
 {
 	mSkeleton.Deallocate();
+	fsUnmapFile(&mSkeletonImage);
 
 	ozz::memory::Allocator* allocator = ozz::memory::default_allocator();
 	allocator->Deallocate(mJointModelMats);
@@ -64,14 +65,162 @@ void Rig::Destroy()
 	mJointScales.set_capacity(0);
 }
 
+// 4 affine matrices in SoA form: the x, y and z rows of every column hold one joint per lane, the w row is 0 0 0 1
+struct SoaAffineMats
+{
+	Vector4 mCols[4][3];
+};
+
+static inline void LoadSoaAffineMats(const Matrix4* mats, const uint32_t* remaps, uint32_t first, SoaAffineMats& out)
+{
+	const Matrix4& mat0 = mats[remaps ? remaps[first + 0] : first + 0];
+	const Matrix4& mat1 = mats[remaps ? remaps[first + 1] : first + 1];
+	const Matrix4& mat2 = mats[remaps ? remaps[first + 2] : first + 2];
+	const Matrix4& mat3 = mats[remaps ? remaps[first + 3] : first + 3];
+
+	for (int col = 0; col < 4; ++col)
+	{
+		const Vector4 in[4] = { mat0.getCol(col), mat1.getCol(col), mat2.getCol(col), mat3.getCol(col) };
+		Vector4       rows[4];
+		transpose4x3(in, rows);
+		out.mCols[col][0] = rows[0];
+		out.mCols[col][1] = rows[1];
+		out.mCols[col][2] = rows[2];
+	}
+}
+
+static inline void StoreSoaAffineMats(const SoaAffineMats& mats, Matrix4* out)
+{
+	const Vector4 zero = Vector4(0.0f);
+	const Vector4 one = Vector4(1.0f);
+
+	// cols[col][joint]
+	Vector4 cols[4][4];
+	for (int col = 0; col < 4; ++col)
+	{
+		const Vector4 in[4] = { mats.mCols[col][0], mats.mCols[col][1], mats.mCols[col][2], col == 3 ? one : zero };
+		transpose4x4(in, cols[col]);
+	}
+
+	// Whole matrices are written in order, out may be write combined memory
+	for (int joint = 0; joint < 4; ++joint)
+		out[joint] = Matrix4(cols[0][joint], cols[1][joint], cols[2][joint], cols[3][joint]);
+}
+
+// out = a * b, out must not alias a or b
+static inline void MulSoaAffineMats(const SoaAffineMats& a, const SoaAffineMats& b, SoaAffineMats& out)
+{
+	for (int col = 0; col < 4; ++col)
+	{
+		for (int row = 0; row < 3; ++row)
+		{
+			const Vector4 sum = mulPerElem(a.mCols[0][row], b.mCols[col][0]) + mulPerElem(a.mCols[1][row], b.mCols[col][1]) +
+								mulPerElem(a.mCols[2][row], b.mCols[col][2]);
+			// The w row of b is 0 0 0 1
+			out.mCols[col][row] = col == 3 ? sum + a.mCols[3][row] : sum;
+		}
+	}
+}
+
+void Rig::ComputeWorldMats(
+	const Matrix4* pRootTransform, const Matrix4* pModelMats, const uint32_t* pJointRemaps, const Matrix4* pInverseBindMats,
+	uint32_t count, Matrix4* pOutWorldMats, Matrix4* pOutSkinningMats)
+{
+	ASSERT(!pOutSkinningMats || pInverseBindMats);
+	ASSERT(((uintptr_t)pOutWorldMats % alignof(Matrix4)) == 0 && ((uintptr_t)pOutSkinningMats % alignof(Matrix4)) == 0);
+
+	if (!pOutSkinningMats)
+		pInverseBindMats = nullptr;
+
+	// Root transform broadcast to all lanes
+	SoaAffineMats root;
+	if (pRootTransform)
+	{
+		for (int col = 0; col < 4; ++col)
+		{
+			for (int row = 0; row < 3; ++row)
+				root.mCols[col][row] = Vector4((float)pRootTransform->getElem(col, row));
+		}
+	}
+
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		SoaAffineMats model, world;
+		if (pRootTransform)
+		{
+			LoadSoaAffineMats(pModelMats, pJointRemaps, i, model);
+			MulSoaAffineMats(root, model, world);
+		}
+		else
+		{
+			LoadSoaAffineMats(pModelMats, pJointRemaps, i, world);
+		}
+
+		if (pOutWorldMats)
+			StoreSoaAffineMats(world, pOutWorldMats + i);
+
+		if (pInverseBindMats)
+		{
+			SoaAffineMats inverseBind, skinning;
+			LoadSoaAffineMats(pInverseBindMats, nullptr, i, inverseBind);
+			MulSoaAffineMats(world, inverseBind, skinning);
+			StoreSoaAffineMats(skinning, pOutSkinningMats + i);
+		}
+	}
+
+	// Remaining joints
+	for (; i < count; ++i)
+	{
+		const Matrix4& model = pModelMats[pJointRemaps ? pJointRemaps[i] : i];
+		const Matrix4  world = pRootTransform ? *pRootTransform * model : model;
+
+		if (pOutWorldMats)
+			pOutWorldMats[i] = world;
+
+		if (pInverseBindMats)
+			pOutSkinningMats[i] = world * pInverseBindMats[i];
+	}
+}
+
 void Rig::Pose(const Matrix4& rootTransform)
 {
 	// Set the world matrix of each joint
-	for (unsigned int jointIndex = 0; jointIndex < mNumJoints; jointIndex++)
+	ComputeWorldMats(&rootTransform, mJointModelMats.begin, nullptr, nullptr, mNumJoints, mJointWorldMats.data(), nullptr);
+
+	UpdateBones(rootTransform);
+}
+
+void Rig::Pose(
+	const Matrix4& rootTransform, const Matrix4* pInverseBindMats, const uint32_t* pJointRemaps, uint32_t numSkinningMats,
+	Matrix4* pOutSkinningMats)
+{
+	if (!pJointRemaps && numSkinningMats <= mNumJoints)
+	{
+		// Palette entries match the joints, world and skinning matrices are computed in the same pass
+		ComputeWorldMats(
+			&rootTransform, mJointModelMats.begin, nullptr, pInverseBindMats, numSkinningMats, mJointWorldMats.data(), pOutSkinningMats);
+		ComputeWorldMats(
+			&rootTransform, mJointModelMats.begin + numSkinningMats, nullptr, nullptr, mNumJoints - numSkinningMats,
+			mJointWorldMats.data() + numSkinningMats, nullptr);
+	}
+	else
 	{
-		mJointWorldMats[jointIndex] = rootTransform * mJointModelMats[jointIndex];
+		ComputeWorldMats(&rootTransform, mJointModelMats.begin, nullptr, nullptr, mNumJoints, mJointWorldMats.data(), nullptr);
+		WriteSkinningMats(pInverseBindMats, pJointRemaps, numSkinningMats, pOutSkinningMats);
 	}
 
+	UpdateBones(rootTransform);
+}
+
+void Rig::WriteSkinningMats(
+	const Matrix4* pInverseBindMats, const uint32_t* pJointRemaps, uint32_t numSkinningMats, Matrix4* pOutSkinningMats)
+{
+	ComputeWorldMats(nullptr, mJointWorldMats.data(), pJointRemaps, pInverseBindMats, numSkinningMats, nullptr, pOutSkinningMats);
+}
+
+void Rig::UpdateBones(const Matrix4& rootTransform)
+{
 	// If we wish to update the world matricies of the bones and the scales of the joints
 	// based on the distance between each joint
 	if (mUpdateBones)
@@ -135,34 +284,44 @@ void Rig::Pose(const Matrix4& rootTransform)
 
 bool Rig::LoadSkeleton(const ResourceDirectory resourceDir, const char* fileName)
 {
-	FileStream file = {};
-	if (!fsOpenStreamFromPath(resourceDir, fileName, FM_READ_BINARY, &file))
+	MappedFile file = {};
+	if (!fsMapFileFromPath(resourceDir, fileName, &file))
 	{
 		LOGF(eERROR, "Cannot open skeleton file");
 		return false;
 	}
 
-	ssize_t size = fsGetStreamFileSize(&file);
-	void* data = tf_malloc(size);
-	fsReadFromStream(&file, data, (size_t)size);
-	fsCloseStream(&file);
+	// Runtime images are used in place without any allocation, the mapping is kept until Destroy
+	if (ozz::animation::IsRuntimeImage(file.pData, file.mSize))
+	{
+		if (!mSkeleton.LoadImage(file.pData, file.mSize))
+		{
+			fsUnmapFile(&file);
+			return false;
+		}
+
+		mSkeletonImage = file;
+		return true;
+	}
 
-	// Archive is doing a lot of freads from disk which is slow on some platforms and also generally not good
-	// So we just read the entire file once into a mem stream so the freads from IArchive are actually
-	// only reading from system memory instead of disk or network
+	// Archives are deserialized from the mapped file so the many small reads of IArchive
+	// only read from system memory instead of disk or network
 	FileStream memStream = {};
-	fsOpenStreamFromMemory(data, size, FM_READ, true, &memStream);
+	fsOpenStreamFromMemory(file.pData, file.mSize, FM_READ, false, &memStream);
 
 	ozz::io::IArchive archive(&memStream);
 	if (!archive.TestTag<ozz::animation::Skeleton>())
 	{
 		LOGF(eERROR, "Skeleton Archive doesn't contain the expected object type");
+		fsCloseStream(&memStream);
+		fsUnmapFile(&file);
 		return false;
 	}
 
 	archive >> mSkeleton;
 
 	fsCloseStream(&memStream);
+	fsUnmapFile(&file);
 
 	return true;
 }
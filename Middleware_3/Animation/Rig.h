@@ -25,11 +25,13 @@
 #pragma once
 
 #include "../../Common_3/OS/Math/MathTypes.h"
+#include "../../Common_3/OS/Interfaces/IFileSystem.h"
 
 #include "../../Common_3/ThirdParty/OpenSource/EASTL/vector.h"
 
 #include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/animation/runtime/skeleton.h"
 #include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/animation/runtime/skeleton_utils.h"
+#include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/animation/runtime/runtime_image.h"
 
 #include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/base/io/archive.h"
 #include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/base/memory/allocator.h"
@@ -55,6 +57,25 @@ class Rig
 	// Updates the skeleton's joint and bone world matricies based on mJointModelMats
 	void Pose(const Matrix4& rootTransform);
 
+	// Same as Pose, also writes the skinning palette (world * inverse bind) of numSkinningMats joints
+	// to pOutSkinningMats, which can be the mapped address of a persistently mapped buffer.
+	// Palette entry i uses joint pJointRemaps[i], or joint i when pJointRemaps is null
+	void Pose(
+		const Matrix4& rootTransform, const Matrix4* pInverseBindMats, const uint32_t* pJointRemaps, uint32_t numSkinningMats,
+		Matrix4* pOutSkinningMats);
+
+	// Writes the skinning palette of the last pose to pOutSkinningMats, see Pose
+	void WriteSkinningMats(
+		const Matrix4* pInverseBindMats, const uint32_t* pJointRemaps, uint32_t numSkinningMats, Matrix4* pOutSkinningMats);
+
+	// Batched SIMD version of pOutWorldMats[i] = root * modelMats[j] and pOutSkinningMats[i] = pOutWorldMats[i] * pInverseBindMats[i]
+	// with j = pJointRemaps ? pJointRemaps[i] : i, 4 joints per iteration.
+	// Null pRootTransform is identity, null pInverseBindMats or output pointers skip the corresponding output.
+	// All matrices must be affine (last row 0 0 0 1), outputs must be aligned like Matrix4 and are written without being read
+	static void ComputeWorldMats(
+		const Matrix4* pRootTransform, const Matrix4* pModelMats, const uint32_t* pJointRemaps, const Matrix4* pInverseBindMats,
+		uint32_t count, Matrix4* pOutWorldMats, Matrix4* pOutSkinningMats);
+
 	// Set the color of the joints
 	inline void SetJointColor(const Vector4& color) { mJointColor = color; };
 
@@ -142,12 +163,18 @@ class Rig
 	void FindJointChain(const char* jointNames[], size_t numNames, int jointChain[]);
 
 	private:
-	// Load a runtime skeleton from a skeleton.ozz file
+	// Updates the bone world matrices and joint scales from mJointModelMats, when enabled with SetUpdateBones
+	void UpdateBones(const Matrix4& rootTransform);
+
+	// Load a runtime skeleton from a skeleton.ozz file, either an ozz archive or a runtime image
 	bool LoadSkeleton(const ResourceDirectory resourceDir, const char* fileName);
 
 	// Runtime skeleton.
 	ozz::animation::Skeleton mSkeleton;
 
+	// Mapped skeleton.ozz file mSkeleton points into when it was stored as a runtime image
+	MappedFile mSkeletonImage = {};
+
 	// The number of soa elements matching the number of joints of the
 	// skeleton. This value is useful to allocate SoA runtime data structures.
 	unsigned int mNumSoaJoints;
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+#include "SamplingCachePool.h"
+
+#include "../../Common_3/OS/Interfaces/IMemory.h"
+
+// Bucket sizes are multiples of this many soa joints (8 joints)
+static const uint32_t kBucketSoaJointGranularity = 2;
+
+// Size of the buffer a SamplingCache allocates for its soa tracks, mirrors SamplingCache::SamplingCache
+static uint64_t GetCacheBufferSize(uint32_t numSoaJoints)
+{
+	// Two keyframes of InterpSoaTranslation, InterpSoaRotation and InterpSoaScale: ratio + value
+	const uint64_t interpSize = 2 * sizeof(Vector4) * 3 + 2 * sizeof(SoaFloat3) * 2 + 2 * sizeof(SoaQuaternion);
+	const uint64_t keysSize = sizeof(int) * numSoaJoints * 4 * 2 * 3;
+	const uint64_t outdatedSize = 3 * ((numSoaJoints + 7) / 8);
+	return interpSize * numSoaJoints + keysSize + outdatedSize;
+}
+
+// Memory of one lease with its cache and local transforms
+static uint64_t GetLeaseSize(uint32_t numSoaJoints)
+{
+	return sizeof(SamplingCacheLease) + GetCacheBufferSize(numSoaJoints) + sizeof(SoaTransform) * numSoaJoints;
+}
+
+// Leases are at the start of a block, the local transforms follow them
+static size_t GetBlockLeasesSize(uint32_t leasesPerBlock)
+{
+	const size_t size = sizeof(SamplingCacheLease) * leasesPerBlock;
+	return (size + alignof(SoaTransform) - 1) / alignof(SoaTransform) * alignof(SoaTransform);
+}
+
+void SamplingCachePool::Initialize(uint32_t leasesPerBlock)
+{
+	mLeasesPerBlock = max(1U, leasesPerBlock);
+	mMutex.Init();
+}
+
+void SamplingCachePool::Destroy()
+{
+	if (mNumLeases)
+		LOGF(eWARNING, "SamplingCachePool destroyed with %u leases still in use", mNumLeases);
+
+	for (Bucket& bucket : mBuckets)
+	{
+		const size_t numBlocks = bucket.mBlocks.size();
+		for (size_t block = 0; block < numBlocks; ++block)
+		{
+			// Only the last block can be partially constructed
+			const uint32_t numConstructed =
+				block + 1 < numBlocks ? mLeasesPerBlock : bucket.mNumConstructed - (uint32_t)block * mLeasesPerBlock;
+			SamplingCacheLease* leases = (SamplingCacheLease*)bucket.mBlocks[block];
+			for (uint32_t i = 0; i < numConstructed; ++i)
+			{
+				leases[i].mSampleMutex.Destroy();
+				leases[i].~SamplingCacheLease();
+			}
+			tf_free(bucket.mBlocks[block]);
+		}
+	}
+
+	mBuckets.set_capacity(0);
+	mSharedLeases.set_capacity(0);
+	mMutex.Destroy();
+
+	mNumLeases = 0;
+	mNumUsedCaches = 0;
+	mNumFreeCaches = 0;
+	mAllocatedBytes = 0;
+	mUsedBytes = 0;
+}
+
+uint32_t SamplingCachePool::GetBucket(uint32_t numSoaJoints)
+{
+	const uint32_t bucketSoaJoints =
+		(numSoaJoints + kBucketSoaJointGranularity - 1) / kBucketSoaJointGranularity * kBucketSoaJointGranularity;
+
+	for (uint32_t i = 0; i < (uint32_t)mBuckets.size(); ++i)
+	{
+		if (mBuckets[i].mNumSoaJoints == bucketSoaJoints)
+			return i;
+	}
+
+	Bucket bucket = {};
+	bucket.mNumSoaJoints = bucketSoaJoints;
+	mBuckets.push_back(bucket);
+	return (uint32_t)mBuckets.size() - 1;
+}
+
+SamplingCacheLease* SamplingCachePool::Acquire(uint32_t numJoints, const Clip* clip, uint32_t lockstepGroup)
+{
+	const uint32_t numSoaJoints = (numJoints + 3) / 4;
+
+	MutexLock lock(mMutex);
+
+	if (lockstepGroup)
+	{
+		for (SamplingCacheLease* lease : mSharedLeases)
+		{
+			if (lease->pClip == clip && lease->mLockstepGroup == lockstepGroup && lease->mLocalTrans.count() >= numSoaJoints)
+			{
+				++lease->mRefCount;
+				++mNumLeases;
+				return lease;
+			}
+		}
+	}
+
+	const uint32_t bucketIndex = GetBucket(numSoaJoints);
+	Bucket&        bucket = mBuckets[bucketIndex];
+
+	SamplingCacheLease* lease = bucket.pFreeList;
+	if (lease)
+	{
+		bucket.pFreeList = lease->pNextFree;
+		lease->pNextFree = nullptr;
+		// Cursors of the previous user are meaningless for the new one
+		lease->mCache.Invalidate();
+		--mNumFreeCaches;
+	}
+	else
+	{
+		const uint32_t indexInBlock = bucket.mNumConstructed % mLeasesPerBlock;
+		if (indexInBlock == 0)
+		{
+			const size_t blockSize = GetBlockLeasesSize(mLeasesPerBlock) + sizeof(SoaTransform) * bucket.mNumSoaJoints * mLeasesPerBlock;
+			void*        block = tf_memalign(max(alignof(SamplingCacheLease), alignof(SoaTransform)), blockSize);
+			if (!block)
+			{
+				LOGF(eERROR, "Failed to allocate a SamplingCachePool block of %llu bytes", (unsigned long long)blockSize);
+				return nullptr;
+			}
+
+			bucket.mBlocks.push_back(block);
+			mAllocatedBytes += blockSize;
+		}
+
+		uint8_t*      block = (uint8_t*)bucket.mBlocks.back();
+		SoaTransform* localTrans =
+			(SoaTransform*)(block + GetBlockLeasesSize(mLeasesPerBlock)) + (size_t)indexInBlock * bucket.mNumSoaJoints;
+
+		lease = tf_placement_new<SamplingCacheLease>((SamplingCacheLease*)block + indexInBlock, bucket.mNumSoaJoints * 4);
+		lease->mLocalTrans = ozz::Range<SoaTransform>(localTrans, bucket.mNumSoaJoints);
+		lease->mBucket = bucketIndex;
+		lease->mSampleMutex.Init();
+		++bucket.mNumConstructed;
+		mAllocatedBytes += sizeof(ozz::animation::SamplingCache) + GetCacheBufferSize(bucket.mNumSoaJoints);
+	}
+
+	lease->pClip = lockstepGroup ? clip : nullptr;
+	lease->mLockstepGroup = lockstepGroup;
+	lease->mRefCount = 1;
+	lease->mSampledTimeRatio = -1.0f;
+	lease->mNumReaders = 0;
+	if (lockstepGroup)
+		mSharedLeases.push_back(lease);
+
+	++mNumLeases;
+	++mNumUsedCaches;
+	mUsedBytes += GetLeaseSize(bucket.mNumSoaJoints);
+	return lease;
+}
+
+void SamplingCachePool::Release(SamplingCacheLease* pLease)
+{
+	if (!pLease)
+		return;
+
+	MutexLock lock(mMutex);
+
+	--mNumLeases;
+	if (--pLease->mRefCount)
+		return;
+
+	if (pLease->mLockstepGroup)
+	{
+		SamplingCacheLease** shared = eastl::find(mSharedLeases.begin(), mSharedLeases.end(), pLease);
+		if (shared != mSharedLeases.end())
+			mSharedLeases.erase_unsorted(shared);
+	}
+
+	Bucket& bucket = mBuckets[pLease->mBucket];
+	pLease->pNextFree = bucket.pFreeList;
+	bucket.pFreeList = pLease;
+	--mNumUsedCaches;
+	++mNumFreeCaches;
+	mUsedBytes -= GetLeaseSize(bucket.mNumSoaJoints);
+}
+
+bool SamplingCachePool::Sample(
+	SamplingCacheLease* pLease, Clip* clip, float timeRatio, ozz::Range<SoaTransform>* pMissLocalTrans,
+	ozz::Range<SoaTransform>* pOutLocalTrans)
+{
+	*pOutLocalTrans = pLease->mLocalTrans;
+	if (!pLease->mLockstepGroup)
+		return clip->Sample(&pLease->mCache, pLease->mLocalTrans, timeRatio);
+
+	// All users of a shared lease sample the same time ratio, the first one does the work
+	MutexLock lock(pLease->mSampleMutex);
+	if (pLease->mSampledTimeRatio == timeRatio)
+	{
+		tfrg_atomic32_add_relaxed(&mNumSharedSamples, 1);
+		++pLease->mNumReaders;
+		return true;
+	}
+
+	if (!pLease->mNumReaders)
+	{
+		if (!clip->Sample(&pLease->mCache, pLease->mLocalTrans, timeRatio))
+		{
+			pLease->mSampledTimeRatio = -1.0f;
+			return false;
+		}
+
+		pLease->mSampledTimeRatio = timeRatio;
+		++pLease->mNumReaders;
+		return true;
+	}
+
+	// Other users are still blending mLocalTrans, the late one gets its own pose
+	tfrg_atomic32_add_relaxed(&mNumLockstepMisses, 1);
+	if (!pMissLocalTrans->begin)
+	{
+		*pMissLocalTrans = ozz::memory::default_allocator()->AllocateRange<SoaTransform>(pLease->mLocalTrans.count());
+		if (!pMissLocalTrans->begin)
+			return false;
+	}
+
+	*pOutLocalTrans = *pMissLocalTrans;
+	return clip->Sample(&pLease->mCache, *pMissLocalTrans, timeRatio);
+}
+
+void SamplingCachePool::EndSample(SamplingCacheLease* pLease)
+{
+	MutexLock lock(pLease->mSampleMutex);
+	ASSERT(pLease->mNumReaders);
+	--pLease->mNumReaders;
+}
+
+SamplingCachePoolStats SamplingCachePool::GetStats()
+{
+	MutexLock lock(mMutex);
+
+	SamplingCachePoolStats stats = {};
+	stats.mNumLeases = mNumLeases;
+	stats.mNumUsedCaches = mNumUsedCaches;
+	stats.mNumFreeCaches = mNumFreeCaches;
+	stats.mNumSharedSamples = tfrg_atomic32_load_relaxed(&mNumSharedSamples);
+	stats.mNumLockstepMisses = tfrg_atomic32_load_relaxed(&mNumLockstepMisses);
+	stats.mAllocatedBytes = mAllocatedBytes;
+	stats.mUsedBytes = mUsedBytes;
+	return stats;
+}
+
+uint64_t SamplingCachePool::GetUnpooledSize(uint32_t numJoints)
+{
+	const uint32_t numSoaJoints = (numJoints + 3) / 4;
+	return sizeof(ozz::animation::SamplingCache) + GetCacheBufferSize(numSoaJoints) + sizeof(SoaTransform) * numSoaJoints;
+}
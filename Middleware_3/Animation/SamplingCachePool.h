@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+#pragma once
+
+#include "../../Common_3/OS/Math/MathTypes.h"
+#include "../../Common_3/OS/Core/Atomics.h"
+#include "../../Common_3/OS/Interfaces/IThread.h"
+
+#include "../../Common_3/ThirdParty/OpenSource/EASTL/vector.h"
+
+#include "../../Common_3/ThirdParty/OpenSource/ozz-animation/include/ozz/animation/runtime/sampling_job.h"
+
+#include "Clip.h"
+
+// Sampling cache and local transform buffer of one clip layer, leased from a SamplingCachePool
+struct SamplingCacheLease
+{
+	SamplingCacheLease(uint32_t maxJoints): mCache((int)maxJoints) {}
+
+	ozz::animation::SamplingCache mCache;
+	// Bucket sized, at least as many soa joints as requested
+	ozz::Range<SoaTransform> mLocalTrans;
+
+	// Set for leases shared by instances playing mClip in lockstep
+	const Clip* pClip = nullptr;
+	uint32_t    mLockstepGroup = 0;
+	uint32_t    mRefCount = 0;
+	uint32_t    mBucket = 0;
+	// Time ratio mLocalTrans was last sampled at and users still blending it, only used by shared leases
+	float    mSampledTimeRatio = -1.0f;
+	uint32_t mNumReaders = 0;
+	Mutex    mSampleMutex;
+
+	SamplingCacheLease* pNextFree = nullptr;
+};
+
+struct SamplingCachePoolStats
+{
+	// Leases handed out, each shared lease counts once per user
+	uint32_t mNumLeases;
+	// Distinct caches in use and caches waiting in the free lists
+	uint32_t mNumUsedCaches;
+	uint32_t mNumFreeCaches;
+	// Samples of shared leases that were reused by another instance of the lockstep group
+	uint32_t mNumSharedSamples;
+	// Shared leases sampled at another time ratio while the group was blending them, the instances of the group
+	// are not in lockstep and the late one sampled into its own buffer
+	uint32_t mNumLockstepMisses;
+	// Memory of all blocks and of the caches constructed in them
+	uint64_t mAllocatedBytes;
+	// Part of mAllocatedBytes used by the leases in use
+	uint64_t mUsedBytes;
+};
+
+// Leases sampling caches and local transform buffers to Animations.
+// Leases are bucketed by joint count and carved from blocks of mLeasesPerBlock
+// leases, so released leases are reused by any rig of a similar size and the
+// working set of a crowd stays in few contiguous allocations.
+// Instances playing the same clip in lockstep can share a single lease, the
+// clip is then only sampled once per time ratio for the whole group.
+class SamplingCachePool
+{
+	public:
+	void Initialize(uint32_t leasesPerBlock = 64);
+
+	// Must be called to clean up if the pool was initialized, all leases must have been released
+	void Destroy();
+
+	// Leases a cache for rigs of numJoints joints. When lockstepGroup is not 0 the lease is shared with all other
+	// leases of the same clip and group, these must be sampled at the same time ratio on every update
+	SamplingCacheLease* Acquire(uint32_t numJoints, const Clip* clip, uint32_t lockstepGroup);
+
+	void Release(SamplingCacheLease* pLease);
+
+	// Samples clip into pLease->mLocalTrans and returns the sampled pose in pOutLocalTrans.
+	// Shared leases are only sampled by the first user of a time ratio, every user then reads mLocalTrans until it
+	// calls EndSample. A user at another time ratio while others still read it samples into *pMissLocalTrans
+	// instead, allocated with the ozz default allocator on the first miss and deallocated by the caller
+	bool Sample(
+		SamplingCacheLease* pLease, Clip* clip, float timeRatio, ozz::Range<SoaTransform>* pMissLocalTrans,
+		ozz::Range<SoaTransform>* pOutLocalTrans);
+
+	// Ends the read of pLease->mLocalTrans started by Sample, once the pose was blended
+	void EndSample(SamplingCacheLease* pLease);
+
+	SamplingCachePoolStats GetStats();
+
+	// Memory used by a sampling cache and local transforms of numJoints joints allocated on their own
+	static uint64_t GetUnpooledSize(uint32_t numJoints);
+
+	private:
+	struct Bucket
+	{
+		uint32_t            mNumSoaJoints;
+		uint32_t            mNumConstructed;
+		SamplingCacheLease* pFreeList;
+		// Leases first, followed by the local transforms of every lease
+		eastl::vector<void*> mBlocks;
+	};
+
+	uint32_t GetBucket(uint32_t numSoaJoints);
+
+	uint32_t mLeasesPerBlock = 0;
+
+	eastl::vector<Bucket>              mBuckets;
+	eastl::vector<SamplingCacheLease*> mSharedLeases;
+	Mutex                              mMutex;
+
+	uint32_t mNumLeases = 0;
+	uint32_t mNumUsedCaches = 0;
+	uint32_t mNumFreeCaches = 0;
+	uint64_t mAllocatedBytes = 0;
+	uint64_t mUsedBytes = 0;
+
+	tfrg_atomic32_t mNumSharedSamples = 0;
+	tfrg_atomic32_t mNumLockstepMisses = 0;
+};
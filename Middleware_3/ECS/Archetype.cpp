@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+
+#include "Archetype.h"
+
+#include "../../Common_3/OS/Interfaces/IMemory.h"    // Must be the last include in a cpp file
+
+static inline uint32_t alignOffset(uint32_t offset, uint32_t alignment) { return (offset + alignment - 1) & ~(alignment - 1); }
+
+// Size of the chunk data when every column holds capacity components
+static uint32_t getChunkLayout(const eastl::vector<const ComponentTypeInfo*>& types, uint32_t capacity, uint32_t* pColumnOffsets)
+{
+	uint32_t offset = capacity * (uint32_t)sizeof(EntityId);
+	for (uint32_t i = 0; i < (uint32_t)types.size(); ++i)
+	{
+		offset = alignOffset(offset, types[i]->mAlignment);
+		if (pColumnOffsets)
+			pColumnOffsets[i] = offset;
+		offset += capacity * types[i]->mSize;
+	}
+	return offset;
+}
+
+Archetype::Archetype(const ComponentTypeInfo* const* ppTypes, uint32_t typeCount):
+	mTypes(ppTypes, ppTypes + typeCount),
+	mColumnOffsets(typeCount),
+	mChunkCapacity(0),
+	mChunkDataSize(0),
+	mCount(0)
+{
+	uint32_t rowSize = (uint32_t)sizeof(EntityId);
+	for (uint32_t i = 0; i < typeCount; ++i)
+	{
+		ASSERT(i == 0 || ppTypes[i - 1]->mType < ppTypes[i]->mType);
+		ASSERT(ppTypes[i]->mAlignment <= ARCHETYPE_CHUNK_ALIGNMENT);
+		rowSize += ppTypes[i]->mSize;
+	}
+
+	// Fit as many rows as possible, alignment padding between the arrays can take a few rows away
+	mChunkCapacity = max(1u, (uint32_t)ARCHETYPE_CHUNK_SIZE / rowSize);
+	while (mChunkCapacity > 1 && getChunkLayout(mTypes, mChunkCapacity, NULL) > ARCHETYPE_CHUNK_SIZE)
+		--mChunkCapacity;
+
+	mChunkDataSize = getChunkLayout(mTypes, mChunkCapacity, mColumnOffsets.data());
+}
+
+Archetype::~Archetype()
+{
+	while (mCount)
+		removeRow(mCount - 1);
+}
+
+int32_t Archetype::findColumn(uint32_t type) const
+{
+	for (uint32_t i = 0; i < (uint32_t)mTypes.size(); ++i)
+	{
+		if (mTypes[i]->mType == type)
+			return (int32_t)i;
+	}
+	return -1;
+}
+
+bool Archetype::hasAllComponents(const uint32_t* pTypes, uint32_t typeCount) const
+{
+	for (uint32_t i = 0; i < typeCount; ++i)
+	{
+		if (!hasComponent(pTypes[i]))
+			return false;
+	}
+	return true;
+}
+
+bool Archetype::hasAnyComponent(const uint32_t* pTypes, uint32_t typeCount) const
+{
+	for (uint32_t i = 0; i < typeCount; ++i)
+	{
+		if (hasComponent(pTypes[i]))
+			return true;
+	}
+	return false;
+}
+
+bool Archetype::matches(const ComponentTypeInfo* const* ppTypes, uint32_t typeCount) const
+{
+	if (typeCount != (uint32_t)mTypes.size())
+		return false;
+
+	for (uint32_t i = 0; i < typeCount; ++i)
+	{
+		if (mTypes[i]->mType != ppTypes[i]->mType)
+			return false;
+	}
+	return true;
+}
+
+uint32_t Archetype::allocateRow(EntityId id)
+{
+	if (mCount == (uint32_t)mChunks.size() * mChunkCapacity)
+	{
+		// Chunk header and data in one allocation, the data starts on its own cache line
+		const uint32_t headerSize = alignOffset((uint32_t)sizeof(ArchetypeChunk), ARCHETYPE_CHUNK_ALIGNMENT);
+		ArchetypeChunk* pChunk = (ArchetypeChunk*)tf_memalign(ARCHETYPE_CHUNK_ALIGNMENT, headerSize + mChunkDataSize);
+		pChunk->pArchetype = this;
+		pChunk->pData = (uint8_t*)pChunk + headerSize;
+		pChunk->mCount = 0;
+		mChunks.push_back(pChunk);
+	}
+
+	const uint32_t row = mCount++;
+	ArchetypeChunk* pChunk = mChunks[row / mChunkCapacity];
+	pChunk->getEntityIds()[pChunk->mCount++] = id;
+	return row;
+}
+
+uint32_t Archetype::addRow(EntityId id)
+{
+	const uint32_t row = allocateRow(id);
+	for (uint32_t i = 0; i < (uint32_t)mTypes.size(); ++i)
+		mTypes[i]->pConstruct(getComponent(i, row));
+
+	return row;
+}
+
+EntityId Archetype::removeRow(uint32_t row)
+{
+	ASSERT(row < mCount);
+
+	const uint32_t  last = mCount - 1;
+	ArchetypeChunk* pLastChunk = mChunks[last / mChunkCapacity];
+
+	EntityId movedId = 0;
+	for (uint32_t i = 0; i < (uint32_t)mTypes.size(); ++i)
+	{
+		void* pComponent = getComponent(i, row);
+		mTypes[i]->pDestroy(pComponent);
+		if (row != last)
+		{
+			void* pLastComponent = getComponent(i, last);
+			mTypes[i]->pCopy(pComponent, pLastComponent);
+			mTypes[i]->pDestroy(pLastComponent);
+		}
+	}
+
+	if (row != last)
+	{
+		movedId = getEntityId(last);
+		mChunks[row / mChunkCapacity]->getEntityIds()[row % mChunkCapacity] = movedId;
+	}
+
+	--mCount;
+	if (--pLastChunk->mCount == 0)
+	{
+		tf_free(pLastChunk);
+		mChunks.pop_back();
+	}
+
+	return movedId;
+}
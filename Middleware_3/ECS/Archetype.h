@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+
+#pragma once
+
+#include "../../Common_3/OS/Interfaces/IOperatingSystem.h"
+#include "../../Common_3/OS/Interfaces/ILog.h"
+
+#include "../../Common_3/ThirdParty/OpenSource/EASTL/vector.h"
+
+#include "BaseComponent.h"
+
+// Generational entity handle, the low ENTITY_INDEX_BITS are the slot index of the entity in the EntityManager and
+// the high bits the generation of that slot, which changes every time the slot is reused so stale ids can be detected.
+// Index 0 is reserved for the scene root, so no valid entity has id 0
+typedef uint32_t EntityId;
+
+#define ENTITY_INDEX_BITS 22
+#define ENTITY_GENERATION_BITS (32 - ENTITY_INDEX_BITS)
+#define ENTITY_MAX_COUNT (1u << ENTITY_INDEX_BITS)
+#define ENTITY_INDEX_MASK (ENTITY_MAX_COUNT - 1)
+#define ENTITY_GENERATION_MASK ((1u << ENTITY_GENERATION_BITS) - 1)
+
+inline uint32_t getEntityIndex(EntityId id) { return id & ENTITY_INDEX_MASK; }
+inline uint32_t getEntityGeneration(EntityId id) { return id >> ENTITY_INDEX_BITS; }
+inline EntityId makeEntityId(uint32_t index, uint32_t generation) { return (generation << ENTITY_INDEX_BITS) | index; }
+
+// Archetype rows are stored in chunks of this size, archetypes with larger rows get chunks of a single row
+#define ARCHETYPE_CHUNK_SIZE (16 * 1024)
+#define ARCHETYPE_CHUNK_ALIGNMENT 64
+#define ARCHETYPE_MAX_COMPONENTS 32
+
+class Archetype;
+
+// Block of rows of one archetype.
+// Every component type of the archetype has its own contiguous array in the chunk,
+// row i of the chunk is made of element i of every array.
+struct ArchetypeChunk
+{
+	Archetype* pArchetype;
+	uint8_t*   pData;
+	uint32_t   mCount;
+
+	// Ids of the entities stored in the chunk, one per row
+	inline EntityId* getEntityIds() const { return (EntityId*)pData; }
+
+	// Array of the mCount components of type T, NULL if the archetype has no T
+	template <typename T> T* getArray() const;
+};
+
+// Storage of all entities that have the same set of components.
+// Rows are numbered across chunks and kept dense, removing a row moves the last row into its place.
+class Archetype
+{
+public:
+	// ppTypes must be sorted by mType and must not contain duplicates
+	Archetype(const ComponentTypeInfo* const* ppTypes, uint32_t typeCount);
+	~Archetype();
+
+	inline uint32_t getTypeCount() const { return (uint32_t)mTypes.size(); }
+	inline const ComponentTypeInfo* getTypeInfo(uint32_t column) const { return mTypes[column]; }
+
+	// Column of the component type in this archetype, -1 if the archetype has no such component
+	int32_t findColumn(uint32_t type) const;
+	inline bool hasComponent(uint32_t type) const { return findColumn(type) >= 0; }
+	bool hasAllComponents(const uint32_t* pTypes, uint32_t typeCount) const;
+	bool hasAnyComponent(const uint32_t* pTypes, uint32_t typeCount) const;
+
+	// True if this archetype stores exactly the sorted types ppTypes
+	bool matches(const ComponentTypeInfo* const* ppTypes, uint32_t typeCount) const;
+
+	inline uint32_t getCount() const { return mCount; }
+	inline uint32_t getChunkCapacity() const { return mChunkCapacity; }
+	inline uint32_t getChunkCount() const { return (uint32_t)mChunks.size(); }
+	inline ArchetypeChunk* getChunk(uint32_t index) const { return mChunks[index]; }
+
+	inline void* getColumn(const ArchetypeChunk* pChunk, uint32_t column) const { return pChunk->pData + mColumnOffsets[column]; }
+
+	inline void* getComponent(uint32_t column, uint32_t row) const
+	{
+		const ArchetypeChunk* pChunk = mChunks[row / mChunkCapacity];
+		return (uint8_t*)getColumn(pChunk, column) + (row % mChunkCapacity) * mTypes[column]->mSize;
+	}
+
+	inline EntityId getEntityId(uint32_t row) const { return mChunks[row / mChunkCapacity]->getEntityIds()[row % mChunkCapacity]; }
+
+	// Appends a row for entity id and returns it, the components of the row are left unconstructed
+	uint32_t allocateRow(EntityId id);
+
+	// Appends a row for entity id with default constructed components and returns it
+	uint32_t addRow(EntityId id);
+
+	// Destroys the components of row and moves the last row into it.
+	// Returns the id of the entity that now lives in row, 0 if row was the last one
+	EntityId removeRow(uint32_t row);
+
+private:
+	eastl::vector<const ComponentTypeInfo*> mTypes;
+	// Offset of every component array in the chunk data, the entity ids are stored first
+	eastl::vector<uint32_t>                 mColumnOffsets;
+	eastl::vector<ArchetypeChunk*>          mChunks;
+
+	uint32_t mChunkCapacity;
+	uint32_t mChunkDataSize;
+	uint32_t mCount;
+};
+
+template <typename T>
+T* ArchetypeChunk::getArray() const
+{
+	const int32_t column = pArchetype->findColumn(T::getTypeStatic());
+	return column >= 0 ? (T*)pArchetype->getColumn(this, (uint32_t)column) : NULL;
+}
@@ -53,6 +53,18 @@ class BaseComponent;
 
 typedef BaseComponent* (*ComponentGeneratorFctPtr)();
 
+// Layout of a component type and how to construct it in place, used to store components in archetype chunks.
+// Generated for every component by FORGE_IMPLEMENT_COMPONENT
+struct ComponentTypeInfo
+{
+	uint32_t mType;
+	uint32_t mSize;
+	uint32_t mAlignment;
+	void (*pConstruct)(void* pDst);
+	void (*pCopy)(void* pDst, const void* pSrc);
+	void (*pDestroy)(void* pComponent);
+};
+
 class ComponentRegistrator
 {// singleton
 	friend class BaseComponent;
@@ -76,6 +88,7 @@ public:
 	virtual ~BaseComponent() {}
 	virtual BaseComponent* clone() const = 0;
 	virtual uint32_t getType() const = 0;
+	virtual const ComponentTypeInfo* getTypeInfo() const = 0;
 	virtual FCR::ComponentRepresentation* createRepresentation() = 0;
 	virtual void destroyRepresentation(FCR::ComponentRepresentation* pRep) = 0;
 
@@ -88,7 +101,9 @@ public:
 		virtual FCR::ComponentRepresentation* createRepresentation() override; \
 		virtual void destroyRepresentation(FCR::ComponentRepresentation* pRep) override; \
 		virtual uint32_t getType() const override; \
+		virtual const ComponentTypeInfo* getTypeInfo() const override; \
 		static uint32_t getTypeStatic(); \
+		static const ComponentTypeInfo* getTypeInfoStatic(); \
 		static BaseComponent* GenerateComponent(); \
 		static eastl::hash<eastl::string> Component_##hashedStr; \
 		static uint32_t Component_##typeHash; \
@@ -102,4 +117,13 @@ public:
 	void Component_::destroyRepresentation(FCR::ComponentRepresentation* pRep) { pRep->~ComponentRepresentation(); tf_free(pRep); } \
 	uint32_t Component_::getTypeStatic() {  return Component_##typeHash; } \
 	uint32_t Component_::getType() const { return Component_::getTypeStatic(); } \
-	BaseComponent* Component_::GenerateComponent() { return tf_new(Component_); }
\ No newline at end of file
+	const ComponentTypeInfo* Component_::getTypeInfo() const { return Component_::getTypeInfoStatic(); } \
+	BaseComponent* Component_::GenerateComponent() { return tf_new(Component_); } \
+	const ComponentTypeInfo* Component_::getTypeInfoStatic() \
+	{ \
+		static const ComponentTypeInfo typeInfo = { getTypeStatic(), (uint32_t)sizeof(Component_), (uint32_t)alignof(Component_), \
+			[](void* pDst) { tf_placement_new<Component_>(pDst); }, \
+			[](void* pDst, const void* pSrc) { tf_placement_new<Component_>(pDst, *(const Component_*)pSrc); }, \
+			[](void* pComponent) { ((Component_*)pComponent)->~Component_(); } }; \
+		return &typeInfo; \
+	}
@@ -100,9 +100,57 @@ void Entity::addComponent(BaseComponent* component)
 	}
 }
 
+EntityId EntityCommandBuffer::createEntity()
+{
+	return createArchetypeEntity(NULL, 0);
+}
+
+EntityId EntityCommandBuffer::createArchetypeEntity(const ComponentTypeInfo* const* ppTypes, uint32_t typeCount)
+{
+	ASSERT(typeCount <= ARCHETYPE_MAX_COMPONENTS);
+
+	// Entities created without types get individually allocated components, see EntityManager::createEntity
+	const EntityId id = pManager->reserveEntityId();
+	const Command  command = { COMMAND_CREATE, id, 0, (uint32_t)mTypes.size(), typeCount };
+	mTypes.insert(mTypes.end(), ppTypes, ppTypes + typeCount);
+	mCommands.push_back(command);
+	return id;
+}
+
+EntityId EntityCommandBuffer::cloneEntity(EntityId id)
+{
+	const EntityId newId = pManager->reserveEntityId();
+	const Command  command = { COMMAND_CLONE, newId, id, 0, 0 };
+	mCommands.push_back(command);
+	return newId;
+}
+
+void EntityCommandBuffer::deleteEntity(EntityId id)
+{
+	ASSERT(id != 0);    // 0 is reserved for describing to root of the scene in the scene graph
+	const Command command = { COMMAND_DELETE, id, 0, 0, 0 };
+	mCommands.push_back(command);
+}
+
+void EntityCommandBuffer::addComponentToEntity(EntityId id, const ComponentTypeInfo* pTypeInfo)
+{
+	const Command command = { COMMAND_ADD_COMPONENT, id, 0, (uint32_t)mTypes.size(), 1 };
+	mTypes.push_back(pTypeInfo);
+	mCommands.push_back(command);
+}
+
 EntityManager::EntityManager()
 {
-	mEntityIdCounter = 1; // entity ids will be used in scene graph tree for transformations... 0 will be dedicated to scene root.
+	// entity ids will be used in scene graph tree for transformations... index 0 will be dedicated to scene root.
+	memset((void*)mSlotPages, 0, sizeof(mSlotPages));
+	mSlotPages[0] = (uintptr_t)tf_calloc(ENTITY_SLOTS_PER_PAGE, sizeof(EntitySlot));
+	mSlotCount = 1;
+	mEntityCount = 0;
+	mFreeCursor = 0;
+
+	memset((void*)mCommandBuffers, 0, sizeof(mCommandBuffers));
+	memset(mCommandBufferThreads, 0, sizeof(mCommandBufferThreads));
+	mCommandBufferCount = 0;
 
 	mComponentViseMap.rehash(93);
 	const eastl::unordered_map<uint32_t, ComponentGeneratorFctPtr>& CompGenMap = ComponentRegistrator::getInstance()->getComponentGeneratorMap();
@@ -112,30 +160,42 @@ EntityManager::EntityManager()
 		map.rehash(11083);
 		mComponentViseMap.insert(eastl::pair< uint32_t, ComponentLookup >(pair.first, map));
 	}
-	
-	mEntitiesMutex.Init();
-	mIdMutex.Init();
-	mComponentMutex.Init();
 }
 
 EntityManager::~EntityManager()
 {
 	reset();
-	mEntitiesMutex.Destroy();
-	mIdMutex.Destroy();
-	mComponentMutex.Destroy();
+	for (Archetype* pArchetype : mArchetypes)
+		tf_delete(pArchetype);
+	mArchetypes.set_capacity(0);
+
+	for (uint32_t i = 0; i < mCommandBufferCount; ++i)
+		tf_delete((EntityCommandBuffer*)mCommandBuffers[i]);
+
+	for (uint32_t i = 0; i < ENTITY_MAX_SLOT_PAGES; ++i)
+		tf_free((void*)mSlotPages[i]);
+
 	ComponentRegistrator::destroyInstance();
 }
 
 void EntityManager::reset()
 {
-	eastl::unordered_map<EntityId, Entity*> entities = getEntities();
+	for (uint32_t i = 0; i < mCommandBufferCount; ++i)
+	{
+		EntityCommandBuffer* pBuffer = (EntityCommandBuffer*)mCommandBuffers[i];
+		pBuffer->mCommands.clear();
+		pBuffer->mTypes.clear();
+	}
+
 	// Release memory for each entity
-	for (eastl::pair<EntityId, Entity*> entity : entities)
+	flushReservedIds();
+	for (uint32_t i = 1; i < mSlotCount; ++i)
 	{
-		deleteEntity(entity.first);
+		const EntitySlot* pSlot = getSlot(i);
+		if (pSlot->pEntity)
+			deleteEntity(makeEntityId(i, pSlot->mGeneration));
 	}
-	mEntities.clear();
+	ASSERT(mEntityCount == 0);
 
 	// Clear stale component pointers
 	for (eastl::pair<uint32_t, ComponentLookup> pair : mComponentViseMap)
@@ -144,42 +204,300 @@ void EntityManager::reset()
 	}
 }
 
-EntityId EntityManager::createEntity()
+EntityId EntityManager::reserveEntityId()
 {
-	Entity* new_entity = tf_placement_new<Entity>(tf_calloc(1, sizeof(Entity)));
+	// Take the last free index, or a fresh slot past mSlotCount once the free list is used up
+	const int32_t cursor = (int32_t)tfrg_atomic32_add_relaxed(&mFreeCursor, (uint32_t)-1);
+	if (cursor > 0)
+	{
+		const uint32_t index = mFreeIndices[cursor - 1];
+		return makeEntityId(index, getSlot(index)->mGeneration);
+	}
 
-	EntityId id = 0;
+	const uint32_t index = mSlotCount + (uint32_t)(-cursor);
+	ASSERT(index < ENTITY_MAX_COUNT && "Too many entities");
+	return makeEntityId(index, 0);
+}
+
+void EntityManager::flushReservedIds()
+{
+	int32_t cursor = (int32_t)tfrg_atomic32_load_relaxed(&mFreeCursor);
+	if (cursor < 0)
 	{
-		MutexLock lock(mIdMutex);
-		id = mEntityIdCounter++;
-		MutexLock entLock(mEntitiesMutex);
-		mEntities[id] = new_entity;
+		const uint32_t slotCount = mSlotCount + (uint32_t)(-cursor);
+		ASSERT(slotCount <= ENTITY_MAX_COUNT && "Too many entities");
+		for (uint32_t page = (mSlotCount + ENTITY_SLOTS_PER_PAGE - 1) / ENTITY_SLOTS_PER_PAGE;
+			 page * ENTITY_SLOTS_PER_PAGE < slotCount; ++page)
+		{
+			// Pages stay allocated when readSnapshot shrinks the slot count
+			if (!mSlotPages[page])
+				tfrg_atomicptr_store_release(&mSlotPages[page], (uintptr_t)tf_calloc(ENTITY_SLOTS_PER_PAGE, sizeof(EntitySlot)));
+		}
+		mSlotCount = slotCount;
+		cursor = 0;
 	}
 
-    // If id < 0, the m_EntityIdCounter is over flow.
-    // id == 0 is reserved for SCENE_ROOT.
-    ASSERT(id > 0);
+	// Reserved indices were taken from the back of the free list
+	mFreeIndices.resize((uint32_t)cursor);
+	tfrg_atomic32_store_relaxed(&mFreeCursor, (uint32_t)cursor);
+}
+
+void EntityManager::bindEntity(EntityId id, Entity* pEntity)
+{
+	EntitySlot* pSlot = getSlot(getEntityIndex(id));
+	ASSERT(!pSlot->pEntity && pSlot->mGeneration == getEntityGeneration(id) && "Entity id was not reserved");
+	pSlot->pEntity = pEntity;
+	++mEntityCount;
+}
+
+Entity* EntityManager::findEntity(EntityId id) const
+{
+	const uint32_t index = getEntityIndex(id);
+	if (index == 0 || index >= ENTITY_MAX_COUNT)
+		return NULL;
+
+	const EntitySlot* pSlot = getSlot(index);
+	if (!pSlot || pSlot->mGeneration != getEntityGeneration(id))
+		return NULL;
+
+	return pSlot->pEntity;
+}
 
+EntityId EntityManager::createEntity()
+{
+	const EntityId id = reserveEntityId();
+	flushReservedIds();
+	bindEntity(id, tf_placement_new<Entity>(tf_calloc(1, sizeof(Entity))));
 	return id;
 }
 
+EntityId EntityManager::createArchetypeEntity(const ComponentTypeInfo* const* ppTypes, uint32_t typeCount)
+{
+	const EntityId id = reserveEntityId();
+	flushReservedIds();
+	createArchetypeEntity(id, ppTypes, typeCount);
+	return id;
+}
+
+void EntityManager::createArchetypeEntity(EntityId id, const ComponentTypeInfo* const* ppTypes, uint32_t typeCount)
+{
+	ASSERT(typeCount <= ARCHETYPE_MAX_COMPONENTS);
+
+	// Archetypes are keyed by their component types sorted by type hash
+	const ComponentTypeInfo* sortedTypes[ARCHETYPE_MAX_COMPONENTS];
+	for (uint32_t i = 0; i < typeCount; ++i)
+	{
+		uint32_t j = i;
+		for (; j > 0 && sortedTypes[j - 1]->mType > ppTypes[i]->mType; --j)
+			sortedTypes[j] = sortedTypes[j - 1];
+		ASSERT((j == 0 || sortedTypes[j - 1]->mType != ppTypes[i]->mType) && "component for entity already exist");
+		sortedTypes[j] = ppTypes[i];
+	}
+
+	Entity* new_entity = tf_placement_new<Entity>(tf_calloc(1, sizeof(Entity)));
+	bindEntity(id, new_entity);
+
+	new_entity->pArchetype = getArchetype(sortedTypes, typeCount);
+	new_entity->mArchetypeRow = new_entity->pArchetype->addRow(id);
+}
+
 EntityId EntityManager::cloneEntity(EntityId id)
+{
+	const EntityId newId = reserveEntityId();
+	flushReservedIds();
+	cloneEntity(newId, id);
+	return newId;
+}
+
+void EntityManager::cloneEntity(EntityId newId, EntityId id)
 {
 	Entity* source_entity = getEntityById(id);
-	Entity* new_entity	  = source_entity->clone();
+	if (!source_entity->pArchetype)
+	{
+		bindEntity(newId, source_entity->clone());
+		return;
+	}
+
+	Entity* new_entity = tf_placement_new<Entity>(tf_calloc(1, sizeof(Entity)));
+	bindEntity(newId, new_entity);
 
-	EntityId newid = 0;
+	Archetype* pArchetype = source_entity->pArchetype;
+	new_entity->pArchetype = pArchetype;
+	new_entity->mArchetypeRow = pArchetype->allocateRow(newId);
+	for (uint32_t i = 0; i < pArchetype->getTypeCount(); ++i)
 	{
-		MutexLock lock(mIdMutex);
-		newid = mEntityIdCounter++;
-		MutexLock entLock(mEntitiesMutex);
-		mEntities[newid] = new_entity;
+		pArchetype->getTypeInfo(i)->pCopy(
+			pArchetype->getComponent(i, new_entity->mArchetypeRow), pArchetype->getComponent(i, source_entity->mArchetypeRow));
+	}
+}
+
+EntityCommandBuffer* EntityManager::getCommandBuffer()
+{
+	const ThreadID threadId = Thread::GetCurrentThreadID();
+	const uint32_t count = min(tfrg_atomic32_load_acquire(&mCommandBufferCount), (uint32_t)ENTITY_MAX_COMMAND_BUFFERS);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		// Buffers are published after their thread id, a NULL buffer is still being registered by another thread
+		EntityCommandBuffer* pBuffer = (EntityCommandBuffer*)tfrg_atomicptr_load_acquire(&mCommandBuffers[i]);
+		if (pBuffer && mCommandBufferThreads[i] == threadId)
+			return pBuffer;
+	}
+
+	const uint32_t index = tfrg_atomic32_add_relaxed(&mCommandBufferCount, 1);
+	ASSERT(index < ENTITY_MAX_COMMAND_BUFFERS && "Too many threads record entity commands");
+	EntityCommandBuffer* pBuffer = tf_new(EntityCommandBuffer, this);
+	mCommandBufferThreads[index] = threadId;
+	tfrg_atomicptr_store_release(&mCommandBuffers[index], (uintptr_t)pBuffer);
+	return pBuffer;
+}
+
+void EntityManager::applyCommandBuffers()
+{
+	flushReservedIds();
+
+	for (uint32_t i = 0; i < mCommandBufferCount; ++i)
+	{
+		EntityCommandBuffer* pBuffer = (EntityCommandBuffer*)mCommandBuffers[i];
+		for (const EntityCommandBuffer::Command& command : pBuffer->mCommands)
+		{
+			const ComponentTypeInfo* const* ppTypes = pBuffer->mTypes.data() + command.mFirstType;
+			switch (command.mType)
+			{
+				case EntityCommandBuffer::COMMAND_CREATE:
+					if (command.mTypeCount)
+						createArchetypeEntity(command.mId, ppTypes, command.mTypeCount);
+					else
+						bindEntity(command.mId, tf_placement_new<Entity>(tf_calloc(1, sizeof(Entity))));
+					break;
+				case EntityCommandBuffer::COMMAND_CLONE: cloneEntity(command.mId, command.mSourceId); break;
+				case EntityCommandBuffer::COMMAND_DELETE: deleteReservedEntity(command.mId); break;
+				case EntityCommandBuffer::COMMAND_ADD_COMPONENT: addComponentToEntity(command.mId, ppTypes[0]); break;
+			}
+		}
+
+		pBuffer->mCommands.clear();
+		pBuffer->mTypes.clear();
+	}
+}
+
+Archetype* EntityManager::getArchetype(const ComponentTypeInfo* const* ppTypes, uint32_t typeCount)
+{
+	for (Archetype* pArchetype : mArchetypes)
+	{
+		if (pArchetype->matches(ppTypes, typeCount))
+			return pArchetype;
+	}
+
+	Archetype* pArchetype = tf_new(Archetype, ppTypes, typeCount);
+	mArchetypes.push_back(pArchetype);
+	return pArchetype;
+}
+
+void* EntityManager::addComponentToEntity(EntityId _id, const ComponentTypeInfo* pTypeInfo)
+{
+	Entity* pEntity = getEntityById(_id);
+	if (pEntity->pArchetype)
+		return addComponentToArchetypeEntity(_id, pEntity, pTypeInfo);
+
+	BaseComponent* pComponent = nullptr;
+
+	const eastl::unordered_map< uint32_t, ComponentGeneratorFctPtr >& CompGenMap   = ComponentRegistrator::getInstance()->getComponentGeneratorMap();
+	eastl::unordered_map< uint32_t, ComponentGeneratorFctPtr >::const_iterator itr = CompGenMap.find(pTypeInfo->mType);
+	if (itr != CompGenMap.end())
+	{
+		pComponent = itr->second();
+		pEntity->addComponent(pComponent);
+
+		ComponentViseMap::iterator itr = mComponentViseMap.find(pTypeInfo->mType);
+		if (itr != mComponentViseMap.end())
+		{
+			ComponentLookup& componentMap = itr->second;
+			componentMap.insert(Pair(_id, pComponent));
+		}
+		else
+		{
+			ASSERT(0);
+		}
+	}
+	else
+	{
+		ASSERT(0 && "COMPONENT OF GIVEN NAME NOT FOUND");
+	}
+
+	return pComponent;
+}
+
+void* EntityManager::addComponentToArchetypeEntity(EntityId id, Entity* pEntity, const ComponentTypeInfo* pTypeInfo)
+{
+	Archetype* pSrcArchetype = pEntity->pArchetype;
+	ASSERT(!pSrcArchetype->hasComponent(pTypeInfo->mType) && "component for entity already exist");
+	ASSERT(pSrcArchetype->getTypeCount() < ARCHETYPE_MAX_COMPONENTS);
+
+	const ComponentTypeInfo* types[ARCHETYPE_MAX_COMPONENTS];
+	uint32_t                 typeCount = 0;
+	for (uint32_t i = 0; i < pSrcArchetype->getTypeCount(); ++i)
+	{
+		if (typeCount == i && pSrcArchetype->getTypeInfo(i)->mType > pTypeInfo->mType)
+			types[typeCount++] = pTypeInfo;
+		types[typeCount++] = pSrcArchetype->getTypeInfo(i);
+	}
+	if (typeCount == pSrcArchetype->getTypeCount())
+		types[typeCount++] = pTypeInfo;
+
+	// Copy the existing components into a row of the new archetype, then remove the old row
+	Archetype*     pDstArchetype = getArchetype(types, typeCount);
+	const uint32_t row = pDstArchetype->allocateRow(id);
+	void*          pComponent = NULL;
+	for (uint32_t i = 0; i < typeCount; ++i)
+	{
+		void*         pDst = pDstArchetype->getComponent(i, row);
+		const int32_t srcColumn = pSrcArchetype->findColumn(types[i]->mType);
+		if (srcColumn >= 0)
+		{
+			types[i]->pCopy(pDst, pSrcArchetype->getComponent((uint32_t)srcColumn, pEntity->mArchetypeRow));
+		}
+		else
+		{
+			types[i]->pConstruct(pDst);
+			pComponent = pDst;
+		}
+	}
+
+	removeArchetypeRow(pEntity);
+	pEntity->pArchetype = pDstArchetype;
+	pEntity->mArchetypeRow = row;
+
+	return pComponent;
+}
+
+void EntityManager::removeArchetypeRow(Entity* pEntity)
+{
+	const EntityId movedId = pEntity->pArchetype->removeRow(pEntity->mArchetypeRow);
+	if (movedId)
+		getEntityById(movedId)->mArchetypeRow = pEntity->mArchetypeRow;
+}
+
+void EntityManager::getChunks(
+	const uint32_t* pTypes, uint32_t typeCount, const uint32_t* pExcludedTypes, uint32_t excludedTypeCount,
+	eastl::vector<ArchetypeChunk*>& chunks)
+{
+	for (Archetype* pArchetype : mArchetypes)
+	{
+		if (!pArchetype->hasAllComponents(pTypes, typeCount) || pArchetype->hasAnyComponent(pExcludedTypes, excludedTypeCount))
+			continue;
+
+		for (uint32_t i = 0; i < pArchetype->getChunkCount(); ++i)
+			chunks.push_back(pArchetype->getChunk(i));
 	}
-	
-	return newid;
 }
 
 void EntityManager::deleteEntity(EntityId id)
+{
+	flushReservedIds();
+	deleteReservedEntity(id);
+}
+
+void EntityManager::deleteReservedEntity(EntityId id)
 {
 	ASSERT (id != 0); // 0 is reserved for describing to root of the scene in the scene graph
 
@@ -189,28 +507,42 @@ void EntityManager::deleteEntity(EntityId id)
 	entity = getEntityById(id);
 	ASSERT(entity);
 
+	// Unpopulate data structures, the id may be handed out again
+	for (Entity::ComponentMap::iterator it = entity->mComponents.begin(); it != entity->mComponents.end(); ++it)
 	{
-		MutexLock lock(mEntitiesMutex);
-		// Unpopulate data structures
-		eastl::unordered_map<EntityId, Entity*>::iterator entities_iter = mEntities.find(id);
-		ASSERT(entities_iter != mEntities.end());
-		mEntities.erase(entities_iter);
+		ComponentViseMap::iterator itr = mComponentViseMap.find(it->first);
+		if (itr != mComponentViseMap.end())
+			itr->second.erase(id);
 	}
+
+	if (entity->pArchetype)
+	{
+		removeArchetypeRow(entity);
+	}
+
 	entity->~Entity();
 	tf_free(entity);
+
+	// Bump the generation so the id becomes stale. Slots whose generation would wrap around are
+	// retired instead of being reused, ids can then never alias an older entity
+	const uint32_t index = getEntityIndex(id);
+	EntitySlot*    pSlot = getSlot(index);
+	pSlot->pEntity = NULL;
+	pSlot->mGeneration = (pSlot->mGeneration + 1) & ENTITY_GENERATION_MASK;
+	--mEntityCount;
+	if (pSlot->mGeneration != 0)
+	{
+		mFreeIndices.push_back(index);
+		tfrg_atomic32_store_relaxed(&mFreeCursor, (uint32_t)mFreeIndices.size());
+	}
 }
 
 
 Entity* EntityManager::getEntityById(EntityId const id)
 {
 	ASSERT (id != 0); // 0 is reserved for describing to root of the scene in the scene graph
-	Entity* pEntity = NULL;
-	{
-		MutexLock lock(mEntitiesMutex);
-		EntityMap::iterator iter = mEntities.find(id);
-		ASSERT(iter != mEntities.end());
-		pEntity = iter->second;
-	}
+	Entity* pEntity = findEntity(id);
+	ASSERT(pEntity && "Stale or unknown entity id");
 	return pEntity;
 }
 
@@ -222,9 +554,28 @@ bool EntityManager::entityExist(EntityId const id)
 		// 0 is root and always exists
 		return true;
 	}
+
+	return findEntity(id) != NULL;
+}
+
+void EntityManager::setEntityName(EntityId id, const char* name)
+{
+	ASSERT(findEntity(id));
+	mEntitiesName[eastl::string(name)] = id;
+}
+
+EntityId EntityManager::findEntityByName(const char* name)
+{
+	eastl::unordered_map<eastl::string, EntityId>::iterator iter = mEntitiesName.find(eastl::string(name));
+	if (iter == mEntitiesName.end())
+		return 0;
+
+	// The generation tells whether the named entity is still alive
+	if (!findEntity(iter->second))
 	{
-		MutexLock lock(mEntitiesMutex);
-		EntityMap::iterator iter = mEntities.find(id);
-		return (iter != mEntities.end());
+		mEntitiesName.erase(iter);
+		return 0;
 	}
+
+	return iter->second;
 }
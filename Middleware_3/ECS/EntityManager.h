@@ -26,6 +26,8 @@
 
 #include "../../Common_3/OS/Interfaces/ILog.h"
 #include "../../Common_3/OS/Interfaces/IThread.h"
+#include "../../Common_3/OS/Interfaces/IFileSystem.h"
+#include "../../Common_3/OS/Core/Atomics.h"
 
 #include "../../Common_3/ThirdParty/OpenSource/EASTL/string.h"
 #include "../../Common_3/ThirdParty/OpenSource/EASTL/unordered_set.h"
@@ -39,9 +41,12 @@ namespace FCR
 
 //class BaseComponent;
 #include "BaseComponent.h"
+#include "Archetype.h"
 
 // An entity is collection of components.
 // An entity has a name.
+// Components are either allocated one by one or, for entities created with
+// EntityManager::createArchetypeEntity, stored in the chunks of an Archetype.
 class Entity
 {
 	friend class EntityManager; // only entity manager should directly modify entities
@@ -68,8 +73,12 @@ public:
 
 	template<typename T> void getComponent(T*& componentOut);
 
+	// Individually allocated components, empty for entities stored in an archetype
 	ComponentMap& getComponents() { return mComponents; }
 
+	// Archetype the components of this entity are stored in, NULL if they are allocated one by one
+	Archetype* getArchetype() const { return pArchetype; }
+
 	FCR::ComponentRepresentation* const
 	getComponentRepresentation(uint32_t const compId);
 
@@ -79,6 +88,9 @@ private:
 
 	ComponentMap	mComponents;
 	ComponentRepMap	mComponentRepresentations;
+
+	Archetype*		pArchetype = NULL;
+	uint32_t		mArchetypeRow = 0;
 };
 
 
@@ -87,6 +99,13 @@ T* Entity::getComponent()
 {
 	T* componentOut = NULL;
 
+	if (pArchetype)
+	{
+		// Only valid until the component set of any entity of the archetype changes
+		const int32_t column = pArchetype->findColumn(T::getTypeStatic());
+		return column >= 0 ? (T*)pArchetype->getComponent((uint32_t)column, mArchetypeRow) : NULL;
+	}
+
 	ComponentMap::iterator it = mComponents.find(T::getTypeStatic());
 	if (it != mComponents.end())
 		componentOut = (T*)it->second;
@@ -108,39 +127,193 @@ void Entity::getComponent(T*& componentOut)
 	componentOut = getComponent<T>();
 }
 
-typedef int32_t EntityId;
-
-typedef eastl::unordered_map<EntityId, Entity*>					 EntityMap;
-typedef eastl::unordered_map<EntityId, Entity*>::iterator		 EntityMapIterator;
-typedef eastl::unordered_map<EntityId, Entity*>::const_iterator  EntityMapConstIterator;
-//typedef eastl::hash_map<EntityId, Entity*>					 EntityMapNode;
-
 typedef eastl::hash_map<EntityId, BaseComponent*>				 ComponentLookup;
 typedef const ComponentLookup									 Lookup;
 typedef eastl::hash_map<uint32_t, ComponentLookup>				 ComponentViseMap;
 typedef eastl::pair<EntityId, BaseComponent*>					 Pair;
 
+// Entity slots are allocated in pages that never move, so readers can look up entities without locking
+#define ENTITY_SLOTS_PER_PAGE 4096
+#define ENTITY_MAX_SLOT_PAGES (ENTITY_MAX_COUNT / ENTITY_SLOTS_PER_PAGE)
+#define ENTITY_MAX_COMMAND_BUFFERS 64
+
+class EntityManager;
+
+// Records structural changes from any thread, they are applied by EntityManager::applyCommandBuffers.
+// Ids are reserved when a command is recorded, so they can be stored right away, but the entities
+// only exist once the buffer was applied. Every thread records into its own buffer, see EntityManager::getCommandBuffer
+class EntityCommandBuffer
+{
+	friend class EntityManager;
+
+public:
+	EntityCommandBuffer(EntityManager* pManager): pManager(pManager) {}
+
+	EntityId createEntity();
+
+	template <typename... Ts>
+	EntityId createArchetypeEntity()
+	{
+		const ComponentTypeInfo* pTypes[] = { Ts::getTypeInfoStatic()... };
+		return createArchetypeEntity(pTypes, (uint32_t)(sizeof(pTypes) / sizeof(pTypes[0])));
+	}
+	EntityId createArchetypeEntity(const ComponentTypeInfo* const* ppTypes, uint32_t typeCount);
+
+	// The source entity is read when the buffer is applied
+	EntityId cloneEntity(EntityId id);
+	void deleteEntity(EntityId id);
+
+	// Adds a default constructed component, its values can be set once the buffer was applied
+	template <typename T>
+	void addComponentToEntity(EntityId id)
+	{
+		addComponentToEntity(id, T::getTypeInfoStatic());
+	}
+	void addComponentToEntity(EntityId id, const ComponentTypeInfo* pTypeInfo);
 
+	bool empty() const { return mCommands.empty(); }
+
+private:
+	enum CommandType
+	{
+		COMMAND_CREATE,
+		COMMAND_CLONE,
+		COMMAND_DELETE,
+		COMMAND_ADD_COMPONENT,
+	};
+
+	struct Command
+	{
+		CommandType mType;
+		EntityId    mId;
+		// Source entity of COMMAND_CLONE
+		EntityId mSourceId;
+		// Component types of COMMAND_CREATE and COMMAND_ADD_COMPONENT in mTypes
+		uint32_t mFirstType;
+		uint32_t mTypeCount;
+	};
+
+	EntityManager*                           pManager;
+	eastl::vector<Command>                   mCommands;
+	eastl::vector<const ComponentTypeInfo*> mTypes;
+};
+
+
+// Owns all entities, looked up through generational ids in a paged slot array.
+// Lookups (getEntityById, entityExist) are lock free. Structural changes (creating, cloning, deleting entities and adding
+// components) made directly through the manager must only happen on one thread at a time while no other thread
+// records commands or reads the affected entities. Other threads record them into command buffers instead,
+// which are applied at a sync point with applyCommandBuffers.
 class EntityManager
 {
+	friend class EntityCommandBuffer;
+
 public:
 	EntityManager();
 	~EntityManager();
 
 	EntityId createEntity();
+
+	// Creates an entity whose default constructed components Ts are stored in the archetype of that component set.
+	// Components of archetype entities have no representations and are not part of getByComponent
+	template <typename... Ts>
+	EntityId createArchetypeEntity()
+	{
+		const ComponentTypeInfo* pTypes[] = { Ts::getTypeInfoStatic()... };
+		return createArchetypeEntity(pTypes, (uint32_t)(sizeof(pTypes) / sizeof(pTypes[0])));
+	}
+	EntityId createArchetypeEntity(const ComponentTypeInfo* const* ppTypes, uint32_t typeCount);
+
 	EntityId cloneEntity(EntityId id);
 	void deleteEntity(EntityId id);
 
+	// Asserts if the id is stale or was never created
 	Entity* getEntityById(EntityId const id);
     
+	// False for stale ids and for ids reserved by a command buffer that was not applied yet
 	bool entityExist(EntityId const id);
 
+	// Deletes all entities and drops all recorded commands
 	void reset();
 
-	const eastl::unordered_map<EntityId, Entity*>& getEntities() const { return mEntities; }
+	uint32_t getEntityCount() const { return mEntityCount; }
 
+	// For archetype entities this moves the entity to the archetype with T added,
+	// which invalidates pointers to the components of the entity and of the last entity of its old archetype
 	template <typename T>
-	T& addComponentToEntity(EntityId id);
+	T& addComponentToEntity(EntityId id)
+	{
+		return *(T*)addComponentToEntity(id, T::getTypeInfoStatic());
+	}
+	void* addComponentToEntity(EntityId id, const ComponentTypeInfo* pTypeInfo);
+
+	// Names are kept in snapshots, looking up the name of a deleted entity returns 0
+	void setEntityName(EntityId id, const char* name);
+	EntityId findEntityByName(const char* name);
+
+	// Snapshots store the entities with their ids, components and names in the binary format described in EntitySnapshot.h.
+	// Components must be raw data besides their BaseComponent, they are copied byte by byte.
+	// Snapshots must be written and read at a sync point, with no recorded commands pending
+
+	// Writes the entities pIds, or all entities when pIds is NULL, to data
+	void writeSnapshot(eastl::vector<uint8_t>& data, const EntityId* pIds = NULL, uint32_t idCount = 0);
+
+	// Replaces all entities by the ones of the snapshot, which get back their ids. Pointers to entities and components
+	// are invalidated. The snapshot is only read, so pData can point into a mapped file
+	bool readSnapshot(const void* pData, size_t size);
+
+	bool saveSnapshot(const ResourceDirectory resourceDir, const char* fileName, const EntityId* pIds = NULL, uint32_t idCount = 0);
+	bool loadSnapshot(const ResourceDirectory resourceDir, const char* fileName);
+
+	// Command buffer of the calling thread, created on first use
+	EntityCommandBuffer* getCommandBuffer();
+
+	// Sync point, applies and clears the command buffers of all threads in the order the threads first asked for a buffer.
+	// Commands of one buffer are applied in the order they were recorded.
+	// Must not run concurrently with recording commands or reading entities
+	void applyCommandBuffers();
+
+	// Archetype queries, must not run concurrently with creating, deleting or adding components to archetype entities
+
+	// Appends the chunks of all archetypes that store components Ts and none of the pExcludedTypes,
+	// so the chunks can be split across threads
+	template <typename... Ts>
+	void getChunks(eastl::vector<ArchetypeChunk*>& chunks, const uint32_t* pExcludedTypes = NULL, uint32_t excludedTypeCount = 0)
+	{
+		const uint32_t types[] = { 0, Ts::getTypeStatic()... };
+		getChunks(types + 1, (uint32_t)sizeof...(Ts), pExcludedTypes, excludedTypeCount, chunks);
+	}
+	void getChunks(
+		const uint32_t* pTypes, uint32_t typeCount, const uint32_t* pExcludedTypes, uint32_t excludedTypeCount,
+		eastl::vector<ArchetypeChunk*>& chunks);
+
+	// Calls func(count, pEntityIds, pTs...) with the component arrays of every chunk that stores components Ts
+	template <typename... Ts, typename Func>
+	void forEachChunk(Func func)
+	{
+		const uint32_t types[] = { 0, Ts::getTypeStatic()... };
+		for (Archetype* pArchetype : mArchetypes)
+		{
+			if (!pArchetype->hasAllComponents(types + 1, (uint32_t)sizeof...(Ts)))
+				continue;
+
+			for (uint32_t i = 0; i < pArchetype->getChunkCount(); ++i)
+			{
+				const ArchetypeChunk* pChunk = pArchetype->getChunk(i);
+				func(pChunk->mCount, pChunk->getEntityIds(), pChunk->getArray<Ts>()...);
+			}
+		}
+	}
+
+	// Calls func(Ts&...) on every archetype entity that has components Ts
+	template <typename... Ts, typename Func>
+	void forEach(Func func)
+	{
+		forEachChunk<Ts...>([&func](uint32_t count, const EntityId*, Ts*... pArrays) {
+			for (uint32_t i = 0; i < count; ++i)
+				func(pArrays[i]...);
+		});
+	}
 
 	template <typename T>
 	Lookup& getByComponent()
@@ -158,58 +331,64 @@ public:
 	}
 
 private:
-	Mutex mIdMutex;
-	Mutex mEntitiesMutex;
-	Mutex mComponentMutex;
-	// Entities book-keeping data-structures ////////////////////////
-	/* Note:	for now we clump all entities in one data-structure.
-	 *			In the future however, as the complexities of the scenes we
-	 *			support increases, we may need to be smarter about how we
-	 *			store and retrieve entities as to minimize the iterations we
-	 *			do over the data-structures.
-	 */
-	eastl::unordered_map<EntityId, Entity*>			mEntities;
-	//eastl::unordered_map<EntityId, EEntityType>		mEntitiesType;
-	eastl::unordered_map<eastl::string, EntityId>	mEntitiesName;
+	struct EntitySlot
+	{
+		// NULL while the slot is free or only reserved
+		Entity*  pEntity;
+		uint32_t mGeneration;
+	};
 
-	// incr. on entity creation... used to fetch entities.
-	EntityId										mEntityIdCounter;
-	/////////////////////////////////////////////////////////////////
+	inline EntitySlot* getSlot(uint32_t index) const
+	{
+		EntitySlot* pPage = (EntitySlot*)tfrg_atomicptr_load_acquire((tfrg_atomicptr_t*)&mSlotPages[index / ENTITY_SLOTS_PER_PAGE]);
+		return pPage ? &pPage[index % ENTITY_SLOTS_PER_PAGE] : NULL;
+	}
 
-	ComponentViseMap mComponentViseMap;
-};
+	// Entity of a live id, NULL for stale or reserved ids
+	Entity* findEntity(EntityId id) const;
 
+	// Hands out a free slot without locking, safe to call from any thread between two sync points
+	EntityId reserveEntityId();
 
-template <typename T>
-T& EntityManager::addComponentToEntity(EntityId _id)
-{
-	MutexLock lock(mComponentMutex);
-	
-	BaseComponent* pComponent = nullptr;
+	// Creates the slots of all ids reserved since the last call, must run on the thread making structural changes
+	void flushReservedIds();
 
-	const eastl::unordered_map< uint32_t, ComponentGeneratorFctPtr >& CompGenMap   = ComponentRegistrator::getInstance()->getComponentGeneratorMap();
-	eastl::unordered_map< uint32_t, ComponentGeneratorFctPtr >::const_iterator itr = CompGenMap.find(T::getTypeStatic());
-	if (itr != CompGenMap.end())
-	{
-		pComponent = itr->second();
-		Entity* pEntity = getEntityById(_id);
-		pEntity->addComponent(pComponent);
+	void bindEntity(EntityId id, Entity* pEntity);
 
-		ComponentViseMap::iterator itr = mComponentViseMap.find(T::getTypeStatic());
-		if (itr != mComponentViseMap.end())
-		{
-			ComponentLookup& componentMap = itr->second;
-			componentMap.insert(Pair(_id, pComponent));
-		}
-		else
-		{
-			ASSERT(0);
-		}
-	}
-	else
-	{
-		ASSERT(0 && "COMPONENT OF GIVEN NAME NOT FOUND");
-	}
+	// Sorts ppTypes by type hash and creates the entity in the archetype of these types
+	void createArchetypeEntity(EntityId id, const ComponentTypeInfo* const* ppTypes, uint32_t typeCount);
+	void cloneEntity(EntityId newId, EntityId id);
+	void deleteReservedEntity(EntityId id);
 
-	return *(static_cast<T*>(pComponent));
-}
+	// Archetype storing exactly the sorted types ppTypes, created on first use
+	Archetype* getArchetype(const ComponentTypeInfo* const* ppTypes, uint32_t typeCount);
+
+	void* addComponentToArchetypeEntity(EntityId id, Entity* pEntity, const ComponentTypeInfo* pTypeInfo);
+
+	// Removes the row of an archetype entity and updates the entity moved into its place
+	void removeArchetypeRow(Entity* pEntity);
+
+	// Entities book-keeping data-structures ////////////////////////
+	// Slot i holds the entity of index i, slot 0 is the scene root and never used
+	tfrg_atomicptr_t mSlotPages[ENTITY_MAX_SLOT_PAGES];
+	uint32_t         mSlotCount;
+	uint32_t         mEntityCount;
+
+	// Indices of free slots. mFreeCursor free indices are left, a negative cursor counts the fresh
+	// slots reserved past mSlotCount since the last flush
+	eastl::vector<uint32_t> mFreeIndices;
+	tfrg_atomic32_t         mFreeCursor;
+
+	// Command buffers and the ids of the threads owning them
+	tfrg_atomicptr_t mCommandBuffers[ENTITY_MAX_COMMAND_BUFFERS];
+	ThreadID         mCommandBufferThreads[ENTITY_MAX_COMMAND_BUFFERS];
+	tfrg_atomic32_t  mCommandBufferCount;
+
+	//eastl::unordered_map<EntityId, EEntityType>		mEntitiesType;
+	eastl::unordered_map<eastl::string, EntityId>	mEntitiesName;
+	/////////////////////////////////////////////////////////////////
+
+	ComponentViseMap mComponentViseMap;
+
+	eastl::vector<Archetype*> mArchetypes;
+};
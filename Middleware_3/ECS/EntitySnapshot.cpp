@@ -0,0 +1,511 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+
+#include "EntityManager.h"
+#include "EntitySnapshot.h"
+
+#include "../../Common_3/ThirdParty/OpenSource/EASTL/hash_map.h"
+
+#include "../../Common_3/OS/Interfaces/IMemory.h"    // Must be the last include in a cpp file
+
+// Components are stored without their BaseComponent, which only holds the vtable pointer
+static const uint32_t ComponentDataOffset = (uint32_t)sizeof(BaseComponent);
+
+// Appends a zeroed section of size bytes and returns its offset
+static uint64_t allocSection(eastl::vector<uint8_t>& data, size_t size)
+{
+	const size_t offset = (data.size() + ENTITY_SNAPSHOT_ALIGNMENT - 1) & ~(size_t)(ENTITY_SNAPSHOT_ALIGNMENT - 1);
+	data.resize(offset + size, 0);
+	return offset;
+}
+
+template <typename T>
+static uint64_t appendSection(eastl::vector<uint8_t>& data, const eastl::vector<T>& elements)
+{
+	const uint64_t offset = allocSection(data, elements.size() * sizeof(T));
+	if (!elements.empty())
+		memcpy(data.data() + offset, elements.data(), elements.size() * sizeof(T));
+	return offset;
+}
+
+static bool isInSnapshot(size_t size, uint64_t offset, uint64_t count, uint64_t elementSize)
+{
+	return offset <= size && (offset % ENTITY_SNAPSHOT_ALIGNMENT) == 0 && count * elementSize <= size - offset;
+}
+
+template <typename T>
+static const T* getSection(const uint8_t* pData, uint64_t offset)
+{
+	return (const T*)(pData + offset);
+}
+
+void EntityManager::writeSnapshot(eastl::vector<uint8_t>& data, const EntityId* pIds, uint32_t idCount)
+{
+	flushReservedIds();
+
+	// Slots of the entities to write
+	eastl::vector<uint8_t> included(mSlotCount, 0);
+	for (uint32_t i = 1; i < mSlotCount; ++i)
+		included[i] = !pIds && getSlot(i)->pEntity;
+	for (uint32_t i = 0; pIds && i < idCount; ++i)
+	{
+		ASSERT(findEntity(pIds[i]) && "Stale or unknown entity id");
+		if (findEntity(pIds[i]))
+			included[getEntityIndex(pIds[i])] = 1;
+	}
+
+	data.clear();
+	data.resize(sizeof(EntitySnapshotHeader), 0);
+
+	eastl::vector<EntitySnapshotType>    types;
+	eastl::hash_map<uint32_t, uint32_t>  typeIndices;
+	auto getTypeIndex = [&types, &typeIndices](const ComponentTypeInfo* pTypeInfo) {
+		eastl::hash_map<uint32_t, uint32_t>::iterator iter = typeIndices.find(pTypeInfo->mType);
+		if (iter != typeIndices.end())
+			return iter->second;
+
+		const EntitySnapshotType type = { pTypeInfo->mType, pTypeInfo->mSize - ComponentDataOffset };
+		typeIndices[pTypeInfo->mType] = (uint32_t)types.size();
+		types.push_back(type);
+		return (uint32_t)types.size() - 1;
+	};
+
+	// Archetype columns, only the rows of included entities
+	eastl::vector<EntitySnapshotArchetype>      archetypes;
+	eastl::vector<EntitySnapshotComponentArray> arrays;
+	eastl::vector<uint32_t>                     archetypeIndices(mArchetypes.size(), ENTITY_SNAPSHOT_NO_ARCHETYPE);
+	eastl::vector<uint32_t>                     rows;
+	for (uint32_t a = 0; a < (uint32_t)mArchetypes.size(); ++a)
+	{
+		const Archetype* pArchetype = mArchetypes[a];
+		rows.clear();
+		for (uint32_t row = 0; row < pArchetype->getCount(); ++row)
+		{
+			if (included[getEntityIndex(pArchetype->getEntityId(row))])
+				rows.push_back(row);
+		}
+		if (rows.empty())
+			continue;
+
+		EntitySnapshotArchetype archetype = {};
+		archetype.mFirstArray = (uint32_t)arrays.size();
+		archetype.mArrayCount = pArchetype->getTypeCount();
+		archetype.mRowCount = (uint32_t)rows.size();
+		archetype.mEntityIdsOffset = allocSection(data, rows.size() * sizeof(EntityId));
+		for (uint32_t i = 0; i < (uint32_t)rows.size(); ++i)
+			((EntityId*)(data.data() + archetype.mEntityIdsOffset))[i] = pArchetype->getEntityId(rows[i]);
+
+		for (uint32_t column = 0; column < pArchetype->getTypeCount(); ++column)
+		{
+			const ComponentTypeInfo*     pTypeInfo = pArchetype->getTypeInfo(column);
+			const uint32_t               dataSize = pTypeInfo->mSize - ComponentDataOffset;
+			EntitySnapshotComponentArray array = { getTypeIndex(pTypeInfo), (uint32_t)rows.size(), 0, 0 };
+			array.mDataOffset = allocSection(data, rows.size() * dataSize);
+
+			uint8_t* pDst = data.data() + array.mDataOffset;
+			for (uint32_t i = 0; i < (uint32_t)rows.size(); ++i, pDst += dataSize)
+				memcpy(pDst, (const uint8_t*)pArchetype->getComponent(column, rows[i]) + ComponentDataOffset, dataSize);
+
+			arrays.push_back(array);
+		}
+
+		archetypeIndices[a] = (uint32_t)archetypes.size();
+		archetypes.push_back(archetype);
+	}
+
+	// Entity table and slots, entities left out are written as deleted
+	eastl::vector<uint32_t>             generations(mSlotCount);
+	eastl::vector<uint32_t>             freeIndices(mFreeIndices);
+	eastl::vector<EntitySnapshotEntity> entities;
+	eastl::hash_map<uint32_t, eastl::vector<BaseComponent*> > individualComponents;
+	eastl::vector<uint32_t>             individualTypes;
+	for (uint32_t i = 0; i < mSlotCount; ++i)
+	{
+		const EntitySlot* pSlot = getSlot(i);
+		generations[i] = pSlot->mGeneration;
+		if (!pSlot->pEntity)
+			continue;
+
+		if (!included[i])
+		{
+			generations[i] = (pSlot->mGeneration + 1) & ENTITY_GENERATION_MASK;
+			if (generations[i])
+				freeIndices.push_back(i);
+			continue;
+		}
+
+		EntitySnapshotEntity entity = { makeEntityId(i, pSlot->mGeneration), ENTITY_SNAPSHOT_NO_ARCHETYPE };
+		Entity*              pEntity = pSlot->pEntity;
+		if (pEntity->pArchetype)
+		{
+			for (uint32_t a = 0; a < (uint32_t)mArchetypes.size(); ++a)
+			{
+				if (mArchetypes[a] == pEntity->pArchetype)
+					entity.mArchetype = archetypeIndices[a];
+			}
+		}
+		entities.push_back(entity);
+
+		for (Entity::ComponentMap::const_iterator it = pEntity->mComponents.begin(); it != pEntity->mComponents.end(); ++it)
+		{
+			eastl::vector<BaseComponent*>& components = individualComponents[it->first];
+			if (components.empty())
+				individualTypes.push_back(it->first);
+			components.push_back(it->second);
+		}
+	}
+
+	// Individually allocated components, one array per type
+	const uint32_t firstIndividualArray = (uint32_t)arrays.size();
+	for (uint32_t type : individualTypes)
+	{
+		const eastl::vector<BaseComponent*>& components = individualComponents[type];
+		const ComponentTypeInfo*             pTypeInfo = components[0]->getTypeInfo();
+		const uint32_t                       dataSize = pTypeInfo->mSize - ComponentDataOffset;
+		EntitySnapshotComponentArray         array = { getTypeIndex(pTypeInfo), (uint32_t)components.size(), 0, 0 };
+
+		// Owners are found again through the entity table, components of an entity are in the order of its component map
+		array.mEntityIdsOffset = allocSection(data, components.size() * sizeof(EntityId));
+		array.mDataOffset = allocSection(data, components.size() * dataSize);
+		uint32_t componentIndex = 0;
+		for (const EntitySnapshotEntity& entity : entities)
+		{
+			Entity::ComponentMap& entityComponents = getSlot(getEntityIndex(entity.mId))->pEntity->mComponents;
+			Entity::ComponentMap::iterator it = entityComponents.find(type);
+			if (it == entityComponents.end())
+				continue;
+
+			((EntityId*)(data.data() + array.mEntityIdsOffset))[componentIndex] = entity.mId;
+			memcpy(data.data() + array.mDataOffset + componentIndex * dataSize, (const uint8_t*)it->second + ComponentDataOffset, dataSize);
+			++componentIndex;
+		}
+		ASSERT(componentIndex == array.mCount);
+
+		arrays.push_back(array);
+	}
+
+	// Names of the included entities
+	eastl::vector<EntitySnapshotName> names;
+	eastl::vector<char>               stringPool;
+	for (const eastl::pair<const eastl::string, EntityId>& name : mEntitiesName)
+	{
+		if (!findEntity(name.second) || !included[getEntityIndex(name.second)])
+			continue;
+
+		const EntitySnapshotName snapshotName = { name.second, (uint32_t)stringPool.size() };
+		names.push_back(snapshotName);
+		stringPool.insert(stringPool.end(), name.first.c_str(), name.first.c_str() + name.first.size() + 1);
+	}
+
+	EntitySnapshotHeader header = {};
+	header.mMagic = ENTITY_SNAPSHOT_MAGIC;
+	header.mVersion = ENTITY_SNAPSHOT_VERSION;
+	header.mSlotCount = mSlotCount;
+	header.mFreeIndexCount = (uint32_t)freeIndices.size();
+	header.mEntityCount = (uint32_t)entities.size();
+	header.mTypeCount = (uint32_t)types.size();
+	header.mArchetypeCount = (uint32_t)archetypes.size();
+	header.mComponentArrayCount = (uint32_t)arrays.size();
+	header.mFirstIndividualArray = firstIndividualArray;
+	header.mNameCount = (uint32_t)names.size();
+	header.mStringPoolSize = (uint32_t)stringPool.size();
+	header.mGenerationsOffset = appendSection(data, generations);
+	header.mFreeIndicesOffset = appendSection(data, freeIndices);
+	header.mEntitiesOffset = appendSection(data, entities);
+	header.mTypesOffset = appendSection(data, types);
+	header.mArchetypesOffset = appendSection(data, archetypes);
+	header.mComponentArraysOffset = appendSection(data, arrays);
+	header.mNamesOffset = appendSection(data, names);
+	header.mStringPoolOffset = appendSection(data, stringPool);
+	memcpy(data.data(), &header, sizeof(header));
+}
+
+bool EntityManager::readSnapshot(const void* pSnapshot, size_t size)
+{
+	const uint8_t*              pData = (const uint8_t*)pSnapshot;
+	const EntitySnapshotHeader* pHeader = (const EntitySnapshotHeader*)pData;
+	if (size < sizeof(EntitySnapshotHeader) || pHeader->mMagic != ENTITY_SNAPSHOT_MAGIC)
+	{
+		LOGF(eERROR, "Entity snapshot: not a snapshot");
+		return false;
+	}
+	if (pHeader->mVersion != ENTITY_SNAPSHOT_VERSION)
+	{
+		LOGF(eERROR, "Entity snapshot: version %u, expected %u", pHeader->mVersion, ENTITY_SNAPSHOT_VERSION);
+		return false;
+	}
+
+	// Validate everything before touching the world
+	if (!pHeader->mSlotCount || pHeader->mSlotCount > ENTITY_MAX_COUNT || pHeader->mFirstIndividualArray > pHeader->mComponentArrayCount ||
+		!isInSnapshot(size, pHeader->mGenerationsOffset, pHeader->mSlotCount, sizeof(uint32_t)) ||
+		!isInSnapshot(size, pHeader->mFreeIndicesOffset, pHeader->mFreeIndexCount, sizeof(uint32_t)) ||
+		!isInSnapshot(size, pHeader->mEntitiesOffset, pHeader->mEntityCount, sizeof(EntitySnapshotEntity)) ||
+		!isInSnapshot(size, pHeader->mTypesOffset, pHeader->mTypeCount, sizeof(EntitySnapshotType)) ||
+		!isInSnapshot(size, pHeader->mArchetypesOffset, pHeader->mArchetypeCount, sizeof(EntitySnapshotArchetype)) ||
+		!isInSnapshot(size, pHeader->mComponentArraysOffset, pHeader->mComponentArrayCount, sizeof(EntitySnapshotComponentArray)) ||
+		!isInSnapshot(size, pHeader->mNamesOffset, pHeader->mNameCount, sizeof(EntitySnapshotName)) ||
+		!isInSnapshot(size, pHeader->mStringPoolOffset, pHeader->mStringPoolSize, 1) ||
+		(pHeader->mStringPoolSize && pData[pHeader->mStringPoolOffset + pHeader->mStringPoolSize - 1] != 0))
+	{
+		LOGF(eERROR, "Entity snapshot: truncated or corrupt");
+		return false;
+	}
+
+	const uint32_t*                     pGenerations = getSection<uint32_t>(pData, pHeader->mGenerationsOffset);
+	const uint32_t*                     pFreeIndices = getSection<uint32_t>(pData, pHeader->mFreeIndicesOffset);
+	const EntitySnapshotEntity*         pEntities = getSection<EntitySnapshotEntity>(pData, pHeader->mEntitiesOffset);
+	const EntitySnapshotType*           pTypes = getSection<EntitySnapshotType>(pData, pHeader->mTypesOffset);
+	const EntitySnapshotArchetype*      pArchetypes = getSection<EntitySnapshotArchetype>(pData, pHeader->mArchetypesOffset);
+	const EntitySnapshotComponentArray* pArrays = getSection<EntitySnapshotComponentArray>(pData, pHeader->mComponentArraysOffset);
+	const EntitySnapshotName*           pNames = getSection<EntitySnapshotName>(pData, pHeader->mNamesOffset);
+	const char*                         pStringPool = getSection<char>(pData, pHeader->mStringPoolOffset);
+
+	// Component types are looked up through their generators, the stored size catches layout changes
+	eastl::vector<const ComponentTypeInfo*> typeInfos(pHeader->mTypeCount);
+	const eastl::unordered_map<uint32_t, ComponentGeneratorFctPtr>& CompGenMap = ComponentRegistrator::getInstance()->getComponentGeneratorMap();
+	for (uint32_t i = 0; i < pHeader->mTypeCount; ++i)
+	{
+		eastl::unordered_map<uint32_t, ComponentGeneratorFctPtr>::const_iterator itr = CompGenMap.find(pTypes[i].mType);
+		if (itr == CompGenMap.end())
+		{
+			LOGF(eERROR, "Entity snapshot: unknown component type %u", pTypes[i].mType);
+			return false;
+		}
+
+		BaseComponent* pComponent = itr->second();
+		typeInfos[i] = pComponent->getTypeInfo();
+		pComponent->~BaseComponent();
+		tf_free(pComponent);
+
+		if (typeInfos[i]->mSize - ComponentDataOffset != pTypes[i].mDataSize)
+		{
+			LOGF(eERROR, "Entity snapshot: component type %u has %u bytes of data, the snapshot %u", pTypes[i].mType,
+				 typeInfos[i]->mSize - ComponentDataOffset, pTypes[i].mDataSize);
+			return false;
+		}
+	}
+
+	// Slots of the snapshot entities, 2 once an archetype row was found for the entity
+	eastl::vector<uint8_t> slotStates(pHeader->mSlotCount, 0);
+	for (uint32_t i = 0; i < pHeader->mEntityCount; ++i)
+	{
+		const uint32_t index = getEntityIndex(pEntities[i].mId);
+		if (!index || index >= pHeader->mSlotCount || slotStates[index] || pGenerations[index] != getEntityGeneration(pEntities[i].mId) ||
+			(pEntities[i].mArchetype != ENTITY_SNAPSHOT_NO_ARCHETYPE && pEntities[i].mArchetype >= pHeader->mArchetypeCount))
+		{
+			LOGF(eERROR, "Entity snapshot: invalid entity %u", pEntities[i].mId);
+			return false;
+		}
+		slotStates[index] = 1;
+	}
+
+	for (uint32_t i = 0; i < pHeader->mFreeIndexCount; ++i)
+	{
+		if (!pFreeIndices[i] || pFreeIndices[i] >= pHeader->mSlotCount)
+		{
+			LOGF(eERROR, "Entity snapshot: invalid free slot %u", pFreeIndices[i]);
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < pHeader->mComponentArrayCount; ++i)
+	{
+		const EntitySnapshotComponentArray& array = pArrays[i];
+		const bool individual = i >= pHeader->mFirstIndividualArray;
+		if (array.mTypeIndex >= pHeader->mTypeCount || !isInSnapshot(size, array.mDataOffset, array.mCount, pTypes[array.mTypeIndex].mDataSize) ||
+			(individual && !isInSnapshot(size, array.mEntityIdsOffset, array.mCount, sizeof(EntityId))))
+		{
+			LOGF(eERROR, "Entity snapshot: invalid component array %u", i);
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < pHeader->mArchetypeCount; ++i)
+	{
+		const EntitySnapshotArchetype& archetype = pArchetypes[i];
+		bool valid = archetype.mArrayCount <= ARCHETYPE_MAX_COMPONENTS && archetype.mFirstArray <= pHeader->mFirstIndividualArray &&
+					 archetype.mArrayCount <= pHeader->mFirstIndividualArray - archetype.mFirstArray &&
+					 isInSnapshot(size, archetype.mEntityIdsOffset, archetype.mRowCount, sizeof(EntityId));
+		for (uint32_t j = 0; valid && j < archetype.mArrayCount; ++j)
+		{
+			const EntitySnapshotComponentArray& array = pArrays[archetype.mFirstArray + j];
+			valid = array.mCount == archetype.mRowCount &&
+					(j == 0 || pTypes[pArrays[archetype.mFirstArray + j - 1].mTypeIndex].mType < pTypes[array.mTypeIndex].mType);
+		}
+		// Every row belongs to an entity of the snapshot that has no other row
+		const EntityId* pIds = valid ? getSection<EntityId>(pData, archetype.mEntityIdsOffset) : NULL;
+		for (uint32_t row = 0; valid && row < archetype.mRowCount; ++row)
+		{
+			const uint32_t index = getEntityIndex(pIds[row]);
+			valid = index < pHeader->mSlotCount && slotStates[index] == 1 && pGenerations[index] == getEntityGeneration(pIds[row]);
+			if (valid)
+				slotStates[index] = 2;
+		}
+		if (!valid)
+		{
+			LOGF(eERROR, "Entity snapshot: invalid archetype %u", i);
+			return false;
+		}
+	}
+
+	// Individual components belong to entities of the snapshot without an archetype row, at most one of each type.
+	// Types are checked one after the other, the slots keep the last type found for them plus one
+	eastl::vector<uint32_t> slotTypes(pHeader->mSlotCount, 0);
+	for (uint32_t type = 0; type < pHeader->mTypeCount; ++type)
+	{
+		for (uint32_t i = pHeader->mFirstIndividualArray; i < pHeader->mComponentArrayCount; ++i)
+		{
+			const EntitySnapshotComponentArray& array = pArrays[i];
+			if (array.mTypeIndex != type)
+				continue;
+
+			const EntityId* pIds = getSection<EntityId>(pData, array.mEntityIdsOffset);
+			for (uint32_t j = 0; j < array.mCount; ++j)
+			{
+				const uint32_t index = getEntityIndex(pIds[j]);
+				if (index >= pHeader->mSlotCount || slotStates[index] != 1 || pGenerations[index] != getEntityGeneration(pIds[j]) ||
+					slotTypes[index] == type + 1)
+				{
+					LOGF(eERROR, "Entity snapshot: invalid component array %u", i);
+					return false;
+				}
+				slotTypes[index] = type + 1;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < pHeader->mNameCount; ++i)
+	{
+		if (pNames[i].mStringOffset >= pHeader->mStringPoolSize)
+		{
+			LOGF(eERROR, "Entity snapshot: invalid name %u", i);
+			return false;
+		}
+	}
+
+	reset();
+	mEntitiesName.clear();
+
+	// Slots get back their generations and the free list its order, so ids are handed out as if the world never changed
+	const uint32_t oldSlotCount = mSlotCount;
+	mSlotCount = 1;
+	mFreeIndices.clear();
+	tfrg_atomic32_store_relaxed(&mFreeCursor, (uint32_t)(1 - (int32_t)pHeader->mSlotCount));
+	flushReservedIds();
+	for (uint32_t i = 0; i < max(oldSlotCount, mSlotCount); ++i)
+		getSlot(i)->mGeneration = i < mSlotCount ? pGenerations[i] : 0;
+	mFreeIndices.assign(pFreeIndices, pFreeIndices + pHeader->mFreeIndexCount);
+	tfrg_atomic32_store_relaxed(&mFreeCursor, pHeader->mFreeIndexCount);
+
+	for (uint32_t i = 0; i < pHeader->mEntityCount; ++i)
+		bindEntity(pEntities[i].mId, tf_placement_new<Entity>(tf_calloc(1, sizeof(Entity))));
+
+	// Archetype rows are allocated in bulk, then every column is constructed and filled from its array
+	eastl::vector<uint32_t> rows;
+	for (uint32_t i = 0; i < pHeader->mArchetypeCount; ++i)
+	{
+		const EntitySnapshotArchetype& archetype = pArchetypes[i];
+		const EntityId*                pIds = getSection<EntityId>(pData, archetype.mEntityIdsOffset);
+
+		const ComponentTypeInfo* types[ARCHETYPE_MAX_COMPONENTS];
+		for (uint32_t j = 0; j < archetype.mArrayCount; ++j)
+			types[j] = typeInfos[pArrays[archetype.mFirstArray + j].mTypeIndex];
+		Archetype* pArchetype = getArchetype(types, archetype.mArrayCount);
+
+		rows.resize(archetype.mRowCount);
+		for (uint32_t row = 0; row < archetype.mRowCount; ++row)
+		{
+			Entity* pEntity = findEntity(pIds[row]);
+			ASSERT(pEntity && !pEntity->pArchetype);
+			pEntity->pArchetype = pArchetype;
+			pEntity->mArchetypeRow = rows[row] = pArchetype->allocateRow(pIds[row]);
+		}
+
+		for (uint32_t j = 0; j < archetype.mArrayCount; ++j)
+		{
+			const uint32_t dataSize = pTypes[pArrays[archetype.mFirstArray + j].mTypeIndex].mDataSize;
+			const uint8_t* pSrc = pData + pArrays[archetype.mFirstArray + j].mDataOffset;
+			for (uint32_t row = 0; row < archetype.mRowCount; ++row, pSrc += dataSize)
+			{
+				uint8_t* pDst = (uint8_t*)pArchetype->getComponent(j, rows[row]);
+				types[j]->pConstruct(pDst);
+				memcpy(pDst + ComponentDataOffset, pSrc, dataSize);
+			}
+		}
+	}
+
+	for (uint32_t i = pHeader->mFirstIndividualArray; i < pHeader->mComponentArrayCount; ++i)
+	{
+		const EntitySnapshotComponentArray& array = pArrays[i];
+		const EntityId*                     pIds = getSection<EntityId>(pData, array.mEntityIdsOffset);
+		const uint32_t                      dataSize = pTypes[array.mTypeIndex].mDataSize;
+		const uint8_t*                      pSrc = pData + array.mDataOffset;
+		for (uint32_t j = 0; j < array.mCount; ++j, pSrc += dataSize)
+		{
+			uint8_t* pComponent = (uint8_t*)addComponentToEntity(pIds[j], typeInfos[array.mTypeIndex]);
+			memcpy(pComponent + ComponentDataOffset, pSrc, dataSize);
+		}
+	}
+
+	for (uint32_t i = 0; i < pHeader->mNameCount; ++i)
+		mEntitiesName[eastl::string(pStringPool + pNames[i].mStringOffset)] = pNames[i].mId;
+
+	return true;
+}
+
+bool EntityManager::saveSnapshot(const ResourceDirectory resourceDir, const char* fileName, const EntityId* pIds, uint32_t idCount)
+{
+	eastl::vector<uint8_t> data;
+	writeSnapshot(data, pIds, idCount);
+
+	FileStream stream = {};
+	if (!fsOpenStreamFromPath(resourceDir, fileName, FM_WRITE_BINARY, &stream))
+	{
+		LOGF(eERROR, "Entity snapshot: could not open '%s' for writing", fileName);
+		return false;
+	}
+
+	const bool written = fsWriteToStream(&stream, data.data(), data.size()) == data.size();
+	fsCloseStream(&stream);
+	if (!written)
+		LOGF(eERROR, "Entity snapshot: could not write '%s'", fileName);
+
+	return written;
+}
+
+bool EntityManager::loadSnapshot(const ResourceDirectory resourceDir, const char* fileName)
+{
+	// Components are copied straight out of the mapping
+	MappedFile file = {};
+	if (!fsMapFileFromPath(resourceDir, fileName, &file))
+	{
+		LOGF(eERROR, "Entity snapshot: could not open '%s'", fileName);
+		return false;
+	}
+
+	const bool loaded = readSnapshot(file.pData, file.mSize);
+	fsUnmapFile(&file);
+	return loaded;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+
+#pragma once
+
+#include "Archetype.h"
+
+// Binary snapshot of EntityManager entities, see EntityManager::writeSnapshot.
+// The header is followed by its sections, each aligned to ENTITY_SNAPSHOT_ALIGNMENT, all offsets are from the start
+// of the snapshot. Components are stored without their BaseComponent part, one packed array per component type and
+// archetype, so every array can be copied into freshly constructed components.
+#define ENTITY_SNAPSHOT_MAGIC 0x53434546    // "FECS"
+#define ENTITY_SNAPSHOT_VERSION 1
+#define ENTITY_SNAPSHOT_ALIGNMENT 16
+#define ENTITY_SNAPSHOT_NO_ARCHETYPE 0xFFFFFFFF
+
+struct EntitySnapshotHeader
+{
+	uint32_t mMagic;
+	uint32_t mVersion;
+	// One uint32_t generation per entity slot, followed by the uint32_t free slot indices in allocation order
+	uint32_t mSlotCount;
+	uint32_t mFreeIndexCount;
+	uint32_t mEntityCount;
+	uint32_t mTypeCount;
+	uint32_t mArchetypeCount;
+	// Arrays of archetype columns come first, followed by the arrays of individually allocated components
+	uint32_t mComponentArrayCount;
+	uint32_t mFirstIndividualArray;
+	uint32_t mNameCount;
+	uint32_t mStringPoolSize;
+	uint32_t mPadding;
+	uint64_t mGenerationsOffset;
+	uint64_t mFreeIndicesOffset;
+	uint64_t mEntitiesOffset;
+	uint64_t mTypesOffset;
+	uint64_t mArchetypesOffset;
+	uint64_t mComponentArraysOffset;
+	uint64_t mNamesOffset;
+	uint64_t mStringPoolOffset;
+};
+
+struct EntitySnapshotEntity
+{
+	EntityId mId;
+	// Index of the archetype the entity is stored in, ENTITY_SNAPSHOT_NO_ARCHETYPE for individually allocated components
+	uint32_t mArchetype;
+};
+
+struct EntitySnapshotType
+{
+	uint32_t mType;
+	// Bytes stored per component, the size of the component minus its BaseComponent
+	uint32_t mDataSize;
+};
+
+struct EntitySnapshotArchetype
+{
+	// mArrayCount columns sorted by type, all of mRowCount components
+	uint32_t mFirstArray;
+	uint32_t mArrayCount;
+	uint32_t mRowCount;
+	uint32_t mPadding;
+	// mRowCount ids of the entities of the rows
+	uint64_t mEntityIdsOffset;
+};
+
+struct EntitySnapshotComponentArray
+{
+	uint32_t mTypeIndex;
+	uint32_t mCount;
+	// Ids of the entities owning the components, 0 for archetype columns whose owners are the archetype rows
+	uint64_t mEntityIdsOffset;
+	// mCount * EntitySnapshotType::mDataSize bytes
+	uint64_t mDataOffset;
+};
+
+struct EntitySnapshotName
+{
+	EntityId mId;
+	// Offset of the null terminated name in the string pool
+	uint32_t mStringOffset;
+};
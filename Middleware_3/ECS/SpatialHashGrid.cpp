@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+
+#include "SpatialHashGrid.h"
+
+#include "../../Common_3/OS/Interfaces/ILog.h"
+
+#include "../../Common_3/OS/Interfaces/IMemory.h"    // Must be the last include in a cpp file
+
+SpatialHashGrid::SpatialHashGrid(float cellSize, uint32_t bucketCount):
+	mCellSize(cellSize),
+	mInvCellSize(1.0f / cellSize),
+	mBucketMask(0),
+	mTaskCount(0)
+{
+	ASSERT(cellSize > 0.0f);
+
+	uint32_t powerOfTwo = 1;
+	while (powerOfTwo < bucketCount && powerOfTwo < (1u << 31))
+		powerOfTwo <<= 1;
+	mBucketMask = powerOfTwo - 1;
+
+	mBucketStarts.resize(powerOfTwo + 1, 0);
+}
+
+void SpatialHashGrid::beginBuild(uint32_t pointCount, uint32_t taskCount)
+{
+	// Points are only sorted by tasks, queries would walk unsorted points in the buckets of the previous build
+	ASSERT((taskCount > 0 || pointCount == 0) && "Points can't be built without any task");
+
+	mTaskCount = taskCount;
+	mPoints.resize(pointCount);
+	mPointBuckets.resize(pointCount);
+	mSortedPoints.resize(pointCount);
+	mTaskOffsets.resize((size_t)taskCount * (mBucketMask + 1));
+}
+
+void SpatialHashGrid::countPoints(uint32_t task, uint32_t first, uint32_t count)
+{
+	ASSERT(task < mTaskCount && first + count <= (uint32_t)mPoints.size());
+
+	uint32_t* pCounts = mTaskOffsets.data() + (size_t)task * (mBucketMask + 1);
+	memset(pCounts, 0, (mBucketMask + 1) * sizeof(uint32_t));
+
+	for (uint32_t i = first; i < first + count; ++i)
+	{
+		const SpatialHashGridPoint& point = mPoints[i];
+		const uint32_t              bucket = getBucket(getCellCoord(point.x), getCellCoord(point.y));
+		mPointBuckets[i] = bucket;
+		++pCounts[bucket];
+	}
+}
+
+void SpatialHashGrid::sortPoints()
+{
+	// Exclusive prefix sum in bucket major order, within a bucket the points of task 0 come first
+	const uint32_t bucketCount = mBucketMask + 1;
+	uint32_t       offset = 0;
+	for (uint32_t bucket = 0; bucket < bucketCount; ++bucket)
+	{
+		mBucketStarts[bucket] = offset;
+		for (uint32_t task = 0; task < mTaskCount; ++task)
+		{
+			uint32_t& taskOffset = mTaskOffsets[(size_t)task * bucketCount + bucket];
+			const uint32_t count = taskOffset;
+			taskOffset = offset;
+			offset += count;
+		}
+	}
+	mBucketStarts[bucketCount] = offset;
+
+	ASSERT(offset == (uint32_t)mPoints.size() && "countPoints was not called for every point");
+}
+
+void SpatialHashGrid::scatterPoints(uint32_t task, uint32_t first, uint32_t count)
+{
+	ASSERT(task < mTaskCount && first + count <= (uint32_t)mPoints.size());
+
+	uint32_t* pOffsets = mTaskOffsets.data() + (size_t)task * (mBucketMask + 1);
+	for (uint32_t i = first; i < first + count; ++i)
+		mSortedPoints[pOffsets[mPointBuckets[i]]++] = mPoints[i];
+}
+
+void SpatialHashGrid::build(const SpatialHashGridPoint* pPoints, uint32_t count)
+{
+	beginBuild(count, 1);
+	if (count)
+		memcpy(mPoints.data(), pPoints, count * sizeof(SpatialHashGridPoint));
+	countPoints(0, 0, count);
+	sortPoints();
+	scatterPoints(0, 0, count);
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+
+#pragma once
+
+#include "../../Common_3/OS/Math/MathTypes.h"
+
+#include "../../Common_3/ThirdParty/OpenSource/EASTL/vector.h"
+
+struct SpatialHashGridPoint
+{
+	float    x;
+	float    y;
+	uint32_t mValue;
+};
+
+// Uniform grid of 2D points, hashed into a fixed number of buckets so the world does not need bounds.
+// The grid is rebuilt from scratch with a counting sort that runs as a number of tasks:
+//   beginBuild                           once
+//   setPoint + countPoints               for every task, concurrently
+//   sortPoints                           once
+//   scatterPoints                        for every task, concurrently
+// Each task covers a contiguous range of points and must use the same range in both passes, the sorted order
+// only depends on the points and the ranges, not on the order the tasks ran in.
+// Once built the grid is read only and queries can be run from any number of threads.
+class SpatialHashGrid
+{
+public:
+	// bucketCount is rounded up to a power of two, a few times the number of occupied cells is enough
+	SpatialHashGrid(float cellSize, uint32_t bucketCount);
+
+	inline float    getCellSize() const { return mCellSize; }
+	inline uint32_t getPointCount() const { return (uint32_t)mPoints.size(); }
+
+	// taskCount can only be 0 when there are no points
+	void beginBuild(uint32_t pointCount, uint32_t taskCount);
+
+	inline void setPoint(uint32_t index, float x, float y, uint32_t value) { mPoints[index] = { x, y, value }; }
+
+	// Histogram of the cells of points [first, first + count) for task, these points must have been set
+	void countPoints(uint32_t task, uint32_t first, uint32_t count);
+
+	void sortPoints();
+
+	void scatterPoints(uint32_t task, uint32_t first, uint32_t count);
+
+	// Builds the grid on the calling thread
+	void build(const SpatialHashGridPoint* pPoints, uint32_t count);
+
+	// Calls func(const SpatialHashGridPoint&) for every point at a distance of at most radius from (x, y)
+	template <typename Func>
+	void queryRadius(float x, float y, float radius, Func func) const
+	{
+		const float radiusSq = radius * radius;
+		queryBox(x - radius, y - radius, x + radius, y + radius, [&](const SpatialHashGridPoint& point) {
+			const float dx = point.x - x;
+			const float dy = point.y - y;
+			if (dx * dx + dy * dy <= radiusSq)
+				func(point);
+		});
+	}
+
+	// Calls func(const SpatialHashGridPoint&) for every point inside the box, bounds included
+	template <typename Func>
+	void queryBox(float xMin, float yMin, float xMax, float yMax, Func func) const
+	{
+		// Empty grids may be built without any task and sortPoints, mBucketStarts is then left from the previous build
+		if (mSortedPoints.empty())
+			return;
+
+		const int32_t cellXMin = getCellCoord(xMin);
+		const int32_t cellYMin = getCellCoord(yMin);
+		const int32_t cellXMax = getCellCoord(xMax);
+		const int32_t cellYMax = getCellCoord(yMax);
+
+		// Boxes covering more cells than there are buckets are cheaper to test against every point
+		const uint64_t cellCount = (uint64_t)(cellXMax - cellXMin + 1) * (uint64_t)(cellYMax - cellYMin + 1);
+		if (cellCount > (uint64_t)mBucketMask + 1)
+		{
+			for (const SpatialHashGridPoint& point : mSortedPoints)
+			{
+				if (point.x >= xMin && point.x <= xMax && point.y >= yMin && point.y <= yMax)
+					func(point);
+			}
+			return;
+		}
+
+		for (int32_t cellY = cellYMin; cellY <= cellYMax; ++cellY)
+		{
+			for (int32_t cellX = cellXMin; cellX <= cellXMax; ++cellX)
+			{
+				const uint32_t bucket = getBucket(cellX, cellY);
+				const uint32_t end = mBucketStarts[bucket + 1];
+				for (uint32_t i = mBucketStarts[bucket]; i < end; ++i)
+				{
+					// Buckets are shared by several cells, only points of this cell are reported so none is reported twice
+					const SpatialHashGridPoint& point = mSortedPoints[i];
+					if (getCellCoord(point.x) != cellX || getCellCoord(point.y) != cellY)
+						continue;
+					if (point.x >= xMin && point.x <= xMax && point.y >= yMin && point.y <= yMax)
+						func(point);
+				}
+			}
+		}
+	}
+
+private:
+	// floorf is a library call on targets without SSE4.1, truncate and fix negative values instead
+	inline int32_t getCellCoord(float v) const
+	{
+		const float   scaled = v * mInvCellSize;
+		const int32_t truncated = (int32_t)scaled;
+		return truncated - (scaled < (float)truncated ? 1 : 0);
+	}
+
+	inline uint32_t getBucket(int32_t cellX, int32_t cellY) const
+	{
+		return (((uint32_t)cellX * 73856093u) ^ ((uint32_t)cellY * 19349663u)) & mBucketMask;
+	}
+
+	float    mCellSize;
+	float    mInvCellSize;
+	uint32_t mBucketMask;
+	uint32_t mTaskCount;
+
+	eastl::vector<SpatialHashGridPoint> mPoints;
+	eastl::vector<uint32_t>             mPointBuckets;
+	// Per task histograms, turned into the scatter offsets of each task by sortPoints
+	eastl::vector<uint32_t>             mTaskOffsets;
+	// mBucketStarts[b] to mBucketStarts[b + 1] are the points of bucket b in mSortedPoints
+	eastl::vector<uint32_t>             mBucketStarts;
+	eastl::vector<SpatialHashGridPoint> mSortedPoints;
+};
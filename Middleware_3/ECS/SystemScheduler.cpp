@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+
+#include "SystemScheduler.h"
+
+#include "../../Common_3/OS/Interfaces/ITime.h"
+
+#include "../../Common_3/OS/Interfaces/IMemory.h"    // Must be the last include in a cpp file
+
+static bool containsType(const eastl::vector<uint32_t>& types, uint32_t type)
+{
+	for (uint32_t t : types)
+	{
+		if (t == type)
+			return true;
+	}
+	return false;
+}
+
+SystemAccess& SystemAccess::read(uint32_t type)
+{
+	if (!containsType(mReads, type))
+		mReads.push_back(type);
+	return *this;
+}
+
+SystemAccess& SystemAccess::write(uint32_t type)
+{
+	if (!containsType(mWrites, type))
+		mWrites.push_back(type);
+	return *this;
+}
+
+SystemAccess& SystemAccess::exclusive()
+{
+	mExclusive = true;
+	return *this;
+}
+
+bool SystemAccess::conflicts(const SystemAccess& other) const
+{
+	if (mExclusive || other.mExclusive)
+		return true;
+
+	for (uint32_t type : mWrites)
+	{
+		if (containsType(other.mReads, type) || containsType(other.mWrites, type))
+			return true;
+	}
+
+	for (uint32_t type : other.mWrites)
+	{
+		if (containsType(mReads, type))
+			return true;
+	}
+
+	return false;
+}
+
+ChunkSystem::ChunkSystem(EntityManager* pEntityManager, uint32_t chunksPerTask):
+	pEntityManager(pEntityManager),
+	mChunksPerTask(max(chunksPerTask, 1u))
+{
+}
+
+uint32_t ChunkSystem::prepare(float deltaTime)
+{
+	mChunks.clear();
+	pEntityManager->getChunks(mTypes.data(), (uint32_t)mTypes.size(), mExcludedTypes.data(), (uint32_t)mExcludedTypes.size(), mChunks);
+	return ((uint32_t)mChunks.size() + mChunksPerTask - 1) / mChunksPerTask;
+}
+
+void ChunkSystem::update(uint32_t task, float deltaTime)
+{
+	const uint32_t end = min((uint32_t)mChunks.size(), (task + 1) * mChunksPerTask);
+	for (uint32_t i = task * mChunksPerTask; i < end; ++i)
+		updateChunk(mChunks[i], deltaTime);
+}
+
+SystemScheduler::SystemScheduler(EntityManager* pEntityManager):
+	pEntityManager(pEntityManager),
+	pThreadSystem(NULL),
+	mDeltaTime(0.0f),
+	mPendingSystems(0)
+{
+}
+
+SystemScheduler::~SystemScheduler()
+{
+	for (SystemNode* pNode : mNodes)
+		tf_delete(pNode);
+}
+
+void SystemScheduler::addSystem(EntitySystem* pSystem)
+{
+	ASSERT(!findNode(pSystem) && "System was already added");
+
+	SystemNode* pNode = tf_new(SystemNode);
+	pNode->pScheduler = this;
+	pNode->pSystem = pSystem;
+	pNode->mDependencyCount = 0;
+	pNode->mTaskCount = 0;
+	pNode->mPendingDependencies = 0;
+	pNode->mPendingTasks = 0;
+	pNode->mStartUSec = 0;
+	pNode->mDurationUSec = 0;
+	pSystem->declareAccess(pNode->mAccess);
+
+	mNodes.push_back(pNode);
+	buildGraph();
+}
+
+void SystemScheduler::removeSystem(EntitySystem* pSystem)
+{
+	for (uint32_t i = 0; i < (uint32_t)mNodes.size(); ++i)
+	{
+		if (mNodes[i]->pSystem == pSystem)
+		{
+			tf_delete(mNodes[i]);
+			mNodes.erase(mNodes.begin() + i);
+			buildGraph();
+			return;
+		}
+	}
+
+	ASSERT(0 && "System was not added");
+}
+
+SystemScheduler::SystemNode* SystemScheduler::findNode(EntitySystem* pSystem) const
+{
+	for (SystemNode* pNode : mNodes)
+	{
+		if (pNode->pSystem == pSystem)
+			return pNode;
+	}
+	return NULL;
+}
+
+void SystemScheduler::buildGraph()
+{
+	// Edges only point from earlier to later systems, so the order systems were added in breaks ties and the graph has no cycles
+	for (SystemNode* pNode : mNodes)
+	{
+		pNode->mDependents.clear();
+		pNode->mDependencyCount = 0;
+	}
+
+	for (uint32_t i = 0; i < (uint32_t)mNodes.size(); ++i)
+	{
+		for (uint32_t j = i + 1; j < (uint32_t)mNodes.size(); ++j)
+		{
+			if (mNodes[i]->mAccess.conflicts(mNodes[j]->mAccess))
+			{
+				mNodes[i]->mDependents.push_back(j);
+				++mNodes[j]->mDependencyCount;
+			}
+		}
+	}
+}
+
+int64_t SystemScheduler::getSystemUSec(EntitySystem* pSystem) const
+{
+	const SystemNode* pNode = findNode(pSystem);
+	return pNode ? pNode->mDurationUSec : 0;
+}
+
+uint32_t SystemScheduler::getDependencyCount(EntitySystem* pSystem) const
+{
+	const SystemNode* pNode = findNode(pSystem);
+	return pNode ? pNode->mDependencyCount : 0;
+}
+
+void SystemScheduler::update(float deltaTime, ThreadSystem* pThreadSystem)
+{
+	this->pThreadSystem = pThreadSystem;
+	mDeltaTime = deltaTime;
+
+	for (SystemNode* pNode : mNodes)
+	{
+		pNode->mPendingDependencies = pNode->mDependencyCount;
+		pNode->mPendingTasks = 0;
+	}
+	tfrg_atomic32_store_release(&mPendingSystems, (uint32_t)mNodes.size());
+
+	// Starting a system queues its tasks, the calling thread then helps until every system finished
+	for (SystemNode* pNode : mNodes)
+	{
+		if (!pNode->mDependencyCount)
+			startSystem(pNode);
+	}
+
+	if (pThreadSystem)
+	{
+		while (assistThreadSystem(pThreadSystem)) {}
+		waitThreadSystemIdle(pThreadSystem);
+	}
+	ASSERT(tfrg_atomic32_load_acquire(&mPendingSystems) == 0);
+
+	// Sync point for the structural changes recorded by the systems
+	if (pEntityManager)
+		pEntityManager->applyCommandBuffers();
+}
+
+void SystemScheduler::startSystem(SystemNode* pNode)
+{
+	pNode->mStartUSec = getUSec();
+	const uint32_t taskCount = pNode->pSystem->prepare(mDeltaTime);
+	if (!taskCount)
+	{
+		finishSystem(pNode);
+		return;
+	}
+
+	runTasks(pNode, taskCount);
+}
+
+void SystemScheduler::runTasks(SystemNode* pNode, uint32_t taskCount)
+{
+	pNode->mTaskCount = taskCount;
+	tfrg_atomic32_store_release(&pNode->mPendingTasks, taskCount);
+	if (pThreadSystem && taskCount > 1)
+	{
+		addThreadSystemRangeTask(pThreadSystem, runSystemTask, pNode, taskCount);
+	}
+	else
+	{
+		// The last task may start the next pass, the loop must not read mTaskCount
+		for (uint32_t i = 0; i < taskCount; ++i)
+			runSystemTask(pNode, i);
+	}
+}
+
+void SystemScheduler::runSystemTask(void* pUser, uintptr_t task)
+{
+	SystemNode*      pNode = (SystemNode*)pUser;
+	SystemScheduler* pScheduler = pNode->pScheduler;
+	pNode->pSystem->update((uint32_t)task, pScheduler->mDeltaTime);
+
+	// The thread finishing the last task starts the next pass or the dependents
+	if (tfrg_atomic32_add_acq_rel(&pNode->mPendingTasks, (uint32_t)-1) == 1)
+	{
+		const uint32_t taskCount = pNode->pSystem->nextPass(pScheduler->mDeltaTime);
+		if (taskCount)
+			pScheduler->runTasks(pNode, taskCount);
+		else
+			pScheduler->finishSystem(pNode);
+	}
+}
+
+void SystemScheduler::finishSystem(SystemNode* pNode)
+{
+	pNode->mDurationUSec = getUSec() - pNode->mStartUSec;
+
+	for (uint32_t dependent : pNode->mDependents)
+	{
+		SystemNode* pDependent = mNodes[dependent];
+		if (tfrg_atomic32_add_acq_rel(&pDependent->mPendingDependencies, (uint32_t)-1) == 1)
+			startSystem(pDependent);
+	}
+
+	tfrg_atomic32_add_acq_rel(&mPendingSystems, (uint32_t)-1);
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+
+#pragma once
+
+#include "../../Common_3/OS/Interfaces/IThread.h"
+#include "../../Common_3/OS/Core/Atomics.h"
+#include "../../Common_3/OS/Core/ThreadSystem.h"
+
+#include "../../Common_3/ThirdParty/OpenSource/EASTL/vector.h"
+
+#include "EntityManager.h"
+
+// Component types a system reads and writes
+class SystemAccess
+{
+public:
+	template <typename T> SystemAccess& read() { return read(T::getTypeStatic()); }
+	template <typename T> SystemAccess& write() { return write(T::getTypeStatic()); }
+	SystemAccess& read(uint32_t type);
+	SystemAccess& write(uint32_t type);
+
+	// The system makes structural changes through the EntityManager directly, it never runs concurrently with other systems
+	SystemAccess& exclusive();
+
+	// True if the two systems must not run at the same time: one writes a component the other one reads or writes
+	bool conflicts(const SystemAccess& other) const;
+
+private:
+	eastl::vector<uint32_t> mReads;
+	eastl::vector<uint32_t> mWrites;
+	bool                    mExclusive = false;
+};
+
+// System run by a SystemScheduler.
+// Structural changes made during update must be recorded in the command buffer of the calling thread,
+// see EntityManager::getCommandBuffer, unless the system declared exclusive access
+class EntitySystem
+{
+public:
+	virtual ~EntitySystem() {}
+
+	// Called once when the system is added to a scheduler
+	virtual void declareAccess(SystemAccess& access) = 0;
+
+	// Called once per frame when the systems this system depends on are done, on any thread.
+	// Returns the number of tasks update is called for, these run concurrently
+	virtual uint32_t prepare(float deltaTime) = 0;
+
+	virtual void update(uint32_t task, float deltaTime) = 0;
+
+	// Called on the thread finishing the last task of the system. Returns the number of tasks of another pass of update,
+	// for work that needs all previous tasks to be done, like the scatter of a counting sort. 0 finishes the system
+	virtual uint32_t nextPass(float deltaTime) { return 0; }
+};
+
+// System processing the archetype chunks that store the query types and none of the excluded types, mChunksPerTask chunks per task
+class ChunkSystem: public EntitySystem
+{
+public:
+	ChunkSystem(EntityManager* pEntityManager, uint32_t chunksPerTask);
+
+	template <typename... Ts>
+	void setQuery()
+	{
+		const uint32_t types[] = { 0, Ts::getTypeStatic()... };
+		mTypes.assign(types + 1, types + 1 + sizeof...(Ts));
+	}
+
+	template <typename... Ts>
+	void setExcludedTypes()
+	{
+		const uint32_t types[] = { 0, Ts::getTypeStatic()... };
+		mExcludedTypes.assign(types + 1, types + 1 + sizeof...(Ts));
+	}
+
+	// Gathers the chunks, systems overriding this to gather per frame data must call it
+	virtual uint32_t prepare(float deltaTime) override;
+
+	virtual void update(uint32_t task, float deltaTime) override;
+
+	virtual void updateChunk(ArchetypeChunk* pChunk, float deltaTime) = 0;
+
+protected:
+	EntityManager*                 pEntityManager;
+	eastl::vector<uint32_t>        mTypes;
+	eastl::vector<uint32_t>        mExcludedTypes;
+	uint32_t                       mChunksPerTask;
+	eastl::vector<ArchetypeChunk*> mChunks;
+};
+
+// Runs systems in parallel on a ThreadSystem.
+// Systems are ordered by the access they declare: a system depends on every system added before it whose access
+// conflicts with its own. Every frame the systems without pending dependencies are prepared and their tasks queued,
+// a system is started as soon as the last task of its last dependency finished, so independent systems overlap
+// and no system waits for the whole thread system to become idle.
+class SystemScheduler
+{
+public:
+	// Command buffers of pEntityManager are applied after all systems ran
+	SystemScheduler(EntityManager* pEntityManager);
+	~SystemScheduler();
+
+	void addSystem(EntitySystem* pSystem);
+	void removeSystem(EntitySystem* pSystem);
+
+	// Runs all systems once on pThreadSystem and the calling thread, or on the calling thread only when pThreadSystem is NULL
+	void update(float deltaTime, ThreadSystem* pThreadSystem);
+
+	// Time from the start of prepare to the end of the last task of the system during the last update
+	int64_t getSystemUSec(EntitySystem* pSystem) const;
+
+	// Number of systems the system waits for, for debugging the schedule
+	uint32_t getDependencyCount(EntitySystem* pSystem) const;
+
+private:
+	struct SystemNode
+	{
+		SystemScheduler*        pScheduler;
+		EntitySystem*           pSystem;
+		SystemAccess            mAccess;
+		eastl::vector<uint32_t> mDependents;
+		uint32_t                mDependencyCount;
+		uint32_t                mTaskCount;
+		tfrg_atomic32_t         mPendingDependencies;
+		tfrg_atomic32_t         mPendingTasks;
+		int64_t                 mStartUSec;
+		int64_t                 mDurationUSec;
+	};
+
+	SystemNode* findNode(EntitySystem* pSystem) const;
+	void        buildGraph();
+	void        startSystem(SystemNode* pNode);
+	void        runTasks(SystemNode* pNode, uint32_t taskCount);
+	void        finishSystem(SystemNode* pNode);
+
+	static void runSystemTask(void* pUser, uintptr_t task);
+
+	EntityManager*            pEntityManager;
+	ThreadSystem*             pThreadSystem;
+	eastl::vector<SystemNode*> mNodes;
+	float                     mDeltaTime;
+	tfrg_atomic32_t           mPendingSystems;
+};
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+#include "LuaAllocator.h"
+
+#include "../../Common_3/OS/Interfaces/ILog.h"
+#include "../../Common_3/OS/Interfaces/IMemory.h"
+
+//Multiples of 8 bytes, the alignment Lua expects from its allocator
+static const uint32_t gSizeClassSizes[LUA_ALLOCATOR_SIZE_CLASS_COUNT] = { 8, 16, 24, 32, 48, 64, 80, 96, 128, 160, 192, 256 };
+
+//Size class of the sizes (8 * i - 7) to 8 * i
+static const uint8_t gSizeClassOfSize[LUA_ALLOCATOR_MAX_POOLED_SIZE / 8 + 1] = {
+	0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 11,
+};
+
+static inline uint32_t GetSizeClass(size_t size) { return gSizeClassOfSize[(size + 7) / 8]; }
+
+LuaAllocator::LuaAllocator():
+	mUsedBytes(0),
+	mLargeBytes(0),
+	mNumAllocations(0),
+	mNumReallocations(0),
+	mNumFrees(0),
+	mNumLargeAllocations(0)
+{
+	memset(mSizeClasses, 0, sizeof(mSizeClasses));
+}
+
+LuaAllocator::~LuaAllocator()
+{
+	//lua_close frees every block of the state
+	ASSERT(mUsedBytes == 0);
+	for (void* pPage : mPages)
+		tf_free(pPage);
+	mPages.set_capacity(0);
+}
+
+void* LuaAllocator::Alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+	LuaAllocator* pAllocator = (LuaAllocator*)ud;
+	//osize is the type of the object when ptr is NULL
+	if (ptr == NULL)
+		return nsize == 0 ? NULL : pAllocator->Allocate(nsize);
+	if (nsize == 0)
+	{
+		pAllocator->Free(ptr, osize);
+		return NULL;
+	}
+	return pAllocator->Reallocate(ptr, osize, nsize);
+}
+
+void* LuaAllocator::Allocate(size_t size)
+{
+	void* ptr = NULL;
+	if (size > LUA_ALLOCATOR_MAX_POOLED_SIZE)
+	{
+		ptr = tf_malloc(size);
+		if (ptr == NULL)
+			return NULL;
+		mLargeBytes += size;
+		++mNumLargeAllocations;
+	}
+	else
+	{
+		const uint32_t sizeClass = GetSizeClass(size);
+		const uint32_t blockSize = gSizeClassSizes[sizeClass];
+		SizeClass&     pool = mSizeClasses[sizeClass];
+		if (pool.pFreeList)
+		{
+			ptr = pool.pFreeList;
+			pool.pFreeList = pool.pFreeList->pNext;
+		}
+		else
+		{
+			if (pool.pCursor + blockSize > pool.pEnd)
+			{
+				char* pPage = (char*)tf_malloc(LUA_ALLOCATOR_PAGE_SIZE);
+				if (pPage == NULL)
+					return NULL;
+				mPages.push_back(pPage);
+				//The rest of the previous page is too small for a block and stays unused
+				pool.pCursor = pPage;
+				pool.pEnd = pPage + LUA_ALLOCATOR_PAGE_SIZE;
+			}
+			ptr = pool.pCursor;
+			pool.pCursor += blockSize;
+		}
+	}
+
+	mUsedBytes += size;
+	++mNumAllocations;
+	return ptr;
+}
+
+void* LuaAllocator::Reallocate(void* ptr, size_t oldSize, size_t newSize)
+{
+	const bool oldPooled = oldSize <= LUA_ALLOCATOR_MAX_POOLED_SIZE;
+	const bool newPooled = newSize <= LUA_ALLOCATOR_MAX_POOLED_SIZE;
+	void*      newPtr = NULL;
+
+	if (oldPooled && newPooled && GetSizeClass(oldSize) == GetSizeClass(newSize))
+	{
+		newPtr = ptr;
+	}
+	else if (!oldPooled && !newPooled)
+	{
+		newPtr = tf_realloc(ptr, newSize);
+		if (newPtr == NULL)
+			return NULL;
+		mLargeBytes += newSize;
+		mLargeBytes -= oldSize;
+	}
+	else
+	{
+		//Moves between size classes or between the pool and the heap, the old block is still valid if this fails
+		newPtr = Allocate(newSize);
+		if (newPtr == NULL)
+			return NULL;
+		memcpy(newPtr, ptr, oldSize < newSize ? oldSize : newSize);
+		Free(ptr, oldSize);
+		//Counted as a reallocation only
+		--mNumAllocations;
+		--mNumFrees;
+		++mNumReallocations;
+		return newPtr;
+	}
+
+	mUsedBytes += newSize;
+	mUsedBytes -= oldSize;
+	++mNumReallocations;
+	return newPtr;
+}
+
+void LuaAllocator::Free(void* ptr, size_t size)
+{
+	if (size > LUA_ALLOCATOR_MAX_POOLED_SIZE)
+	{
+		tf_free(ptr);
+		mLargeBytes -= size;
+	}
+	else
+	{
+		SizeClass& pool = mSizeClasses[GetSizeClass(size)];
+		FreeBlock* pBlock = (FreeBlock*)ptr;
+		pBlock->pNext = pool.pFreeList;
+		pool.pFreeList = pBlock;
+	}
+
+	mUsedBytes -= size;
+	++mNumFrees;
+}
+
+void LuaAllocator::GetStats(LuaMemoryStats* pOutStats) const
+{
+	pOutStats->mUsedBytes = mUsedBytes;
+	pOutStats->mReservedBytes = (uint64_t)mPages.size() * LUA_ALLOCATOR_PAGE_SIZE + mLargeBytes;
+	pOutStats->mLargeBytes = mLargeBytes;
+	pOutStats->mNumPages = (uint32_t)mPages.size();
+	pOutStats->mNumAllocations = mNumAllocations;
+	pOutStats->mNumReallocations = mNumReallocations;
+	pOutStats->mNumFrees = mNumFrees;
+	pOutStats->mNumLargeAllocations = mNumLargeAllocations;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+#pragma once
+
+#include "LuaManagerCommon.h"
+
+#include "../../Common_3/ThirdParty/OpenSource/EASTL/vector.h"
+
+#define LUA_ALLOCATOR_SIZE_CLASS_COUNT 12
+//Bigger blocks (large tables, long strings) are allocated from the heap
+#define LUA_ALLOCATOR_MAX_POOLED_SIZE 256
+#define LUA_ALLOCATOR_PAGE_SIZE 8192
+
+//lua_Alloc of one lua_State. Blocks up to LUA_ALLOCATOR_MAX_POOLED_SIZE are rounded up to a size class and
+//carved from pages of LUA_ALLOCATOR_PAGE_SIZE bytes, freed blocks go to the free list of their class.
+//A lua_State is only used by one thread at a time, so nothing is locked. Pages are kept until the state is closed.
+class LuaAllocator
+{
+	public:
+	LuaAllocator();
+	~LuaAllocator();
+
+	//Given to lua_newstate with the allocator as ud
+	static void* Alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+	//Must not be called while a script runs on the state on another thread
+	void GetStats(LuaMemoryStats* pOutStats) const;
+
+	private:
+	struct FreeBlock
+	{
+		FreeBlock* pNext;
+	};
+
+	struct SizeClass
+	{
+		FreeBlock* pFreeList;
+		//Unused end of the last page of the class
+		char* pCursor;
+		char* pEnd;
+	};
+
+	void* Allocate(size_t size);
+	void* Reallocate(void* ptr, size_t oldSize, size_t newSize);
+	void  Free(void* ptr, size_t size);
+
+	SizeClass mSizeClasses[LUA_ALLOCATOR_SIZE_CLASS_COUNT];
+	eastl::vector<void*> mPages;
+
+	uint64_t mUsedBytes;
+	uint64_t mLargeBytes;
+	uint64_t mNumAllocations;
+	uint64_t mNumReallocations;
+	uint64_t mNumFrees;
+	uint64_t mNumLargeAllocations;
+};
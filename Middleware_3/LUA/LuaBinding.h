@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+#pragma once
+
+extern "C"
+{
+#include "../../Common_3/ThirdParty/OpenSource/lua-5.3.5/src/lua.h"
+}
+
+#include "../../Common_3/ThirdParty/OpenSource/EASTL/internal/integer_sequence.h"
+#include "../../Common_3/ThirdParty/OpenSource/EASTL/type_traits.h"
+
+//Typed native bindings. LUA_BINDING(&Foo::bar) is a lua_CFunction generator for Foo::bar, registered with
+//	luaManager.SetFunction<LUA_BINDING(&Foo::bar)>("bar", &foo);
+//and called from scripts as loader.bar(...). The generated function reads the arguments straight from the Lua stack,
+//without virtual calls or copies: const char* parameters point into the Lua string, which is only valid during the call.
+//Supported parameter and return types are bool, integers, enums, floating point and const char*.
+#define LUA_BINDING(function) LuaBinding<typename eastl::decay<decltype(function)>::type, function>
+
+template <typename T, typename Enable = void>
+struct LuaValue;
+
+template <>
+struct LuaValue<bool>
+{
+	static bool Get(lua_State* L, int index) { return lua_toboolean(L, index) != 0; }
+	static void Push(lua_State* L, bool value) { lua_pushboolean(L, value); }
+};
+
+template <typename T>
+struct LuaValue<T, typename eastl::enable_if<eastl::is_integral<T>::value || eastl::is_enum<T>::value>::type>
+{
+	static T    Get(lua_State* L, int index) { return (T)lua_tointeger(L, index); }
+	static void Push(lua_State* L, T value) { lua_pushinteger(L, (lua_Integer)value); }
+};
+
+template <typename T>
+struct LuaValue<T, typename eastl::enable_if<eastl::is_floating_point<T>::value>::type>
+{
+	static T    Get(lua_State* L, int index) { return (T)lua_tonumber(L, index); }
+	static void Push(lua_State* L, T value) { lua_pushnumber(L, (lua_Number)value); }
+};
+
+template <>
+struct LuaValue<const char*>
+{
+	static const char* Get(lua_State* L, int index) { return lua_tostring(L, index); }
+	static void        Push(lua_State* L, const char* value) { lua_pushstring(L, value); }
+};
+
+//Calls function with the arguments 1..N of the Lua stack and pushes its result
+template <typename R>
+struct LuaBindingCall
+{
+	template <typename F, typename... Args, size_t... I>
+	static int Invoke(lua_State* L, F&& function, eastl::index_sequence<I...>)
+	{
+		LuaValue<typename eastl::decay<R>::type>::Push(L, function(LuaValue<typename eastl::decay<Args>::type>::Get(L, (int)I + 1)...));
+		return 1;
+	}
+};
+
+template <>
+struct LuaBindingCall<void>
+{
+	template <typename F, typename... Args, size_t... I>
+	static int Invoke(lua_State* L, F&& function, eastl::index_sequence<I...>)
+	{
+		function(LuaValue<typename eastl::decay<Args>::type>::Get(L, (int)I + 1)...);
+		return 0;
+	}
+};
+
+template <typename F, F function>
+struct LuaBinding;
+
+template <typename R, typename... Args, R (*function)(Args...)>
+struct LuaBinding<R (*)(Args...), function>
+{
+	typedef void InstanceType;
+
+	static int Call(lua_State* L)
+	{
+		return LuaBindingCall<R>::template Invoke<decltype(function), Args...>(
+			L, function, eastl::make_index_sequence<sizeof...(Args)>());
+	}
+};
+
+//Member functions are called on the instance given to SetFunction, stored as upvalue of the Lua function
+template <typename C, typename R, typename... Args, R (C::*function)(Args...)>
+struct LuaBinding<R (C::*)(Args...), function>
+{
+	typedef C InstanceType;
+
+	static int Call(lua_State* L)
+	{
+		C* pInstance = (C*)lua_touserdata(L, lua_upvalueindex(1));
+		return LuaBindingCall<R>::template Invoke<decltype(Bind(pInstance)), Args...>(
+			L, Bind(pInstance), eastl::make_index_sequence<sizeof...(Args)>());
+	}
+
+	private:
+	struct Bound
+	{
+		C* pInstance;
+		R  operator()(Args... args) const { return (pInstance->*function)(args...); }
+	};
+	static Bound Bind(C* pInstance) { return Bound{ pInstance }; }
+};
+
+template <typename C, typename R, typename... Args, R (C::*function)(Args...) const>
+struct LuaBinding<R (C::*)(Args...) const, function>
+{
+	typedef const C InstanceType;
+
+	static int Call(lua_State* L)
+	{
+		const C* pInstance = (const C*)lua_touserdata(L, lua_upvalueindex(1));
+		return LuaBindingCall<R>::template Invoke<decltype(Bind(pInstance)), Args...>(
+			L, Bind(pInstance), eastl::make_index_sequence<sizeof...(Args)>());
+	}
+
+	private:
+	struct Bound
+	{
+		const C* pInstance;
+		R        operator()(Args... args) const { return (pInstance->*function)(args...); }
+	};
+	static Bound Bind(const C* pInstance) { return Bound{ pInstance }; }
+};
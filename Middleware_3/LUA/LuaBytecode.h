@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2018-2021 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Compiled scripts are written next to their source by the AssetPipeline (-plua), foo.lua becomes foo.luac.
+// The file is a LuaBytecodeHeader followed by the output of lua_dump.
+#define LUA_BYTECODE_EXTENSION "luac"
+#define LUA_BYTECODE_MAGIC 0x43415546u    // "FUAC"
+#define LUA_BYTECODE_VERSION 1u
+
+enum LuaBytecodeFlags
+{
+	LUA_BYTECODE_FLAG_NONE = 0x0,
+	// Debug information was stripped, errors of the script have no line numbers
+	LUA_BYTECODE_FLAG_STRIPPED = 0x1,
+};
+
+struct LuaBytecodeHeader
+{
+	uint32_t mMagic;
+	uint32_t mVersion;
+	uint32_t mLuaVersion;    // LUA_VERSION_NUM of the compiler, lua_load also rejects chunks of other builds
+	uint32_t mFlags;
+	uint64_t mSourceSize;
+	uint64_t mSourceHash;    // LuaBytecodeHashSource of the script the bytecode was compiled from
+};
+
+// FNV-1a of the script source, bytecode is only used while this matches the source on disk
+inline uint64_t LuaBytecodeHashSource(const void* pSource, size_t size)
+{
+	const uint8_t* bytes = (const uint8_t*)pSource;
+	uint64_t       hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
@@ -54,6 +54,12 @@ void LuaManager::SetFunction(ILuaFunctionWrap* wrap)
 	m_Impl->SetFunction(wrap);
 }
 
+void LuaManager::SetNativeFunction(const char* functionName, LuaNativeFunction function, void* pUserData)
+{
+	ASSERT(m_Impl != nullptr);
+	m_Impl->SetNativeFunction(functionName, function, pUserData);
+}
+
 bool LuaManager::RunScript(const char* scriptFile)
 {
 	ASSERT(m_Impl != nullptr);
@@ -78,6 +84,48 @@ void LuaManager::AddAsyncScript(const char* scriptFile, IScriptCallbackWrap* cal
 	m_Impl->AddAsyncScript(scriptFile, callbackLambda);
 }
 
+void LuaManager::DispatchScriptCallbacks()
+{
+	ASSERT(m_Impl != nullptr);
+	m_Impl->DispatchScriptCallbacks();
+}
+
+void LuaManager::WaitForAsyncScripts()
+{
+	ASSERT(m_Impl != nullptr);
+	m_Impl->WaitForAsyncScripts();
+}
+
+void LuaManager::SetPreferBytecode(bool preferBytecode)
+{
+	ASSERT(m_Impl != nullptr);
+	m_Impl->SetPreferBytecode(preferBytecode);
+}
+
+void LuaManager::GetMemoryStats(eastl::vector<LuaMemoryStats>& outStats)
+{
+	ASSERT(m_Impl != nullptr);
+	m_Impl->GetMemoryStats(outStats);
+}
+
+void LuaManager::SetGarbageCollectorParams(int pause, int stepMultiplier)
+{
+	ASSERT(m_Impl != nullptr);
+	m_Impl->SetGarbageCollectorParams(pause, stepMultiplier);
+}
+
+void LuaManager::SetGarbageCollectorMode(LuaGarbageCollectorMode mode, float frameBudgetMs)
+{
+	ASSERT(m_Impl != nullptr);
+	m_Impl->SetGarbageCollectorMode(mode, frameBudgetMs);
+}
+
+void LuaManager::CollectGarbage(float budgetMs)
+{
+	ASSERT(m_Impl != nullptr);
+	m_Impl->CollectGarbage(budgetMs);
+}
+
 bool LuaManager::SetUpdatableScript(const char* scriptFile, const char* updateFunctionName, const char* exitFunctionName)
 {
 	ASSERT(m_Impl != nullptr);
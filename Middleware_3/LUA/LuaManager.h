@@ -44,6 +44,10 @@ class LuaManager
 	template <class T>
 	void SetFunction(const char* functionName, T function);
 
+	//Binding is a LUA_BINDING from LuaBinding.h, pInstance the object member functions are called on
+	template <class Binding>
+	void SetFunction(const char* functionName, typename Binding::InstanceType* pInstance = nullptr);
+
 	bool RunScript(const char* scriptFile);
 	void AddAsyncScript(const char* scriptFile, ScriptDoneCallback callback);
 	void AddAsyncScript(const char* scriptFile);
@@ -51,6 +55,29 @@ class LuaManager
 	template <class T>
 	void AddAsyncScript(const char* scriptFile, T callbackLambda);
 
+	//Async scripts run on worker threads, their callbacks are called from DispatchScriptCallbacks,
+	//WaitForAsyncScripts or Update, which must be called on the main thread
+	void DispatchScriptCallbacks();
+	void WaitForAsyncScripts();
+
+	//Scripts are loaded from the bytecode compiled by the AssetPipeline (-plua) when it matches the source.
+	//Off by default, projects without compiled scripts would report every missing .luac file
+	void SetPreferBytecode(bool preferBytecode);
+
+	//Memory used by each Lua state, see LuaAllocator.h. Waits for the async scripts that are running
+	void GetMemoryStats(eastl::vector<LuaMemoryStats>& outStats);
+	//Tuning of the incremental garbage collector of all Lua states, see LUA_GCSETPAUSE and LUA_GCSETSTEPMUL.
+	//pause: memory growth in percent since the last collection before a new cycle starts, Lua default is 200.
+	//stepMultiplier: speed of the collector relative to allocation in percent, Lua default is 200
+	void SetGarbageCollectorParams(int pause, int stepMultiplier);
+	//LUA_GC_MODE_BUDGETED moves the collection of the sync and updatable states out of the script allocations:
+	//each Update steps their collectors for up to frameBudgetMs, CollectGarbage adds idle time to that.
+	//The budget must keep up with the garbage the scripts make, see the heap size in GetMemoryStats
+	void SetGarbageCollectorMode(LuaGarbageCollectorMode mode, float frameBudgetMs = 0.5f);
+	//Spends up to budgetMs collecting garbage of the budgeted states, e.g. while waiting for the GPU.
+	//Does nothing in LUA_GC_MODE_AUTOMATIC
+	void CollectGarbage(float budgetMs);
+
 	//updateFunctionName - function that will be called on Update()
 	bool SetUpdatableScript(const char* scriptFile, const char* updateFunctionName, const char* exitFunctionName);
 	bool ReloadUpdatableScript();
@@ -62,6 +89,7 @@ class LuaManager
 	LuaManagerImpl* m_Impl;
 
 	void SetFunction(ILuaFunctionWrap* wrap);
+	void SetNativeFunction(const char* functionName, LuaNativeFunction function, void* pUserData);
 	void AddAsyncScript(const char* scriptFile, IScriptCallbackWrap* callbackLambda);
 };
 
@@ -73,6 +101,12 @@ void LuaManager::SetFunction(const char* functionName, T function)
 	SetFunction(functionWrap);
 }
 
+template <class Binding>
+void LuaManager::SetFunction(const char* functionName, typename Binding::InstanceType* pInstance)
+{
+	SetNativeFunction(functionName, &Binding::Call, (void*)pInstance);
+}
+
 template <class T>
 void LuaManager::AddAsyncScript(const char* scriptFile, T callbackLambda)
 {
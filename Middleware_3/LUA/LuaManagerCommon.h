@@ -37,6 +37,42 @@ enum ScriptState
 
 typedef void (*ScriptDoneCallback)(ScriptState state);
 
+enum LuaGarbageCollectorMode
+{
+	//Lua's incremental collector runs its steps inside the allocations of the scripts, whenever its heuristics decide
+	LUA_GC_MODE_AUTOMATIC,
+	//The collector of the sync and updatable states only runs in Update and CollectGarbage, within a time budget.
+	//The async states keep the automatic mode, they run on the workers outside of the frame
+	LUA_GC_MODE_BUDGETED,
+};
+
+struct lua_State;
+//Function called by Lua without any wrapper, see LuaBinding.h
+typedef int (*LuaNativeFunction)(lua_State* L);
+
+//Memory of one Lua state, see LuaAllocator.h
+struct LuaMemoryStats
+{
+	//"sync", "updatable" or "async N"
+	const char* pStateName;
+	//Bytes requested by Lua and bytes allocated from the heap for them: pool pages plus large blocks
+	uint64_t mUsedBytes;
+	uint64_t mReservedBytes;
+	//Part of both used by blocks too big for the size classes, allocated from the heap one by one
+	uint64_t mLargeBytes;
+	uint32_t mNumPages;
+	uint64_t mNumAllocations;
+	uint64_t mNumReallocations;
+	uint64_t mNumFrees;
+	uint64_t mNumLargeAllocations;
+	//Budgeted collection only: time spent since the last Update, total time and number of finished cycles
+	uint64_t mGCFrameTimeUs;
+	uint64_t mGCTotalTimeUs;
+	uint32_t mNumGCCycles;
+	//Cycles the budgets could not keep up with, finished at once
+	uint32_t mNumGCForcedCycles;
+};
+
 struct ILuaStateWrap
 {
 	virtual int           GetArgumentsCount() = 0;
@@ -25,10 +25,14 @@
 
 
 #include "LuaManagerImpl.h"
+#include "LuaAllocator.h"
+#include "LuaBytecode.h"
 
 #include "../../Common_3/ThirdParty/OpenSource/EASTL/string.h"
 #include "../../Common_3/OS/Interfaces/IFileSystem.h"
 #include "../../Common_3/OS/Interfaces/ICameraController.h"
+#include "../../Common_3/OS/Interfaces/IProfiler.h"
+#include "../../Common_3/OS/Interfaces/ITime.h"
 #include "../../Common_3/OS/Interfaces/IMemory.h"
 
 const char LuaManagerImpl::className[] = "LuaManager";
@@ -66,21 +70,50 @@ Luna<LuaManagerImpl>::FunctionType LuaManagerImpl::methods[] = { { NULL, NULL }
 
 Luna<LuaManagerImpl>::PropertyType LuaManagerImpl::properties[] = { { NULL, NULL } };
 
-LuaManagerImpl::LuaManagerImpl(lua_State* L): m_SyncLuaState(nullptr) { memset(m_AsyncLuaStates, 0, MAX_LUA_WORKERS * sizeof(lua_State*)); }
+LuaManagerImpl::LuaManagerImpl(lua_State* L): m_SyncLuaState(nullptr), m_AsyncThreadSystem(nullptr), m_FreeAsyncLuaStateCount(0), m_PreferBytecode(false),
+	m_GCPause(LUA_DEFAULT_GC_PAUSE), m_GCStepMultiplier(LUA_DEFAULT_GC_STEP_MULTIPLIER), m_GCMode(LUA_GC_MODE_AUTOMATIC),
+	m_GCFrameBudgetUs(0), m_SyncGC(), m_UpdatableGC()
+{
+	memset(m_AsyncLuaStates, 0, MAX_LUA_WORKERS * sizeof(lua_State*));
+	for (uint32_t i = 0; i < MAX_LUA_WORKERS; ++i)
+		snprintf(m_AsyncLuaStateNames[i], sizeof(m_AsyncLuaStateNames[i]), "async %u", i);
+}
 
-LuaManagerImpl::LuaManagerImpl(): m_SyncLuaState(nullptr), m_AsyncScriptsCounter(0)
+LuaManagerImpl::LuaManagerImpl(): m_SyncLuaState(nullptr), m_AsyncThreadSystem(nullptr), m_FreeAsyncLuaStateCount(0), m_PreferBytecode(false),
+	m_GCPause(LUA_DEFAULT_GC_PAUSE), m_GCStepMultiplier(LUA_DEFAULT_GC_STEP_MULTIPLIER), m_GCMode(LUA_GC_MODE_AUTOMATIC),
+	m_GCFrameBudgetUs(0), m_SyncGC(), m_UpdatableGC()
 {
 	memset(m_AsyncLuaStates, 0, MAX_LUA_WORKERS * sizeof(lua_State*));
+	for (uint32_t i = 0; i < MAX_LUA_WORKERS; ++i)
+		snprintf(m_AsyncLuaStateNames[i], sizeof(m_AsyncLuaStateNames[i]), "async %u", i);
 
 	Register();
 	
 	for (uint32_t i = 0; i <  MAX_LUA_WORKERS; ++i)
+	{
 		m_AsyncLuaStatesMutex[i].Init();
+		m_FreeAsyncLuaStates[m_FreeAsyncLuaStateCount++] = i;
+	}
 	m_AddAsyncScriptMutex.Init();
+	m_AsyncScriptsIdleCond.Init();
+	m_FinishedScriptsMutex.Init();
+
+	initThreadSystem(&m_AsyncThreadSystem, MAX_LUA_WORKERS, 0, true, "LuaWorker");
 }
 
 LuaManagerImpl::~LuaManagerImpl()
 {
+	//Scripts still queued run to completion, callbacks that were not dispatched are dropped
+	if (m_AsyncThreadSystem)
+	{
+		WaitForAsyncScriptsIdle();
+		shutdownThreadSystem(m_AsyncThreadSystem);
+		m_AsyncThreadSystem = nullptr;
+	}
+	for (ScriptTaskInfo* info : m_FinishedScripts)
+		ReleaseScriptTaskInfo(info);
+	m_FinishedScripts.clear();
+
 	DestroyLuaState(m_SyncLuaState);
 	m_SyncLuaState = nullptr;
 
@@ -107,6 +140,8 @@ LuaManagerImpl::~LuaManagerImpl()
 	for (uint32_t i = 0; i <  MAX_LUA_WORKERS; ++i)
 		m_AsyncLuaStatesMutex[i].Destroy();
 	m_AddAsyncScriptMutex.Destroy();
+	m_AsyncScriptsIdleCond.Destroy();
+	m_FinishedScriptsMutex.Destroy();
 	
 	m_registered = false;
 }
@@ -120,7 +155,10 @@ void LuaManagerImpl::DestroyLuaState(lua_State* state)
 		lua_pushnil(state);
 		lua_setmetatable(state, -2);
 
+		void* pAllocator = NULL;
+		lua_getallocf(state, &pAllocator);
 		lua_close(state);
+		tf_delete((LuaAllocator*)pAllocator);
 	}
 }
 
@@ -141,35 +179,67 @@ static int msghandler(lua_State* L)
 	return 1; /* return the traceback */
 }
 
-const char* luaReaderFunction(lua_State *L, void *ud, size_t *sz)
+//Pushes the chunk of scriptFile. With preferBytecode the compiled script written by the AssetPipeline is loaded instead
+//as long as the hash in its header matches the source, otherwise the source is compiled.
+//Files are mapped and loaded in one piece, lua_load copies everything it keeps so they are unmapped right after.
+//Returns LUA_ERRFILE without pushing anything when no file could be mapped
+static int LoadScriptChunk(lua_State* L, const char* scriptFile, bool preferBytecode)
 {
-	FileStream* pHandle = (FileStream*)ud;
-	const size_t size = 1024;
-	static char buffer[size];
-	//*sz = read_file((void*)buffer, size, pHandle);
-	*sz = fsReadFromStream(pHandle, buffer, size);
-	return buffer;
+	char chunkName[FS_MAX_PATH + 1] = {};
+	snprintf(chunkName, sizeof(chunkName), "@%s", scriptFile);
+
+	MappedFile source = {};
+	const bool hasSource = fsMapFileFromPath(RD_SCRIPTS, scriptFile, &source);
+
+	int status = LUA_ERRFILE;
+	MappedFile bytecode = {};
+	char bytecodeFile[FS_MAX_PATH] = {};
+	fsReplacePathExtension(scriptFile, LUA_BYTECODE_EXTENSION, bytecodeFile);
+	if (preferBytecode && fsMapFileFromPath(RD_SCRIPTS, bytecodeFile, &bytecode))
+	{
+		const LuaBytecodeHeader* pHeader = (const LuaBytecodeHeader*)bytecode.pData;
+		bool upToDate = bytecode.mSize > sizeof(LuaBytecodeHeader) && pHeader->mMagic == LUA_BYTECODE_MAGIC &&
+						pHeader->mVersion == LUA_BYTECODE_VERSION && pHeader->mLuaVersion == LUA_VERSION_NUM;
+		//Shipped builds may only contain the bytecode
+		if (upToDate && hasSource)
+			upToDate = pHeader->mSourceSize == source.mSize && pHeader->mSourceHash == LuaBytecodeHashSource(source.pData, source.mSize);
+
+		if (upToDate)
+		{
+			status = luaL_loadbufferx(L, (const char*)(pHeader + 1), bytecode.mSize - sizeof(LuaBytecodeHeader), chunkName, "b");
+			if (status != LUA_OK)
+			{
+				LOGF(eWARNING, "Can't load bytecode of script %s: %s\n", scriptFile, lua_tostring(L, -1));
+				lua_pop(L, 1); /* remove error message */
+				status = LUA_ERRFILE;
+			}
+		}
+		fsUnmapFile(&bytecode);
+	}
+
+	if (status != LUA_OK && hasSource)
+		status = luaL_loadbufferx(L, (const char*)source.pData, source.mSize, chunkName, "t");
+
+	if (hasSource)
+		fsUnmapFile(&source);
+	return status;
 }
 
-int RunScriptFile(const char* scriptFile, lua_State* L)
+//Returns true if the script was loaded and ran without errors
+bool RunScriptFile(const char* scriptFile, lua_State* L, bool preferBytecode)
 {
-	//int loadfile_error = luaL_loadfile(L, scriptFile);
-	lua_Reader reader = luaReaderFunction;
-    
-	FileStream fh = {};
-	
-    if (!fsOpenStreamFromPath(RD_SCRIPTS, scriptFile, FM_READ_BINARY, &fh))
-    {
-        return false;
-    }
-    
-	int loadfile_error = lua_load(L, reader, &fh, NULL, NULL);
-    fsCloseStream(&fh);
-	if (loadfile_error != 0)
+	int loadfile_error = LoadScriptChunk(L, scriptFile, preferBytecode);
+	if (loadfile_error == LUA_ERRFILE)
 	{
 		LOGF(eERROR, "Can't load script %s\n", scriptFile);
 		return false;
 	}
+	if (loadfile_error != LUA_OK)
+	{
+		LOGF(eERROR, "Can't load script %s: %s\n", scriptFile, lua_tostring(L, -1));
+		lua_pop(L, 1); /* remove error message */
+		return false;
+	}
 
 	int status;
 	int narg = 0;
@@ -180,6 +250,8 @@ int RunScriptFile(const char* scriptFile, lua_State* L)
 	status = lua_pcall(L, narg, nres, base);
 	//signal(SIGINT, SIG_DFL); /* reset C-signal handler */
 	lua_remove(L, base); /* remove message handler from the stack */
+	if (status != 0)
+		lua_pop(L, 1); /* remove traceback, states of async scripts are reused */
 	return status == 0;
 }
 
@@ -206,30 +278,26 @@ bool LuaManagerImpl::SetUpdatableScript(const char* scriptFile, const char* upda
 	}
 
 	m_UpdatableScriptLuaState = CreateLuaState();
+	m_UpdatableGC = LuaGarbageCollectorState();
+	ApplyGarbageCollectorMode(m_UpdatableScriptLuaState, m_UpdatableGC);
 	RegisterLuaManagerForLuaState(m_UpdatableScriptLuaState);
 	RegisterFunctionsForState(m_UpdatableScriptLuaState);
 
 	m_UpdateFunctonName = updateFunctionName;
     m_UpdatableScriptFile = scriptFile;
 	m_UpdatableScriptExitName = exitFunctionName;
-	//int loadfile_error = luaL_loadfile(m_UpdatableScriptLuaState, m_UpdatableScriptName.c_str());
-	lua_Reader reader = luaReaderFunction;
-	//int loadfile_error = lua_load(m_UpdatableScriptLuaState, reader, open_file(scriptFile, "rb"), NULL, NULL);
-    
-	FileStream fHandle = {};
-    if (!fsOpenStreamFromPath(RD_SCRIPTS, scriptFile, FM_READ_BINARY, &fHandle))
-    {
-        return false;
-    }
-    
-	int loadfile_error = lua_load(m_UpdatableScriptLuaState, reader, &fHandle, NULL, NULL);
-    fsCloseStream(&fHandle);
-    
-	if (loadfile_error != 0)
+	int loadfile_error = LoadScriptChunk(m_UpdatableScriptLuaState, scriptFile, m_PreferBytecode);
+	if (loadfile_error == LUA_ERRFILE)
 	{
 		LOGF(eERROR, "Can't load script %s\n", scriptFile);
 		return false;
 	}
+	if (loadfile_error != LUA_OK)
+	{
+		LOGF(eERROR, "Can't load script %s: %s\n", scriptFile, lua_tostring(m_UpdatableScriptLuaState, -1));
+		lua_pop(m_UpdatableScriptLuaState, 1); /* remove error message */
+		return false;
+	}
 	int narg = 0;
 	int nres = 0;
 	int base = lua_gettop(m_UpdatableScriptLuaState) - narg;  /* function index */
@@ -253,10 +321,20 @@ void LuaManagerImpl::RegisterFunctionsForState(lua_State* state)
 	{
 		Luna<LuaManagerImpl>::RegisterMethod(state, m_Functions[i]->functionName.c_str(), (int)i);
 	}
+	for (const LuaNativeFunctionInfo& info : m_NativeFunctions)
+		Luna<LuaManagerImpl>::RegisterFunction(state, info.functionName.c_str(), info.function, info.pUserData);
 }
 
 bool LuaManagerImpl::Update(float deltaTime, const char* updateFunctionName)
 {
+	DispatchScriptCallbacks();
+
+	if (m_UpdatableScriptLuaState == nullptr)
+		return false;
+
+	m_SyncGC.mFrameTimeUs = 0;
+	m_UpdatableGC.mFrameTimeUs = 0;
+
 	int narg = 1;    //we are going to push "deltaTime"
 	int nres = 0;
 	int base = lua_gettop(m_UpdatableScriptLuaState) - narg; /* function index */
@@ -269,99 +347,295 @@ bool LuaManagerImpl::Update(float deltaTime, const char* updateFunctionName)
 		ASSERT(m_UpdateFunctonName.size() > 0);
 		lua_getglobal(m_UpdatableScriptLuaState, m_UpdateFunctonName.c_str());
 	}
+	bool succeeded = false;
 	if (lua_isfunction(m_UpdatableScriptLuaState, -1))
 	{
 		lua_pushnumber(m_UpdatableScriptLuaState, deltaTime);
 		int status = lua_pcall(m_UpdatableScriptLuaState, narg, nres, base);
-		return status == 0;
+		succeeded = status == 0;
 	}
-	return false;
+
+	//Garbage of this frame is collected right away, in the budget of the frame
+	if (m_GCMode == LUA_GC_MODE_BUDGETED)
+		CollectGarbage(m_GCFrameBudgetUs / 1000.0f);
+
+	return succeeded;
 }
 
 bool LuaManagerImpl::RunScript(const char* scriptFile)
 {
-	int status = RunScriptFile(scriptFile, m_SyncLuaState);
-	return status == 0;
+	return RunScriptFile(scriptFile, m_SyncLuaState, m_PreferBytecode);
 }
 
-void AsyncScriptExecute(void* pData)
+void LuaManagerImpl::AsyncScriptTask(void* pUser, uintptr_t stateIndex)
 {
-	ASSERT(pData != nullptr);
-	ScriptTaskInfo* info = (ScriptTaskInfo*)pData;
-	MutexLock       lock(*(info->mutex));
-	int             status = RunScriptFile(info->scriptFile, info->luaState);
-	if (info->callback)
+	LuaManagerImpl* manager = (LuaManagerImpl*)pUser;
+	for (;;)
 	{
-		info->callback(status == 0 ? FINISHED_OK : FINISHED_ERROR);
+		ScriptTaskInfo* info = nullptr;
+		{
+			MutexLock lock(manager->m_AddAsyncScriptMutex);
+			if (manager->m_PendingScripts.empty())
+			{
+				manager->m_FreeAsyncLuaStates[manager->m_FreeAsyncLuaStateCount++] = (uint32_t)stateIndex;
+				if (manager->m_FreeAsyncLuaStateCount == MAX_LUA_WORKERS)
+					manager->m_AsyncScriptsIdleCond.WakeAll();
+				return;
+			}
+			info = manager->m_PendingScripts.front();
+			manager->m_PendingScripts.pop_front();
+		}
+
+		{
+			MutexLock lock(manager->m_AsyncLuaStatesMutex[stateIndex]);
+			bool      succeeded = RunScriptFile(info->scriptFile.c_str(), manager->m_AsyncLuaStates[stateIndex], manager->m_PreferBytecode);
+			info->resultState = succeeded ? FINISHED_OK : FINISHED_ERROR;
+		}
+
+		MutexLock lock(manager->m_FinishedScriptsMutex);
+		manager->m_FinishedScripts.push_back(info);
 	}
+}
+
+void LuaManagerImpl::QueueAsyncScript(const char* scriptFile, ScriptDoneCallback callback, IScriptCallbackWrap* callbackLambda)
+{
+	ScriptTaskInfo* info = tf_new(ScriptTaskInfo);
+	info->scriptFile = scriptFile;
+	info->callback = callback;
+	info->callbackLambda = callbackLambda;
+	info->resultState = FINISHED_ERROR;
+
+	MutexLock lock(m_AddAsyncScriptMutex);
+	m_PendingScripts.push_back(info);
+
+	//Start a worker on a free state, busy states pick the script up when they finish their current one
+	if (m_FreeAsyncLuaStateCount > 0)
+	{
+		uint32_t stateIndex = m_FreeAsyncLuaStates[--m_FreeAsyncLuaStateCount];
+		addThreadSystemTask(m_AsyncThreadSystem, AsyncScriptTask, this, stateIndex);
+	}
+}
+
+void LuaManagerImpl::AddAsyncScript(const char* scriptFile, IScriptCallbackWrap* callbackLambda)
+{
+	QueueAsyncScript(scriptFile, nullptr, callbackLambda);
+}
+
+void LuaManagerImpl::AddAsyncScript(const char* scriptFile, ScriptDoneCallback callback)
+{
+	QueueAsyncScript(scriptFile, callback, nullptr);
+}
+
+void LuaManagerImpl::AddAsyncScript(const char* scriptFile)
+{
+	ScriptDoneCallback cb = nullptr;
+	AddAsyncScript(scriptFile, cb);
+}
+
+void LuaManagerImpl::DispatchScriptCallbacks()
+{
+	ASSERT(Thread::IsMainThread());
+
+	eastl::vector<ScriptTaskInfo*> finishedScripts;
+	{
+		MutexLock lock(m_FinishedScriptsMutex);
+		finishedScripts.swap(m_FinishedScripts);
+	}
+
+	for (ScriptTaskInfo* info : finishedScripts)
+	{
+		if (info->callback)
+			info->callback(info->resultState);
+		if (info->callbackLambda)
+			info->callbackLambda->ExecuteCallback(info->resultState);
+		ReleaseScriptTaskInfo(info);
+	}
+}
+
+void LuaManagerImpl::WaitForAsyncScripts()
+{
+	WaitForAsyncScriptsIdle();
+	DispatchScriptCallbacks();
+}
+
+void LuaManagerImpl::WaitForAsyncScriptsIdle()
+{
+	MutexLock lock(m_AddAsyncScriptMutex);
+	while (!m_PendingScripts.empty() || m_FreeAsyncLuaStateCount < MAX_LUA_WORKERS)
+		m_AsyncScriptsIdleCond.Wait(m_AddAsyncScriptMutex);
+}
+
+void LuaManagerImpl::ReleaseScriptTaskInfo(ScriptTaskInfo* info)
+{
 	if (info->callbackLambda)
 	{
-		info->callbackLambda->ExecuteCallback(status == 0 ? FINISHED_OK : FINISHED_ERROR);
 		info->callbackLambda->~IScriptCallbackWrap();
 		tf_free(info->callbackLambda);
 	}
-	info->~ScriptTaskInfo();           //call destructors of non-trivial members of the struct
-	memset(info, 0, sizeof(*info));    //set zeros just in case if someone will try to use released chunk of memory
-	tf_free(info);
+	tf_delete(info);
 }
 
-void LuaManagerImpl::AddAsyncScript(const char* scriptFile, IScriptCallbackWrap* callbackLambda)
+void LuaManagerImpl::SetPreferBytecode(bool preferBytecode)
 {
-	ScriptTaskInfo* info = (ScriptTaskInfo*)tf_calloc(1, sizeof(ScriptTaskInfo));
-	info->scriptFile = scriptFile;
-	info->callback = nullptr;
+	//Running async scripts read the setting
+	WaitForAsyncScriptsIdle();
+	m_PreferBytecode = preferBytecode;
+}
 
-	info->callbackLambda = callbackLambda;
+static void GetLuaStateMemoryStats(
+	lua_State* state, const char* stateName, const LuaGarbageCollectorState* pGC, eastl::vector<LuaMemoryStats>& outStats)
+{
+	void* pAllocator = NULL;
+	lua_getallocf(state, &pAllocator);
+	LuaMemoryStats stats = {};
+	((LuaAllocator*)pAllocator)->GetStats(&stats);
+	stats.pStateName = stateName;
+	if (pGC)
+	{
+		stats.mGCFrameTimeUs = pGC->mFrameTimeUs;
+		stats.mGCTotalTimeUs = pGC->mTotalTimeUs;
+		stats.mNumGCCycles = pGC->mNumCycles;
+		stats.mNumGCForcedCycles = pGC->mNumForcedCycles;
+	}
+	outStats.push_back(stats);
+}
 
-	//ThreadDesc* pItem = (ThreadDesc*)tf_calloc(1, sizeof(*pItem));
+void LuaManagerImpl::GetMemoryStats(eastl::vector<LuaMemoryStats>& outStats)
+{
+	outStats.clear();
+	GetLuaStateMemoryStats(m_SyncLuaState, "sync", &m_SyncGC, outStats);
+	if (m_UpdatableScriptLuaState != nullptr)
+		GetLuaStateMemoryStats(m_UpdatableScriptLuaState, "updatable", &m_UpdatableGC, outStats);
+	for (int i = 0; i < MAX_LUA_WORKERS; ++i)
+	{
+		//The allocator of an async state is only read between scripts
+		MutexLock lock(m_AsyncLuaStatesMutex[i]);
+		GetLuaStateMemoryStats(m_AsyncLuaStates[i], m_AsyncLuaStateNames[i], NULL, outStats);
+	}
+}
 
-	//pItem->pFunc = AsyncScriptExecute;
-	//pItem->pData = info;
+void LuaManagerImpl::SetGarbageCollectorParams(int pause, int stepMultiplier)
+{
+	m_GCPause = pause;
+	m_GCStepMultiplier = stepMultiplier;
 
+	lua_gc(m_SyncLuaState, LUA_GCSETPAUSE, pause);
+	lua_gc(m_SyncLuaState, LUA_GCSETSTEPMUL, stepMultiplier);
+	if (m_UpdatableScriptLuaState != nullptr)
 	{
-		MutexLock lock(m_AddAsyncScriptMutex);
-		info->luaState = m_AsyncLuaStates[m_AsyncScriptsCounter % MAX_LUA_WORKERS];
-		info->mutex = &m_AsyncLuaStatesMutex[m_AsyncScriptsCounter % MAX_LUA_WORKERS];
-		++m_AsyncScriptsCounter;
-
-		//for now we run scripts in synchronous way
-		//m_ThreadPool->AddWorkItem(pItem);
-		AsyncScriptExecute(info);
+		lua_gc(m_UpdatableScriptLuaState, LUA_GCSETPAUSE, pause);
+		lua_gc(m_UpdatableScriptLuaState, LUA_GCSETSTEPMUL, stepMultiplier);
+	}
+	for (int i = 0; i < MAX_LUA_WORKERS; ++i)
+	{
+		MutexLock lock(m_AsyncLuaStatesMutex[i]);
+		lua_gc(m_AsyncLuaStates[i], LUA_GCSETPAUSE, pause);
+		lua_gc(m_AsyncLuaStates[i], LUA_GCSETSTEPMUL, stepMultiplier);
 	}
 }
 
-void LuaManagerImpl::AddAsyncScript(const char* scriptFile, ScriptDoneCallback callback)
+static uint64_t GetLuaHeapBytes(lua_State* state)
 {
-	ScriptTaskInfo* info = (ScriptTaskInfo*)tf_calloc(1, sizeof(ScriptTaskInfo));
-    info->scriptFile = scriptFile;
-	info->callback = callback;
-	info->callbackLambda = nullptr;
-	//ThreadDesc* pItem = (ThreadDesc*)tf_calloc(1, sizeof(*pItem));
+	return (uint64_t)lua_gc(state, LUA_GCCOUNT, 0) * 1024 + (uint64_t)lua_gc(state, LUA_GCCOUNTB, 0);
+}
 
-	//pItem->pFunc = AsyncScriptExecute;
-	//pItem->pData = info;
+void LuaManagerImpl::SetGarbageCollectorMode(LuaGarbageCollectorMode mode, float frameBudgetMs)
+{
+	m_GCMode = mode;
+	m_GCFrameBudgetUs = (int64_t)(frameBudgetMs * 1000.0f);
 
+	ApplyGarbageCollectorMode(m_SyncLuaState, m_SyncGC);
+	if (m_UpdatableScriptLuaState != nullptr)
+		ApplyGarbageCollectorMode(m_UpdatableScriptLuaState, m_UpdatableGC);
+}
+
+void LuaManagerImpl::ApplyGarbageCollectorMode(lua_State* state, LuaGarbageCollectorState& gc)
+{
+	if (m_GCMode == LUA_GC_MODE_BUDGETED)
 	{
-		MutexLock lock(m_AddAsyncScriptMutex);
-		info->luaState = m_AsyncLuaStates[m_AsyncScriptsCounter % MAX_LUA_WORKERS];
-		info->mutex = &m_AsyncLuaStatesMutex[m_AsyncScriptsCounter % MAX_LUA_WORKERS];
-		++m_AsyncScriptsCounter;
-		//m_ThreadPool->AddWorkItem(pItem);
-		AsyncScriptExecute(info);
+		//A cycle Lua started goes on in the budget, the next one starts from the current heap size
+		lua_gc(state, LUA_GCSTOP, 0);
+		gc.mEstimateBytes = GetLuaHeapBytes(state);
+		gc.mCycleActive = true;
+		gc.mCycleBudgets = 0;
+	}
+	else
+	{
+		lua_gc(state, LUA_GCRESTART, 0);
 	}
 }
 
-void LuaManagerImpl::AddAsyncScript(const char* scriptFile)
+void LuaManagerImpl::StepGarbageCollector(lua_State* state, LuaGarbageCollectorState& gc, int64_t endUs)
 {
-	ScriptDoneCallback cb = nullptr;
-	AddAsyncScript(scriptFile, cb);
+	const uint64_t heapBytes = GetLuaHeapBytes(state);
+	if (!gc.mCycleActive)
+	{
+		//Same pause as the automatic collector, without it every budget would start a new cycle
+		if (heapBytes * 100 < gc.mEstimateBytes * (uint64_t)m_GCPause)
+			return;
+		gc.mCycleActive = true;
+	}
+
+	//Objects allocated late in a cycle survive it, the heap at its end is the estimate of the next one.
+	//When the budgets do not keep up with the garbage, the longer cycles would raise the estimate without bounds:
+	//after LUA_GC_MAX_BUDGETS_PER_CYCLE budgets the cycle is finished at once, a hitch is the lesser evil
+	const bool finishCycle = ++gc.mCycleBudgets > LUA_GC_MAX_BUDGETS_PER_CYCLE;
+	if (finishCycle)
+		++gc.mNumForcedCycles;
+
+	PROFILER_SET_CPU_SCOPE("Lua", "GC", 0x2e8b57);
+	const int64_t startUs = getUSec();
+	int64_t       nowUs = startUs;
+	//At least one step, a budget that is always spent by the script must not stop the collection
+	do
+	{
+		//A single step of the collector, returns 1 when it finished a cycle
+		if (lua_gc(state, LUA_GCSTEP, 0))
+		{
+			gc.mCycleActive = false;
+			gc.mCycleBudgets = 0;
+			gc.mEstimateBytes = GetLuaHeapBytes(state);
+			++gc.mNumCycles;
+		}
+		nowUs = getUSec();
+	} while (gc.mCycleActive && (nowUs < endUs || finishCycle));
+
+	gc.mFrameTimeUs += nowUs - startUs;
+	gc.mTotalTimeUs += nowUs - startUs;
+}
+
+void LuaManagerImpl::CollectGarbage(float budgetMs)
+{
+	if (m_GCMode != LUA_GC_MODE_BUDGETED)
+		return;
+
+	//The updatable state makes garbage every frame, the sync state only when scripts are run
+	const int64_t endUs = getUSec() + (int64_t)(budgetMs * 1000.0f);
+	if (m_UpdatableScriptLuaState != nullptr)
+		StepGarbageCollector(m_UpdatableScriptLuaState, m_UpdatableGC, endUs);
+	if (getUSec() < endUs)
+		StepGarbageCollector(m_SyncLuaState, m_SyncGC, endUs);
 }
 
 void LuaManagerImpl::SetFunction(ILuaFunctionWrap* wrap)
 {
+	//Async scripts call m_Functions from the workers, they must not run while it changes
+	WaitForAsyncScriptsIdle();
+
+	//A native function of the same name is replaced as well
+	for (size_t i = 0; i < m_NativeFunctions.size(); ++i)
+	{
+		if (m_NativeFunctions[i].functionName == wrap->functionName)
+		{
+			m_NativeFunctions.erase(m_NativeFunctions.begin() + i);
+			break;
+		}
+	}
+
 	//1. Check if function is already registered
 	//Since this shouldn't be called often then just
 	//use string compare. We can implement more fast search if needed
+	size_t functionIndex = m_Functions.size();
 	for (size_t i = 0; i < m_Functions.size(); ++i)
 	{
 		if (m_Functions[i]->functionName == wrap->functionName)
@@ -369,35 +643,53 @@ void LuaManagerImpl::SetFunction(ILuaFunctionWrap* wrap)
 			m_Functions[i]->~ILuaFunctionWrap();
 			tf_free(m_Functions[i]);
 			m_Functions[i] = wrap;
-			return;
+			functionIndex = i;
+			break;
 		}
 	}
 	//2.
-	m_Functions.push_back(wrap);
-	Luna<LuaManagerImpl>::RegisterMethod(m_SyncLuaState, wrap->functionName.c_str(), (int)m_Functions.size() - 1);
+	if (functionIndex == m_Functions.size())
+		m_Functions.push_back(wrap);
+	Luna<LuaManagerImpl>::RegisterMethod(m_SyncLuaState, wrap->functionName.c_str(), (int)functionIndex);
 	//m_UpdatableScriptLuaState is created in LuaManagerImpl::SetUpdatableScript() so it may not exist here.
 	//When LuaManagerImpl::SetUpdatableScript() is invoked all these functions will be registered in new state.
 	if (m_UpdatableScriptLuaState != nullptr)
-		Luna<LuaManagerImpl>::RegisterMethod(m_UpdatableScriptLuaState, wrap->functionName.c_str(), (int)m_Functions.size() - 1);
+		Luna<LuaManagerImpl>::RegisterMethod(m_UpdatableScriptLuaState, wrap->functionName.c_str(), (int)functionIndex);
 	for (int i = 0; i < MAX_LUA_WORKERS; ++i)
 	{
 		MutexLock lock(m_AsyncLuaStatesMutex[i]);
-		Luna<LuaManagerImpl>::RegisterMethod(m_AsyncLuaStates[i], wrap->functionName.c_str(), (int)m_Functions.size() - 1);
+		Luna<LuaManagerImpl>::RegisterMethod(m_AsyncLuaStates[i], wrap->functionName.c_str(), (int)functionIndex);
 	}
 }
 
-//allocate and free function. Used in lua_newstate and in lua_close
-static void* tf_l_alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+void LuaManagerImpl::SetNativeFunction(const char* functionName, LuaNativeFunction function, void* pUserData)
 {
-	(void)ud;
-	(void)osize; /* not used */
-	if (nsize == 0)
+	WaitForAsyncScriptsIdle();
+
+	//Registered after the wrapped functions in every state, so it also replaces a wrapped function of the same name
+	LuaNativeFunctionInfo* pInfo = nullptr;
+	for (size_t i = 0; i < m_NativeFunctions.size(); ++i)
 	{
-		tf_free(ptr);
-		return NULL;
+		if (m_NativeFunctions[i].functionName == functionName)
+			pInfo = &m_NativeFunctions[i];
+	}
+	if (!pInfo)
+	{
+		m_NativeFunctions.push_back(LuaNativeFunctionInfo());
+		pInfo = &m_NativeFunctions.back();
+		pInfo->functionName = functionName;
+	}
+	pInfo->function = function;
+	pInfo->pUserData = pUserData;
+
+	Luna<LuaManagerImpl>::RegisterFunction(m_SyncLuaState, functionName, function, pUserData);
+	if (m_UpdatableScriptLuaState != nullptr)
+		Luna<LuaManagerImpl>::RegisterFunction(m_UpdatableScriptLuaState, functionName, function, pUserData);
+	for (int i = 0; i < MAX_LUA_WORKERS; ++i)
+	{
+		MutexLock lock(m_AsyncLuaStatesMutex[i]);
+		Luna<LuaManagerImpl>::RegisterFunction(m_AsyncLuaStates[i], functionName, function, pUserData);
 	}
-	else
-		return tf_realloc(ptr, nsize);
 }
 
 static int l_panic(lua_State* L)
@@ -428,11 +720,19 @@ void LuaManagerImpl::Register()
 
 lua_State* LuaManagerImpl::CreateLuaState()
 {
-	lua_State* lstate = lua_newstate(tf_l_alloc, NULL);
-	if (lstate)
-		lua_atpanic(lstate, &l_panic);
+	//Every state gets its own pool, states running on different threads never share a lock
+	LuaAllocator* pAllocator = tf_new(LuaAllocator);
+	lua_State*    lstate = lua_newstate(LuaAllocator::Alloc, pAllocator);
+	if (!lstate)
+	{
+		tf_delete(pAllocator);
+		return NULL;
+	}
+	lua_atpanic(lstate, &l_panic);
 	luaL_openlibs(lstate);
 	luaopen_debug(lstate);
+	lua_gc(lstate, LUA_GCSETPAUSE, m_GCPause);
+	lua_gc(lstate, LUA_GCSETSTEPMUL, m_GCStepMultiplier);
 	return lstate;
 }
 
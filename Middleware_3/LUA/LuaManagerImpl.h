@@ -35,6 +35,7 @@ extern "C"
 
 #include "../../Common_3/ThirdParty/OpenSource/EASTL/string.h"
 #include "../../Common_3/ThirdParty/OpenSource/EASTL/vector.h"
+#include "../../Common_3/ThirdParty/OpenSource/EASTL/deque.h"
 
 #include "../../Common_3/OS/Interfaces/ILog.h"
 #include "LunaV.hpp"
@@ -42,9 +43,16 @@ extern "C"
 
 #include "../../Common_3/OS/Interfaces/IFileSystem.h"
 #include "../../Common_3/OS/Interfaces/IThread.h"
+#include "../../Common_3/OS/Core/ThreadSystem.h"
 
 #define MAX_LUA_WORKERS 4
 
+//Lua defaults of LUA_GCSETPAUSE and LUA_GCSETSTEPMUL
+#define LUA_DEFAULT_GC_PAUSE 200
+#define LUA_DEFAULT_GC_STEP_MULTIPLIER 200
+//Calls of Update or CollectGarbage a budgeted collection cycle may span before it is finished regardless of the budget
+#define LUA_GC_MAX_BUDGETS_PER_CYCLE 16
+
 struct LuaStateWrap: public ILuaStateWrap
 {
 	virtual int             GetArgumentsCount() override;
@@ -62,11 +70,31 @@ struct LuaStateWrap: public ILuaStateWrap
 
 struct ScriptTaskInfo
 {
-	lua_State*           luaState;
-	Mutex*               mutex;
-    const char*          scriptFile;
+	eastl::string        scriptFile;
 	ScriptDoneCallback   callback;
 	IScriptCallbackWrap* callbackLambda;
+	ScriptState          resultState;
+};
+
+//Incremental collection of a state in LUA_GC_MODE_BUDGETED
+struct LuaGarbageCollectorState
+{
+	//Heap size at the end of the last cycle, the next cycle starts once the heap grew by the GC pause
+	uint64_t mEstimateBytes;
+	bool     mCycleActive;
+	//Budgets spent on the current cycle
+	uint32_t mCycleBudgets;
+	uint64_t mFrameTimeUs;
+	uint64_t mTotalTimeUs;
+	uint32_t mNumCycles;
+	uint32_t mNumForcedCycles;
+};
+
+struct LuaNativeFunctionInfo
+{
+	eastl::string     functionName;
+	LuaNativeFunction function;
+	void*             pUserData;
 };
 
 class LuaManagerImpl
@@ -79,7 +107,24 @@ class LuaManagerImpl
 	void AddAsyncScript(const char* scriptFile);
 	void AddAsyncScript(const char* scriptFile, IScriptCallbackWrap* callbackLambda);
 
+	//Runs the callbacks of the async scripts that finished since the last call, on the calling thread
+	void DispatchScriptCallbacks();
+	//Blocks until all async scripts finished, then dispatches their callbacks
+	void WaitForAsyncScripts();
+
 	void SetFunction(ILuaFunctionWrap* wrap);
+	void SetNativeFunction(const char* functionName, LuaNativeFunction function, void* pUserData);
+
+	//Load the bytecode compiled by the AssetPipeline (foo.luac next to foo.lua) while it is up-to-date with the source
+	void SetPreferBytecode(bool preferBytecode);
+
+	//Memory of the sync, updatable and async states, waits for the scripts running on the async states
+	void GetMemoryStats(eastl::vector<LuaMemoryStats>& outStats);
+	//Applied to all states, current and future
+	void SetGarbageCollectorParams(int pause, int stepMultiplier);
+	void SetGarbageCollectorMode(LuaGarbageCollectorMode mode, float frameBudgetMs);
+	//Steps the collectors of the budgeted states for up to budgetMs
+	void CollectGarbage(float budgetMs);
 
 	//updateFunctionName - function that will be called on Update()
 	bool SetUpdatableScript(const char* scriptFile, const char* updateFunctionName, const char* exitFunctionName);
@@ -96,14 +141,34 @@ class LuaManagerImpl
 	lua_State*  m_SyncLuaState;
 	lua_State*  m_AsyncLuaStates[MAX_LUA_WORKERS];
 	Mutex       m_AsyncLuaStatesMutex[MAX_LUA_WORKERS];
-	Mutex       m_AddAsyncScriptMutex;
-
-	eastl::vector<ILuaFunctionWrap*> m_Functions;
-	eastl::string                    m_UpdateFunctonName;
-	const char*                      m_UpdatableScriptFile;
-	eastl::string                    m_UpdatableScriptExitName;
-
-	uint32_t m_AsyncScriptsCounter;
+	//"async N", the names of the async states in GetMemoryStats
+	char        m_AsyncLuaStateNames[MAX_LUA_WORKERS][16];
+
+	//Scripts wait in m_PendingScripts, each free async state drains the queue in one thread system task.
+	//This keeps the tasks queued in the thread system below MAX_LUA_WORKERS whatever the number of scripts
+	ThreadSystem*                 m_AsyncThreadSystem;
+	Mutex                         m_AddAsyncScriptMutex;
+	ConditionVariable             m_AsyncScriptsIdleCond;
+	eastl::deque<ScriptTaskInfo*> m_PendingScripts;
+	uint32_t                      m_FreeAsyncLuaStates[MAX_LUA_WORKERS];
+	uint32_t                      m_FreeAsyncLuaStateCount;
+
+	//Finished scripts whose callbacks were not dispatched yet
+	Mutex                          m_FinishedScriptsMutex;
+	eastl::vector<ScriptTaskInfo*> m_FinishedScripts;
+
+	eastl::vector<ILuaFunctionWrap*>     m_Functions;
+	eastl::vector<LuaNativeFunctionInfo> m_NativeFunctions;
+	eastl::string                        m_UpdateFunctonName;
+	const char*                          m_UpdatableScriptFile;
+	eastl::string                        m_UpdatableScriptExitName;
+	bool                                 m_PreferBytecode;
+	int                                  m_GCPause;
+	int                                  m_GCStepMultiplier;
+	LuaGarbageCollectorMode              m_GCMode;
+	int64_t                              m_GCFrameBudgetUs;
+	LuaGarbageCollectorState             m_SyncGC;
+	LuaGarbageCollectorState             m_UpdatableGC;
 
 	void       Register();
 	void       RegisterLuaManagerForLuaState(lua_State* state);
@@ -111,7 +176,14 @@ class LuaManagerImpl
 	lua_State* CreateLuaState();
 	void       DestroyLuaState(lua_State* state);
 	void       RegisterFunctionsForState(lua_State* state);
+	void       ApplyGarbageCollectorMode(lua_State* state, LuaGarbageCollectorState& gc);
+	void       StepGarbageCollector(lua_State* state, LuaGarbageCollectorState& gc, int64_t endUs);
 	void       ExitScript(lua_State* state, const char* exitFunctionName);
+	void       QueueAsyncScript(const char* scriptFile, ScriptDoneCallback callback, IScriptCallbackWrap* callbackLambda);
+	void       WaitForAsyncScriptsIdle();
+	void       ReleaseScriptTaskInfo(ScriptTaskInfo* info);
+
+	static void AsyncScriptTask(void* pUser, uintptr_t stateIndex);
 
 	LuaManagerImpl(lua_State* L);
 	static const char                         className[];
@@ -249,6 +249,20 @@ class Luna
 		lua_settop(L, top);
 	}
 
+	//Registers a C function called directly by Lua, pUserData is its first upvalue
+	static void RegisterFunction(lua_State* L, const char* functionName, lua_CFunction function, void* pUserData)
+	{
+		int top = lua_gettop(L);
+		luaL_getmetatable(L, T::className);
+		int metatable = lua_gettop(L);
+
+		lua_pushstring(L, functionName);
+		lua_pushlightuserdata(L, pUserData);
+		lua_pushcclosure(L, function, 1);    // property_getter returns non-index values as is
+		lua_settable(L, metatable);
+		lua_settop(L, top);
+	}
+
 	/*
 	@ constructor (internal)
 	Arguments: